@@ -1,3 +1,4 @@
+#include <chrono>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -19,21 +20,22 @@ struct BenchResult {
   double gbytes_s; // rough effective GB/s
 };
 
+template <typename T>
 static inline double estimate_bytes(std::size_t m, std::size_t n) {
-  const double bytes_W = 4.0 * double(m) * double(n);
-  const double bytes_x = 4.0 * double(n);
-  const double bytes_b = 4.0 * double(m);
-  const double bytes_y = 4.0 * double(m);
+  const double bytes_W = sizeof(T) * double(m) * double(n);
+  const double bytes_x = sizeof(T) * double(n);
+  const double bytes_b = sizeof(T) * double(m);
+  const double bytes_y = sizeof(T) * double(m);
   return bytes_W + bytes_x + bytes_b + bytes_y;
 }
 
-BenchResult
-bench_kernel(void (*kernel)(const float *, const float *, const float *,
-                            float *, std::size_t, std::size_t),
-             const char *name, const std::vector<float> &W,
-             const std::vector<float> &x, const std::vector<float> &b,
-             std::vector<float> &y, std::size_t m, std::size_t n,
-             int warmup_runs = 2, int trials = 5) {
+template <typename T>
+BenchResult bench_kernel(void (*kernel)(const T *, const T *, const T *, T *,
+                                        std::size_t, std::size_t),
+                         const char *name, const std::vector<T> &W,
+                         const std::vector<T> &x, const std::vector<T> &b,
+                         std::vector<T> &y, std::size_t m, std::size_t n,
+                         int warmup_runs = 2, int trials = 5) {
   // Warm-ups
   for (int w = 0; w < warmup_runs; ++w) {
     kernel(W.data(), x.data(), b.empty() ? nullptr : b.data(), y.data(), m, n);
@@ -52,10 +54,10 @@ bench_kernel(void (*kernel)(const float *, const float *, const float *,
   const double seconds = best_ms / 1000.0;
   const double gflops = (flops / seconds) / 1e9;
 
-  const double bytes = estimate_bytes(m, n);
+  const double bytes = estimate_bytes<T>(m, n);
   const double gbytes_s = (bytes / seconds) / 1e9;
 
-  volatile float sink = 0.0f;
+  volatile T sink = T{0};
   for (std::size_t i = 0; i < m; ++i)
     sink += y[i];
   (void)sink;
@@ -67,6 +69,28 @@ bench_kernel(void (*kernel)(const float *, const float *, const float *,
   return BenchResult{best_ms, gflops, gbytes_s};
 }
 
+// STREAM triad a = b + s * c over arrays well past the last level cache :
+// the sustainable bandwidth a GEMV on a large W can hope for.
+static double stream_triad_gbytes_s(std::size_t len = std::size_t{1} << 24,
+                                    int trials = 5) {
+  std::vector<float> a(len, 0.0f), b(len, 1.0f), c(len, 2.0f);
+  const float s = 3.0f;
+
+  double best_ms = 1e100;
+  for (int t = 0; t < trials; ++t) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < len; ++i)
+      a[i] = b[i] + s * c[i];
+    auto t1 = std::chrono::steady_clock::now();
+    best_ms = std::min(
+        best_ms, std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+
+  volatile float sink = a[len / 2];
+  (void)sink;
+  return (3.0 * sizeof(float) * double(len)) / (best_ms / 1000.0) / 1e9;
+}
+
 int main(int argc, char **argv) {
 
   std::size_t m = 2048, n = 2048;
@@ -75,7 +99,8 @@ int main(int argc, char **argv) {
     n = static_cast<std::size_t>(std::stoull(argv[2]));
   }
 
-  std::cout << "Matrix-Vector benchmark (m=" << m << ", n=" << n << ")\n";
+  std::cout << "Matrix-Vector benchmark (m=" << m << ", n=" << n
+            << ", blas=" << blas_backend() << ")\n";
 
   std::vector<float> W(m * n), x(n), b(m), y_scalar(m), y_blas(m);
 
@@ -99,14 +124,40 @@ int main(int argc, char **argv) {
     }
   }
 
+  const double triad = stream_triad_gbytes_s();
+  std::cout << std::fixed << std::setprecision(3)
+            << "STREAM triad reference: " << triad << " GB/s\n";
+
   // Benchmarks
+  using torchlet::core::CpuCapability;
+  const CpuCapability max_cap = torchlet::core::max_cpu_capability();
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
   auto r_scalar = bench_kernel(mvb_kernel, "Scalar", W, x, b, y_scalar, m, n);
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > max_cap)
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    std::string name = torchlet::core::to_string(cap);
+    name.resize(6, ' ');
+    auto r = bench_kernel(mvb_kernel, name.c_str(), W, x, b, y_scalar, m, n);
+    std::cout << std::setprecision(1) << "        "
+              << 100.0 * r.gbytes_s / triad << "% of triad\n";
+  }
+  torchlet::core::set_cpu_capability(max_cap);
+
   auto r_blas = bench_kernel(mvb_blas_kernel, "BLAS  ", W, x, b, y_blas, m, n);
 
+  std::vector<double> Wd(W.begin(), W.end()), xd(x.begin(), x.end()),
+      bd(b.begin(), b.end()), yd(m);
+  bench_kernel(mvb_kernel, "Double", Wd, xd, bd, yd, m, n);
+
   double speedup_blas = r_scalar.ms / r_blas.ms;
 
   std::cout << std::setprecision(2)
             << "Speedup (BLAS / Scalar): " << speedup_blas << "×\n";
 
   return 0;
-}
\ No newline at end of file
+}
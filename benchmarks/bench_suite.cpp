@@ -0,0 +1,566 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "harness.h"
+#include <torchlet/core/half.h>
+#include <torchlet/torchlet.h>
+
+// Benchmarks of the forward and GEMM kernels of kernel.h, the ops of
+// functional.h, the optimizers, the random fills and an MLP forward, across
+// sizes, dtypes and thread counts. The norm, loss, optimizer and random
+// kernels are timed through the ops that run them; the backward kernels of
+// the activations are not covered.
+//
+//   torchlet_bench_suite [--quick] [--filter <substring>] [--threads 1,4,8]
+//                        [--json <path>]
+//
+// Results go to stdout, and as JSON to <path> ("-" for stdout) to compare
+// runs across releases.
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::module::Linear,
+    torchlet::module::Sequential;
+
+namespace {
+
+template <typename T> const char *dtype_name() {
+  return sizeof(T) == 4 ? "float32" : "float64";
+};
+
+std::string dims(std::initializer_list<std::size_t> d) {
+  std::string s;
+  for (std::size_t v : d)
+    s += (s.empty() ? "" : "x") + std::to_string(v);
+  return s;
+};
+
+template <typename T> std::vector<T> random_vector(std::size_t n) {
+  static std::mt19937 engine{123};
+  std::uniform_real_distribution<T> dist{T{-1}, T{1}};
+  std::vector<T> v(n);
+  for (auto &x : v)
+    x = dist(engine);
+  return v;
+};
+
+Tensor random_tensor(const std::vector<std::size_t> &shape, Dtype dtype) {
+  Tensor t(shape, Dtype::Float32);
+  torchlet::ops::init::normal_(t, 0.0f, 1.0f);
+  return dtype == Dtype::Float32 ? t : t.to(dtype);
+};
+
+// Kernels : raw pointers, no tensor overhead.
+
+template <typename T>
+void kernel_cases(std::vector<bench::Case> &cases, bool quick) {
+  const double sz = sizeof(T);
+  const char *dt = dtype_name<T>();
+
+  for (std::size_t n : {std::size_t{1024}, std::size_t{4096}}) {
+    auto W = std::make_shared<std::vector<T>>(random_vector<T>(n * n));
+    auto x = std::make_shared<std::vector<T>>(random_vector<T>(n));
+    auto y = std::make_shared<std::vector<T>>(n);
+    cases.push_back({"kernel/mvb", dt, dims({n, n}), 2.0 * n * n,
+                     sz * (n * n + 3.0 * n), [=] {
+                       mvb_kernel(W->data(), x->data(), x->data(), y->data(),
+                                  n, n);
+                     }});
+    cases.push_back({"kernel/mvb_blas", dt, dims({n, n}), 2.0 * n * n,
+                     sz * (n * n + 3.0 * n), [=] {
+                       mvb_blas_kernel(W->data(), x->data(), x->data(),
+                                       y->data(), n, n);
+                     }});
+  }
+
+  std::vector<std::size_t> squares = {64, 256, 512};
+  if (!quick)
+    squares.push_back(1024);
+  for (std::size_t n : squares) {
+    auto A = std::make_shared<std::vector<T>>(random_vector<T>(n * n));
+    auto B = std::make_shared<std::vector<T>>(random_vector<T>(n * n));
+    auto b = std::make_shared<std::vector<T>>(random_vector<T>(n));
+    auto C = std::make_shared<std::vector<T>>(n * n);
+    const double flops = 2.0 * n * n * n, bytes = 3.0 * sz * n * n;
+    cases.push_back({"kernel/mm", dt, dims({n, n, n}), flops, bytes, [=] {
+                       mm_kernel(A->data(), B->data(), C->data(), n, n, n);
+                     }});
+    cases.push_back({"kernel/mmb_gelu", dt, dims({n, n, n}), flops, bytes,
+                     [=] {
+                       mmb_kernel(A->data(), B->data(), b->data(), C->data(),
+                                  n, n, n, Activation::GELU);
+                     }});
+    cases.push_back({"kernel/mmb_blas_gelu", dt, dims({n, n, n}), flops,
+                     bytes, [=] {
+                       mmb_blas_kernel(A->data(), B->data(), b->data(),
+                                       C->data(), n, n, n, Activation::GELU);
+                     }});
+    cases.push_back({"kernel/mm_strided_nt", dt, dims({n, n, n}), flops,
+                     bytes, [=] {
+                       mm_strided_kernel(A->data(), n, std::size_t{1},
+                                         B->data(), std::size_t{1}, n,
+                                         C->data(), n, n, n, n);
+                     }});
+  }
+
+  for (std::size_t n : {std::size_t{4096}, std::size_t{1} << 20}) {
+    auto a = std::make_shared<std::vector<T>>(random_vector<T>(n));
+    auto y = std::make_shared<std::vector<T>>(random_vector<T>(n));
+    const std::string shape = dims({n});
+    cases.push_back({"kernel/vadd", dt, shape, double(n), 3.0 * sz * n,
+                     [=] { vadd_kernel(a->data(), y->data(), n); }});
+    cases.push_back({"kernel/binary_mul", dt, shape, double(n), 3.0 * sz * n,
+                     [=] {
+                       binary_kernel(a->data(), 1, y->data(), 1, y->data(), n,
+                                     BinaryOp::Mul);
+                     }});
+    cases.push_back({"kernel/gelu", dt, shape, 0, 2.0 * sz * n,
+                     [=] { gelu_kernel(a->data(), y->data(), n); }});
+    cases.push_back({"kernel/relu", dt, shape, 0, 2.0 * sz * n,
+                     [=] { relu_kernel(a->data(), y->data(), n); }});
+    // in place on a fresh copy : repeated GELU drifts into denormals
+    cases.push_back({"kernel/activation_gelu", dt, shape, 0, 4.0 * sz * n,
+                     [=] {
+                       std::memcpy(y->data(), a->data(), n * sizeof(T));
+                       activation_kernel(y->data(), n, Activation::GELU);
+                     }});
+    cases.push_back({"kernel/softmax", dt, shape, 0, 2.0 * sz * n,
+                     [=] { softmax_kernel(a->data(), y->data(), n); }});
+    cases.push_back({"kernel/log_softmax", dt, shape, 0, 2.0 * sz * n,
+                     [=] { log_softmax_kernel(a->data(), y->data(), n); }});
+  }
+
+  for (bool causal : {false, true}) {
+    const std::size_t L = quick ? 256 : 1024, d = 64;
+    auto q = std::make_shared<std::vector<T>>(random_vector<T>(L * d));
+    auto k = std::make_shared<std::vector<T>>(random_vector<T>(L * d));
+    auto v = std::make_shared<std::vector<T>>(random_vector<T>(L * d));
+    auto o = std::make_shared<std::vector<T>>(L * d);
+    cases.push_back({causal ? "kernel/attention_causal" : "kernel/attention",
+                     dt, dims({L, L, d}),
+                     (causal ? 0.5 : 1.0) * 4.0 * L * L * d, 4.0 * sz * L * d,
+                     [=] {
+                       attention_kernel(q->data(), k->data(), v->data(),
+                                        o->data(), 0, L, L, d, d,
+                                        T(0.125), causal);
+                     }});
+  }
+};
+
+// Kernels with reduced or quantized operands, float accumulation.
+void mixed_kernel_cases(std::vector<bench::Case> &cases) {
+  using torchlet::core::BFloat16, torchlet::core::Half;
+  const std::size_t n = 4096;
+
+  auto x = std::make_shared<std::vector<float>>(random_vector<float>(n));
+  auto y = std::make_shared<std::vector<float>>(n);
+  auto Wf = random_vector<float>(n * n);
+  auto Wh = std::make_shared<std::vector<Half>>(Wf.begin(), Wf.end());
+  auto Wb = std::make_shared<std::vector<BFloat16>>(Wf.begin(), Wf.end());
+  cases.push_back({"kernel/mvb_mixed", "float16", dims({n, n}), 2.0 * n * n,
+                   2.0 * n * n, [=] {
+                     mvb_mixed_kernel(Wh->data(), x->data(), nullptr,
+                                      y->data(), n, n);
+                   }});
+  cases.push_back({"kernel/mvb_mixed", "bfloat16", dims({n, n}), 2.0 * n * n,
+                   2.0 * n * n, [=] {
+                     mvb_mixed_kernel(Wb->data(), x->data(), nullptr,
+                                      y->data(), n, n);
+                   }});
+  cases.push_back({"kernel/widen", "bfloat16", dims({n}), 0, 6.0 * n,
+                   [=] { widen_kernel(Wb->data(), y->data(), n); }});
+  cases.push_back({"kernel/narrow", "bfloat16", dims({n}), 0, 6.0 * n,
+                   [=] { narrow_kernel(x->data(), Wb->data(), n); }});
+
+  // int8 GEMM on a 64-row batch, per-row activation scales
+  const std::size_t M = 64, m = 1024, k = 1024;
+  auto xs = std::make_shared<std::vector<float>>(random_vector<float>(M * k));
+  auto Xq = std::make_shared<std::vector<std::int8_t>>(M * k);
+  auto x_scale = std::make_shared<std::vector<float>>(M);
+  auto x_sum = std::make_shared<std::vector<std::int32_t>>(M);
+  for (std::size_t i = 0; i < M; ++i)
+    quantize_row_kernel(xs->data() + i * k, Xq->data() + i * k, k,
+                        (*x_scale)[i], (*x_sum)[i]);
+  auto Wq = std::make_shared<std::vector<std::uint8_t>>(m * k, 64);
+  auto w_scale = std::make_shared<std::vector<float>>(m, 0.01f);
+  auto w_zp = std::make_shared<std::vector<std::int32_t>>(m, 64);
+  auto Y = std::make_shared<std::vector<float>>(M * m);
+  cases.push_back({"kernel/quantize_row", "float32", dims({M, k}), 0,
+                   5.0 * M * k, [=] {
+                     for (std::size_t i = 0; i < M; ++i)
+                       quantize_row_kernel(xs->data() + i * k,
+                                           Xq->data() + i * k, k,
+                                           (*x_scale)[i], (*x_sum)[i]);
+                   }});
+  cases.push_back({"kernel/qmmb", "uint8", dims({M, m, k}), 2.0 * M * m * k,
+                   double(m * k + M * k) + 4.0 * M * m, [=] {
+                     qmmb_kernel(Wq->data(), w_scale->data(), w_zp->data(),
+                                 Xq->data(), x_scale->data(), x_sum->data(),
+                                 nullptr, Y->data(), M, m, k, m);
+                   }});
+};
+
+// Ops : tensors in, preallocated out, so the op is timed without the
+// allocation of its result.
+void op_cases(std::vector<bench::Case> &cases, bool quick) {
+  namespace ops = torchlet::ops;
+
+  for (Dtype dtype : {Dtype::Float32, Dtype::Float64}) {
+    const char *dt = dtype == Dtype::Float32 ? "float32" : "float64";
+    const double sz = dtype == Dtype::Float32 ? 4 : 8;
+
+    for (std::size_t B : {std::size_t{1}, std::size_t{64}}) {
+      const std::size_t in = 1024, out = 1024;
+      auto x = std::make_shared<Tensor>(random_tensor({B, in}, dtype));
+      auto W = std::make_shared<Tensor>(random_tensor({out, in}, dtype));
+      auto b = std::make_shared<Tensor>(random_tensor({out}, dtype));
+      auto y = std::make_shared<Tensor>(std::vector<std::size_t>{B, out},
+                                        dtype);
+      const double flops = 2.0 * B * in * out;
+      const double bytes = sz * (B * in + in * out + out + B * out);
+      const std::string shape = dims({B, in, out});
+      cases.push_back({"op/linear", dt, shape, flops, bytes,
+                       [=] { ops::linear_out(*x, *W, *b, *y); }});
+      cases.push_back({"op/linear_gelu", dt, shape, flops, bytes,
+                       [=] { ops::linear_gelu_out(*x, *W, *b, *y); }});
+      cases.push_back({"op/linear_relu", dt, shape, flops, bytes,
+                       [=] { ops::linear_relu_out(*x, *W, *b, *y); }});
+      cases.push_back({"op/linear_bias_softmax", dt, shape, flops, bytes,
+                       [=] { ops::linear_bias_softmax_out(*x, *W, *b, *y); }});
+      // dropout in the GEMM epilogue against a second sweep; both allocate
+      cases.push_back({"op/linear_gelu_dropout", dt, shape, flops, bytes,
+                       [=] { ops::linear_gelu_dropout(*x, *W, *b, 0.1); }});
+      cases.push_back({"op/linear_gelu+dropout", dt, shape, flops, bytes, [=] {
+                         Tensor h = ops::linear_gelu(*x, *W, *b);
+                         ops::dropout_(h, 0.1);
+                       }});
+    }
+
+    {
+      // batched, b broadcast over the batch
+      const std::size_t Bt = 8, n = quick ? 128 : 256;
+      auto a = std::make_shared<Tensor>(random_tensor({Bt, n, n}, dtype));
+      auto b = std::make_shared<Tensor>(random_tensor({n, n}, dtype));
+      auto c = std::make_shared<Tensor>(std::vector<std::size_t>{Bt, n, n},
+                                        dtype);
+      cases.push_back({"op/matmul", dt, dims({Bt, n, n, n}),
+                       2.0 * Bt * n * n * n, sz * (2.0 * Bt * n * n + n * n),
+                       [=] { ops::matmul_out(*a, *b, *c); }});
+    }
+
+    {
+      const std::size_t B = 2, H = 8, L = quick ? 128 : 512, d = 64;
+      auto q = std::make_shared<Tensor>(random_tensor({B, H, L, d}, dtype));
+      auto k = std::make_shared<Tensor>(random_tensor({B, H, L, d}, dtype));
+      auto v = std::make_shared<Tensor>(random_tensor({B, H, L, d}, dtype));
+      auto o = std::make_shared<Tensor>(
+          std::vector<std::size_t>{B, H, L, d}, dtype);
+      cases.push_back({"op/attention_causal", dt, dims({B, H, L, d}),
+                       2.0 * B * H * L * L * d, 4.0 * sz * B * H * L * d, [=] {
+                         ops::scaled_dot_product_attention_out(*q, *k, *v, *o,
+                                                               true);
+                       }});
+    }
+
+    {
+      const std::size_t rows = 1024, cols = 1024;
+      auto x = std::make_shared<Tensor>(random_tensor({rows, cols}, dtype));
+      auto row = std::make_shared<Tensor>(random_tensor({cols}, dtype));
+      auto y = std::make_shared<Tensor>(
+          std::vector<std::size_t>{rows, cols}, dtype);
+      const double n = double(rows * cols);
+      const std::string shape = dims({rows, cols});
+      cases.push_back({"op/add", dt, shape, n, 3.0 * sz * n,
+                       [=] { ops::add_out(*x, *x, *y); }});
+      cases.push_back({"op/mul_broadcast_row", dt, shape, n, 2.0 * sz * n,
+                       [=] { ops::mul_out(*x, *row, *y); }});
+      cases.push_back({"op/sub", dt, shape, n, 3.0 * sz * n,
+                       [=] { ops::sub_out(*x, *x, *y); }});
+      cases.push_back({"op/div", dt, shape, n, 3.0 * sz * n,
+                       [=] { ops::div_out(*x, *row, *y); }});
+      cases.push_back({"op/maximum", dt, shape, n, 3.0 * sz * n,
+                       [=] { ops::maximum_out(*x, *x, *y); }});
+      cases.push_back({"op/gelu", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::gelu_out(*x, *y); }});
+      cases.push_back({"op/relu", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::relu_out(*x, *y); }});
+      cases.push_back({"op/softmax", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::softmax_out(*x, *y); }});
+      cases.push_back({"op/log_softmax", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::log_softmax_out(*x, *y); }});
+      auto ones = std::make_shared<Tensor>(Tensor::ones({cols}, dtype));
+      auto h = std::make_shared<Tensor>(
+          std::vector<std::size_t>{rows, cols}, dtype);
+      cases.push_back({"op/layer_norm", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::layer_norm_out(*x, *ones, *row, *y); }});
+      cases.push_back({"op/rms_norm", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::rms_norm_out(*x, *ones, *y); }});
+      // x + residual kept in h
+      cases.push_back({"op/residual_layer_norm", dt, shape, 0, 4.0 * sz * n,
+                       [=] {
+                         ops::residual_layer_norm_out(*x, *x, *ones, *row, *y,
+                                                      *h);
+                       }});
+      // strided rows : the transpose is gathered per row
+      auto xt = std::make_shared<Tensor>(x->permute(0, 1));
+      cases.push_back({"op/softmax_transposed", dt, shape, 0, 2.0 * sz * n,
+                       [=] { ops::softmax_out(*xt, *y); }});
+    }
+
+    // Large vocabulary loss : one read of the logits forward, one read and
+    // one write of their gradient backward.
+    {
+      const std::size_t rows = 64, cols = 50257;
+      auto logits =
+          std::make_shared<Tensor>(random_tensor({rows, cols}, dtype));
+      auto targets =
+          std::make_shared<Tensor>(Tensor::zeros({rows}, Dtype::Int64));
+      for (std::size_t r = 0; r < rows; ++r)
+        targets->data_ptr<std::int64_t>()[r] =
+            static_cast<std::int64_t>(r * 997 % cols);
+      auto loss = std::make_shared<Tensor>(std::vector<std::size_t>{1}, dtype);
+      const double n = double(rows * cols);
+      const std::string shape = dims({rows, cols});
+      cases.push_back({"op/cross_entropy", dt, shape, 0, sz * n, [=] {
+                         ops::cross_entropy_out(*logits, *targets, *loss);
+                       }});
+      auto train = std::make_shared<Tensor>(*logits);
+      train->requires_grad_();
+      cases.push_back({"op/cross_entropy_backward", dt, shape, 0, 3.0 * sz * n,
+                       [=] {
+                         train->zero_grad();
+                         torchlet::core::backward(
+                             ops::cross_entropy(*train, *targets));
+                       }});
+    }
+  }
+
+  // reduced precision weights and int8 weights, float activations
+  for (std::size_t B : {std::size_t{1}, std::size_t{64}}) {
+    const std::size_t in = 1024, out = 1024;
+    const double flops = 2.0 * B * in * out;
+    const std::string shape = dims({B, in, out});
+    auto x = std::make_shared<Tensor>(random_tensor({B, in}, Dtype::Float32));
+    auto y = std::make_shared<Tensor>(std::vector<std::size_t>{B, out},
+                                      Dtype::Float32);
+
+    for (Dtype wt : {Dtype::Float16, Dtype::BFloat16}) {
+      auto W = std::make_shared<Tensor>(random_tensor({out, in}, wt));
+      auto b = std::make_shared<Tensor>(random_tensor({out}, Dtype::Float32));
+      cases.push_back({"op/linear_mixed",
+                       wt == Dtype::Float16 ? "float16" : "bfloat16", shape,
+                       flops, 2.0 * in * out + 4.0 * B * (in + out),
+                       [=] { ops::linear_out(*x, *W, *b, *y); }});
+    }
+
+    auto q = std::make_shared<torchlet::module::QuantizedLinear>(
+        Linear(in, out, true, Dtype::Float32).quantize());
+    cases.push_back({"op/quantized_linear", "uint8", shape, flops,
+                     double(in * out) + 4.0 * B * (in + out),
+                     [=] { q->forward_out(*x, *y); }});
+  }
+};
+
+// End to end : the MLP of main.cpp at a size worth timing, planned once.
+void mlp_cases(std::vector<bench::Case> &cases) {
+  const std::size_t in = 784, hidden = 1024, out = 10, n_layer = 4;
+
+  for (Dtype dtype : {Dtype::Float32, Dtype::Float64})
+    for (std::size_t B : {std::size_t{1}, std::size_t{64}}) {
+      auto nn = std::make_shared<Sequential>();
+      nn->add(Linear(in, hidden, false, dtype)).add(Activation::GELU);
+      for (std::size_t k = 0; k + 2 < n_layer; ++k)
+        nn->add(Linear(hidden, hidden, false, dtype)).add(Activation::GELU);
+      nn->add(Linear(hidden, out, false, dtype)).add(Activation::Softmax);
+
+      auto x = std::make_shared<Tensor>(random_tensor({B, in}, dtype));
+      auto y = std::make_shared<Tensor>(std::vector<std::size_t>{B, out},
+                                        dtype);
+      const double macs =
+          double(in * hidden + (n_layer - 2) * hidden * hidden + hidden * out);
+      const double sz = dtype == Dtype::Float32 ? 4 : 8;
+      cases.push_back({"e2e/mlp_forward",
+                       dtype == Dtype::Float32 ? "float32" : "float64",
+                       dims({B, in, hidden, out}), 2.0 * B * macs, sz * macs,
+                       [=] { nn->forward_out(*x, *y); }});
+
+      // Training step : recorded forward and backward, about three times
+      // the forward flops. x takes no gradient.
+      if (B == 1)
+        continue;
+      auto train = std::make_shared<Sequential>(*nn);
+      train->requires_grad_();
+      auto seed = std::make_shared<Tensor>(random_tensor({B, out}, dtype));
+      cases.push_back({"e2e/mlp_forward_backward",
+                       dtype == Dtype::Float32 ? "float32" : "float64",
+                       dims({B, in, hidden, out}), 6.0 * B * macs, 0,
+                       [=] {
+                         for (Tensor &p : train->parameters())
+                           p.zero_grad();
+                         torchlet::core::backward(train->forward(*x), *seed);
+                       }});
+    }
+};
+
+// Optimizer steps over many small layers, from fixed gradients. The per
+// tensor Adam, one optimizer per parameter, is the loop the fused pass
+// replaces.
+void optim_cases(std::vector<bench::Case> &cases) {
+  const std::size_t n_layer = 256, width = 64;
+  const Dtype dtype = Dtype::Float32;
+
+  auto params = std::make_shared<std::vector<Tensor>>();
+  auto grads = std::make_shared<std::vector<Tensor>>();
+  for (std::size_t k = 0; k < n_layer; ++k)
+    for (const Tensor &p : Linear(width, width, true, dtype).parameters()) {
+      params->push_back(p);
+      grads->push_back(random_tensor(p.shape(), dtype));
+    }
+  const double n = double(n_layer * (width * width + width));
+  const std::string shape = dims({n_layer, width, width});
+
+  auto sgd = std::make_shared<torchlet::optim::SGD>(*params, 1e-3, 0.9);
+  cases.push_back({"optim/sgd_momentum", "float32", shape, 0, 4.0 * 5 * n,
+                   [=] { sgd->step(*grads); }});
+  auto adam = std::make_shared<torchlet::optim::AdamW>(*params);
+  cases.push_back({"optim/adamw", "float32", shape, 0, 4.0 * 7 * n,
+                   [=] { adam->step(*grads); }});
+
+  auto per_tensor =
+      std::make_shared<std::vector<std::unique_ptr<torchlet::optim::AdamW>>>();
+  for (const Tensor &p : *params)
+    per_tensor->push_back(
+        std::make_unique<torchlet::optim::AdamW>(std::vector<Tensor>{p}));
+  cases.push_back({"optim/adamw_per_tensor", "float32", shape, 0, 4.0 * 7 * n,
+                   [=] {
+                     for (std::size_t k = 0; k < params->size(); ++k)
+                       (*per_tensor)[k]->step({(*grads)[k]});
+                   }});
+};
+
+// Random fills of a large tensor, chunked across threads on the counter
+// based generator.
+void init_cases(std::vector<bench::Case> &cases) {
+  const std::size_t n = std::size_t{1} << 22;
+  auto gen = std::make_shared<torchlet::core::Generator>(1u);
+  for (Dtype dtype : {Dtype::Float32, Dtype::Float64}) {
+    auto t = std::make_shared<Tensor>(std::vector<std::size_t>{n}, dtype);
+    const bool f32 = dtype == Dtype::Float32;
+    const double bytes = (f32 ? 4.0 : 8.0) * n;
+    const char *dt = f32 ? "float32" : "float64";
+    cases.push_back({"init/normal", dt, dims({n}), 0, bytes, [=] {
+                       if (f32)
+                         torchlet::ops::init::normal_(*t, 0.0f, 1.0f, *gen);
+                       else
+                         torchlet::ops::init::normal_(*t, 0.0, 1.0, *gen);
+                     }});
+    cases.push_back({"init/uniform", dt, dims({n}), 0, bytes, [=] {
+                       if (f32)
+                         torchlet::ops::init::uniform_(*t, -1.0f, 1.0f, *gen);
+                       else
+                         torchlet::ops::init::uniform_(*t, -1.0, 1.0, *gen);
+                     }});
+  }
+};
+
+std::vector<std::size_t> parse_list(const char *s) {
+  std::vector<std::size_t> v;
+  for (const char *p = s; *p;) {
+    v.push_back(std::strtoull(p, nullptr, 10));
+    p = std::strchr(p, ',');
+    if (!p)
+      break;
+    ++p;
+  }
+  return v;
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool quick = false;
+  std::string filter, json_path;
+  std::vector<std::size_t> threads = {1};
+  const std::size_t hw =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  if (hw > 1)
+    threads.push_back(hw);
+
+  for (int a = 1; a < argc; ++a) {
+    const std::string arg = argv[a];
+    if (arg == "--quick") {
+      quick = true;
+    } else if (arg == "--filter" && a + 1 < argc) {
+      filter = argv[++a];
+    } else if (arg == "--threads" && a + 1 < argc) {
+      threads = parse_list(argv[++a]);
+    } else if (arg == "--json" && a + 1 < argc) {
+      json_path = argv[++a];
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--quick] [--filter <substring>] "
+                   "[--threads 1,4,...] [--json <path>|-]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  bench::Config cfg;
+  if (quick) {
+    cfg.warmup_s = 0.01;
+    cfg.budget_s = 0.05;
+    cfg.min_samples = 5;
+  }
+
+  std::vector<bench::Case> cases;
+  kernel_cases<float>(cases, quick);
+  kernel_cases<double>(cases, quick);
+  mixed_kernel_cases(cases);
+  op_cases(cases, quick);
+  mlp_cases(cases);
+  optim_cases(cases);
+  init_cases(cases);
+
+  // with --json - the table goes to stderr, stdout is the JSON alone
+  std::FILE *log = json_path == "-" ? stderr : stdout;
+  std::fprintf(log, "torchlet benchmarks : blas=%s cpu=%s\n", blas_backend(),
+               torchlet::core::to_string(torchlet::core::cpu_capability()));
+
+  std::vector<bench::Result> results;
+  const std::size_t saved = torchlet::get_num_threads();
+  for (std::size_t t : threads) {
+    if (t == 0)
+      continue;
+    torchlet::set_num_threads(t);
+    for (const bench::Case &c : cases) {
+      if (!filter.empty() && c.name.find(filter) == std::string::npos)
+        continue;
+      results.push_back(bench::run(c, t, cfg));
+      bench::print(log, results.back());
+    }
+  }
+  torchlet::set_num_threads(saved);
+
+  if (!json_path.empty()) {
+    std::FILE *f =
+        json_path == "-" ? stdout : std::fopen(json_path.c_str(), "w");
+    if (!f) {
+      std::fprintf(stderr, "cannot write %s\n", json_path.c_str());
+      return 1;
+    }
+    bench::write_json(
+        f,
+        {{"blas", blas_backend()},
+         {"cpu_capability",
+          torchlet::core::to_string(torchlet::core::cpu_capability())},
+         {"hardware_concurrency", std::to_string(hw)},
+         {"quick", quick ? "true" : "false"}},
+        results);
+    if (f != stdout)
+      std::fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/// @brief How long each case runs : warmup, then samples until both the
+/// time budget and the minimum sample count are reached.
+struct Config {
+  double warmup_s = 0.05;
+  double budget_s = 0.25;
+  std::size_t min_samples = 10;
+  std::size_t max_samples = 1000;
+};
+
+/// @brief Work of one call : flops and bytes moved are 0 when meaningless.
+struct Case {
+  std::string name;  // "kernel/mmb", "op/linear", "e2e/mlp"
+  std::string dtype; // "float32", ...
+  std::string shape; // free form, "512x512x512"
+  double flops = 0;
+  double bytes = 0;
+  std::function<void()> fn;
+};
+
+struct Result {
+  std::string name, dtype, shape;
+  std::size_t threads = 1;
+  std::size_t samples = 0;
+  std::size_t reps = 1; // calls per sample
+  double median_ns = 0, p99_ns = 0, min_ns = 0;
+  double gflops = 0, gbytes_s = 0;
+};
+
+/// @brief Time c.fn. Short calls are repeated within a sample so that each
+/// one lasts at least ~10 us, well above the clock resolution; reported
+/// times are per call.
+inline Result run(const Case &c, std::size_t threads, const Config &cfg) {
+  using clock = std::chrono::steady_clock;
+  auto seconds = [](clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+  };
+
+  // warmup : caches, page faults, allocator pools, thread pool start up
+  std::size_t calls = 0;
+  const auto w0 = clock::now();
+  do {
+    c.fn();
+    ++calls;
+  } while (seconds(clock::now() - w0) < cfg.warmup_s || calls < 2);
+  const double per_call = seconds(clock::now() - w0) / double(calls);
+  const std::size_t reps =
+      std::max<std::size_t>(1, static_cast<std::size_t>(10e-6 / per_call));
+
+  std::vector<double> ns;
+  const auto t0 = clock::now();
+  while (ns.size() < cfg.max_samples &&
+         (ns.size() < cfg.min_samples ||
+          seconds(clock::now() - t0) < cfg.budget_s)) {
+    const auto s0 = clock::now();
+    for (std::size_t r = 0; r < reps; ++r)
+      c.fn();
+    ns.push_back(seconds(clock::now() - s0) * 1e9 / double(reps));
+  }
+  std::sort(ns.begin(), ns.end());
+
+  Result r;
+  r.name = c.name;
+  r.dtype = c.dtype;
+  r.shape = c.shape;
+  r.threads = threads;
+  r.samples = ns.size();
+  r.reps = reps;
+  r.median_ns = ns.size() % 2 ? ns[ns.size() / 2]
+                              : 0.5 * (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]);
+  r.p99_ns = ns[static_cast<std::size_t>(
+                    std::ceil(0.99 * double(ns.size()))) -
+                1];
+  r.min_ns = ns.front();
+  r.gflops = c.flops / r.median_ns;
+  r.gbytes_s = c.bytes / r.median_ns;
+  return r;
+};
+
+inline std::string json_escape(const std::string &s) {
+  std::string out;
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\')
+      out += '\\';
+    out += ch;
+  }
+  return out;
+};
+
+/// @brief {"context": {...}, "benchmarks": [...]}, context values are
+/// strings. Rates are null for cases without a flop or byte count.
+inline void write_json(
+    std::FILE *f, const std::vector<std::pair<std::string, std::string>> &ctx,
+    const std::vector<Result> &results) {
+  std::fprintf(f, "{\n  \"context\": {");
+  for (std::size_t k = 0; k < ctx.size(); ++k)
+    std::fprintf(f, "%s\n    \"%s\": \"%s\"", k ? "," : "",
+                 json_escape(ctx[k].first).c_str(),
+                 json_escape(ctx[k].second).c_str());
+  std::fprintf(f, "\n  },\n  \"benchmarks\": [");
+
+  auto rate = [](double v) {
+    char buf[32];
+    if (v > 0)
+      std::snprintf(buf, sizeof(buf), "%.4f", v);
+    else
+      std::snprintf(buf, sizeof(buf), "null");
+    return std::string(buf);
+  };
+  for (std::size_t k = 0; k < results.size(); ++k) {
+    const Result &r = results[k];
+    std::fprintf(f,
+                 "%s\n    {\"name\": \"%s\", \"dtype\": \"%s\", \"shape\": "
+                 "\"%s\", \"threads\": %zu, \"samples\": %zu, \"reps\": %zu, "
+                 "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, "
+                 "\"gflops\": %s, \"gbytes_s\": %s}",
+                 k ? "," : "", json_escape(r.name).c_str(),
+                 json_escape(r.dtype).c_str(), json_escape(r.shape).c_str(),
+                 r.threads, r.samples, r.reps, r.median_ns, r.p99_ns, r.min_ns,
+                 rate(r.gflops).c_str(), rate(r.gbytes_s).c_str());
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+};
+
+/// @brief One line per result, for humans.
+inline void print(std::FILE *f, const Result &r) {
+  std::fprintf(f, "%-28s %-8s %-18s t=%-3zu median %11.1f us  p99 %11.1f us",
+               r.name.c_str(), r.dtype.c_str(), r.shape.c_str(), r.threads,
+               r.median_ns * 1e-3, r.p99_ns * 1e-3);
+  if (r.gflops > 0)
+    std::fprintf(f, "  %8.2f GFLOP/s", r.gflops);
+  if (r.gbytes_s > 0)
+    std::fprintf(f, "  %8.2f GB/s", r.gbytes_s);
+  std::fprintf(f, "\n");
+};
+
+} // namespace bench
@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace torchlet::core {
+
+/// @brief Alignment of every buffer handed out by the torchlet allocators,
+/// one cache line / one AVX-512 register.
+inline constexpr std::size_t ALIGNMENT = 64;
+
+class Allocator {
+public:
+  virtual ~Allocator() = default;
+
+  /// @brief ALIGNMENT aligned buffer of at least nbytes bytes.
+  virtual void *allocate(std::size_t nbytes) = 0;
+  /// @brief Release a buffer, nbytes as passed to allocate.
+  virtual void deallocate(void *ptr, std::size_t nbytes) noexcept = 0;
+};
+
+/// @brief Straight aligned_alloc / free, no caching.
+class AlignedAllocator : public Allocator {
+public:
+  void *allocate(std::size_t nbytes) override;
+  void deallocate(void *ptr, std::size_t nbytes) noexcept override;
+};
+
+/// @brief Keeps freed blocks in per size-class free lists and hands them
+/// back to later requests of the same class. Classes are 64-byte steps up
+/// to 256 bytes, then four steps per power of two (<= 25% slack).
+class CachingAllocator : public Allocator {
+public:
+  struct Stats {
+    std::size_t allocated_bytes = 0; // held by live buffers
+    std::size_t cached_bytes = 0;    // sitting in the free lists
+    std::size_t n_fresh = 0;         // requests that went to the system
+    std::size_t n_reused = 0;        // requests served from the cache
+  };
+
+  ~CachingAllocator() override;
+
+  void *allocate(std::size_t nbytes) override;
+  void deallocate(void *ptr, std::size_t nbytes) noexcept override;
+
+  /// @brief Return every cached block to the system.
+  void empty_cache() noexcept;
+  Stats stats() const;
+
+  static std::size_t round_size(std::size_t nbytes) noexcept;
+
+private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::size_t, std::vector<void *>> m_free;
+  Stats m_stats;
+};
+
+/// @brief Bump allocator for inference : every intermediate of a forward
+/// pass is carved out of a few large blocks and released at once by
+/// reset(). The arena must outlive the tensors allocated from it.
+class Arena : public Allocator {
+public:
+  explicit Arena(std::size_t block_size = std::size_t{1} << 22);
+  ~Arena() override;
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(std::size_t nbytes) override;
+  /// Only tracks liveness, memory comes back on reset().
+  void deallocate(void *ptr, std::size_t nbytes) noexcept override;
+
+  /// @brief Rewind to the first block, keeping all blocks for reuse.
+  /// Throws std::runtime_error if buffers from this arena are still alive.
+  void reset();
+
+  std::size_t live() const noexcept { return m_live.load(); };
+  std::size_t capacity() const noexcept;
+
+private:
+  struct Block {
+    std::byte *data;
+    std::size_t size;
+  };
+
+  std::size_t m_block_size;
+  std::vector<Block> m_blocks;
+  std::size_t m_block = 0;  // block being bumped
+  std::size_t m_offset = 0; // bytes used in it
+  std::atomic<std::size_t> m_live{0};
+};
+
+/// @brief Routes the Tensor allocations of the calling thread to an arena
+/// for the guard's lifetime. Guards nest.
+class ArenaGuard {
+public:
+  explicit ArenaGuard(Arena &arena) noexcept;
+  ~ArenaGuard();
+
+  ArenaGuard(const ArenaGuard &) = delete;
+  ArenaGuard &operator=(const ArenaGuard &) = delete;
+
+private:
+  Allocator *m_prev;
+};
+
+CachingAllocator &caching_allocator() noexcept;
+
+/// @brief Allocator new tensors get : the innermost ArenaGuard of this
+/// thread if any, else the global default (caching_allocator() initially).
+Allocator *get_allocator() noexcept;
+void set_allocator(Allocator *alloc) noexcept;
+
+} // namespace torchlet::core
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+
+#include <torchlet/core/tensor.h>
+
+// Tape-based reverse mode autograd. The allocating ops of functional.h
+// (linear and its fused variants, gelu, relu, softmax, log_softmax) append
+// a Node to a per-thread tape when one of their inputs requires grad;
+// backward() replays the tape in reverse. out= and in-place variants are
+// not recorded, and a view (permute, view, index) does not track the
+// gradient of the tensor it views. Tensors an op saved for backward must
+// not be modified in place before it runs.
+
+namespace torchlet::core {
+
+/// @brief Gradient state of a tensor, shared by the handles copied from it
+/// once requires_grad_ was set.
+struct AutogradMeta {
+  bool requires_grad = false;
+  bool is_leaf = true; // set by the user, not produced by a recorded op
+  Tensor grad;         // empty until a gradient reaches the tensor
+};
+
+/// @brief A recorded op. backward receives the gradient of its output and
+/// accumulates those of its inputs, see grad_buffer.
+class Node {
+public:
+  virtual ~Node() = default;
+  virtual const char *name() const noexcept = 0;
+  /// @param grad dense, of the output's shape; the node may overwrite it
+  virtual void backward(Tensor &grad) = 0;
+
+private:
+  friend void record(std::shared_ptr<Node> node, Tensor &output);
+  friend void backward(const Tensor &output, const Tensor &grad);
+  std::shared_ptr<AutogradMeta> m_output;
+};
+
+/// @brief Whether ops are recorded on this thread, true by default.
+bool grad_enabled() noexcept;
+
+/// @brief Disables recording on this thread for its lifetime : inference
+/// with trainable parameters leaves nothing on the tape.
+class NoGradGuard {
+public:
+  NoGradGuard();
+  ~NoGradGuard();
+  NoGradGuard(const NoGradGuard &) = delete;
+  NoGradGuard &operator=(const NoGradGuard &) = delete;
+
+private:
+  bool m_prev;
+};
+
+/// @brief True if recording is enabled and one of the tensors requires
+/// grad, empty tensors skipped.
+bool needs_grad(std::initializer_list<const Tensor *> tensors) noexcept;
+
+/// @brief Append node, which produced output, to the tape. output then
+/// requires grad. Throws std::runtime_error unless it is Float32 or Float64.
+void record(std::shared_ptr<Node> node, Tensor &output);
+
+/// @brief Run the tape backward from output, seeded with grad (ones when
+/// empty, output must then have one element). Gradients accumulate into
+/// the grad() of the leaves; those of intermediates are freed as soon as
+/// their node ran. The nodes reached from output leave the tape, the others
+/// stay for a later backward while their output can still be reached.
+/// Throws std::runtime_error if output does not require grad, or if it was
+/// produced by a node no longer on the tape.
+void backward(const Tensor &output, const Tensor &grad = Tensor());
+
+/// @brief Drop the recorded nodes, and the tensors they saved.
+void clear_tape() noexcept;
+std::size_t tape_size() noexcept;
+
+/// @brief For Node::backward : the gradient buffer of t, dense of t's
+/// shape, allocated on first use. fresh is then set and the caller must
+/// overwrite the buffer instead of accumulating into it. nullptr if t does
+/// not require grad.
+/// @param donor a dense tensor of t's shape and dtype the caller is done
+/// with (the gradient it received) : a fresh buffer takes its memory
+/// instead of allocating
+Tensor *grad_buffer(const Tensor &t, bool &fresh, Tensor *donor = nullptr);
+
+} // namespace torchlet::core
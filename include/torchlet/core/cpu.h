@@ -0,0 +1,23 @@
+#pragma once
+
+namespace torchlet::core {
+
+/// @brief Instruction sets the float kernels have been specialised for.
+/// Ordered : a capability implies all the ones before it.
+enum class CpuCapability { Default, SSE4, AVX2, AVX512 };
+
+/// @brief Best capability supported by both this build and the host CPU.
+CpuCapability max_cpu_capability() noexcept;
+
+/// @brief Capability the kernels currently dispatch to.
+/// Starts at max_cpu_capability(), capped by TORCHLET_CPU_CAPABILITY
+/// (default | sse4 | avx2 | avx512) when set.
+CpuCapability cpu_capability() noexcept;
+
+/// @brief Force the kernels onto a given capability (tests, benchmarks).
+/// Throws std::invalid_argument if the host does not support it.
+void set_cpu_capability(CpuCapability cap);
+
+const char *to_string(CpuCapability cap) noexcept;
+
+} // namespace torchlet::core
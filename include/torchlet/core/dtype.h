@@ -1,8 +1,20 @@
 #pragma once
 #include <cstdint>
 
+#include <torchlet/core/half.h>
+
 namespace torchlet::core {
-enum class Dtype { Float32, Float64, Int32, Int64, UInt8, UInt32, UInt64 };
+enum class Dtype {
+  Float32,
+  Float64,
+  Int32,
+  Int64,
+  UInt8,
+  UInt32,
+  UInt64,
+  Float16,
+  BFloat16
+};
 };
 
 template <typename T> struct CPPTypeToDType;
@@ -13,6 +25,13 @@ template <> struct CPPTypeToDType<float> {
 template <> struct CPPTypeToDType<double> {
   static constexpr torchlet::core::Dtype dtype = torchlet::core::Dtype::Float64;
 };
+template <> struct CPPTypeToDType<torchlet::core::Half> {
+  static constexpr torchlet::core::Dtype dtype = torchlet::core::Dtype::Float16;
+};
+template <> struct CPPTypeToDType<torchlet::core::BFloat16> {
+  static constexpr torchlet::core::Dtype dtype =
+      torchlet::core::Dtype::BFloat16;
+};
 template <> struct CPPTypeToDType<std::int32_t> {
   static constexpr torchlet::core::Dtype dtype = torchlet::core::Dtype::Int32;
 };
@@ -39,6 +58,21 @@ template <> struct CPPTypeToDType<std::uint64_t> {
     using NAME = double;                                                       \
     BODY                                                                       \
   } break;                                                                     \
+  default:                                                                     \
+    throw std::runtime_error("Unsupported dtype");                             \
+  }
+
+#define DISPATCH_REDUCED(dtype, NAME, BODY)                                    \
+  switch (dtype) {                                                             \
+  case torchlet::core::Dtype::Float16: {                                       \
+    using NAME = torchlet::core::Half;                                         \
+    BODY                                                                       \
+  } break;                                                                     \
+  case torchlet::core::Dtype::BFloat16: {                                      \
+    using NAME = torchlet::core::BFloat16;                                     \
+    BODY                                                                       \
+  } break;                                                                     \
+  default:                                                                     \
     throw std::runtime_error("Unsupported dtype");                             \
   }
 
@@ -72,5 +106,14 @@ template <> struct CPPTypeToDType<std::uint64_t> {
     using NAME = std::uint8_t;                                                 \
     BODY                                                                       \
   } break;                                                                     \
+  case torchlet::core::Dtype::Float16: {                                       \
+    using NAME = torchlet::core::Half;                                         \
+    BODY                                                                       \
+  } break;                                                                     \
+  case torchlet::core::Dtype::BFloat16: {                                      \
+    using NAME = torchlet::core::BFloat16;                                     \
+    BODY                                                                       \
+  } break;                                                                     \
+  default:                                                                     \
     throw std::runtime_error("Unsupported dtype");                             \
   }
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace torchlet::core {
+
+namespace detail {
+
+inline std::uint32_t float_bits(float f) noexcept {
+  std::uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return u;
+};
+
+inline float bits_float(std::uint32_t u) noexcept {
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+};
+
+/// IEEE binary16 to binary32, exact.
+inline float half_to_float(std::uint16_t h) noexcept {
+  const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+  const std::uint32_t exp = (h >> 10) & 0x1fu;
+  const std::uint32_t man = h & 0x3ffu;
+
+  if (exp == 0x1fu) // inf / nan
+    return bits_float(sign | 0x7f800000u | (man << 13));
+  if (exp != 0)
+    return bits_float(sign | ((exp + 112u) << 23) | (man << 13));
+  // zero or subnormal : man * 2^-24
+  const float mag = static_cast<float>(man) * 5.9604644775390625e-8f;
+  return sign ? -mag : mag;
+};
+
+/// binary32 to binary16, round to nearest even, overflow to inf.
+inline std::uint16_t float_to_half(float f) noexcept {
+  const std::uint32_t u = float_bits(f);
+  const std::uint16_t sign = static_cast<std::uint16_t>((u >> 16) & 0x8000u);
+  const std::uint32_t abs = u & 0x7fffffffu;
+
+  if (abs >= 0x7f800000u) // inf / nan, keep nan quiet
+    return static_cast<std::uint16_t>(sign | 0x7c00u |
+                                      (abs > 0x7f800000u ? 0x200u : 0u));
+  if (abs >= 0x477ff000u) // rounds above 65504
+    return static_cast<std::uint16_t>(sign | 0x7c00u);
+  if (abs < 0x38800000u) {
+    // subnormal half : adding 0.5 lets the FPU do the rounding
+    const float mag = bits_float(abs) + 0.5f;
+    return static_cast<std::uint16_t>(sign |
+                                      ((float_bits(mag) - 0x3f000000u)));
+  }
+  const std::uint32_t odd = (abs >> 13) & 1u;
+  return static_cast<std::uint16_t>(
+      sign | ((abs + 0xc8000fffu + odd) >> 13));
+};
+
+/// bfloat16 is the upper half of a binary32.
+inline float bfloat16_to_float(std::uint16_t b) noexcept {
+  return bits_float(static_cast<std::uint32_t>(b) << 16);
+};
+
+/// binary32 to bfloat16, round to nearest even.
+inline std::uint16_t float_to_bfloat16(float f) noexcept {
+  const std::uint32_t u = float_bits(f);
+  if ((u & 0x7fffffffu) > 0x7f800000u) // nan, keep it quiet
+    return static_cast<std::uint16_t>((u >> 16) | 0x40u);
+  const std::uint32_t odd = (u >> 16) & 1u;
+  return static_cast<std::uint16_t>((u + 0x7fffu + odd) >> 16);
+};
+
+} // namespace detail
+
+/// @brief IEEE half precision storage type. Arithmetic goes through float :
+/// values widen implicitly and narrow back on construction.
+struct Half {
+  std::uint16_t bits = 0;
+
+  Half() = default;
+  Half(float f) noexcept : bits(detail::float_to_half(f)) {};
+  operator float() const noexcept { return detail::half_to_float(bits); };
+
+  static Half from_bits(std::uint16_t b) noexcept {
+    Half h;
+    h.bits = b;
+    return h;
+  };
+};
+
+/// @brief bfloat16 storage type : float's exponent range with an 8 bit
+/// mantissa. Same conversion rules as Half.
+struct BFloat16 {
+  std::uint16_t bits = 0;
+
+  BFloat16() = default;
+  BFloat16(float f) noexcept : bits(detail::float_to_bfloat16(f)) {};
+  operator float() const noexcept { return detail::bfloat16_to_float(bits); };
+
+  static BFloat16 from_bits(std::uint16_t b) noexcept {
+    BFloat16 h;
+    h.bits = b;
+    return h;
+  };
+};
+
+static_assert(sizeof(Half) == 2 && sizeof(BFloat16) == 2);
+
+template <typename T>
+inline constexpr bool is_reduced_float_v = false;
+template <> inline constexpr bool is_reduced_float_v<Half> = true;
+template <> inline constexpr bool is_reduced_float_v<BFloat16> = true;
+
+} // namespace torchlet::core
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace torchlet {
+
+/// @brief Minimal amount of work (in elements) worth handing to a thread.
+inline constexpr std::size_t GRAIN_SIZE = 32768;
+
+/// @brief Set the number of threads used for intra-op parallelism.
+/// Defaults to TORCHLET_NUM_THREADS if set, else to the hardware concurrency.
+/// Must not be called while a parallel region is running.
+/// @param n number of threads (> 0), the calling thread included
+void set_num_threads(std::size_t n);
+std::size_t get_num_threads() noexcept;
+
+/// @brief True when called from inside a parallel_for chunk.
+bool in_parallel_region() noexcept;
+
+namespace detail {
+void parallel_for_impl(std::size_t begin, std::size_t end,
+                       std::size_t grain_size,
+                       const std::function<void(std::size_t, std::size_t)> &f);
+} // namespace detail
+
+/// @brief Split [begin, end) into contiguous chunks of at least grain_size
+/// indices and run f(chunk_begin, chunk_end) on the thread pool.
+/// Small ranges and nested calls run serially on the calling thread.
+template <typename F>
+void parallel_for(std::size_t begin, std::size_t end, std::size_t grain_size,
+                  F &&f) {
+  if (begin >= end)
+    return;
+
+  if (end - begin <= grain_size || get_num_threads() == 1 ||
+      in_parallel_region()) {
+    f(begin, end);
+    return;
+  }
+
+  detail::parallel_for_impl(begin, end, grain_size,
+                            [&](std::size_t b, std::size_t e) { f(b, e); });
+};
+
+} // namespace torchlet
@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include <torchlet/core/tensor.h>
+
+namespace torchlet::core {
+
+/// @brief One profiled call : an op or a module forward. Times are in ns
+/// from start_profiling(), allocations are the Tensor buffers created on the
+/// calling thread during the call, nested calls included.
+struct ProfileEvent {
+  const char *name;
+  std::string shapes; // of the operands, "[8, 64] [32, 64] [32]"
+  std::uint64_t start_ns = 0, duration_ns = 0;
+  double flops = 0; // 0 when not counted
+  double bytes = 0; // operands and result
+  std::size_t n_allocs = 0, alloc_bytes = 0;
+  std::size_t thread = 0; // 0 for the first thread that recorded, 1, ...
+  std::size_t depth = 0;  // nesting level on its thread
+};
+
+/// @brief What an op reads, writes and computes. Only built while profiling.
+struct OpCost {
+  std::string shapes;
+  double flops = 0;
+  double bytes = 0;
+};
+
+/// @brief Shapes of the tensors and their bytes, empty tensors skipped.
+OpCost op_cost(std::initializer_list<const Tensor *> tensors,
+               double flops = 0);
+
+namespace detail {
+extern std::atomic<bool> g_profiling;
+void record_allocation(std::size_t nbytes) noexcept;
+} // namespace detail
+
+/// @brief Opt-in profiler. Disabled, a RecordScope costs one relaxed load
+/// and one predictable branch.
+inline bool profiling() noexcept {
+  return detail::g_profiling.load(std::memory_order_relaxed);
+};
+
+/// @brief Clear the recorded events and start recording.
+void start_profiling();
+void stop_profiling() noexcept;
+std::vector<ProfileEvent> profile_events();
+
+/// @brief Events as chrome://tracing / Perfetto JSON ("X" events, one track
+/// per thread). Throws std::runtime_error if path cannot be written.
+void export_chrome_trace(const std::string &path);
+
+/// @brief Events aggregated by name, slowest total first. Times include
+/// nested calls.
+std::string profile_table();
+
+/// @brief Records the enclosing call as one event. A scope opened inside a
+/// scope of the same name on the same thread (linear calling linear_out)
+/// does not record a second event : its cost goes to the outer one.
+class RecordScope {
+public:
+  explicit RecordScope(const char *name) {
+    if (__builtin_expect(profiling(), 0))
+      enter(name);
+  };
+  /// @param cost callable returning the OpCost, only invoked while profiling
+  template <typename F> RecordScope(const char *name, F &&cost) {
+    if (__builtin_expect(profiling(), 0))
+      if (RecordScope *owner = enter(name))
+        owner->m_cost = cost();
+  };
+  ~RecordScope() {
+    if (m_active)
+      leave();
+  };
+
+  RecordScope(const RecordScope &) = delete;
+  RecordScope &operator=(const RecordScope &) = delete;
+
+private:
+  // The scope the event goes to, nullptr if none.
+  RecordScope *enter(const char *name);
+  void leave() noexcept;
+
+  bool m_active = false;
+  const char *m_name = nullptr;
+  RecordScope *m_parent = nullptr;
+  std::uint64_t m_start_ns = 0;
+  std::size_t m_allocs = 0, m_alloc_bytes = 0; // thread counters at entry
+  OpCost m_cost;
+};
+
+} // namespace torchlet::core
@@ -1,7 +1,15 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <random>
 
 namespace torchlet::core {
+
+/// @brief Counter-based random stream, Philox4x32-10 keyed by the seed :
+/// counter c maps to 128 random bits that only depend on (seed, c), so a
+/// tensor can be drawn in chunks, on any number of threads, and match the
+/// serial draw bit for bit. The generator itself only holds the seed and the
+/// next unused counter; each draw reserves the counters it consumes.
 class Generator {
 
 public:
@@ -10,20 +18,32 @@ public:
     return g;
   };
 
-  void manual_seed(std::uint32_t s) {
+  /// @brief Restart the stream of seed s from its first counter.
+  void manual_seed(std::uint64_t s) noexcept {
     m_seed = s;
-    m_engine.seed(s);
+    m_offset = 0;
   };
 
   Generator() = default;
-  explicit Generator(std::uint32_t s) : m_seed(s), m_engine(s) {};
+  explicit Generator(std::uint64_t s) noexcept : m_seed(s) {};
 
-  std::mt19937 &engine() noexcept { return m_engine; } // for drawing
-  const std::mt19937 &engine() const noexcept { return m_engine; } // read-only
+  std::uint64_t seed() const noexcept { return m_seed; };
+  /// @brief First counter of the next draw.
+  std::uint64_t offset() const noexcept { return m_offset.load(); };
+  /// @brief Reserve n counters and return the first one. Concurrent draws
+  /// get disjoint ranges.
+  std::uint64_t advance(std::uint64_t n) noexcept {
+    return m_offset.fetch_add(n);
+  };
 
 private:
-  std::uint32_t m_seed{static_cast<std::uint32_t>(std::random_device{}())};
-  std::mt19937 m_engine{m_seed};
+  static std::uint64_t random_seed() {
+    std::random_device rd;
+    return (std::uint64_t{rd()} << 32) | rd();
+  };
+
+  std::uint64_t m_seed{random_seed()};
+  std::atomic<std::uint64_t> m_offset{0};
 
   Generator(const Generator &) = delete;
   Generator(Generator &&) = delete;
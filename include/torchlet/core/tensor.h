@@ -1,23 +1,35 @@
 #pragma once
 #include <cstddef>
 #include <cstdlib>
+#include <memory>
 #include <random>
 #include <utility>
 #include <vector>
 
+#include <torchlet/core/allocator.h>
 #include <torchlet/core/dtype.h>
 #include <torchlet/core/index.h>
 #include <torchlet/core/rng.h>
 
 namespace torchlet::core {
 
+// core/autograd.h
+struct AutogradMeta;
+class Node;
+
+/// @brief Owning handle on a data buffer. deleter(data, nbytes, ctx) is
+/// called on destruction; ctx is whatever the producer of the buffer needs to
+/// release it (the Allocator it came from, a mapping, ...).
 struct Storage {
   void *data = nullptr;
-  void (*deleter)(void *) = [](void *dt) { std::free(dt); };
+  std::size_t nbytes = 0;
+  void *ctx = nullptr;
+  void (*deleter)(void *, std::size_t, void *) =
+      [](void *dt, std::size_t, void *) { std::free(dt); };
 
   ~Storage() {
     if (data && deleter)
-      deleter(data);
+      deleter(data, nbytes, ctx);
   };
 };
 
@@ -36,6 +48,12 @@ public:
                      const Dtype &dtype);
   static Tensor ones(const std::vector<std::size_t> &shape, const Dtype &dtype);
 
+  /// @brief Dense tensor viewing an existing buffer, which must hold at least
+  /// numel(shape) elements of dtype.
+  static Tensor from_storage(const std::shared_ptr<Storage> &storage,
+                             const std::vector<std::size_t> &shape,
+                             const Dtype &dtype);
+
   Tensor index(const std::initializer_list<std::size_t> &index) const;
   Tensor
   index(const std::initializer_list<torchlet::core::index::Slice> &index) const;
@@ -46,6 +64,14 @@ public:
 
   Tensor permute(const std::size_t &idx1, const std::size_t &idx2) const;
   Tensor view(const std::vector<std::size_t> &new_shape) const;
+  /// @brief This tensor if its layout is already dense row-major, else a
+  /// dense copy.
+  Tensor contiguous() const;
+  /// @brief Dense copy converted to dtype, this tensor if it already has it.
+  Tensor to(const Dtype &dtype) const;
+  /// @brief Copy src into this tensor, converting its dtype. src must
+  /// broadcast to this shape.
+  Tensor &copy_(const Tensor &src);
 
   template <typename T>
   void assign_(const std::initializer_list<std::size_t> &index, T val);
@@ -70,6 +96,19 @@ public:
   inline std::size_t numel() const noexcept { return m_numel; }
   inline bool is_contiguous() const noexcept { return m_contiguous; };
 
+  /// @brief Record the ops reading this tensor so that backward() fills its
+  /// grad(), see core/autograd.h. Applies to this handle and the copies made
+  /// from it afterwards.
+  Tensor &requires_grad_(bool requires_grad = true);
+  bool requires_grad() const noexcept;
+  /// @brief Gradient accumulated by backward(), an empty Tensor until one
+  /// reaches this tensor. Shares memory with the stored gradient : writes
+  /// through it change what the next backward adds to.
+  Tensor grad() const;
+  /// @brief Drop the gradient : the next backward writes a new buffer
+  /// instead of accumulating.
+  void zero_grad() noexcept;
+
 private:
   Dtype m_dtype = Dtype::Float32;
   std::vector<std::size_t> m_shape{0};
@@ -78,6 +117,11 @@ private:
   std::size_t m_numel = 0;
   std::shared_ptr<Storage> m_storage = nullptr;
   bool m_contiguous = true;
+  std::shared_ptr<AutogradMeta> m_autograd = nullptr;
+
+  friend void record(std::shared_ptr<Node> node, Tensor &output);
+  friend void backward(const Tensor &output, const Tensor &grad);
+  friend Tensor *grad_buffer(const Tensor &t, bool &fresh, Tensor *donor);
 
   Tensor(const std::vector<std::size_t> &shape,
          const std::vector<std::size_t> &strides,
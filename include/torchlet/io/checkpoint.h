@@ -0,0 +1,30 @@
+#pragma once
+#include <map>
+#include <string>
+
+#include <torchlet/core/tensor.h>
+
+namespace torchlet::io {
+
+/// @brief Named tensors, ordered by name.
+using TensorDict = std::map<std::string, torchlet::core::Tensor>;
+
+// Checkpoint layout, little endian :
+//   "TLCKPT01"                      magic
+//   u64 header_size                 bytes of header that follow
+//   u64 n_tensors
+//   n_tensors x { u32 name_len, name, u32 dtype, u32 ndim, u64 dims[ndim],
+//                 u64 offset, u64 nbytes }
+//   data blocks                     offset from the start of the file, each
+//                                   ALIGNMENT (64) byte aligned
+
+/// @brief Write tensors to path. Strided views are stored dense.
+void save(const std::string &path, const TensorDict &tensors);
+
+/// @brief Map the checkpoint at path. The tensors point into a private
+/// mapping of the file : loading only parses the header, pages are read on
+/// first touch and shared through the page cache. Writes stay private to
+/// the process. The file is unmapped with its last tensor.
+TensorDict load(const std::string &path);
+
+} // namespace torchlet::io
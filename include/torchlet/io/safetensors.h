@@ -0,0 +1,24 @@
+#pragma once
+#include <map>
+#include <string>
+
+#include <torchlet/io/checkpoint.h>
+
+namespace torchlet::io {
+
+/// @brief Read a safetensors file (as written by PyTorch / huggingface).
+/// F32, F64, F16, BF16, I32, I64, U8, U32 and U64 are supported. Like load,
+/// the tensors view a private mapping of the file; a tensor whose offset is
+/// not a multiple of its item size is copied out instead.
+/// @param metadata if not null, receives the "__metadata__" entries
+TensorDict
+load_safetensors(const std::string &path,
+                 std::map<std::string, std::string> *metadata = nullptr);
+
+/// @brief Write tensors as safetensors. The data region starts 64 byte
+/// aligned and tensors are packed by decreasing item size, so every tensor
+/// of the file is aligned for zero-copy loading.
+void save_safetensors(const std::string &path, const TensorDict &tensors,
+                      const std::map<std::string, std::string> &metadata = {});
+
+} // namespace torchlet::io
@@ -1,8 +1,10 @@
 #pragma once
+#include <algorithm>
 #include <cstddef>
 #include <vector>
 
 #include <torchlet/core/dtype.h>
+#include <torchlet/core/parallel.h>
 #include <torchlet/core/tensor.h>
 
 namespace torchlet::iterator {
@@ -25,6 +27,31 @@ struct ContiguousIterator {
 
   template <typename Lambda> void for_each_no_inputs(Lambda &&lambda);
   template <typename Lambda> void for_each_with_inputs(Lambda &&lambda);
+
+  // Parallel variants : the batch is split in contiguous row ranges over the
+  // thread pool. grain_size is the minimal number of elements per thread so
+  // that small tensors stay on the calling thread.
+
+  template <typename Lambda>
+  void parallel_for_each_no_inputs(Lambda &&lambda,
+                                   std::size_t grain_size = GRAIN_SIZE);
+  template <typename Lambda>
+  void parallel_for_each_with_inputs(Lambda &&lambda,
+                                     std::size_t grain_size = GRAIN_SIZE);
+
+  /// lambda(out_ptr, in_ptrs, n_in, n_rows) on blocks of consecutive rows.
+  template <typename Lambda>
+  void parallel_for_each_block_with_inputs(Lambda &&lambda,
+                                           std::size_t grain_size = GRAIN_SIZE);
+
+private:
+  std::size_t grain_rows(std::size_t grain_size) const noexcept {
+    const std::size_t row = std::max<std::size_t>({input_dim, output_dim, 1});
+    return std::max<std::size_t>(grain_size / row, 1);
+  };
+  template <typename Lambda>
+  void for_each_with_inputs_range(std::size_t b0, std::size_t b1,
+                                  Lambda &lambda);
 };
 
 template <typename Lambda>
@@ -38,15 +65,19 @@ void ContiguousIterator::for_each_no_inputs(Lambda &&lambda) {
 };
 
 template <typename Lambda>
-void ContiguousIterator::for_each_with_inputs(Lambda &&lambda) {
+void ContiguousIterator::for_each_with_inputs_range(std::size_t b0,
+                                                    std::size_t b1,
+                                                    Lambda &lambda) {
   std::size_t in_step = input_dim * itemsize;
   std::size_t out_step = output_dim * itemsize;
 
-  std::uint8_t *out_ptr = output_ptr;
+  std::uint8_t *out_ptr = output_ptr + b0 * out_step;
   std::vector<const std::uint8_t *> in_ptrs = input_ptrs;
   std::size_t in_size = in_ptrs.size();
+  for (auto &ptr : in_ptrs)
+    ptr += b0 * in_step;
 
-  for (std::size_t b = 0; b < batch_size; ++b) {
+  for (std::size_t b = b0; b < b1; ++b) {
     lambda(out_ptr, in_ptrs.data(), in_size);
     out_ptr += out_step;
     for (auto &ptr : in_ptrs)
@@ -54,4 +85,49 @@ void ContiguousIterator::for_each_with_inputs(Lambda &&lambda) {
   }
 };
 
+template <typename Lambda>
+void ContiguousIterator::for_each_with_inputs(Lambda &&lambda) {
+  for_each_with_inputs_range(0, batch_size, lambda);
+};
+
+template <typename Lambda>
+void ContiguousIterator::parallel_for_each_no_inputs(Lambda &&lambda,
+                                                     std::size_t grain_size) {
+  std::size_t out_step = output_dim * itemsize;
+  torchlet::parallel_for(0, batch_size, grain_rows(grain_size),
+                         [&](std::size_t b0, std::size_t b1) {
+                           std::uint8_t *out_ptr = output_ptr + b0 * out_step;
+                           for (std::size_t b = b0; b < b1; ++b) {
+                             lambda(out_ptr);
+                             out_ptr += out_step;
+                           }
+                         });
+};
+
+template <typename Lambda>
+void ContiguousIterator::parallel_for_each_with_inputs(Lambda &&lambda,
+                                                       std::size_t grain_size) {
+  torchlet::parallel_for(0, batch_size, grain_rows(grain_size),
+                         [&](std::size_t b0, std::size_t b1) {
+                           for_each_with_inputs_range(b0, b1, lambda);
+                         });
+};
+
+template <typename Lambda>
+void ContiguousIterator::parallel_for_each_block_with_inputs(
+    Lambda &&lambda, std::size_t grain_size) {
+  std::size_t in_step = input_dim * itemsize;
+  std::size_t out_step = output_dim * itemsize;
+
+  torchlet::parallel_for(0, batch_size, grain_rows(grain_size),
+                         [&](std::size_t b0, std::size_t b1) {
+                           std::vector<const std::uint8_t *> in_ptrs =
+                               input_ptrs;
+                           for (auto &ptr : in_ptrs)
+                             ptr += b0 * in_step;
+                           lambda(output_ptr + b0 * out_step, in_ptrs.data(),
+                                  in_ptrs.size(), b1 - b0);
+                         });
+};
+
 } // namespace torchlet::iterator
@@ -0,0 +1,145 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <torchlet/core/parallel.h>
+#include <torchlet/core/tensor.h>
+
+namespace torchlet::iterator {
+
+/// @brief N-ary iterator over tensors of arbitrary strides and offsets.
+///
+/// Operand 0 is the output, the others are inputs that broadcast to its shape
+/// with NumPy rules : a broadcast dim gets a 0 stride. At construction the
+/// dims are reordered so that the innermost loop runs over the smallest
+/// output stride, and adjacent dims that are contiguous with respect to each
+/// other in every operand are coalesced. A contiguous
+/// tensor, or a permuted one, therefore collapses to a single inner run.
+///
+/// The loop callback receives one run at a time :
+///   loop(std::uint8_t **data, const std::ptrdiff_t *strides, std::size_t n)
+/// with data[t] the first element of operand t and strides[t] its byte step.
+class TensorIterator {
+public:
+  static constexpr std::size_t MAX_OPERANDS = 8;
+  static constexpr std::size_t MAX_DIMS = 16;
+
+  /// @param reorder false keeps the logical row-major visiting order, for
+  /// loops with side effects such as drawing from a sequential RNG.
+  TensorIterator(
+      torchlet::core::Tensor *out,
+      std::initializer_list<const torchlet::core::Tensor *const> inputs,
+      bool reorder = true);
+
+  /// @brief Iterate over the rows of the last dim instead of elements : one
+  /// loop element is a row of row_size() values, row_stride(t) bytes apart.
+  static TensorIterator
+  rows(torchlet::core::Tensor *out,
+       std::initializer_list<const torchlet::core::Tensor *const> inputs);
+
+  std::size_t ntensors() const noexcept { return m_ntensors; };
+  std::size_t ndim() const noexcept { return m_shape.size(); };
+  /// Number of loop elements (rows in row mode).
+  std::size_t numel() const noexcept { return m_numel; };
+  std::size_t itemsize(std::size_t t = 0) const noexcept {
+    return m_itemsizes[t];
+  };
+
+  std::size_t row_size() const noexcept { return m_row_size; };
+  std::ptrdiff_t row_stride(std::size_t t) const noexcept {
+    return m_row_strides[t];
+  };
+
+  /// @brief Single inner run with unit stride in every operand.
+  bool is_contiguous() const noexcept;
+
+  template <typename Loop> void for_each(Loop &&loop);
+  /// @brief for_each split over the thread pool, grain_size in elements.
+  template <typename Loop>
+  void parallel_for_each(Loop &&loop, std::size_t grain_size = GRAIN_SIZE);
+  /// @brief Visit loop elements [begin, end) in iteration order.
+  template <typename Loop>
+  void for_each_range(std::size_t begin, std::size_t end, Loop &loop);
+
+private:
+  TensorIterator() = default;
+
+  void build(torchlet::core::Tensor *out,
+             std::initializer_list<const torchlet::core::Tensor *const> inputs,
+             bool reorder, bool row_mode);
+  void reorder_dims();
+  void coalesce_dims();
+
+  std::size_t m_ntensors = 0;
+  std::array<std::size_t, MAX_OPERANDS> m_itemsizes{};
+  std::size_t m_numel = 0;
+  std::size_t m_row_size = 1;
+  bool m_row_mode = false;
+
+  // innermost dim first
+  std::vector<std::size_t> m_shape;
+  // m_strides[d * m_ntensors + t], in bytes
+  std::vector<std::ptrdiff_t> m_strides;
+  std::array<std::uint8_t *, MAX_OPERANDS> m_data{};
+  std::array<std::ptrdiff_t, MAX_OPERANDS> m_row_strides{};
+};
+
+template <typename Loop>
+void TensorIterator::for_each_range(std::size_t begin, std::size_t end,
+                                    Loop &loop) {
+  if (begin >= end)
+    return;
+
+  const std::size_t nd = m_shape.size();
+  const std::size_t nt = m_ntensors;
+  const std::ptrdiff_t *strides = m_strides.data();
+
+  std::array<std::size_t, MAX_DIMS> idx{};
+  std::array<std::uint8_t *, MAX_OPERANDS> ptrs = m_data;
+
+  std::size_t lin = begin;
+  for (std::size_t d = 0; d < nd; ++d) {
+    idx[d] = lin % m_shape[d];
+    lin /= m_shape[d];
+    for (std::size_t t = 0; t < nt; ++t)
+      ptrs[t] += static_cast<std::ptrdiff_t>(idx[d]) * strides[d * nt + t];
+  }
+
+  while (begin < end) {
+    const std::size_t n = std::min(m_shape[0] - idx[0], end - begin);
+    loop(ptrs.data(), strides, n);
+    begin += n;
+
+    idx[0] += n;
+    for (std::size_t t = 0; t < nt; ++t)
+      ptrs[t] += static_cast<std::ptrdiff_t>(n) * strides[t];
+
+    // carry into the outer dims
+    for (std::size_t d = 0; d + 1 < nd && idx[d] == m_shape[d]; ++d) {
+      for (std::size_t t = 0; t < nt; ++t)
+        ptrs[t] += strides[(d + 1) * nt + t] -
+                   static_cast<std::ptrdiff_t>(idx[d]) * strides[d * nt + t];
+      idx[d] = 0;
+      idx[d + 1]++;
+    }
+  }
+};
+
+template <typename Loop> void TensorIterator::for_each(Loop &&loop) {
+  for_each_range(0, m_numel, loop);
+};
+
+template <typename Loop>
+void TensorIterator::parallel_for_each(Loop &&loop, std::size_t grain_size) {
+  const std::size_t grain = std::max<std::size_t>(
+      grain_size / std::max<std::size_t>(m_row_size, 1), 1);
+  torchlet::parallel_for(0, m_numel, grain,
+                         [&](std::size_t b, std::size_t e) {
+                           for_each_range(b, e, loop);
+                         });
+};
+
+} // namespace torchlet::iterator
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <torchlet/core/tensor.h>
+#include <torchlet/io/checkpoint.h>
+
+namespace torchlet::module {
+
+/// @brief LayerNorm over the last dim, of length dim. With affine, a weight
+/// initialised to 1 and a bias to 0, see ops::layer_norm.
+class LayerNorm {
+public:
+  LayerNorm(std::size_t dim, double eps, bool affine,
+            const torchlet::core::Dtype &dtype);
+
+  LayerNorm() = delete;
+
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x) const;
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out) const;
+  /// @brief residual += x, then forward(residual) : the pre-norm residual
+  /// block in two passes over each row, see ops::residual_layer_norm.
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x,
+                                 torchlet::core::Tensor &residual) const;
+
+  /// @brief Parameters by name : "weight" and "bias" when affine.
+  torchlet::io::TensorDict state_dict() const;
+  void load_state_dict(const torchlet::io::TensorDict &state,
+                       const std::string &prefix = "");
+
+  torchlet::core::Tensor &weight() { return m_weight; };
+  torchlet::core::Tensor &bias() { return m_bias; };
+  double eps() const { return m_eps; };
+
+private:
+  std::size_t m_dim;
+  double m_eps;
+  bool m_affine;
+  torchlet::core::Tensor m_weight;
+  torchlet::core::Tensor m_bias;
+};
+
+/// @brief RMSNorm over the last dim, of length dim, with a weight
+/// initialised to 1, see ops::rms_norm.
+class RMSNorm {
+public:
+  RMSNorm(std::size_t dim, double eps, const torchlet::core::Dtype &dtype);
+
+  RMSNorm() = delete;
+
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x) const;
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out) const;
+  /// @brief residual += x, then forward(residual), see
+  /// ops::residual_rms_norm.
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x,
+                                 torchlet::core::Tensor &residual) const;
+
+  /// @brief Parameters by name : "weight".
+  torchlet::io::TensorDict state_dict() const;
+  void load_state_dict(const torchlet::io::TensorDict &state,
+                       const std::string &prefix = "");
+
+  torchlet::core::Tensor &weight() { return m_weight; };
+  double eps() const { return m_eps; };
+
+private:
+  std::size_t m_dim;
+  double m_eps;
+  torchlet::core::Tensor m_weight;
+};
+
+} // namespace torchlet::module
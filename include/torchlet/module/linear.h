@@ -2,6 +2,9 @@
 
 #include <torchlet/core/rng.h>
 #include <torchlet/core/tensor.h>
+#include <torchlet/io/checkpoint.h>
+#include <torchlet/module/quantized_linear.h>
+#include <torchlet/ops/kernel.h>
 
 namespace torchlet::module {
 
@@ -13,6 +16,34 @@ public:
   Linear() = delete;
 
   torchlet::core::Tensor forward(const torchlet::core::Tensor &x) const;
+  /// @brief forward into a preallocated tensor, see ops::linear_out.
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out) const;
+  /// @brief forward_out with act fused in the kernel epilogue.
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out,
+                                      Activation act) const;
+
+  /// @brief Parameters by name : "weight" and, with a bias, "bias". The
+  /// tensors share memory with the layer.
+  torchlet::io::TensorDict state_dict() const;
+  /// @brief Take the parameters prefix + "weight" / "bias" of state, e.g.
+  /// tensors of torchlet::io::load or io::load_safetensors with prefix
+  /// "fc1.". Shapes must match the layer's; parameters of the layer's dtype
+  /// are taken without copying, others are converted.
+  void load_state_dict(const torchlet::io::TensorDict &state,
+                       const std::string &prefix = "");
+
+  /// @brief weight and, with a bias, bias; they share memory and gradient
+  /// with the layer.
+  std::vector<torchlet::core::Tensor> parameters() const;
+  /// @brief Track the gradients of the parameters, see core/autograd.h.
+  /// forward then records, forward_out never does.
+  Linear &requires_grad_(bool requires_grad = true);
+
+  /// @brief Post-training quantization : per output channel asymmetric 7 bit
+  /// weights calibrated on the current min / max of each row of W.
+  QuantizedLinear quantize() const;
 
   torchlet::core::Tensor &bias() {
     if (m_bias.storage_ptr() == nullptr) {
@@ -22,6 +53,7 @@ public:
   };
   const bool &has_bias() const { return m_has_bias; };
   torchlet::core::Tensor &weights() { return m_weights; };
+  const torchlet::core::Tensor &weights() const { return m_weights; };
 
 private:
   std::size_t in_features;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <torchlet/core/tensor.h>
+
+namespace torchlet::module {
+
+/// @brief Linear layer with 7 bit per output channel quantized weights,
+/// usually built by Linear::quantize. The output is Float32.
+class QuantizedLinear {
+public:
+  /// @param weights UInt8 {out_features, in_features}, codes in [0, 127]
+  /// @param scales Float32 {out_features}
+  /// @param zero_points Int32 {out_features}
+  /// @param bias Float32 {out_features}, or an empty tensor
+  /// @throws std::invalid_argument on other dtypes or shapes, or a code
+  /// above 127
+  QuantizedLinear(const torchlet::core::Tensor &weights,
+                  const torchlet::core::Tensor &scales,
+                  const torchlet::core::Tensor &zero_points,
+                  const torchlet::core::Tensor &bias);
+
+  QuantizedLinear() = delete;
+
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x) const;
+  /// @brief forward into a preallocated tensor, see ops::quantized_linear_out.
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out) const;
+
+  /// @brief Weights dequantized to Float32.
+  torchlet::core::Tensor dequantize() const;
+
+  const bool &has_bias() const { return m_has_bias; };
+  const torchlet::core::Tensor &weights() const { return m_weights; };
+  const torchlet::core::Tensor &scales() const { return m_scales; };
+  const torchlet::core::Tensor &zero_points() const { return m_zero_points; };
+
+private:
+  torchlet::core::Tensor m_weights;
+  torchlet::core::Tensor m_scales;
+  torchlet::core::Tensor m_zero_points;
+  torchlet::core::Tensor m_bias;
+  bool m_has_bias;
+};
+
+} // namespace torchlet::module
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <torchlet/core/tensor.h>
+#include <torchlet/io/checkpoint.h>
+#include <torchlet/module/linear.h>
+#include <torchlet/ops/kernel.h>
+
+namespace torchlet::module {
+
+/// @brief Chain of Linear layers and activations. An activation right after
+/// a Linear runs in its epilogue.
+///
+/// The first forward for an input shape plans the intermediates : each gets
+/// an offset in one workspace, buffers whose lifetimes do not overlap share
+/// memory, and standalone activations run in place. Later forwards with the
+/// same shape reuse the plan : forward_out then allocates nothing, forward
+/// only its returned output. Another shape replans. forward is not thread
+/// safe.
+class Sequential {
+public:
+  Sequential() = default;
+  /// @brief Copies the layers, not the plan : the copy plans its own
+  /// workspace on its first forward.
+  Sequential(const Sequential &other);
+  Sequential &operator=(const Sequential &other);
+  Sequential(Sequential &&) = default;
+  Sequential &operator=(Sequential &&) = default;
+
+  Sequential &add(const Linear &layer);
+  /// @brief ReLU, GELU, or Softmax over the last dim. None is ignored.
+  Sequential &add(Activation act);
+
+  /// @brief Returns a new output tensor on each call. When a parameter or x
+  /// requires grad (and recording is on), the layers run unplanned through
+  /// the allocating ops so that every intermediate is kept for backward.
+  torchlet::core::Tensor forward(const torchlet::core::Tensor &x);
+  /// @brief forward into a preallocated dense tensor of the output shape,
+  /// never recorded.
+  torchlet::core::Tensor &forward_out(const torchlet::core::Tensor &x,
+                                      torchlet::core::Tensor &out);
+
+  /// @brief Number of layers, activations included.
+  std::size_t size() const noexcept { return m_layers.size(); };
+  /// @brief Bytes of the workspace of the current plan.
+  std::size_t workspace_bytes() const noexcept { return m_workspace_bytes; };
+
+  /// @brief Parameters of the Linear layers in order, sharing memory and
+  /// gradient with them.
+  std::vector<torchlet::core::Tensor> parameters() const;
+  Sequential &requires_grad_(bool requires_grad = true);
+
+  /// @brief Parameters of the Linear layers as "<index>.weight" and
+  /// "<index>.bias", index counting activations like torch.nn.Sequential.
+  torchlet::io::TensorDict state_dict() const;
+  void load_state_dict(const torchlet::io::TensorDict &state,
+                       const std::string &prefix = "");
+
+private:
+  static constexpr std::size_t kInput = static_cast<std::size_t>(-1);
+  static constexpr std::size_t kOutput = static_cast<std::size_t>(-2);
+
+  struct Layer {
+    std::size_t linear; // index in m_linears, kInput for an activation
+    Activation act;
+  };
+
+  // One kernel launch : a Linear with its fused activation, or a standalone
+  // activation. in / out are buffer ids, kInput or kOutput.
+  struct Step {
+    std::size_t linear; // index in m_linears, kInput for an activation
+    Activation act;
+    std::size_t in, out;
+  };
+
+  void plan(const torchlet::core::Tensor &x);
+  torchlet::core::Tensor forward_recorded(const torchlet::core::Tensor &x);
+  const torchlet::core::Tensor &value(std::size_t id,
+                                      const torchlet::core::Tensor &x) const;
+
+  std::vector<Layer> m_layers;
+  std::vector<Linear> m_linears;
+
+  // current plan
+  bool m_planned = false;
+  std::vector<std::size_t> m_in_shape, m_out_shape;
+  torchlet::core::Dtype m_dtype = torchlet::core::Dtype::Float32;
+  std::vector<Step> m_steps;
+  std::vector<torchlet::core::Tensor> m_buffers; // views of the workspace
+  std::size_t m_workspace_bytes = 0;
+};
+
+} // namespace torchlet::module
@@ -1,4 +1,5 @@
 #pragma once
+#include <torchlet/core/rng.h>
 #include <torchlet/core/tensor.h>
 
 namespace torchlet::ops {
@@ -7,8 +8,238 @@ torchlet::core::Tensor linear(const torchlet::core::Tensor &x,
                               const torchlet::core::Tensor &weights,
                               const torchlet::core::Tensor &bias);
 
+// Fused linear + activation : the activation runs in the GEMM / GEMV
+// epilogue instead of a second pass over the output.
+
+torchlet::core::Tensor linear_gelu(const torchlet::core::Tensor &x,
+                                   const torchlet::core::Tensor &weights,
+                                   const torchlet::core::Tensor &bias);
+torchlet::core::Tensor linear_relu(const torchlet::core::Tensor &x,
+                                   const torchlet::core::Tensor &weights,
+                                   const torchlet::core::Tensor &bias);
+/// @brief softmax(x W^T + b) over the last dim.
+torchlet::core::Tensor
+linear_bias_softmax(const torchlet::core::Tensor &x,
+                    const torchlet::core::Tensor &weights,
+                    const torchlet::core::Tensor &bias);
+/// @brief dropout(gelu(x W^T + b), p, gen), the dropout swept over blocks of
+/// the output right after their epilogue, while they are still in cache.
+/// Draws the same mask as dropout would from the same generator state.
+torchlet::core::Tensor linear_gelu_dropout(
+    const torchlet::core::Tensor &x, const torchlet::core::Tensor &weights,
+    const torchlet::core::Tensor &bias, double p,
+    torchlet::core::Generator &gen = torchlet::core::Generator::global());
+
+/// @brief Linear with UInt8 weights : W[o] ~ scales[o] (qweight[o] -
+/// zero_points[o]), codes in [0, 127]. x is quantized per row to int8 and the
+/// int32 products are dequantized to Float32. bias is Float32 or empty. The
+/// codes are not checked here, QuantizedLinear checks them once : above 127
+/// the SIMD kernels saturate and no longer match the scalar ones.
+torchlet::core::Tensor
+quantized_linear(const torchlet::core::Tensor &x,
+                 const torchlet::core::Tensor &qweight,
+                 const torchlet::core::Tensor &scales,
+                 const torchlet::core::Tensor &zero_points,
+                 const torchlet::core::Tensor &bias);
+
+/// @brief Matrix product over the last two dims, a [..., m, k] and
+/// b [..., k, n], the leading dims broadcast like NumPy. Float32 / Float64,
+/// any strides.
+torchlet::core::Tensor matmul(const torchlet::core::Tensor &a,
+                              const torchlet::core::Tensor &b);
+
+/// @brief softmax(q k^T / sqrt(d)) v over the last two dims : q [..., Lq, d],
+/// k [..., Lk, d], v [..., Lk, dv], batch dims broadcast. With causal, query
+/// i attends to keys j <= i. Tiled with an online softmax, the memory is
+/// O(L d) : the [Lq, Lk] scores are never stored.
+torchlet::core::Tensor
+scaled_dot_product_attention(const torchlet::core::Tensor &q,
+                             const torchlet::core::Tensor &k,
+                             const torchlet::core::Tensor &v,
+                             bool causal = false);
+
+// Elementwise binary ops with NumPy broadcasting, for every dtype. a and b
+// must share their dtype; integer division truncates, and throws
+// std::invalid_argument on a zero divisor or on min / -1.
+
+torchlet::core::Tensor add(const torchlet::core::Tensor &a,
+                           const torchlet::core::Tensor &b);
+torchlet::core::Tensor sub(const torchlet::core::Tensor &a,
+                           const torchlet::core::Tensor &b);
+torchlet::core::Tensor mul(const torchlet::core::Tensor &a,
+                           const torchlet::core::Tensor &b);
+torchlet::core::Tensor div(const torchlet::core::Tensor &a,
+                           const torchlet::core::Tensor &b);
+torchlet::core::Tensor maximum(const torchlet::core::Tensor &a,
+                               const torchlet::core::Tensor &b);
+
 torchlet::core::Tensor gelu(const torchlet::core::Tensor &x);
+torchlet::core::Tensor relu(const torchlet::core::Tensor &x);
 torchlet::core::Tensor log_softmax(const torchlet::core::Tensor &x);
 torchlet::core::Tensor softmax(const torchlet::core::Tensor &x);
 
-} // namespace torchlet::ops
\ No newline at end of file
+/// @brief Inverted dropout : each value is zeroed with probability p in
+/// [0, 1] and the others scaled by 1 / (1 - p). The keep mask is generated
+/// from gen in the same sweep and never stored; the backward draws it again
+/// from the seed and counter of the draw. Value k in row-major order takes
+/// value k of the mask, whatever the layout and the number of threads.
+torchlet::core::Tensor dropout(
+    const torchlet::core::Tensor &x, double p,
+    torchlet::core::Generator &gen = torchlet::core::Generator::global());
+
+// Normalisation over the last dim. weight (gamma) and bias (beta) are 1-D of
+// the last dim's length, an empty Tensor for none. Each row is read twice :
+// once for its statistics, once to normalise and apply weight and bias.
+
+/// @brief (x - mean) / sqrt(var + eps) * weight + bias.
+torchlet::core::Tensor layer_norm(const torchlet::core::Tensor &x,
+                                  const torchlet::core::Tensor &weight,
+                                  const torchlet::core::Tensor &bias,
+                                  double eps = 1e-5);
+/// @brief x / sqrt(mean(x^2) + eps) * weight.
+torchlet::core::Tensor rms_norm(const torchlet::core::Tensor &x,
+                                const torchlet::core::Tensor &weight,
+                                double eps = 1e-6);
+
+/// @brief Mean over the rows of -log softmax(logits)[target] : logits
+/// [..., C] Float32 / Float64, targets Int64 [...] in [0, C). One pass per row
+/// for its logsumexp, the log-probabilities are never stored. Returns a {1}
+/// tensor; throws std::invalid_argument for a target out of range.
+torchlet::core::Tensor cross_entropy(const torchlet::core::Tensor &logits,
+                                     const torchlet::core::Tensor &targets);
+
+// Pre-norm residual blocks : residual += x, then the norm of the updated
+// residual, in the same two passes. residual must be dense and of x's shape.
+
+torchlet::core::Tensor residual_layer_norm(const torchlet::core::Tensor &x,
+                                           torchlet::core::Tensor &residual,
+                                           const torchlet::core::Tensor &weight,
+                                           const torchlet::core::Tensor &bias,
+                                           double eps = 1e-5);
+torchlet::core::Tensor residual_rms_norm(const torchlet::core::Tensor &x,
+                                         torchlet::core::Tensor &residual,
+                                         const torchlet::core::Tensor &weight,
+                                         double eps = 1e-6);
+
+// out= variants : write the result into a preallocated tensor of the result's
+// shape and dtype, and return it. For linear, matmul and attention, out must be
+// dense and must not share memory with the inputs; the row-wise and binary ops
+// accept any strided out, including out aliasing an input.
+
+torchlet::core::Tensor &linear_out(const torchlet::core::Tensor &x,
+                                   const torchlet::core::Tensor &weights,
+                                   const torchlet::core::Tensor &bias,
+                                   torchlet::core::Tensor &out);
+torchlet::core::Tensor &linear_gelu_out(const torchlet::core::Tensor &x,
+                                        const torchlet::core::Tensor &weights,
+                                        const torchlet::core::Tensor &bias,
+                                        torchlet::core::Tensor &out);
+torchlet::core::Tensor &linear_relu_out(const torchlet::core::Tensor &x,
+                                        const torchlet::core::Tensor &weights,
+                                        const torchlet::core::Tensor &bias,
+                                        torchlet::core::Tensor &out);
+torchlet::core::Tensor &
+linear_bias_softmax_out(const torchlet::core::Tensor &x,
+                        const torchlet::core::Tensor &weights,
+                        const torchlet::core::Tensor &bias,
+                        torchlet::core::Tensor &out);
+torchlet::core::Tensor &
+quantized_linear_out(const torchlet::core::Tensor &x,
+                     const torchlet::core::Tensor &qweight,
+                     const torchlet::core::Tensor &scales,
+                     const torchlet::core::Tensor &zero_points,
+                     const torchlet::core::Tensor &bias,
+                     torchlet::core::Tensor &out);
+
+torchlet::core::Tensor &matmul_out(const torchlet::core::Tensor &a,
+                                   const torchlet::core::Tensor &b,
+                                   torchlet::core::Tensor &out);
+
+torchlet::core::Tensor &
+scaled_dot_product_attention_out(const torchlet::core::Tensor &q,
+                                 const torchlet::core::Tensor &k,
+                                 const torchlet::core::Tensor &v,
+                                 torchlet::core::Tensor &out,
+                                 bool causal = false);
+
+torchlet::core::Tensor &gelu_out(const torchlet::core::Tensor &x,
+                                 torchlet::core::Tensor &out);
+torchlet::core::Tensor &relu_out(const torchlet::core::Tensor &x,
+                                 torchlet::core::Tensor &out);
+torchlet::core::Tensor &log_softmax_out(const torchlet::core::Tensor &x,
+                                        torchlet::core::Tensor &out);
+torchlet::core::Tensor &softmax_out(const torchlet::core::Tensor &x,
+                                    torchlet::core::Tensor &out);
+torchlet::core::Tensor &dropout_out(
+    const torchlet::core::Tensor &x, double p, torchlet::core::Tensor &out,
+    torchlet::core::Generator &gen = torchlet::core::Generator::global());
+
+// The norms need a dense out, which may alias x (or residual). sum receives
+// x + residual, an empty Tensor to drop it.
+
+torchlet::core::Tensor &layer_norm_out(const torchlet::core::Tensor &x,
+                                       const torchlet::core::Tensor &weight,
+                                       const torchlet::core::Tensor &bias,
+                                       torchlet::core::Tensor &out,
+                                       double eps = 1e-5);
+torchlet::core::Tensor &rms_norm_out(const torchlet::core::Tensor &x,
+                                     const torchlet::core::Tensor &weight,
+                                     torchlet::core::Tensor &out,
+                                     double eps = 1e-6);
+torchlet::core::Tensor &
+residual_layer_norm_out(const torchlet::core::Tensor &x,
+                        const torchlet::core::Tensor &residual,
+                        const torchlet::core::Tensor &weight,
+                        const torchlet::core::Tensor &bias,
+                        torchlet::core::Tensor &out,
+                        torchlet::core::Tensor &sum, double eps = 1e-5);
+torchlet::core::Tensor &
+residual_rms_norm_out(const torchlet::core::Tensor &x,
+                      const torchlet::core::Tensor &residual,
+                      const torchlet::core::Tensor &weight,
+                      torchlet::core::Tensor &out, torchlet::core::Tensor &sum,
+                      double eps = 1e-6);
+
+torchlet::core::Tensor &cross_entropy_out(const torchlet::core::Tensor &logits,
+                                          const torchlet::core::Tensor &targets,
+                                          torchlet::core::Tensor &loss);
+
+torchlet::core::Tensor &add_out(const torchlet::core::Tensor &a,
+                                const torchlet::core::Tensor &b,
+                                torchlet::core::Tensor &out);
+torchlet::core::Tensor &sub_out(const torchlet::core::Tensor &a,
+                                const torchlet::core::Tensor &b,
+                                torchlet::core::Tensor &out);
+torchlet::core::Tensor &mul_out(const torchlet::core::Tensor &a,
+                                const torchlet::core::Tensor &b,
+                                torchlet::core::Tensor &out);
+torchlet::core::Tensor &div_out(const torchlet::core::Tensor &a,
+                                const torchlet::core::Tensor &b,
+                                torchlet::core::Tensor &out);
+torchlet::core::Tensor &maximum_out(const torchlet::core::Tensor &a,
+                                    const torchlet::core::Tensor &b,
+                                    torchlet::core::Tensor &out);
+
+// In-place variants, overwrite x (a for the binary ops, b must broadcast to
+// its shape).
+
+torchlet::core::Tensor &add_(torchlet::core::Tensor &a,
+                             const torchlet::core::Tensor &b);
+torchlet::core::Tensor &sub_(torchlet::core::Tensor &a,
+                             const torchlet::core::Tensor &b);
+torchlet::core::Tensor &mul_(torchlet::core::Tensor &a,
+                             const torchlet::core::Tensor &b);
+torchlet::core::Tensor &div_(torchlet::core::Tensor &a,
+                             const torchlet::core::Tensor &b);
+torchlet::core::Tensor &maximum_(torchlet::core::Tensor &a,
+                                 const torchlet::core::Tensor &b);
+
+torchlet::core::Tensor &gelu_(torchlet::core::Tensor &x);
+torchlet::core::Tensor &relu_(torchlet::core::Tensor &x);
+torchlet::core::Tensor &log_softmax_(torchlet::core::Tensor &x);
+torchlet::core::Tensor &softmax_(torchlet::core::Tensor &x);
+torchlet::core::Tensor &dropout_(
+    torchlet::core::Tensor &x, double p,
+    torchlet::core::Generator &gen = torchlet::core::Generator::global());
+
+} // namespace torchlet::ops
@@ -4,6 +4,9 @@
 
 namespace torchlet::ops::init {
 
+// T must match the tensor dtype; Float16 and BFloat16 tensors take float
+// parameters and store the rounded draws.
+
 template <typename T>
 void normal_(
     torchlet::core::Tensor &tensor, T mean, T stdev,
@@ -1,7 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <cstdlib>
 
+/// @brief Epilogue applied to the output of the fused matrix kernels.
+/// Softmax is row-wise, the others are elementwise.
+enum class Activation { None, ReLU, GELU, Softmax };
+
+/// @brief Elementwise binary operation of binary_kernel.
+enum class BinaryOp { Add, Sub, Mul, Div, Maximum };
+
 /// @brief Matrix vector product kernel
 /// @tparam T double | float
 /// @param W m x n matrix
@@ -14,9 +22,53 @@ template <typename T>
 void mvb_kernel(const T *W, const T *x, const T *b, T *y, std::size_t m,
                 std::size_t n) noexcept;
 
-void mvb_blas_kernel(const float *__restrict W, const float *__restrict x,
-                     const float *__restrict b, float *__restrict y,
-                     std::size_t m, std::size_t n) noexcept;
+/// @brief mvb_kernel with reduced precision weights : W is widened to float
+/// on load and the dot products accumulate in float.
+/// @tparam W_T torchlet::core::Half | torchlet::core::BFloat16
+template <typename W_T>
+void mvb_mixed_kernel(const W_T *W, const float *x, const float *b, float *y,
+                      std::size_t m, std::size_t n) noexcept;
+
+/// @brief y = float(x), for R = torchlet::core::Half | BFloat16
+template <typename R>
+void widen_kernel(const R *x, float *y, std::size_t m) noexcept;
+
+/// @brief y = R(x), round to nearest even
+template <typename R>
+void narrow_kernel(const float *x, R *y, std::size_t m) noexcept;
+
+/// @brief Symmetric int8 quantization of an activation row :
+/// q = round(x / scale) in [-127, 127] with scale = max|x| / 127.
+/// @param scale set to the row scale (1 for an all zero row)
+/// @param sum set to the sum of q, used to fold the weight zero points
+void quantize_row_kernel(const float *x, std::int8_t *q, std::size_t n,
+                         float &scale, std::int32_t &sum) noexcept;
+
+/// @brief Quantized matrix product with bias,
+/// Y[i, o] = w_scale[o] x_scale[i] (X[i] . W[o] - w_zp[o] x_sum[i]) + b[o]
+/// @param W m x n weights, 7 bit unsigned codes in [0, 127]
+/// @param w_scale m per output channel weight scales
+/// @param w_zp m per output channel weight zero points
+/// @param X M x n rows from quantize_row_kernel
+/// @param x_scale M row scales
+/// @param x_sum M row sums
+/// @param b m bias vector (nullptr for none)
+/// @param Y M x m output with row stride ldy
+void qmmb_kernel(const std::uint8_t *W, const float *w_scale,
+                 const std::int32_t *w_zp, const std::int8_t *X,
+                 const float *x_scale, const std::int32_t *x_sum,
+                 const float *b, float *Y, std::size_t M, std::size_t m,
+                 std::size_t n, std::size_t ldy) noexcept;
+
+/// @brief Name of the BLAS backend selected at build time ("native" if none)
+const char *blas_backend() noexcept;
+
+/// @brief mvb_kernel routed through the BLAS backend (sgemv / dgemv).
+/// Falls back to mvb_kernel when torchlet is built without BLAS.
+template <typename T>
+void mvb_blas_kernel(const T *__restrict W, const T *__restrict x,
+                     const T *__restrict b, T *__restrict y, std::size_t m,
+                     std::size_t n) noexcept;
 
 /// @brief Matrix-matrix product kernel
 /// @tparam T double | float
@@ -30,6 +82,57 @@ template <typename T>
 void mm_kernel(const T *A, const T *B, T *C, std::size_t m, std::size_t n,
                std::size_t k);
 
+/// @brief Matrix-matrix product of strided operands, C (+)= A B (cache
+/// blocked, parallel over blocks of C)
+/// @tparam T double | float
+/// @param A m x k matrix, A(i, p) = A[i * rsa + p * csa]
+/// @param B k x n matrix, B(p, j) = B[p * rsb + j * csb]
+/// @param C m x n row-major output with row stride ldc
+/// @param accumulate add the product to C instead of overwriting it
+template <typename T>
+void mm_strided_kernel(const T *A, std::size_t rsa, std::size_t csa,
+                       const T *B, std::size_t rsb, std::size_t csb, T *C,
+                       std::size_t ldc, std::size_t m, std::size_t n,
+                       std::size_t k, bool accumulate = false);
+
+/// @brief Matrix-matrix product with bias, C = act(A W^T + b) (cache blocked)
+/// @tparam T double | float
+/// @param A m x k matrix
+/// @param W n x k matrix
+/// @param b n bias vector (nullptr for none)
+/// @param C m x n output matrix
+/// @param m rowsize A
+/// @param n rowsize W
+/// @param k common dim A, W
+/// @param act activation applied in the epilogue, while C is still in cache
+template <typename T>
+void mmb_kernel(const T *A, const T *W, const T *b, T *C, std::size_t m,
+                std::size_t n, std::size_t k,
+                Activation act = Activation::None);
+
+/// @brief mmb_kernel routed through the BLAS backend (sgemm / dgemm).
+/// Falls back to mmb_kernel when torchlet is built without BLAS. With an
+/// activation the rows are processed in blocks that stay in L2.
+template <typename T>
+void mmb_blas_kernel(const T *__restrict A, const T *__restrict W,
+                     const T *__restrict b, T *__restrict C, std::size_t m,
+                     std::size_t n, std::size_t k,
+                     Activation act = Activation::None);
+
+/// @brief Attention rows [q_begin, q_end) of one head,
+/// O = softmax(scale Q K^T (+ causal mask)) V, in tiles with an online
+/// softmax : scores never exist beyond one Q block x K block tile.
+/// @tparam T double | float
+/// @param Q Lq x d dense matrix, from its row 0
+/// @param K Lk x d dense matrix
+/// @param V Lk x dv dense matrix
+/// @param O Lq x dv dense output, from its row 0
+/// @param causal query i only sees keys j <= i
+template <typename T>
+void attention_kernel(const T *Q, const T *K, const T *V, T *O,
+                      std::size_t q_begin, std::size_t q_end, std::size_t Lk,
+                      std::size_t d, std::size_t dv, T scale, bool causal);
+
 /// @brief Vector addition
 /// @tparam T type
 /// @param x m-dim vector to add
@@ -38,11 +141,156 @@ void mm_kernel(const T *A, const T *B, T *C, std::size_t m, std::size_t n,
 template <typename T>
 void vadd_kernel(const T *x, T *y, std::size_t m) noexcept;
 
+/// @brief y = op(a, b) elementwise
+/// @tparam T any dtype of DISPATCH_ALL
+/// @param a m-dim vector, or a single value when sa == 0
+/// @param sa element step of a, 0 or 1
+/// @param b m-dim vector, or a single value when sb == 0
+/// @param sb element step of b, 0 or 1
+/// @param y m-dim output, may alias a or b
+/// @param m vector size
+template <typename T>
+void binary_kernel(const T *a, std::size_t sa, const T *b, std::size_t sb,
+                   T *y, std::size_t m, BinaryOp op) noexcept;
+
 template <typename T>
 void gelu_kernel(const T *x, T *y, std::size_t m) noexcept;
 
+template <typename T>
+void relu_kernel(const T *x, T *y, std::size_t m) noexcept;
+
 template <typename T>
 void softmax_kernel(const T *x, T *y, std::size_t m) noexcept;
 
 template <typename T>
-void log_softmax_kernel(const T *x, T *y, std::size_t m) noexcept;
\ No newline at end of file
+void log_softmax_kernel(const T *x, T *y, std::size_t m) noexcept;
+
+/// @brief C (+)= op(A) op(B) through the BLAS backend when there is one,
+/// mm_strided_kernel otherwise. op(A) is m x k, op(B) k x n, all row-major
+/// and dense; op transposes its operand when trans_a / trans_b.
+template <typename T>
+void mm_blas_kernel(const T *A, bool trans_a, const T *B, bool trans_b, T *C,
+                    std::size_t m, std::size_t n, std::size_t k,
+                    bool accumulate);
+
+/// @brief One row of LayerNorm, y = (v - mean(v)) / sqrt(var(v) + eps)
+/// * gamma + beta with v = x + r. Mean and variance take a single pass and
+/// the row is read at most twice.
+/// @param r residual added to x, nullptr for none
+/// @param gamma, beta m-dim affine, nullptr for 1 / 0
+/// @param y m-dim output, may alias x
+/// @param h receives v = x + r when r is given (may alias x), nullptr to skip
+template <typename T>
+void layer_norm_kernel(const T *x, const T *r, const T *gamma, const T *beta,
+                       T *y, T *h, std::size_t m, T eps) noexcept;
+
+/// @brief One row of RMSNorm, y = v / sqrt(mean(v^2) + eps) * gamma with
+/// v = x + r, same conventions as layer_norm_kernel.
+template <typename T>
+void rms_norm_kernel(const T *x, const T *r, const T *gamma, T *y, T *h,
+                     std::size_t m, T eps) noexcept;
+
+// Backward of the activations : dx = dy * f'(.), added to dx instead when
+// accumulate. dx may alias dy.
+
+/// @param x input of the forward
+template <typename T>
+void gelu_backward_kernel(const T *x, const T *dy, T *dx, std::size_t m,
+                          bool accumulate) noexcept;
+
+/// @param y output of the forward
+template <typename T>
+void relu_backward_kernel(const T *y, const T *dy, T *dx, std::size_t m,
+                          bool accumulate) noexcept;
+
+/// @brief One row, dx = y * (dy - sum(dy * y)).
+/// @param y output of the forward
+template <typename T>
+void softmax_backward_kernel(const T *y, const T *dy, T *dx, std::size_t m,
+                             bool accumulate) noexcept;
+
+/// @brief One row, dx = dy - exp(y) * sum(dy).
+/// @param y output of the forward
+template <typename T>
+void log_softmax_backward_kernel(const T *y, const T *dy, T *dx,
+                                 std::size_t m, bool accumulate) noexcept;
+
+/// @brief log(sum(exp(x))) of one row in a single pass, the running max
+/// rescaling the running sum when it grows.
+template <typename T> T logsumexp_kernel(const T *x, std::size_t m) noexcept;
+
+/// @brief One row of the gradient of scale * (lse - x[target]),
+/// dx = scale * (exp(x - lse) - onehot(target)), added to dx when accumulate.
+/// @param lse logsumexp_kernel of the row
+template <typename T>
+void cross_entropy_backward_kernel(const T *x, T lse, std::size_t target,
+                                   T scale, T *dx, std::size_t m,
+                                   bool accumulate) noexcept;
+
+/// @brief Hyper-parameters of one SGD step, see optim::SGD.
+struct SGDStep {
+  double lr, momentum, weight_decay;
+  bool nesterov;
+};
+
+/// @brief Hyper-parameters of one Adam step, see optim::Adam. At step t,
+/// bias1 = 1 - beta1^t and bias2 = 1 - beta2^t.
+struct AdamStep {
+  double lr, beta1, beta2, eps, weight_decay, bias1, bias2;
+  bool decoupled;
+};
+
+/// @brief SGD update of n parameters : d = g + weight_decay p, through the
+/// momentum buffer buf = momentum buf + d when momentum != 0 (d = buf, or
+/// d + momentum buf with nesterov), then p -= lr d.
+/// @param buf momentum buffer, unused without momentum
+template <typename T>
+void sgd_kernel(T *p, const T *g, T *buf, std::size_t n,
+                const SGDStep &step) noexcept;
+
+/// @brief Adam update of n parameters : m = beta1 m + (1 - beta1) d,
+/// v = beta2 v + (1 - beta2) d^2, p -= lr (m / bias1) / (sqrt(v / bias2) +
+/// eps). d = g + weight_decay p, or d = g and p *= 1 - lr weight_decay
+/// first when decoupled (AdamW).
+template <typename T>
+void adam_kernel(T *p, const T *g, T *m, T *v, std::size_t n,
+                 const AdamStep &step) noexcept;
+
+/// @brief Values of T drawn from one Philox counter by uniform_kernel and
+/// normal_kernel : 4 floats from 24 bit draws, 2 doubles from 53 bit draws.
+template <typename T>
+inline constexpr std::size_t kPhiloxValues = sizeof(T) == 4 ? 4 : 2;
+
+/// @brief y[k] uniform in [low, high), value k of the Philox stream of seed
+/// from counter on : y[k] comes from counter + k / G, G = kPhiloxValues<T>.
+/// A chunk starting at element k0 (a multiple of G) is drawn on its own by
+/// passing y + k0 and counter + k0 / G.
+template <typename T>
+void uniform_kernel(T *y, std::size_t n, std::uint64_t seed,
+                    std::uint64_t counter, T low, T high) noexcept;
+
+/// @brief y[k] normal(mean, stdev), same stream layout as uniform_kernel.
+/// Box-Muller : each pair of draws of a counter gives a pair of values.
+template <typename T>
+void normal_kernel(T *y, std::size_t n, std::uint64_t seed,
+                   std::uint64_t counter, T mean, T stdev) noexcept;
+
+/// @brief Stream of one dropout mask : drop probability p and the Philox
+/// counters, from counter on under seed, that the mask is drawn from.
+struct DropoutStep {
+  double p;
+  std::uint64_t seed, counter;
+};
+
+/// @brief Inverted dropout of n values, y = keep ? x / (1 - p) : 0, added
+/// to y when accumulate. Value k keeps when its 24 bit draw, element
+/// first + k of the stream (4 per counter), is >= p 2^24 : the mask is
+/// generated in the same sweep, never stored, and any chunk regenerates its
+/// part of it. y may alias x.
+template <typename T>
+void dropout_kernel(const T *x, T *y, std::size_t n, std::size_t first,
+                    const DropoutStep &step, bool accumulate) noexcept;
+
+/// @brief Apply act in place to m values, taken as one row for Softmax.
+template <typename T>
+void activation_kernel(T *y, std::size_t m, Activation act) noexcept;
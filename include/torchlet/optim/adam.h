@@ -0,0 +1,47 @@
+#pragma once
+
+#include <torchlet/ops/kernel.h>
+#include <torchlet/optim/optimizer.h>
+
+namespace torchlet::optim {
+
+/// @brief Adam with weight decay added to the gradient, see adam_kernel.
+/// The first moments live in slot 0 of the flat state, the second in slot 1.
+/// The bias correction of a parameter counts its own steps, steps(i).
+class Adam : public Optimizer {
+public:
+  Adam(const std::vector<torchlet::core::Tensor> &params, double lr = 1e-3,
+       double beta1 = 0.9, double beta2 = 0.999, double eps = 1e-8,
+       double weight_decay = 0.0);
+
+  double lr() const { return m_hyper.lr; };
+  /// @brief Learning rate of the next steps, for schedules.
+  void set_lr(double lr);
+
+protected:
+  Adam(const std::vector<torchlet::core::Tensor> &params, double lr,
+       double beta1, double beta2, double eps, double weight_decay,
+       bool decoupled);
+
+private:
+  void update(float *p, const float *g, std::size_t offset,
+              std::size_t n, std::size_t step) override;
+  void update(double *p, const double *g, std::size_t offset,
+              std::size_t n, std::size_t step) override;
+  template <typename T>
+  void run(T *p, const T *g, std::size_t offset, std::size_t n,
+           std::size_t step);
+
+  AdamStep m_hyper; // bias1 and bias2 set per parameter in run
+};
+
+/// @brief Adam with decoupled weight decay : p *= 1 - lr weight_decay
+/// before the Adam update, in the same pass.
+class AdamW : public Adam {
+public:
+  AdamW(const std::vector<torchlet::core::Tensor> &params, double lr = 1e-3,
+        double beta1 = 0.9, double beta2 = 0.999, double eps = 1e-8,
+        double weight_decay = 1e-2);
+};
+
+} // namespace torchlet::optim
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <torchlet/core/tensor.h>
+#include <vector>
+
+namespace torchlet::optim {
+
+/// @brief Base of the optimizers. The parameters, dense Float32 or Float64
+/// tensors of one dtype, are updated in place by a single multi-tensor pass :
+/// their elements form one range split across the threads, and each thread
+/// runs the update kernel over the pieces of parameters its chunk covers.
+/// The per-element state lives in one flat buffer, state slot by slot, each
+/// parameter at the same offset in every slot.
+class Optimizer {
+public:
+  Optimizer(const Optimizer &) = delete;
+  Optimizer &operator=(const Optimizer &) = delete;
+  virtual ~Optimizer() = default;
+
+  /// @brief Update from the gradients autograd left in p.grad(), parameters
+  /// without one are skipped. The gradients are read through the handles
+  /// given to the constructor : call requires_grad_ before building it.
+  void step();
+  /// @brief Update from gradients given in the order of parameters(), of
+  /// their shape and dtype, an empty Tensor to skip a parameter.
+  void step(const std::vector<torchlet::core::Tensor> &grads);
+  /// @brief Drop the gradient of every parameter.
+  void zero_grad();
+
+  const std::vector<torchlet::core::Tensor> &parameters() const {
+    return m_params;
+  };
+  /// @brief Steps taken so far.
+  std::size_t steps() const { return m_steps; };
+  /// @brief Steps that updated parameter i, those it had no gradient for
+  /// left out.
+  std::size_t steps(std::size_t i) const { return m_param_steps.at(i); };
+
+protected:
+  /// @param n_state state values per parameter element, 0 for none
+  Optimizer(const std::vector<torchlet::core::Tensor> &params,
+            std::size_t n_state);
+
+  /// @brief Update n elements p of a parameter from their gradient g, offset
+  /// being the index of p[0] in the flat state and step the parameter's
+  /// steps(i), this one included.
+  virtual void update(float *p, const float *g, std::size_t offset,
+                      std::size_t n, std::size_t step) = 0;
+  virtual void update(double *p, const double *g, std::size_t offset,
+                      std::size_t n, std::size_t step) = 0;
+
+  /// @brief Slot slot of the state, from the element at offset.
+  template <typename T> T *state(std::size_t slot, std::size_t offset) {
+    return m_state.data_ptr<T>() + slot * m_numel + offset;
+  };
+
+private:
+  std::vector<torchlet::core::Tensor> m_params;
+  std::vector<std::size_t> m_offsets; // in the flat state, of each parameter
+  std::size_t m_numel = 0;
+  std::size_t m_steps = 0;
+  std::vector<std::size_t> m_param_steps; // steps(i) of each parameter
+  torchlet::core::Dtype m_dtype = torchlet::core::Dtype::Float32;
+  torchlet::core::Tensor m_state; // n_state x m_numel
+};
+
+} // namespace torchlet::optim
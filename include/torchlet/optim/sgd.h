@@ -0,0 +1,32 @@
+#pragma once
+
+#include <torchlet/ops/kernel.h>
+#include <torchlet/optim/optimizer.h>
+
+namespace torchlet::optim {
+
+/// @brief Stochastic gradient descent with momentum and weight decay (added
+/// to the gradient), optionally Nesterov, see sgd_kernel. The momentum
+/// buffers start at 0, so the first step takes the plain gradient.
+class SGD : public Optimizer {
+public:
+  SGD(const std::vector<torchlet::core::Tensor> &params, double lr,
+      double momentum = 0.0, double weight_decay = 0.0,
+      bool nesterov = false);
+
+  double lr() const { return m_hyper.lr; };
+  /// @brief Learning rate of the next steps, for schedules.
+  void set_lr(double lr);
+
+private:
+  void update(float *p, const float *g, std::size_t offset,
+              std::size_t n, std::size_t step) override;
+  void update(double *p, const double *g, std::size_t offset,
+              std::size_t n, std::size_t step) override;
+  template <typename T>
+  void run(T *p, const T *g, std::size_t offset, std::size_t n);
+
+  SGDStep m_hyper;
+};
+
+} // namespace torchlet::optim
@@ -1,8 +1,21 @@
 #pragma once
+#include <torchlet/core/allocator.h>
+#include <torchlet/core/autograd.h>
+#include <torchlet/core/cpu.h>
 #include <torchlet/core/dtype.h>
 #include <torchlet/core/index.h>
+#include <torchlet/core/parallel.h>
+#include <torchlet/core/profiler.h>
 #include <torchlet/core/tensor.h>
+#include <torchlet/io/checkpoint.h>
+#include <torchlet/io/safetensors.h>
+#include <torchlet/module/layer_norm.h>
 #include <torchlet/module/linear.h>
+#include <torchlet/module/quantized_linear.h>
+#include <torchlet/module/sequential.h>
 #include <torchlet/ops/functional.h>
 #include <torchlet/ops/init.h>
-#include <torchlet/ops/kernel.h>
\ No newline at end of file
+#include <torchlet/ops/kernel.h>
+#include <torchlet/optim/adam.h>
+#include <torchlet/optim/optimizer.h>
+#include <torchlet/optim/sgd.h>
\ No newline at end of file
@@ -9,7 +9,7 @@
 using namespace std;
 using namespace torchlet::core::index;
 using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::module::Linear,
-    torchlet::core::Generator;
+    torchlet::module::Sequential, torchlet::core::Generator;
 
 template <typename T> void rprint(Tensor &tensor, size_t dim, size_t &index) {
   std::vector<size_t> shape = tensor.shape();
@@ -65,46 +65,24 @@ template <typename T> void print_raw(Tensor &tensor) {
   std::cout << "]" << std::endl;
 }
 
-struct Module {
-
-  size_t input_dim;
-  size_t output_dim;
-  size_t n_layer;
-  size_t hidden_features;
-  Dtype dtype;
-  std::vector<Linear> modules;
-
-  Module() = delete;
-
-  Module(size_t input_dim, size_t output_dim, size_t n_layer,
-         size_t hidden_features, Dtype dtype)
-      : input_dim(input_dim), output_dim(output_dim), n_layer(n_layer),
-        hidden_features(hidden_features), dtype(dtype) {
-
-    modules.emplace_back(input_dim, hidden_features, false, dtype);
-    for (auto k = 0; k < n_layer - 2; ++k)
-      modules.emplace_back(hidden_features, hidden_features, false, dtype);
-
-    modules.emplace_back(hidden_features, output_dim, false, dtype);
-  };
-
-  Tensor forward(Tensor &x) {
-    Tensor out = x;
-    for (auto k = 0; k < n_layer - 1; ++k) {
-      auto mod = modules[k];
-      out = mod.forward(out);
-      out = torchlet::ops::gelu(out);
-    }
-    out = modules.back().forward(out);
-    out = torchlet::ops::softmax(out);
-    return out;
-  }
+// n_layer Linear layers with GELU in between and a softmax head.
+Sequential mlp(size_t input_dim, size_t output_dim, size_t n_layer,
+               size_t hidden_features, Dtype dtype) {
+  Sequential nn;
+  nn.add(Linear(input_dim, hidden_features, false, dtype))
+      .add(Activation::GELU);
+  for (size_t k = 0; k + 2 < n_layer; ++k)
+    nn.add(Linear(hidden_features, hidden_features, false, dtype))
+        .add(Activation::GELU);
+  nn.add(Linear(hidden_features, output_dim, false, dtype))
+      .add(Activation::Softmax);
+  return nn;
 };
 
 int main() {
 
   Generator::global().manual_seed(42);
-  Module nn(5, 10, 3, 10, Dtype::Float32);
+  Sequential nn = mlp(5, 10, 3, 10, Dtype::Float32);
   Tensor x({5}, Dtype::Float32);
   torchlet::ops::init::normal_(x, 0.0f, 1.0f);
 
@@ -0,0 +1,52 @@
+#include <cmath>
+#include <stdexcept>
+#include <torchlet/optim/adam.h>
+
+using torchlet::optim::Adam, torchlet::optim::AdamW, torchlet::core::Tensor;
+
+Adam::Adam(const std::vector<Tensor> &params, double lr, double beta1,
+           double beta2, double eps, double weight_decay)
+    : Adam(params, lr, beta1, beta2, eps, weight_decay, false) {};
+
+Adam::Adam(const std::vector<Tensor> &params, double lr, double beta1,
+           double beta2, double eps, double weight_decay, bool decoupled)
+    : Optimizer(params, 2),
+      m_hyper{lr, beta1, beta2, eps, weight_decay, 1.0, 1.0, decoupled} {
+  if (lr < 0.0 || eps < 0.0 || weight_decay < 0.0)
+    throw std::invalid_argument(
+        "lr, eps and weight_decay must be non negative.");
+  if (beta1 < 0.0 || beta1 >= 1.0 || beta2 < 0.0 || beta2 >= 1.0)
+    throw std::invalid_argument("betas must be in [0, 1).");
+};
+
+void Adam::set_lr(double lr) {
+  if (lr < 0.0)
+    throw std::invalid_argument("lr must be non negative.");
+  m_hyper.lr = lr;
+};
+
+// Bias correction from the parameter's own step count : one that had no
+// gradient on some steps is not under-corrected on its first update.
+template <typename T>
+void Adam::run(T *p, const T *g, std::size_t offset, std::size_t n,
+               std::size_t step) {
+  AdamStep hyper = m_hyper;
+  const double t = static_cast<double>(step);
+  hyper.bias1 = 1.0 - std::pow(hyper.beta1, t);
+  hyper.bias2 = 1.0 - std::pow(hyper.beta2, t);
+  adam_kernel(p, g, state<T>(0, offset), state<T>(1, offset), n, hyper);
+};
+
+void Adam::update(float *p, const float *g, std::size_t offset,
+                  std::size_t n, std::size_t step) {
+  run(p, g, offset, n, step);
+};
+
+void Adam::update(double *p, const double *g, std::size_t offset,
+                  std::size_t n, std::size_t step) {
+  run(p, g, offset, n, step);
+};
+
+AdamW::AdamW(const std::vector<Tensor> &params, double lr, double beta1,
+             double beta2, double eps, double weight_decay)
+    : Adam(params, lr, beta1, beta2, eps, weight_decay, true) {};
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <torchlet/core/allocator.h>
+
+using torchlet::core::Allocator, torchlet::core::AlignedAllocator,
+    torchlet::core::CachingAllocator, torchlet::core::Arena,
+    torchlet::core::ArenaGuard;
+
+namespace {
+
+inline std::size_t align_up(std::size_t n, std::size_t a) noexcept {
+  return (n + a - 1) / a * a;
+};
+
+void *system_alloc(std::size_t nbytes) {
+  // aligned_alloc wants a multiple of the alignment, and never 0 bytes
+  nbytes = align_up(nbytes ? nbytes : 1, torchlet::core::ALIGNMENT);
+  void *ptr = std::aligned_alloc(torchlet::core::ALIGNMENT, nbytes);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+};
+
+// nullptr means the caching allocator; constant initialised so tensors
+// built during static initialisation see a valid state.
+std::atomic<Allocator *> g_allocator{nullptr};
+thread_local Allocator *t_arena = nullptr;
+
+} // namespace
+
+// AlignedAllocator
+
+void *AlignedAllocator::allocate(std::size_t nbytes) {
+  return system_alloc(nbytes);
+};
+
+void AlignedAllocator::deallocate(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+};
+
+// CachingAllocator
+
+CachingAllocator::~CachingAllocator() { empty_cache(); };
+
+std::size_t CachingAllocator::round_size(std::size_t nbytes) noexcept {
+  if (nbytes <= 256)
+    return align_up(nbytes ? nbytes : 1, ALIGNMENT);
+
+  std::size_t pow2 = 256;
+  while (pow2 * 2 < nbytes)
+    pow2 *= 2;
+  return align_up(nbytes, pow2 / 4);
+};
+
+void *CachingAllocator::allocate(std::size_t nbytes) {
+  const std::size_t size = round_size(nbytes);
+  {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto it = m_free.find(size);
+    if (it != m_free.end() && !it->second.empty()) {
+      void *ptr = it->second.back();
+      it->second.pop_back();
+      m_stats.cached_bytes -= size;
+      m_stats.allocated_bytes += size;
+      m_stats.n_reused++;
+      return ptr;
+    }
+  }
+
+  void *ptr = system_alloc(size);
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_stats.allocated_bytes += size;
+  m_stats.n_fresh++;
+  return ptr;
+};
+
+void CachingAllocator::deallocate(void *ptr, std::size_t nbytes) noexcept {
+  if (!ptr)
+    return;
+  const std::size_t size = round_size(nbytes);
+
+  std::lock_guard<std::mutex> lk(m_mutex);
+  m_stats.allocated_bytes -= size;
+  try {
+    m_free[size].push_back(ptr);
+    m_stats.cached_bytes += size;
+  } catch (...) {
+    std::free(ptr); // could not grow the free list, drop the block
+  }
+};
+
+void CachingAllocator::empty_cache() noexcept {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  for (auto &kv : m_free)
+    for (void *ptr : kv.second)
+      std::free(ptr);
+  m_free.clear();
+  m_stats.cached_bytes = 0;
+};
+
+CachingAllocator::Stats CachingAllocator::stats() const {
+  std::lock_guard<std::mutex> lk(m_mutex);
+  return m_stats;
+};
+
+// Arena
+
+Arena::Arena(std::size_t block_size)
+    : m_block_size(align_up(block_size ? block_size : 1, ALIGNMENT)) {};
+
+Arena::~Arena() {
+  for (auto &blk : m_blocks)
+    std::free(blk.data);
+};
+
+void *Arena::allocate(std::size_t nbytes) {
+  const std::size_t size = align_up(nbytes ? nbytes : 1, ALIGNMENT);
+
+  while (m_block < m_blocks.size()) {
+    Block &blk = m_blocks[m_block];
+    if (m_offset + size <= blk.size) {
+      void *ptr = blk.data + m_offset;
+      m_offset += size;
+      m_live++;
+      return ptr;
+    }
+    m_block++;
+    m_offset = 0;
+  }
+
+  const std::size_t blk_size = std::max(m_block_size, size);
+  m_blocks.push_back({static_cast<std::byte *>(system_alloc(blk_size)),
+                      blk_size});
+  m_block = m_blocks.size() - 1;
+  m_offset = size;
+  m_live++;
+  return m_blocks.back().data;
+};
+
+void Arena::deallocate(void *, std::size_t) noexcept { m_live--; };
+
+void Arena::reset() {
+  if (m_live.load() != 0)
+    throw std::runtime_error("Arena reset while " +
+                             std::to_string(m_live.load()) +
+                             " buffers are still alive.");
+  m_block = 0;
+  m_offset = 0;
+};
+
+std::size_t Arena::capacity() const noexcept {
+  std::size_t total = 0;
+  for (auto &blk : m_blocks)
+    total += blk.size;
+  return total;
+};
+
+// Guard and global state
+
+ArenaGuard::ArenaGuard(Arena &arena) noexcept : m_prev(t_arena) {
+  t_arena = &arena;
+};
+
+ArenaGuard::~ArenaGuard() { t_arena = m_prev; };
+
+CachingAllocator &torchlet::core::caching_allocator() noexcept {
+  // Leaked on purpose : tensors with static storage duration may still
+  // release their buffers after the end of main.
+  static CachingAllocator *alloc = new CachingAllocator();
+  return *alloc;
+};
+
+Allocator *torchlet::core::get_allocator() noexcept {
+  if (t_arena)
+    return t_arena;
+  Allocator *alloc = g_allocator.load(std::memory_order_relaxed);
+  return alloc ? alloc : &caching_allocator();
+};
+
+void torchlet::core::set_allocator(Allocator *alloc) noexcept {
+  g_allocator.store(alloc);
+};
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <torchlet/ops/kernel.h>
+
+// FlashAttention-style tiling : a block of query rows walks the keys one
+// block at a time. Each row keeps its running max m and normaliser l, and
+// its accumulated output is rescaled by exp(m_old - m_new) whenever a block
+// raises the max, so the L x L score matrix is never stored.
+
+namespace {
+
+// Query rows per tile, and keys per tile : the Br x Bc scores and the
+// Br x dv accumulators stay in L1 / L2.
+constexpr std::size_t kBr = 64;
+constexpr std::size_t kBc = 64;
+
+} // namespace
+
+template <typename T>
+void attention_kernel(const T *Q, const T *K, const T *V, T *O,
+                      std::size_t q_begin, std::size_t q_end, std::size_t Lk,
+                      std::size_t d, std::size_t dv, T scale, bool causal) {
+  if (Lk == 0) {
+    std::fill(O + q_begin * dv, O + q_end * dv, T{0});
+    return;
+  }
+
+  thread_local std::vector<T> buf;
+  buf.resize(kBr * kBc + 2 * kBr * dv + 2 * kBr);
+  T *S = buf.data();          // scores, then probabilities, br x bc
+  T *PV = S + kBr * kBc;      // P V of the current key block, br x dv
+  T *acc = PV + kBr * dv;     // unnormalised output, br x dv
+  T *row_max = acc + kBr * dv;
+  T *row_sum = row_max + kBr;
+
+  for (std::size_t i0 = q_begin; i0 < q_end; i0 += kBr) {
+    const std::size_t br = std::min(kBr, q_end - i0);
+    // with the mask, keys past the last row of the block are never seen
+    const std::size_t k_end = causal ? std::min(Lk, i0 + br) : Lk;
+
+    std::fill(acc, acc + br * dv, T{0});
+    std::fill(row_sum, row_sum + br, T{0});
+
+    for (std::size_t j0 = 0; j0 < k_end; j0 += kBc) {
+      const std::size_t bc = std::min(kBc, k_end - j0);
+
+      // S = Q_i K_j^T, K read transposed in place
+      mm_strided_kernel(Q + i0 * d, d, std::size_t{1}, K + j0 * d,
+                        std::size_t{1}, d, S, bc, br, bc, d);
+
+      for (std::size_t i = 0; i < br; ++i) {
+        T *s = S + i * bc;
+        // keys j0 + j > i0 + i are masked out, every row keeps key 0
+        const std::size_t visible =
+            causal ? std::min(bc, i0 + i + 1 - std::min(i0 + i + 1, j0)) : bc;
+
+        // -ffast-math assumes no infinities : the first block starts the
+        // row instead of rescaling from -inf
+        T m = j0 == 0 ? std::numeric_limits<T>::lowest() : row_max[i];
+        for (std::size_t j = 0; j < visible; ++j) {
+          s[j] *= scale;
+          m = std::max(m, s[j]);
+        }
+        T sum{0};
+        for (std::size_t j = 0; j < visible; ++j) {
+          s[j] = std::exp(s[j] - m);
+          sum += s[j];
+        }
+        std::fill(s + visible, s + bc, T{0});
+
+        const T alpha = j0 == 0 ? T{0} : std::exp(row_max[i] - m);
+        row_max[i] = m;
+        row_sum[i] = row_sum[i] * alpha + sum;
+        T *a = acc + i * dv;
+        for (std::size_t c = 0; c < dv; ++c)
+          a[c] *= alpha;
+      }
+
+      mm_strided_kernel(static_cast<const T *>(S), bc, std::size_t{1},
+                        V + j0 * dv, dv, std::size_t{1}, PV, dv, br, dv, bc);
+      for (std::size_t e = 0; e < br * dv; ++e)
+        acc[e] += PV[e];
+    }
+
+    for (std::size_t i = 0; i < br; ++i) {
+      const T inv = T{1} / row_sum[i];
+      T *o = O + (i0 + i) * dv;
+      for (std::size_t c = 0; c < dv; ++c)
+        o[c] = acc[i * dv + c] * inv;
+    }
+  }
+};
+
+template void attention_kernel(const float *Q, const float *K, const float *V,
+                               float *O, std::size_t q_begin,
+                               std::size_t q_end, std::size_t Lk,
+                               std::size_t d, std::size_t dv, float scale,
+                               bool causal);
+template void attention_kernel(const double *Q, const double *K,
+                               const double *V, double *O, std::size_t q_begin,
+                               std::size_t q_end, std::size_t Lk,
+                               std::size_t d, std::size_t dv, double scale,
+                               bool causal);
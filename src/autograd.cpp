@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include <torchlet/core/autograd.h>
+#include <torchlet/core/profiler.h>
+#include <torchlet/ops/functional.h>
+
+#include "detail/validators.h"
+
+using torchlet::core::AutogradMeta, torchlet::core::Node,
+    torchlet::core::NoGradGuard, torchlet::core::Tensor;
+
+namespace {
+
+// Ops record on the thread that runs them : one tape per thread.
+thread_local std::vector<std::shared_ptr<Node>> t_tape;
+thread_local bool t_grad_enabled = true;
+
+} // namespace
+
+Tensor &Tensor::requires_grad_(bool requires_grad) {
+  if (!m_autograd) {
+    if (!requires_grad)
+      return *this;
+    m_autograd = std::make_shared<AutogradMeta>();
+  }
+  m_autograd->requires_grad = requires_grad;
+  return *this;
+};
+
+bool Tensor::requires_grad() const noexcept {
+  return m_autograd && m_autograd->requires_grad;
+};
+
+Tensor Tensor::grad() const {
+  return m_autograd ? m_autograd->grad : Tensor();
+};
+
+void Tensor::zero_grad() noexcept {
+  if (m_autograd)
+    m_autograd->grad = Tensor();
+};
+
+bool torchlet::core::grad_enabled() noexcept { return t_grad_enabled; };
+
+NoGradGuard::NoGradGuard() : m_prev(t_grad_enabled) {
+  t_grad_enabled = false;
+};
+
+NoGradGuard::~NoGradGuard() { t_grad_enabled = m_prev; };
+
+bool torchlet::core::needs_grad(
+    std::initializer_list<const Tensor *> tensors) noexcept {
+  if (!t_grad_enabled)
+    return false;
+  for (const Tensor *t : tensors)
+    if (t && t->requires_grad())
+      return true;
+  return false;
+};
+
+void torchlet::core::record(std::shared_ptr<Node> node, Tensor &output) {
+  if (output.dtype() != Dtype::Float32 && output.dtype() != Dtype::Float64)
+    throw std::runtime_error(
+        "Autograd supports Float32 and Float64 tensors only.");
+
+  output.requires_grad_();
+  output.m_autograd->is_leaf = false;
+  node->m_output = output.m_autograd;
+  t_tape.push_back(std::move(node));
+};
+
+void torchlet::core::backward(const Tensor &output, const Tensor &grad) {
+  if (!output.requires_grad())
+    throw std::runtime_error("backward : the tensor does not require grad.");
+
+  const bool seeded = torchlet::detail::has_data(grad);
+  if (!seeded && output.numel() != 1)
+    throw std::runtime_error(
+        "backward : grad must be given for a tensor of several elements.");
+  if (seeded && (grad.shape() != output.shape() ||
+                 grad.dtype() != output.dtype()))
+    throw std::runtime_error("backward : grad must match the tensor.");
+  if (!output.m_autograd->is_leaf &&
+      std::none_of(t_tape.begin(), t_tape.end(), [&](const auto &node) {
+        return node->m_output == output.m_autograd;
+      }))
+    throw std::runtime_error(
+        "backward : the graph of the tensor was already run or cleared.");
+  const Tensor seed =
+      seeded ? grad : Tensor::ones(output.shape(), output.dtype());
+
+  // Copied : nodes overwrite the gradient they receive.
+  bool fresh = false;
+  Tensor *g = grad_buffer(output, fresh);
+  if (fresh)
+    g->copy_(seed);
+  else
+    torchlet::ops::add_(*g, seed);
+
+  // Nodes run in reverse recording order, after every node that reads their
+  // output. The tape is moved out first so that a throwing node leaves an
+  // empty one.
+  std::vector<std::shared_ptr<Node>> tape = std::move(t_tape);
+  t_tape.clear();
+  std::vector<std::shared_ptr<Node>> kept;
+  for (auto it = tape.rbegin(); it != tape.rend(); ++it) {
+    AutogradMeta &meta = *(*it)->m_output;
+    if (!torchlet::detail::has_data(meta.grad)) {
+      // Not reached from output. Its output is held by a tensor handle or by
+      // a later node that reads it, unless only the node itself is left :
+      // then no backward can reach it any more.
+      if ((*it)->m_output.use_count() > 1)
+        kept.push_back(std::move(*it));
+      else
+        it->reset();
+      continue;
+    }
+    // an intermediate's gradient is only needed by its node
+    Tensor g_out = std::move(meta.grad);
+    meta.grad = Tensor();
+    RecordScope scope((*it)->name());
+    (*it)->backward(g_out);
+    it->reset();
+  }
+  t_tape.assign(std::make_move_iterator(kept.rbegin()),
+                std::make_move_iterator(kept.rend()));
+};
+
+void torchlet::core::clear_tape() noexcept { t_tape.clear(); };
+
+std::size_t torchlet::core::tape_size() noexcept { return t_tape.size(); };
+
+Tensor *torchlet::core::grad_buffer(const Tensor &t, bool &fresh,
+                                    Tensor *donor) {
+  if (!t.requires_grad())
+    return nullptr;
+  AutogradMeta &meta = *t.m_autograd;
+  fresh = !torchlet::detail::has_data(meta.grad);
+  if (fresh)
+    meta.grad = donor ? *donor : Tensor(t.shape(), t.dtype());
+  return &meta.grad;
+};
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <torchlet/core/autograd.h>
+#include <torchlet/core/parallel.h>
+#include <torchlet/ops/functional.h>
+
+#include "detail/backward.h"
+#include "detail/validators.h"
+
+using torchlet::core::Node, torchlet::core::Tensor, torchlet::detail::Unary;
+
+namespace {
+
+template <typename T> T *ptr(Tensor &t) {
+  return t.data_ptr<T>() + t.elem_offset();
+};
+
+template <typename T> const T *ptr(const Tensor &t) {
+  return t.data_ptr<T>() + t.elem_offset();
+};
+
+// dx (+)= f'(saved) dy over rows of m values, elementwise ops taking the
+// whole tensor as one row split across the threads.
+template <typename T, typename Kernel>
+void unary_rows(const T *saved, const T *dy, T *dx, std::size_t numel,
+                std::size_t m, bool accumulate, Kernel kernel) {
+  if (numel == 0)
+    return;
+  const std::size_t rows = numel / m;
+  torchlet::parallel_for(
+      0, rows, std::max<std::size_t>(torchlet::GRAIN_SIZE / m, 1),
+      [&](std::size_t r0, std::size_t r1) {
+        for (std::size_t r = r0; r < r1; ++r)
+          kernel(saved + r * m, dy + r * m, dx + r * m, m, accumulate);
+      });
+};
+
+template <typename T, typename Kernel>
+void unary_elementwise(const T *saved, const T *dy, T *dx, std::size_t numel,
+                       bool accumulate, Kernel kernel) {
+  torchlet::parallel_for(0, numel, torchlet::GRAIN_SIZE,
+                         [&](std::size_t k0, std::size_t k1) {
+                           kernel(saved + k0, dy + k0, dx + k0, k1 - k0,
+                                  accumulate);
+                         });
+};
+
+// dx (+)= dropout(dy), the mask drawn again from its stream.
+template <typename T>
+void dropout_backward(const T *dy, T *dx, std::size_t numel,
+                      const DropoutStep &step, bool accumulate) {
+  torchlet::parallel_for(0, numel, torchlet::GRAIN_SIZE,
+                         [&](std::size_t k0, std::size_t k1) {
+                           dropout_kernel(dy + k0, dx + k0, k1 - k0, k0, step,
+                                          accumulate);
+                         });
+};
+
+// dx (+)= op'(saved) g, dx may be g.
+template <typename T>
+void unary_backward(Unary op, const Tensor &saved, const T *g, T *dx,
+                    bool accumulate) {
+  const T *ps = ptr<T>(saved);
+  const std::size_t n = saved.numel();
+  switch (op) {
+  case Unary::GELU:
+    return unary_elementwise(ps, g, dx, n, accumulate,
+                             gelu_backward_kernel<T>);
+  case Unary::ReLU:
+    return unary_elementwise(ps, g, dx, n, accumulate,
+                             relu_backward_kernel<T>);
+  case Unary::Softmax:
+    return unary_rows(ps, g, dx, n, saved.shape().back(), accumulate,
+                      softmax_backward_kernel<T>);
+  case Unary::LogSoftmax:
+    return unary_rows(ps, g, dx, n, saved.shape().back(), accumulate,
+                      log_softmax_backward_kernel<T>);
+  }
+};
+
+/// GELU saves its input, the others their output.
+class UnaryBackward : public Node {
+public:
+  UnaryBackward(Unary op, const Tensor &x, const Tensor &saved)
+      : m_op(op), m_x(x), m_saved(saved.contiguous()) {};
+
+  const char *name() const noexcept override {
+    switch (m_op) {
+    case Unary::GELU:
+      return "gelu_backward";
+    case Unary::ReLU:
+      return "relu_backward";
+    case Unary::Softmax:
+      return "softmax_backward";
+    default:
+      return "log_softmax_backward";
+    }
+  };
+
+  // A first gradient for x is computed in place in g, which x then keeps.
+  void backward(Tensor &g) override {
+    bool fresh = false;
+    Tensor *gx = torchlet::core::grad_buffer(m_x, fresh, &g);
+    if (!gx)
+      return;
+    DISPATCH_FLOAT(g.dtype(), scalar_t, {
+      unary_backward<scalar_t>(m_op, m_saved, ptr<scalar_t>(g),
+                               ptr<scalar_t>(*gx), !fresh);
+    })
+  };
+
+private:
+  Unary m_op;
+  Tensor m_x, m_saved;
+};
+
+/// out = dropout(x) : dx (+)= the same mask applied to g. Only the stream
+/// of the mask is kept.
+class DropoutBackward : public Node {
+public:
+  DropoutBackward(const Tensor &x, const DropoutStep &step)
+      : m_x(x), m_step(step) {};
+
+  const char *name() const noexcept override { return "dropout_backward"; };
+
+  void backward(Tensor &g) override {
+    bool fresh = false;
+    Tensor *gx = torchlet::core::grad_buffer(m_x, fresh, &g);
+    if (!gx)
+      return;
+    DISPATCH_FLOAT(g.dtype(), scalar_t, {
+      dropout_backward<scalar_t>(ptr<scalar_t>(g), ptr<scalar_t>(*gx),
+                                 g.numel(), m_step, !fresh);
+    })
+  };
+
+private:
+  Tensor m_x;
+  DropoutStep m_step;
+};
+
+/// out = act(x W^T + b) : g goes through the activation in place, then
+/// dx (+)= g W, dW (+)= g^T x and db (+)= the sum of the rows of g. GELU
+/// recomputes its input rather than keeping it alive until backward. A
+/// fused dropout goes first, its mask drawn again.
+class LinearBackward : public Node {
+public:
+  LinearBackward(const Tensor &x, const Tensor &weights, const Tensor &bias,
+                 const Tensor &out, Activation act, const DropoutStep &dropout)
+      : m_x(x), m_weights(weights), m_bias(bias), m_act(act),
+        m_dropout(dropout) {
+    if (act == Activation::ReLU || act == Activation::Softmax)
+      m_out = out;
+  };
+
+  const char *name() const noexcept override { return "linear_backward"; };
+
+  void backward(Tensor &g) override {
+    DISPATCH_FLOAT(g.dtype(), scalar_t, { run<scalar_t>(g); })
+  };
+
+private:
+  template <typename T> void run(Tensor &g) {
+    const std::size_t N = m_weights.shape()[0], K = m_weights.shape()[1];
+    const std::size_t M = N ? g.numel() / N : 0;
+    T *pg = ptr<T>(g);
+
+    if (m_dropout.p > 0.0)
+      dropout_backward(static_cast<const T *>(pg), pg, g.numel(), m_dropout,
+                       false);
+    switch (m_act) {
+    case Activation::ReLU:
+      unary_backward<T>(Unary::ReLU, m_out, pg, pg, false);
+      break;
+    case Activation::Softmax:
+      unary_backward<T>(Unary::Softmax, m_out, pg, pg, false);
+      break;
+    case Activation::GELU: {
+      torchlet::core::NoGradGuard guard;
+      const Tensor pre = torchlet::ops::linear(m_x, m_weights, m_bias);
+      unary_backward<T>(Unary::GELU, pre, pg, pg, false);
+      break;
+    }
+    default:
+      break;
+    }
+
+    bool fresh = false;
+    if (Tensor *gx = torchlet::core::grad_buffer(m_x, fresh)) {
+      const Tensor w = m_weights.contiguous();
+      mm_blas_kernel(static_cast<const T *>(pg), false, ptr<T>(w), false,
+                     ptr<T>(*gx), M, K, N, !fresh);
+    }
+    if (Tensor *gw = torchlet::core::grad_buffer(m_weights, fresh)) {
+      const Tensor x = m_x.contiguous();
+      mm_blas_kernel(static_cast<const T *>(pg), true, ptr<T>(x), false,
+                     ptr<T>(*gw), N, K, M, !fresh);
+    }
+    if (Tensor *gb = torchlet::core::grad_buffer(m_bias, fresh)) {
+      T *pb = ptr<T>(*gb);
+      torchlet::parallel_for(
+          0, N, std::max<std::size_t>(torchlet::GRAIN_SIZE / (M + 1), 1),
+          [&](std::size_t j0, std::size_t j1) {
+            if (fresh)
+              std::fill(pb + j0, pb + j1, T{0});
+            for (std::size_t i = 0; i < M; ++i)
+              vadd_kernel(pg + i * N + j0, pb + j0, j1 - j0);
+          });
+    }
+  };
+
+  Tensor m_x, m_weights, m_bias, m_out;
+  Activation m_act;
+  DropoutStep m_dropout;
+};
+
+/// loss = mean(lse - x[target]) : dx (+)= g / rows (softmax(x) -
+/// onehot(target)), written straight from the logits and the saved lse.
+class CrossEntropyBackward : public Node {
+public:
+  CrossEntropyBackward(const Tensor &logits, const Tensor &targets,
+                       const Tensor &lse)
+      : m_logits(logits), m_targets(targets.contiguous()), m_lse(lse) {};
+
+  const char *name() const noexcept override {
+    return "cross_entropy_backward";
+  };
+
+  void backward(Tensor &g) override {
+    DISPATCH_FLOAT(g.dtype(), scalar_t, { run<scalar_t>(g); })
+  };
+
+private:
+  template <typename T> void run(const Tensor &g) {
+    bool fresh = false;
+    Tensor *gx = torchlet::core::grad_buffer(m_logits, fresh);
+    if (!gx)
+      return;
+    const Tensor x = m_logits.contiguous();
+    const std::size_t C = x.shape().back(), rows = m_lse.numel();
+    const T scale = ptr<T>(g)[0] / static_cast<T>(rows);
+    const T *px = ptr<T>(x), *plse = ptr<T>(m_lse);
+    const std::int64_t *pt = ptr<std::int64_t>(m_targets);
+    T *pdx = ptr<T>(*gx);
+
+    torchlet::parallel_for(
+        0, rows, std::max<std::size_t>(torchlet::GRAIN_SIZE / (C + 1), 1),
+        [&](std::size_t r0, std::size_t r1) {
+          for (std::size_t r = r0; r < r1; ++r)
+            cross_entropy_backward_kernel(
+                px + r * C, plse[r], static_cast<std::size_t>(pt[r]), scale,
+                pdx + r * C, C, !fresh);
+        });
+  };
+
+  Tensor m_logits, m_targets, m_lse;
+};
+
+} // namespace
+
+void torchlet::detail::record_unary(Unary op, const Tensor &x, Tensor &out) {
+  torchlet::core::record(
+      std::make_shared<UnaryBackward>(op, x, op == Unary::GELU ? x : out),
+      out);
+};
+
+void torchlet::detail::record_linear(const Tensor &x, const Tensor &weights,
+                                     const Tensor &bias, Tensor &out,
+                                     Activation act,
+                                     const DropoutStep &dropout) {
+  if (weights.dtype() != x.dtype() ||
+      (has_data(bias) && bias.dtype() != x.dtype()))
+    throw std::runtime_error(
+        "Autograd needs x, weights and bias of the same dtype.");
+  torchlet::core::record(
+      std::make_shared<LinearBackward>(x, weights, bias, out, act, dropout),
+      out);
+};
+
+void torchlet::detail::record_dropout(const Tensor &x, Tensor &out,
+                                      const DropoutStep &step) {
+  torchlet::core::record(std::make_shared<DropoutBackward>(x, step), out);
+};
+
+void torchlet::detail::record_cross_entropy(const Tensor &logits,
+                                            const Tensor &targets,
+                                            const Tensor &lse, Tensor &loss) {
+  torchlet::core::record(
+      std::make_shared<CrossEntropyBackward>(logits, targets, lse), loss);
+};
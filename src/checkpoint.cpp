@@ -0,0 +1,164 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <torchlet/io/checkpoint.h>
+
+#include "detail/helpers.h"
+#include "detail/mmap.h"
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::io::TensorDict;
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'L', 'C', 'K', 'P', 'T', '0', '1'};
+constexpr std::size_t kMaxDtype = static_cast<std::size_t>(Dtype::BFloat16);
+
+std::size_t align_up(std::size_t n) {
+  const std::size_t a = torchlet::core::ALIGNMENT;
+  return (n + a - 1) / a * a;
+};
+
+template <typename T> void put(std::string &buf, T v) {
+  buf.append(reinterpret_cast<const char *>(&v), sizeof(T));
+};
+
+// Bounds checked reads of the header.
+class Reader {
+public:
+  Reader(const std::uint8_t *data, std::size_t size)
+      : m_data(data), m_size(size) {};
+
+  template <typename T> T get() {
+    T v;
+    std::memcpy(&v, take(sizeof(T)), sizeof(T));
+    return v;
+  };
+  std::size_t remaining() const noexcept { return m_size - m_pos; };
+  std::string str(std::size_t n) {
+    const std::uint8_t *p = take(n);
+    return std::string(reinterpret_cast<const char *>(p), n);
+  };
+
+private:
+  const std::uint8_t *take(std::size_t n) {
+    if (n > m_size - m_pos)
+      throw std::runtime_error("Truncated checkpoint header.");
+    const std::uint8_t *p = m_data + m_pos;
+    m_pos += n;
+    return p;
+  };
+
+  const std::uint8_t *m_data;
+  std::size_t m_size;
+  std::size_t m_pos = 0;
+};
+
+} // namespace
+
+void torchlet::io::save(const std::string &path, const TensorDict &tensors) {
+
+  std::vector<Tensor> dense;
+  dense.reserve(tensors.size());
+  for (const auto &[name, t] : tensors)
+    dense.push_back(t.contiguous());
+
+  // header size first : the data offsets depend on it
+  std::size_t header_size = sizeof(std::uint64_t);
+  for (const auto &[name, t] : tensors)
+    header_size += 2 * sizeof(std::uint32_t) + sizeof(std::uint32_t) +
+                   name.size() + t.shape().size() * sizeof(std::uint64_t) +
+                   2 * sizeof(std::uint64_t);
+
+  std::string header;
+  header.reserve(header_size);
+  put<std::uint64_t>(header, tensors.size());
+
+  std::vector<std::size_t> offsets;
+  std::size_t offset =
+      align_up(sizeof(kMagic) + sizeof(std::uint64_t) + header_size);
+  for (const auto &[name, t] : tensors) {
+    const std::size_t nbytes = torchlet::detail::nbytes(t.shape(), t.dtype());
+    put<std::uint32_t>(header, static_cast<std::uint32_t>(name.size()));
+    header += name;
+    put<std::uint32_t>(header, static_cast<std::uint32_t>(t.dtype()));
+    put<std::uint32_t>(header, static_cast<std::uint32_t>(t.shape().size()));
+    for (std::size_t d : t.shape())
+      put<std::uint64_t>(header, d);
+    put<std::uint64_t>(header, offset);
+    put<std::uint64_t>(header, nbytes);
+    offsets.push_back(offset);
+    offset = align_up(offset + nbytes);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Cannot open " + path + " for writing.");
+
+  out.write(kMagic, sizeof(kMagic));
+  const std::uint64_t hsize = header.size();
+  out.write(reinterpret_cast<const char *>(&hsize), sizeof(hsize));
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+  std::size_t pos = sizeof(kMagic) + sizeof(hsize) + header.size();
+  const char zeros[torchlet::core::ALIGNMENT] = {};
+  for (std::size_t k = 0; k < dense.size(); ++k) {
+    out.write(zeros, static_cast<std::streamsize>(offsets[k] - pos));
+    const Tensor &t = dense[k];
+    const std::size_t nbytes = torchlet::detail::nbytes(t.shape(), t.dtype());
+    if (nbytes)
+      out.write(t.data_ptr<char>() +
+                    t.elem_offset() * torchlet::detail::dtype_size(t.dtype()),
+                static_cast<std::streamsize>(nbytes));
+    pos = offsets[k] + nbytes;
+  }
+  // pad the last block so that the file ends on the alignment too
+  out.write(zeros, static_cast<std::streamsize>(align_up(pos) - pos));
+
+  if (!out)
+    throw std::runtime_error("Failed writing " + path + ".");
+};
+
+TensorDict torchlet::io::load(const std::string &path) {
+  const auto map = torchlet::detail::map_file(path);
+  const auto *base = static_cast<const std::uint8_t *>(map->data);
+
+  Reader prefix(base, map->size);
+  if (prefix.str(sizeof(kMagic)) != std::string(kMagic, sizeof(kMagic)))
+    throw std::runtime_error(path + " is not a torchlet checkpoint.");
+  const auto header_size = prefix.get<std::uint64_t>();
+  const std::size_t data_start = sizeof(kMagic) + sizeof(std::uint64_t);
+  if (header_size > map->size - data_start)
+    throw std::runtime_error("Truncated checkpoint header.");
+
+  Reader header(base + data_start, header_size);
+  const auto n_tensors = header.get<std::uint64_t>();
+
+  TensorDict tensors;
+  for (std::uint64_t k = 0; k < n_tensors; ++k) {
+    const std::string name = header.str(header.get<std::uint32_t>());
+    const auto dtype = header.get<std::uint32_t>();
+    if (dtype > kMaxDtype)
+      throw std::runtime_error("Unknown dtype for " + name + ".");
+    // the dims must fit in the header before they are allocated
+    const auto ndim = header.get<std::uint32_t>();
+    if (ndim > header.remaining() / sizeof(std::uint64_t))
+      throw std::runtime_error("Truncated checkpoint header.");
+    std::vector<std::size_t> shape(ndim);
+    for (auto &d : shape)
+      d = header.get<std::uint64_t>();
+    const auto offset = header.get<std::uint64_t>();
+    const auto nbytes = header.get<std::uint64_t>();
+
+    const Dtype dt = static_cast<Dtype>(dtype);
+    std::size_t expected = 0;
+    if (!torchlet::detail::checked_nbytes(shape, dt, expected) ||
+        nbytes != expected ||
+        offset % torchlet::core::ALIGNMENT != 0 || offset > map->size ||
+        nbytes > map->size - offset)
+      throw std::runtime_error("Corrupt checkpoint entry " + name + ".");
+
+    auto storage = torchlet::detail::view_storage(map, offset, nbytes);
+    tensors.emplace(name, Tensor::from_storage(storage, shape, dt));
+  }
+  return tensors;
+};
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <torchlet/core/cpu.h>
+
+using torchlet::core::CpuCapability;
+
+namespace {
+
+CpuCapability detect() noexcept {
+#if TORCHLET_HAVE_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512bw") &&
+      __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("f16c"))
+    return CpuCapability::AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+      __builtin_cpu_supports("f16c"))
+    return CpuCapability::AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return CpuCapability::SSE4;
+#endif
+  return CpuCapability::Default;
+};
+
+CpuCapability initial() noexcept {
+  CpuCapability cap = torchlet::core::max_cpu_capability();
+  const char *env = std::getenv("TORCHLET_CPU_CAPABILITY");
+  if (!env)
+    return cap;
+
+  CpuCapability req = cap;
+  if (std::strcmp(env, "default") == 0)
+    req = CpuCapability::Default;
+  else if (std::strcmp(env, "sse4") == 0)
+    req = CpuCapability::SSE4;
+  else if (std::strcmp(env, "avx2") == 0)
+    req = CpuCapability::AVX2;
+  else if (std::strcmp(env, "avx512") == 0)
+    req = CpuCapability::AVX512;
+
+  return req < cap ? req : cap;
+};
+
+std::atomic<CpuCapability> &current() noexcept {
+  static std::atomic<CpuCapability> cap{initial()};
+  return cap;
+};
+
+} // namespace
+
+CpuCapability torchlet::core::max_cpu_capability() noexcept {
+  static const CpuCapability cap = detect();
+  return cap;
+};
+
+CpuCapability torchlet::core::cpu_capability() noexcept {
+  return current().load(std::memory_order_relaxed);
+};
+
+void torchlet::core::set_cpu_capability(CpuCapability cap) {
+  if (cap > max_cpu_capability())
+    throw std::invalid_argument(std::string("CPU capability ") +
+                                to_string(cap) + " is not supported.");
+  current().store(cap, std::memory_order_relaxed);
+};
+
+const char *torchlet::core::to_string(CpuCapability cap) noexcept {
+  switch (cap) {
+  case CpuCapability::Default:
+    return "default";
+  case CpuCapability::SSE4:
+    return "sse4";
+  case CpuCapability::AVX2:
+    return "avx2";
+  case CpuCapability::AVX512:
+    return "avx512";
+  }
+  return "unknown";
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <torchlet/core/tensor.h>
+#include <torchlet/ops/kernel.h>
+
+// Backward nodes of the ops of functional.h, recorded by their allocating
+// variants when core::needs_grad holds for their inputs.
+
+namespace torchlet::detail {
+
+enum class Unary { GELU, ReLU, Softmax, LogSoftmax };
+
+/// @brief out = op(x), op over the last dim for the softmaxes.
+void record_unary(Unary op, const torchlet::core::Tensor &x,
+                  torchlet::core::Tensor &out);
+
+/// @brief out = act(x W^T + b), bias possibly empty, followed by the
+/// dropout of step when step.p > 0.
+void record_linear(const torchlet::core::Tensor &x,
+                   const torchlet::core::Tensor &weights,
+                   const torchlet::core::Tensor &bias,
+                   torchlet::core::Tensor &out, Activation act,
+                   const DropoutStep &dropout = {});
+
+/// @brief out = dropout(x) : only the stream of the mask is kept, the
+/// backward draws the mask again.
+void record_dropout(const torchlet::core::Tensor &x,
+                    torchlet::core::Tensor &out, const DropoutStep &step);
+
+/// @brief loss = mean(lse - logits[target]) over the rows, lse the
+/// logsumexp of each row of logits.
+void record_cross_entropy(const torchlet::core::Tensor &logits,
+                          const torchlet::core::Tensor &targets,
+                          const torchlet::core::Tensor &lse,
+                          torchlet::core::Tensor &loss);
+
+} // namespace torchlet::detail
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+
+// The backend is chosen at configure time (TORCHLET_BLAS in CMakeLists.txt),
+// which defines at most one TORCHLET_BLAS_<VENDOR> macro.
+
+#if defined(TORCHLET_BLAS_ACCELERATE)
+#include <Accelerate/Accelerate.h>
+#define TORCHLET_HAS_BLAS 1
+#define TORCHLET_BLAS_NAME "Accelerate"
+#elif defined(TORCHLET_BLAS_MKL)
+#include <mkl_cblas.h>
+#define TORCHLET_HAS_BLAS 1
+#define TORCHLET_BLAS_NAME "MKL"
+#elif defined(TORCHLET_BLAS_OPENBLAS)
+#include <cblas.h>
+#define TORCHLET_HAS_BLAS 1
+#define TORCHLET_BLAS_NAME "OpenBLAS"
+#elif defined(TORCHLET_BLAS_BLIS)
+#include <cblas.h>
+#define TORCHLET_HAS_BLAS 1
+#define TORCHLET_BLAS_NAME "BLIS"
+#else
+#define TORCHLET_HAS_BLAS 0
+#define TORCHLET_BLAS_NAME "native"
+#endif
+
+#if TORCHLET_HAS_BLAS
+namespace torchlet::detail::blas {
+
+// Thin overloads so templated callers can stay type generic.
+
+inline void gemv(std::size_t m, std::size_t n, const float *A, const float *x,
+                 float beta, float *y) noexcept {
+  cblas_sgemv(CblasRowMajor, CblasNoTrans, static_cast<int>(m),
+              static_cast<int>(n), 1.0f, A, static_cast<int>(n), x, 1, beta, y,
+              1);
+};
+
+inline void gemv(std::size_t m, std::size_t n, const double *A,
+                 const double *x, double beta, double *y) noexcept {
+  cblas_dgemv(CblasRowMajor, CblasNoTrans, static_cast<int>(m),
+              static_cast<int>(n), 1.0, A, static_cast<int>(n), x, 1, beta, y,
+              1);
+};
+
+/// C (m x n) = A (m x k) * W^T (W is n x k) + beta * C
+inline void gemm_nt(std::size_t m, std::size_t n, std::size_t k,
+                    const float *A, const float *W, float beta,
+                    float *C) noexcept {
+  cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, static_cast<int>(m),
+              static_cast<int>(n), static_cast<int>(k), 1.0f, A,
+              static_cast<int>(k), W, static_cast<int>(k), beta, C,
+              static_cast<int>(n));
+};
+
+inline void gemm_nt(std::size_t m, std::size_t n, std::size_t k,
+                    const double *A, const double *W, double beta,
+                    double *C) noexcept {
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, static_cast<int>(m),
+              static_cast<int>(n), static_cast<int>(k), 1.0, A,
+              static_cast<int>(k), W, static_cast<int>(k), beta, C,
+              static_cast<int>(n));
+};
+
+/// C (m x n) = op(A) * op(B) + beta * C, op(A) m x k and op(B) k x n, with
+/// op transposing its operand when ta / tb. All row-major and dense.
+inline void gemm(bool ta, bool tb, std::size_t m, std::size_t n,
+                 std::size_t k, const float *A, const float *B, float beta,
+                 float *C) noexcept {
+  cblas_sgemm(CblasRowMajor, ta ? CblasTrans : CblasNoTrans,
+              tb ? CblasTrans : CblasNoTrans, static_cast<int>(m),
+              static_cast<int>(n), static_cast<int>(k), 1.0f, A,
+              static_cast<int>(ta ? m : k), B, static_cast<int>(tb ? k : n),
+              beta, C, static_cast<int>(n));
+};
+
+inline void gemm(bool ta, bool tb, std::size_t m, std::size_t n,
+                 std::size_t k, const double *A, const double *B, double beta,
+                 double *C) noexcept {
+  cblas_dgemm(CblasRowMajor, ta ? CblasTrans : CblasNoTrans,
+              tb ? CblasTrans : CblasNoTrans, static_cast<int>(m),
+              static_cast<int>(n), static_cast<int>(k), 1.0, A,
+              static_cast<int>(ta ? m : k), B, static_cast<int>(tb ? k : n),
+              beta, C, static_cast<int>(n));
+};
+
+} // namespace torchlet::detail::blas
+#endif
@@ -1,5 +1,8 @@
 #pragma once
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
 #include <torchlet/core/dtype.h>
 #include <vector>
 
@@ -21,6 +24,9 @@ inline constexpr std::size_t dtype_size(torchlet::core::Dtype dtype) noexcept {
     return 4;
   case torchlet::core::Dtype::UInt64:
     return 8;
+  case torchlet::core::Dtype::Float16:
+  case torchlet::core::Dtype::BFloat16:
+    return 2;
   }
   return 0;
 };
@@ -65,9 +71,58 @@ inline std::size_t numel(const std::vector<std::size_t> &shape) noexcept {
   return numel;
 };
 
+/// @brief Row-major dense layout, whatever the flag of the view says : size 1
+/// dims may carry any stride.
+inline bool is_dense(const std::vector<std::size_t> &shape,
+                     const std::vector<std::size_t> &strides) noexcept {
+  std::size_t expected = 1;
+  for (std::size_t d = shape.size(); d-- > 0;) {
+    if (shape[d] == 0)
+      return true;
+    if (shape[d] == 1)
+      continue;
+    if (strides[d] != expected)
+      return false;
+    expected *= shape[d];
+  }
+  return true;
+};
+
+/// @brief Shape of a op b under NumPy broadcasting : shapes are right
+/// aligned and each dim pair must match or contain a 1.
+inline std::vector<std::size_t>
+broadcast_shape(const std::vector<std::size_t> &a,
+                const std::vector<std::size_t> &b) {
+  const std::size_t nd = std::max(a.size(), b.size());
+  std::vector<std::size_t> shape(nd);
+  for (std::size_t d = 0; d < nd; ++d) {
+    const std::size_t da = d < nd - a.size() ? 1 : a[d - (nd - a.size())];
+    const std::size_t db = d < nd - b.size() ? 1 : b[d - (nd - b.size())];
+    if (da != db && da != 1 && db != 1)
+      throw std::invalid_argument("Shapes are not broadcastable.");
+    shape[d] = da == 1 ? db : da;
+  }
+  return shape;
+};
+
 inline std::size_t nbytes(const std::vector<std::size_t> &shape,
                           torchlet::core::Dtype dtype) {
   return dtype_size(dtype) * numel(shape);
 };
 
+/// @brief nbytes of a shape read from a file into bytes, false when some
+/// prefix of the product overflows size_t.
+inline bool checked_nbytes(const std::vector<std::size_t> &shape,
+                           torchlet::core::Dtype dtype,
+                           std::size_t &bytes) noexcept {
+  std::size_t n = dtype_size(dtype);
+  for (const auto &s : shape) {
+    if (s != 0 && n > std::numeric_limits<std::size_t>::max() / s)
+      return false;
+    n *= s;
+  }
+  bytes = n;
+  return true;
+};
+
 } // namespace torchlet::detail
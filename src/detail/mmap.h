@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <torchlet/core/tensor.h>
+#include <unistd.h>
+
+namespace torchlet::detail {
+
+// Private file mapping, released when the last tensor viewing it goes.
+struct Mapping {
+  void *data = nullptr;
+  std::size_t size = 0;
+
+  ~Mapping() {
+    if (data)
+      munmap(data, size);
+  };
+};
+
+inline std::shared_ptr<Mapping> map_file(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Cannot open " + path + ".");
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("Cannot stat " + path + ".");
+  }
+
+  auto map = std::make_shared<Mapping>();
+  map->size = static_cast<std::size_t>(st.st_size);
+  if (map->size > 0) {
+    // private and writable : tensors can be modified in place, copy on write
+    void *p = mmap(nullptr, map->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                   fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Cannot map " + path + ".");
+    }
+    map->data = p;
+  }
+  ::close(fd);
+  return map;
+};
+
+// One Storage per tensor, so that the aliasing checks of the ops still tell
+// them apart; ctx keeps the mapping alive.
+inline std::shared_ptr<torchlet::core::Storage>
+view_storage(const std::shared_ptr<Mapping> &map, std::size_t offset,
+             std::size_t nbytes) {
+  auto storage = std::make_shared<torchlet::core::Storage>();
+  storage->data = static_cast<std::uint8_t *>(map->data) + offset;
+  storage->nbytes = nbytes;
+  storage->ctx = new std::shared_ptr<Mapping>(map);
+  storage->deleter = [](void *, std::size_t, void *ctx) {
+    delete static_cast<std::shared_ptr<Mapping> *>(ctx);
+  };
+  return storage;
+};
+
+} // namespace torchlet::detail
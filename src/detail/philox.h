@@ -0,0 +1,84 @@
+#pragma once
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC'11), shared by the portable kernels and the per-ISA ones. Internal
+// linkage on purpose : each translation unit keeps the copy vectorised for
+// its own instruction set.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace torchlet::detail {
+namespace {
+
+/// Counters run through one philox_batch call.
+constexpr std::size_t kPhiloxBatch = 64;
+
+/// @brief x[j][i] = word j of Philox4x32-10 on the counter
+/// (counter + i, 0) under the key seed, for i < n <= kPhiloxBatch. The words
+/// live in separate arrays so that the rounds vectorise over i.
+inline void philox_batch(std::uint64_t seed, std::uint64_t counter,
+                         std::size_t n,
+                         std::uint32_t (&x)[4][kPhiloxBatch]) noexcept {
+  for (std::size_t i = 0; i < n; ++i) {
+    x[0][i] = static_cast<std::uint32_t>(counter + i);
+    x[1][i] = static_cast<std::uint32_t>((counter + i) >> 32);
+    x[2][i] = 0;
+    x[3][i] = 0;
+  }
+  std::uint32_t k0 = static_cast<std::uint32_t>(seed);
+  std::uint32_t k1 = static_cast<std::uint32_t>(seed >> 32);
+  for (int round = 0; round < 10; ++round) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::uint64_t p0 = std::uint64_t{0xD2511F53u} * x[0][i];
+      const std::uint64_t p1 = std::uint64_t{0xCD9E8D57u} * x[2][i];
+      const std::uint32_t y0 =
+          static_cast<std::uint32_t>(p1 >> 32) ^ x[1][i] ^ k0;
+      const std::uint32_t y2 =
+          static_cast<std::uint32_t>(p0 >> 32) ^ x[3][i] ^ k1;
+      x[1][i] = static_cast<std::uint32_t>(p1);
+      x[3][i] = static_cast<std::uint32_t>(p0);
+      x[0][i] = y0;
+      x[2][i] = y2;
+    }
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+};
+
+/// @brief w[k] = word first + k of the stream from counter on, word j of
+/// counter c being word 4 c + j, for k below the returned count : n capped
+/// to what one batch holds past first % 4.
+inline std::size_t philox_words(std::uint64_t seed, std::uint64_t counter,
+                                std::size_t first, std::size_t n,
+                                std::uint32_t (&w)[4 * kPhiloxBatch]) noexcept {
+  std::uint32_t x[4][kPhiloxBatch];
+  const std::size_t skip = first % 4;
+  const std::size_t room = 4 * kPhiloxBatch - skip;
+  const std::size_t c = n < room ? n : room;
+  philox_batch(seed, counter + first / 4, (skip + c + 3) / 4, x);
+  for (std::size_t k = 0; k < c; ++k)
+    w[k] = x[(skip + k) % 4][(skip + k) / 4];
+  return c;
+};
+
+/// @brief Dropout threshold on the top 24 bits of a word : a value keeps
+/// when (w >> 8) >= philox_threshold(p).
+inline std::uint32_t philox_threshold(double p) noexcept {
+  return p >= 1.0 ? 1u << 24 : static_cast<std::uint32_t>(p * 16777216.0);
+};
+
+/// @brief Uniform float in [0, 1) from the top 24 bits of w.
+inline float philox_unit_float(std::uint32_t w) noexcept {
+  return static_cast<float>(static_cast<std::int32_t>(w >> 8)) *
+         5.9604644775390625e-8f;
+};
+
+/// @brief Uniform double in [0, 1) from the top 53 bits of (hi, lo).
+inline double philox_unit_double(std::uint32_t lo, std::uint32_t hi) noexcept {
+  const std::uint64_t w = (std::uint64_t{hi} << 32) | lo;
+  return static_cast<double>(static_cast<std::int64_t>(w >> 11)) *
+         1.1102230246251565e-16;
+};
+
+} // namespace
+} // namespace torchlet::detail
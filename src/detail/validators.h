@@ -1,4 +1,5 @@
 #pragma once
+#include "helpers.h"
 #include <stdexcept>
 #include <torchlet/core/tensor.h>
 #include <vector>
@@ -45,7 +46,8 @@ inline void validate_contiguous(const std::vector<size_t> &shape,
 
 inline void check_contiguous(const torchlet::core::Tensor &t,
                              const char *name) {
-  TL_CHECK(t.is_contiguous(), std::string(name) + " must be contiguous.");
+  TL_CHECK(t.is_contiguous() || is_dense(t.shape(), t.strides()),
+           std::string(name) + " must be contiguous.");
 };
 
 inline void check_same_dtype(const torchlet::core::Tensor &a,
@@ -73,6 +75,19 @@ inline void check_dim_eq(const torchlet::core::Tensor &t, int axis,
            std::string(name) + " " + what + " mismatch.");
 };
 
+inline void check_shape_eq(const torchlet::core::Tensor &t,
+                           const std::vector<std::size_t> &shape,
+                           const char *name) {
+  TL_CHECK(t.shape() == shape, std::string(name) + " has the wrong shape.");
+};
+
+inline void check_no_alias(const torchlet::core::Tensor &a,
+                           const torchlet::core::Tensor &b, const char *an,
+                           const char *bn) {
+  TL_CHECK(a.storage_ptr() != b.storage_ptr(),
+           std::string(an) + " must not share memory with " + bn + ".");
+};
+
 inline bool has_data(const torchlet::core::Tensor &t) {
   return t.storage_ptr() != nullptr;
 };
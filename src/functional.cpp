@@ -1,36 +1,110 @@
+#include "detail/backward.h"
+#include "detail/blas.h"
+#include "detail/helpers.h"
 #include "detail/validators.h"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <torchlet/core/autograd.h>
+#include <torchlet/core/profiler.h>
 #include <torchlet/iterator/iterator.h>
+#include <torchlet/iterator/tensor_iterator.h>
 #include <torchlet/ops/functional.h>
 #include <torchlet/ops/kernel.h>
 
-using torchlet::core::Tensor, torchlet::iterator::ContiguousIterator;
+using torchlet::core::Tensor, torchlet::core::RecordScope,
+    torchlet::core::op_cost, torchlet::core::Generator,
+    torchlet::iterator::ContiguousIterator,
+    torchlet::iterator::TensorIterator, torchlet::detail::Unary;
 
-// Tensor scaled_dot_product_attention(const Tensor &Q, const Tensor &K,
-//                                     const Tensor &V) {
+// Below this many rows linear streams W once per row as a GEMV.
+static constexpr std::size_t kGemmMinRows = 4;
 
-//   auto k_shape = K.shape(), q_shape = Q.shape();
-//   auto qv_shape = q_shape;
-//   qv_shape.back() = k_shape.at(k_shape.size() - 2);
+// Each output of linear costs in_features MACs. A BLAS backend threads the
+// whole product itself, so the batch is not split on top of it.
+static std::size_t linear_grain(std::size_t in_features) {
+  if (TORCHLET_HAS_BLAS)
+    return std::numeric_limits<std::size_t>::max();
+  return std::max<std::size_t>(
+      torchlet::GRAIN_SIZE / std::max<std::size_t>(in_features, 1), 1);
+};
 
-//   Tensor qv(qv_shape, Q.dtype());
-//   ContiguousIterator it = ContiguousIterator(&qv, {&Q, &K});
-//   std::size_t m =
+// Rows of a linear output in one ~256 KiB block of the mmb_blas_kernel
+// epilogue : a fused dropout sweeps each block while it is still in L2.
+// Without BLAS the thread chunks of linear_grain are about that small.
+static std::size_t epilogue_rows(std::size_t out_features, std::size_t item,
+                                 std::size_t rows) {
+  if (!TORCHLET_HAS_BLAS)
+    return std::max<std::size_t>(rows, 1);
+  return std::max<std::size_t>(
+      (std::size_t{1} << 18) / std::max<std::size_t>(out_features * item, 1),
+      4);
+};
 
-//   DISPATCH_FLOAT(Q.dtype(), scalar_t, {
-//     it.for_each_with_inputs(
-//         [&](uint8_t *optr, const uint8_t **iptrs, size_t n_in) {
-//           const scalar_t *qp = reinterpret_cast<const scalar_t *>(iptrs[0]);
-//           const scalar_t *kp = reinterpret_cast<const scalar_t *>(iptrs[1]);
-//           scalar_t *qkp = reinterpret_cast<scalar_t *>(optr);
-//         });
-//   })
-// };
+namespace {
 
-Tensor torchlet::ops::linear(const Tensor &x, const Tensor &weights,
-                             const Tensor &bias) {
+bool is_reduced(torchlet::core::Dtype dtype) {
+  return dtype == torchlet::core::Dtype::Float16 ||
+         dtype == torchlet::core::Dtype::BFloat16;
+};
+
+Tensor linear_alloc(const Tensor &x, const Tensor &weights) {
+  torchlet::detail::check_rank_ge(x, 1, "x");
+  torchlet::detail::check_rank(weights, 2, "weights");
+
+  auto out_shape = x.shape();
+  out_shape.back() = weights.shape().front();
+  return Tensor(out_shape, x.dtype());
+};
+
+Tensor &linear_mixed_out(const Tensor &x, const Tensor &weights,
+                         const Tensor &bias, Tensor &out, Activation act,
+                         const DropoutStep *dropout);
+
+// The stream of a dropout over n values, reserved on gen.
+DropoutStep draw_dropout(double p, std::size_t n, Generator &gen) {
+  if (!(p >= 0.0 && p <= 1.0))
+    throw std::invalid_argument("Dropout probability must be in [0, 1].");
+  const std::uint64_t seed = gen.seed();
+  return {p, seed, gen.advance((n + 3) / 4)};
+};
+
+const char *linear_name(Activation act) {
+  switch (act) {
+  case Activation::ReLU:
+    return "linear_relu";
+  case Activation::GELU:
+    return "linear_gelu";
+  case Activation::Softmax:
+    return "linear_bias_softmax";
+  default:
+    return "linear";
+  }
+};
+
+// linear with the activation fused in the kernel epilogue : the output is
+// written once instead of being stored, reloaded and stored again. A dropout
+// (not after Softmax) follows the epilogue on the same cached blocks.
+Tensor &linear_act_out(const Tensor &x_in, const Tensor &weights_in,
+                       const Tensor &bias_in, Tensor &out, Activation act,
+                       const DropoutStep *dropout = nullptr) {
+  RecordScope scope(linear_name(act), [&] {
+    return op_cost({&x_in, &weights_in, &bias_in, &out},
+                   2.0 * double(out.numel()) * double(x_in.shape().back()));
+  });
+
+  if (is_reduced(x_in.dtype()) || is_reduced(weights_in.dtype()) ||
+      is_reduced(out.dtype()) ||
+      (torchlet::detail::has_data(bias_in) && is_reduced(bias_in.dtype())))
+    return linear_mixed_out(x_in, weights_in, bias_in, out, act, dropout);
+
+  // The GEMM reads dense operands : strided views are packed once here, a
+  // no-op for tensors that already are.
+  const Tensor x = x_in.contiguous();
+  const Tensor weights = weights_in.contiguous();
+  const Tensor bias = bias_in.contiguous();
 
-  torchlet::detail::check_contiguous(x, "x");
-  torchlet::detail::check_contiguous(weights, "weights");
   torchlet::detail::check_same_dtype(x, weights, "x", "weights");
   torchlet::detail::check_rank_ge(x, 1, "x");
   torchlet::detail::check_rank(weights, 2, "weights");
@@ -45,83 +119,1099 @@ Tensor torchlet::ops::linear(const Tensor &x, const Tensor &weights,
 
   if (torchlet::detail::has_data(bias)) {
     has_bias = true;
-    torchlet::detail::check_contiguous(bias, "bias");
     torchlet::detail::check_same_dtype(bias, x, "bias", "x");
     torchlet::detail::check_rank(bias, 1, "bias");
     torchlet::detail::check_dim_eq(bias, 0, outF, "bias", "length");
+    torchlet::detail::check_no_alias(out, bias, "out", "bias");
   }
 
   auto out_shape = xs;
   out_shape.back() = outF;
-  Tensor out(out_shape, x.dtype());
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_same_dtype(out, x, "out", "x");
+  torchlet::detail::check_shape_eq(out, out_shape, "out");
+  torchlet::detail::check_no_alias(out, x, "out", "x");
+  torchlet::detail::check_no_alias(out, weights, "out", "weights");
 
   ContiguousIterator it(&out, {&x});
 
   DISPATCH_FLOAT(x.dtype(), scalar_t, {
-    const scalar_t *pW = weights.data_ptr<scalar_t>();
-    const scalar_t *pb = has_bias ? bias.data_ptr<scalar_t>() : nullptr;
+    const scalar_t *pW = weights.data_ptr<scalar_t>() + weights.elem_offset();
+    const scalar_t *pb =
+        has_bias ? bias.data_ptr<scalar_t>() + bias.elem_offset() : nullptr;
+
+    // Collapse the leading dims into M rows : a single GEMM reads W once,
+    // the per-row GEMV is only worth it when there is little to batch.
+    const scalar_t *py0 = reinterpret_cast<const scalar_t *>(it.output_ptr);
+    if (it.batch_size >= kGemmMinRows) {
+      it.parallel_for_each_block_with_inputs(
+          [&](uint8_t *optr, const uint8_t **iptrs, size_t, size_t rows) {
+            const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
+            scalar_t *py = reinterpret_cast<scalar_t *>(optr);
+            if (!dropout) {
+              mmb_blas_kernel(px, pW, pb, py, rows, outF, inF, act);
+              return;
+            }
+            const size_t block = epilogue_rows(outF, sizeof(scalar_t), rows);
+            for (size_t i0 = 0; i0 < rows; i0 += block) {
+              const size_t mb = std::min(block, rows - i0);
+              scalar_t *pyb = py + i0 * outF;
+              mmb_blas_kernel(px + i0 * inF, pW, pb, pyb, mb, outF, inF, act);
+              dropout_kernel(static_cast<const scalar_t *>(pyb), pyb,
+                             mb * outF, size_t(pyb - py0), *dropout, false);
+            }
+          },
+          linear_grain(inF));
+    } else {
+      const Activation chunk_act =
+          act == Activation::Softmax ? Activation::None : act;
+      it.for_each_with_inputs(
+          [&](uint8_t *optr, const uint8_t **iptrs, size_t) {
+            const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
+            scalar_t *py = reinterpret_cast<scalar_t *>(optr);
+            // Split the output features : each thread streams its own rows
+            // of W, which is what bounds single-sample latency.
+            torchlet::parallel_for(
+                0, outF, linear_grain(inF), [&](size_t r0, size_t r1) {
+                  mvb_blas_kernel(pW + r0 * inF, px, pb ? pb + r0 : nullptr,
+                                  py + r0, r1 - r0, inF);
+                  activation_kernel(py + r0, r1 - r0, chunk_act);
+                  if (dropout)
+                    dropout_kernel(static_cast<const scalar_t *>(py + r0),
+                                   py + r0, r1 - r0, size_t(py + r0 - py0),
+                                   *dropout, false);
+                });
+            if (act == Activation::Softmax)
+              softmax_kernel(py, py, outF);
+          });
+    }
+  })
+
+  return out;
+};
+
+// Mixed precision : Float16 / BFloat16 operands are widened, the products
+// accumulate in float and the result is narrowed to out's dtype. On the GEMV
+// path, bound by streaming W, the weights are read in their storage type.
+Tensor &linear_mixed_out(const Tensor &x, const Tensor &weights,
+                         const Tensor &bias, Tensor &out, Activation act,
+                         const DropoutStep *dropout) {
+  using torchlet::core::Dtype;
+
+  auto check_dtype = [](const Tensor &t, const char *name) {
+    TL_CHECK(t.dtype() == Dtype::Float32 || is_reduced(t.dtype()),
+             std::string(name) +
+                 " must be Float32, Float16 or BFloat16 in mixed precision.");
+  };
+  check_dtype(x, "x");
+  check_dtype(weights, "weights");
+  check_dtype(out, "out");
+  torchlet::detail::check_rank_ge(x, 1, "x");
+  torchlet::detail::check_rank(weights, 2, "weights");
+
+  const size_t inF = x.shape().back();
+  const size_t outF = weights.shape().front();
+  torchlet::detail::check_dim_eq(weights, 1, inF, "weights", "in_features");
+
+  const bool has_bias = torchlet::detail::has_data(bias);
+  if (has_bias) {
+    check_dtype(bias, "bias");
+    torchlet::detail::check_rank(bias, 1, "bias");
+    torchlet::detail::check_dim_eq(bias, 0, outF, "bias", "length");
+    torchlet::detail::check_no_alias(out, bias, "out", "bias");
+  }
+
+  auto out_shape = x.shape();
+  out_shape.back() = outF;
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_shape_eq(out, out_shape, "out");
+  torchlet::detail::check_no_alias(out, x, "out", "x");
+  torchlet::detail::check_no_alias(out, weights, "out", "weights");
+
+  const Tensor x32 = x.to(Dtype::Float32).contiguous();
+  const Tensor b32 = has_bias ? bias.to(Dtype::Float32).contiguous() : Tensor();
+  Tensor out32 =
+      out.dtype() == Dtype::Float32 ? out : Tensor(out_shape, Dtype::Float32);
+  const size_t rows = inF ? x.numel() / inF : 0;
+
+  if (rows >= kGemmMinRows || weights.dtype() == Dtype::Float32) {
+    // Widening W once is amortised over the rows of the GEMM.
+    const Tensor w32 = weights.to(Dtype::Float32).contiguous();
+    linear_act_out(x32, w32, b32, out32, act, dropout);
+  } else {
+    const Tensor w = weights.contiguous();
+    const Activation chunk_act =
+        act == Activation::Softmax ? Activation::None : act;
+    const float *pb =
+        has_bias ? b32.data_ptr<float>() + b32.elem_offset() : nullptr;
+
+    DISPATCH_REDUCED(w.dtype(), w_t, {
+      const w_t *pW = w.data_ptr<w_t>() + w.elem_offset();
+      for (size_t r = 0; r < rows; ++r) {
+        const float *px = x32.data_ptr<float>() + x32.elem_offset() + r * inF;
+        float *py = out32.data_ptr<float>() + out32.elem_offset() + r * outF;
+        torchlet::parallel_for(
+            0, outF, linear_grain(inF), [&](size_t r0, size_t r1) {
+              mvb_mixed_kernel(pW + r0 * inF, px, pb ? pb + r0 : nullptr,
+                               py + r0, r1 - r0, inF);
+              activation_kernel(py + r0, r1 - r0, chunk_act);
+              if (dropout)
+                dropout_kernel(static_cast<const float *>(py + r0), py + r0,
+                               r1 - r0, r * outF + r0, *dropout, false);
+            });
+        if (act == Activation::Softmax)
+          softmax_kernel(py, py, outF);
+      }
+    })
+  }
+
+  if (out.dtype() != Dtype::Float32)
+    out.copy_(out32);
+  return out;
+};
+
+} // namespace
+
+Tensor torchlet::ops::linear(const Tensor &x, const Tensor &weights,
+                             const Tensor &bias) {
+  RecordScope scope("linear");
+  Tensor out = linear_alloc(x, weights);
+  linear_out(x, weights, bias, out);
+  if (torchlet::core::needs_grad({&x, &weights, &bias}))
+    torchlet::detail::record_linear(x, weights, bias, out, Activation::None);
+  return out;
+};
+
+Tensor &torchlet::ops::linear_out(const Tensor &x, const Tensor &weights,
+                                  const Tensor &bias, Tensor &out) {
+  return linear_act_out(x, weights, bias, out, Activation::None);
+};
+
+Tensor torchlet::ops::linear_gelu(const Tensor &x, const Tensor &weights,
+                                  const Tensor &bias) {
+  RecordScope scope("linear_gelu");
+  Tensor out = linear_alloc(x, weights);
+  linear_act_out(x, weights, bias, out, Activation::GELU);
+  if (torchlet::core::needs_grad({&x, &weights, &bias}))
+    torchlet::detail::record_linear(x, weights, bias, out, Activation::GELU);
+  return out;
+};
+
+Tensor torchlet::ops::linear_relu(const Tensor &x, const Tensor &weights,
+                                  const Tensor &bias) {
+  RecordScope scope("linear_relu");
+  Tensor out = linear_alloc(x, weights);
+  linear_act_out(x, weights, bias, out, Activation::ReLU);
+  if (torchlet::core::needs_grad({&x, &weights, &bias}))
+    torchlet::detail::record_linear(x, weights, bias, out, Activation::ReLU);
+  return out;
+};
+
+Tensor torchlet::ops::linear_bias_softmax(const Tensor &x,
+                                          const Tensor &weights,
+                                          const Tensor &bias) {
+  RecordScope scope("linear_bias_softmax");
+  Tensor out = linear_alloc(x, weights);
+  linear_act_out(x, weights, bias, out, Activation::Softmax);
+  if (torchlet::core::needs_grad({&x, &weights, &bias}))
+    torchlet::detail::record_linear(x, weights, bias, out, Activation::Softmax);
+  return out;
+};
+
+Tensor torchlet::ops::linear_gelu_dropout(const Tensor &x,
+                                          const Tensor &weights,
+                                          const Tensor &bias, double p,
+                                          Generator &gen) {
+  RecordScope scope("linear_gelu_dropout");
+  Tensor out = linear_alloc(x, weights);
+  const DropoutStep step = draw_dropout(p, out.numel(), gen);
+  linear_act_out(x, weights, bias, out, Activation::GELU, &step);
+  if (torchlet::core::needs_grad({&x, &weights, &bias}))
+    torchlet::detail::record_linear(x, weights, bias, out, Activation::GELU,
+                                    step);
+  return out;
+};
+
+Tensor &torchlet::ops::linear_gelu_out(const Tensor &x, const Tensor &weights,
+                                       const Tensor &bias, Tensor &out) {
+  return linear_act_out(x, weights, bias, out, Activation::GELU);
+};
+
+Tensor &torchlet::ops::linear_relu_out(const Tensor &x, const Tensor &weights,
+                                       const Tensor &bias, Tensor &out) {
+  return linear_act_out(x, weights, bias, out, Activation::ReLU);
+};
 
-    it.for_each_with_inputs([&](uint8_t *optr, const uint8_t **iptrs, size_t) {
-      const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
-      scalar_t *py = reinterpret_cast<scalar_t *>(optr);
-      mvb_kernel(pW, px, pb, py, outF, inF);
+Tensor &torchlet::ops::linear_bias_softmax_out(const Tensor &x,
+                                               const Tensor &weights,
+                                               const Tensor &bias,
+                                               Tensor &out) {
+  return linear_act_out(x, weights, bias, out, Activation::Softmax);
+};
+
+// Quantized linear : the rows of x are quantized to int8 on the fly, the
+// int32 products are dequantized in the kernel epilogue.
+
+namespace {
+
+void check_quantized(const Tensor &qweight, const Tensor &scales,
+                     const Tensor &zero_points, const Tensor &bias) {
+  using torchlet::core::Dtype;
+  torchlet::detail::check_rank(qweight, 2, "qweight");
+  TL_CHECK(qweight.dtype() == Dtype::UInt8, "qweight must be UInt8.");
+
+  const size_t outF = qweight.shape().front();
+  TL_CHECK(scales.dtype() == Dtype::Float32, "scales must be Float32.");
+  torchlet::detail::check_rank(scales, 1, "scales");
+  torchlet::detail::check_dim_eq(scales, 0, outF, "scales", "length");
+  TL_CHECK(zero_points.dtype() == Dtype::Int32, "zero_points must be Int32.");
+  torchlet::detail::check_rank(zero_points, 1, "zero_points");
+  torchlet::detail::check_dim_eq(zero_points, 0, outF, "zero_points",
+                                 "length");
+
+  if (torchlet::detail::has_data(bias)) {
+    TL_CHECK(bias.dtype() == Dtype::Float32, "bias must be Float32.");
+    torchlet::detail::check_rank(bias, 1, "bias");
+    torchlet::detail::check_dim_eq(bias, 0, outF, "bias", "length");
+  }
+};
+
+} // namespace
+
+Tensor torchlet::ops::quantized_linear(const Tensor &x, const Tensor &qweight,
+                                       const Tensor &scales,
+                                       const Tensor &zero_points,
+                                       const Tensor &bias) {
+  RecordScope scope("quantized_linear");
+  Tensor out = linear_alloc(x, qweight);
+  return quantized_linear_out(x, qweight, scales, zero_points, bias, out);
+};
+
+Tensor &torchlet::ops::quantized_linear_out(const Tensor &x_in,
+                                            const Tensor &qweight_in,
+                                            const Tensor &scales_in,
+                                            const Tensor &zero_points_in,
+                                            const Tensor &bias_in,
+                                            Tensor &out) {
+  RecordScope scope("quantized_linear", [&] {
+    return op_cost({&x_in, &qweight_in, &scales_in, &zero_points_in, &bias_in,
+                    &out},
+                   2.0 * double(out.numel()) * double(x_in.shape().back()));
+  });
+  using torchlet::core::Dtype;
+
+  const Tensor x = x_in.contiguous();
+  const Tensor qweight = qweight_in.contiguous();
+  const Tensor scales = scales_in.contiguous();
+  const Tensor zero_points = zero_points_in.contiguous();
+  const Tensor bias = bias_in.contiguous();
+
+  torchlet::detail::check_rank_ge(x, 1, "x");
+  TL_CHECK(x.dtype() == Dtype::Float32, "x must be Float32.");
+  check_quantized(qweight, scales, zero_points, bias);
+
+  const size_t inF = x.shape().back();
+  const size_t outF = qweight.shape().front();
+  torchlet::detail::check_dim_eq(qweight, 1, inF, "qweight", "in_features");
+
+  auto out_shape = x.shape();
+  out_shape.back() = outF;
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_same_dtype(out, x, "out", "x");
+  torchlet::detail::check_shape_eq(out, out_shape, "out");
+  torchlet::detail::check_no_alias(out, x, "out", "x");
+
+  const size_t rows = inF ? x.numel() / inF : 0;
+  const float *px = x.data_ptr<float>() + x.elem_offset();
+
+  // int8 activations with one scale and one code sum per row
+  std::vector<std::int8_t> xq(rows * inF);
+  std::vector<float> x_scale(rows);
+  std::vector<std::int32_t> x_sum(rows);
+  torchlet::parallel_for(0, rows, linear_grain(inF), [&](size_t r0, size_t r1) {
+    for (size_t r = r0; r < r1; ++r)
+      quantize_row_kernel(px + r * inF, xq.data() + r * inF, inF, x_scale[r],
+                          x_sum[r]);
+  });
+
+  const std::uint8_t *pW =
+      qweight.data_ptr<std::uint8_t>() + qweight.elem_offset();
+  const float *ps = scales.data_ptr<float>() + scales.elem_offset();
+  const std::int32_t *pz =
+      zero_points.data_ptr<std::int32_t>() + zero_points.elem_offset();
+  const float *pb = torchlet::detail::has_data(bias)
+                        ? bias.data_ptr<float>() + bias.elem_offset()
+                        : nullptr;
+  float *py = out.data_ptr<float>() + out.elem_offset();
+
+  // Split the output features : every thread runs all rows against its own
+  // slice of W, small enough to stay in cache across the row blocks.
+  const size_t grain = std::max<size_t>(
+      torchlet::GRAIN_SIZE / std::max<size_t>(inF * rows, 1), 1);
+  torchlet::parallel_for(0, outF, grain, [&](size_t o0, size_t o1) {
+    qmmb_kernel(pW + o0 * inF, ps + o0, pz + o0, xq.data(), x_scale.data(),
+                x_sum.data(), pb ? pb + o0 : nullptr, py + o0, rows, o1 - o0,
+                inF, outF);
+  });
+
+  return out;
+};
+
+// matmul : the GEMM packs its operands, so any strides of the last two dims
+// are read in place; broadcast batch dims get a 0 stride.
+
+namespace {
+
+// Batch dims of x against the broadcast batch shape : element strides of x,
+// 0 along the dims x broadcasts.
+std::vector<size_t> batch_strides(const Tensor &x,
+                                  const std::vector<size_t> &batch) {
+  const size_t nd = batch.size(), xd = x.shape().size() - 2;
+  std::vector<size_t> strides(nd, 0);
+  for (size_t d = 0; d < xd; ++d)
+    if (x.shape()[d] != 1)
+      strides[nd - xd + d] = x.strides()[d];
+  return strides;
+};
+
+std::vector<size_t> matmul_shape(const Tensor &a, const Tensor &b) {
+  torchlet::detail::check_rank_ge(a, 2, "a");
+  torchlet::detail::check_rank_ge(b, 2, "b");
+  const auto &as = a.shape(), &bs = b.shape();
+  if (as.back() != bs[bs.size() - 2])
+    throw std::invalid_argument("matmul: a and b have mismatched inner dims.");
+
+  auto shape = torchlet::detail::broadcast_shape(
+      {as.begin(), as.end() - 2}, {bs.begin(), bs.end() - 2});
+  shape.push_back(as[as.size() - 2]);
+  shape.push_back(bs.back());
+  return shape;
+};
+
+} // namespace
+
+Tensor torchlet::ops::matmul(const Tensor &a, const Tensor &b) {
+  RecordScope scope("matmul");
+  Tensor out(matmul_shape(a, b), a.dtype());
+  return matmul_out(a, b, out);
+};
+
+Tensor &torchlet::ops::matmul_out(const Tensor &a, const Tensor &b,
+                                  Tensor &out) {
+  RecordScope scope("matmul", [&] {
+    return op_cost({&a, &b, &out},
+                   2.0 * double(out.numel()) * double(a.shape().back()));
+  });
+  torchlet::detail::check_same_dtype(a, b, "a", "b");
+  const auto out_shape = matmul_shape(a, b);
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_same_dtype(out, a, "out", "a");
+  torchlet::detail::check_shape_eq(out, out_shape, "out");
+  torchlet::detail::check_no_alias(out, a, "out", "a");
+  torchlet::detail::check_no_alias(out, b, "out", "b");
+
+  const size_t nd = out_shape.size();
+  const size_t m = out_shape[nd - 2], n = out_shape[nd - 1];
+  const size_t k = a.shape().back();
+  const std::vector<size_t> batch(out_shape.begin(), out_shape.end() - 2);
+  const size_t n_batch = torchlet::detail::numel(batch);
+  const auto sa = batch_strides(a, batch), sb = batch_strides(b, batch);
+
+  const size_t rsa = a.strides()[a.shape().size() - 2];
+  const size_t csa = a.strides().back();
+  const size_t rsb = b.strides()[b.shape().size() - 2];
+  const size_t csb = b.strides().back();
+
+  // Batches go to the threads only when there are enough of them, a single
+  // large product is split by the GEMM itself.
+  const size_t macs = std::max<size_t>(m * n * k, 1);
+  const size_t grain =
+      n_batch >= torchlet::get_num_threads()
+          ? std::max<size_t>(torchlet::GRAIN_SIZE / macs, 1)
+          : n_batch;
+
+  DISPATCH_FLOAT(a.dtype(), scalar_t, {
+    const scalar_t *pa = a.data_ptr<scalar_t>() + a.elem_offset();
+    const scalar_t *pb = b.data_ptr<scalar_t>() + b.elem_offset();
+    scalar_t *pc = out.data_ptr<scalar_t>() + out.elem_offset();
+
+    torchlet::parallel_for(0, n_batch, grain, [&](size_t i0, size_t i1) {
+      for (size_t i = i0; i < i1; ++i) {
+        size_t oa = 0, ob = 0;
+        for (size_t d = batch.size(), r = i; d-- > 0; r /= batch[d]) {
+          oa += r % batch[d] * sa[d];
+          ob += r % batch[d] * sb[d];
+        }
+        mm_strided_kernel(pa + oa, rsa, csa, pb + ob, rsb, csb,
+                          pc + i * m * n, n, m, n, k);
+      }
     });
   })
 
   return out;
 };
 
-Tensor torchlet::ops::gelu(const Tensor &x) {
+// Attention : heads are dense [L, d] slices, strided views are packed once.
+// Batch dims broadcast like matmul, so k / v may be shared between heads.
+
+namespace {
+
+std::vector<size_t> attention_shape(const Tensor &q, const Tensor &k,
+                                    const Tensor &v) {
+  torchlet::detail::check_rank_ge(q, 2, "q");
+  torchlet::detail::check_rank_ge(k, 2, "k");
+  torchlet::detail::check_rank_ge(v, 2, "v");
+  const auto &qs = q.shape(), &ks = k.shape(), &vs = v.shape();
+  if (qs.back() != ks.back())
+    throw std::invalid_argument(
+        "scaled_dot_product_attention: q and k have different head dims.");
+  if (ks[ks.size() - 2] != vs[vs.size() - 2])
+    throw std::invalid_argument(
+        "scaled_dot_product_attention: k and v have different lengths.");
 
-  torchlet::detail::check_contiguous(x, "x");
+  auto shape = torchlet::detail::broadcast_shape(
+      torchlet::detail::broadcast_shape({qs.begin(), qs.end() - 2},
+                                        {ks.begin(), ks.end() - 2}),
+      {vs.begin(), vs.end() - 2});
+  shape.push_back(qs[qs.size() - 2]);
+  shape.push_back(vs.back());
+  return shape;
+};
+
+} // namespace
+
+Tensor torchlet::ops::scaled_dot_product_attention(const Tensor &q,
+                                                   const Tensor &k,
+                                                   const Tensor &v,
+                                                   bool causal) {
+  RecordScope scope("scaled_dot_product_attention");
+  Tensor out(attention_shape(q, k, v), q.dtype());
+  return scaled_dot_product_attention_out(q, k, v, out, causal);
+};
+
+Tensor &torchlet::ops::scaled_dot_product_attention_out(const Tensor &q_in,
+                                                        const Tensor &k_in,
+                                                        const Tensor &v_in,
+                                                        Tensor &out,
+                                                        bool causal) {
+  RecordScope scope("scaled_dot_product_attention", [&] {
+    // scores and probabilities times values, halved by the mask
+    const double per_row = double(k_in.shape()[k_in.shape().size() - 2]) *
+                           double(q_in.shape().back() + v_in.shape().back());
+    return op_cost({&q_in, &k_in, &v_in, &out},
+                   (causal ? 1.0 : 2.0) * double(out.numel()) /
+                       double(v_in.shape().back()) * per_row);
+  });
+  const Tensor q = q_in.contiguous();
+  const Tensor k = k_in.contiguous();
+  const Tensor v = v_in.contiguous();
+
+  torchlet::detail::check_same_dtype(q, k, "q", "k");
+  torchlet::detail::check_same_dtype(q, v, "q", "v");
+  const auto out_shape = attention_shape(q, k, v);
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_same_dtype(out, q, "out", "q");
+  torchlet::detail::check_shape_eq(out, out_shape, "out");
+  torchlet::detail::check_no_alias(out, q, "out", "q");
+  torchlet::detail::check_no_alias(out, k, "out", "k");
+  torchlet::detail::check_no_alias(out, v, "out", "v");
+
+  const size_t nd = out_shape.size();
+  const size_t Lq = out_shape[nd - 2], dv = out_shape[nd - 1];
+  const size_t Lk = k.shape()[k.shape().size() - 2], d = q.shape().back();
+  const std::vector<size_t> batch(out_shape.begin(), out_shape.end() - 2);
+  const size_t n_batch = torchlet::detail::numel(batch);
+  const auto sq = batch_strides(q, batch), sk = batch_strides(k, batch),
+             sv = batch_strides(v, batch);
+
+  // Tasks are blocks of query rows of every head : a single long sequence
+  // still spreads over the threads. Causal blocks see a growing share of
+  // the keys, small grains even that out.
+  constexpr size_t kRows = 64;
+  const size_t n_blocks = (Lq + kRows - 1) / kRows;
+  const size_t block_macs = std::max<size_t>(kRows * Lk * (d + dv), 1);
+  const size_t grain =
+      std::max<size_t>(torchlet::GRAIN_SIZE / block_macs, 1);
+
+  DISPATCH_FLOAT(q.dtype(), scalar_t, {
+    const scalar_t *pq = q.data_ptr<scalar_t>() + q.elem_offset();
+    const scalar_t *pk = k.data_ptr<scalar_t>() + k.elem_offset();
+    const scalar_t *pv = v.data_ptr<scalar_t>() + v.elem_offset();
+    scalar_t *po = out.data_ptr<scalar_t>() + out.elem_offset();
+    const scalar_t scale =
+        scalar_t{1} / std::sqrt(static_cast<scalar_t>(std::max<size_t>(d, 1)));
+
+    torchlet::parallel_for(0, n_batch * n_blocks, grain, [&](size_t t0,
+                                                            size_t t1) {
+      for (size_t t = t0; t < t1; ++t) {
+        const size_t i = t / n_blocks, r0 = t % n_blocks * kRows;
+        size_t oq = 0, ok = 0, ov = 0;
+        for (size_t dim = batch.size(), r = i; dim-- > 0; r /= batch[dim]) {
+          oq += r % batch[dim] * sq[dim];
+          ok += r % batch[dim] * sk[dim];
+          ov += r % batch[dim] * sv[dim];
+        }
+        attention_kernel(pq + oq, pk + ok, pv + ov, po + i * Lq * dv, r0,
+                         std::min(Lq, r0 + kRows), Lk, d, dv, scale, causal);
+      }
+    });
+  })
+
+  return out;
+};
+
+// Row-wise ops : every kernel reads a row of x before writing the same row
+// of y, so they run unchanged with out == x.
+
+namespace {
+
+void check_rowwise(const Tensor &x, const Tensor &out) {
   torchlet::detail::check_rank_ge(x, 1, "x");
+  torchlet::detail::check_same_dtype(out, x, "out", "x");
+  torchlet::detail::check_shape_eq(out, x.shape(), "out");
+};
+
+// Runs kernel(px, py, n) on every row of the last dim, for any layout of x
+// and out. Rows with unit stride go straight to the kernel, others are
+// gathered into a per-thread buffer and scattered back.
+template <typename T, typename Kernel>
+void rowwise(const Tensor &x, Tensor &out, Kernel kernel) {
+  TensorIterator it = TensorIterator::rows(&out, {&x});
+  const std::size_t n = it.row_size();
+  const std::ptrdiff_t item = static_cast<std::ptrdiff_t>(sizeof(T));
+  const std::ptrdiff_t ys = it.row_stride(0), xs = it.row_stride(1);
+  const bool dense = n <= 1 || (ys == item && xs == item);
 
+  it.parallel_for_each([&](uint8_t **data, const std::ptrdiff_t *strides,
+                           size_t rows) {
+    uint8_t *py = data[0];
+    const uint8_t *px = data[1];
+    for (size_t r = 0; r < rows; ++r, py += strides[0], px += strides[1]) {
+      if (dense) {
+        kernel(reinterpret_cast<const T *>(px), reinterpret_cast<T *>(py), n);
+        continue;
+      }
+      thread_local std::vector<T> buf;
+      buf.resize(n);
+      const uint8_t *src = px;
+      for (size_t k = 0; k < n; ++k, src += xs)
+        buf[k] = *reinterpret_cast<const T *>(src);
+      kernel(buf.data(), buf.data(), n);
+      uint8_t *dst = py;
+      for (size_t k = 0; k < n; ++k, dst += ys)
+        *reinterpret_cast<T *>(dst) = buf[k];
+    }
+  });
+};
+
+} // namespace
+
+Tensor torchlet::ops::gelu(const Tensor &x) {
+  RecordScope scope("gelu");
   Tensor out(x.shape(), x.dtype());
-  ContiguousIterator it(&out, {&x});
-  std::size_t nfeat = it.input_dim;
+  gelu_out(x, out);
+  if (torchlet::core::needs_grad({&x}))
+    torchlet::detail::record_unary(Unary::GELU, x, out);
+  return out;
+};
+
+Tensor &torchlet::ops::gelu_(Tensor &x) { return gelu_out(x, x); };
+
+Tensor &torchlet::ops::gelu_out(const Tensor &x, Tensor &out) {
+  RecordScope scope("gelu", [&] { return op_cost({&x, &out}); });
+  check_rowwise(x, out);
 
   DISPATCH_FLOAT(x.dtype(), scalar_t, {
-    it.for_each_with_inputs([&](uint8_t *optr, const uint8_t **iptrs, size_t) {
-      const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
-      scalar_t *py = reinterpret_cast<scalar_t *>(optr);
-      gelu_kernel(px, py, nfeat);
+    rowwise<scalar_t>(x, out, [](const scalar_t *px, scalar_t *py, size_t n) {
+      gelu_kernel(px, py, n);
     });
   })
   return out;
 };
 
-Tensor torchlet::ops::softmax(const Tensor &x) {
-  torchlet::detail::check_contiguous(x, "x");
-  torchlet::detail::check_rank_ge(x, 1, "x");
+Tensor torchlet::ops::relu(const Tensor &x) {
+  RecordScope scope("relu");
+  Tensor out(x.shape(), x.dtype());
+  relu_out(x, out);
+  if (torchlet::core::needs_grad({&x}))
+    torchlet::detail::record_unary(Unary::ReLU, x, out);
+  return out;
+};
+
+Tensor &torchlet::ops::relu_(Tensor &x) { return relu_out(x, x); };
+
+Tensor &torchlet::ops::relu_out(const Tensor &x, Tensor &out) {
+  RecordScope scope("relu", [&] { return op_cost({&x, &out}); });
+  check_rowwise(x, out);
+
+  DISPATCH_FLOAT(x.dtype(), scalar_t, {
+    rowwise<scalar_t>(x, out, [](const scalar_t *px, scalar_t *py, size_t n) {
+      relu_kernel(px, py, n);
+    });
+  })
+  return out;
+};
 
+Tensor torchlet::ops::softmax(const Tensor &x) {
+  RecordScope scope("softmax");
   Tensor out(x.shape(), x.dtype());
-  ContiguousIterator it(&out, {&x});
-  std::size_t nfeat = it.input_dim;
+  softmax_out(x, out);
+  if (torchlet::core::needs_grad({&x}))
+    torchlet::detail::record_unary(Unary::Softmax, x, out);
+  return out;
+};
+
+Tensor &torchlet::ops::softmax_(Tensor &x) { return softmax_out(x, x); };
+
+Tensor &torchlet::ops::softmax_out(const Tensor &x, Tensor &out) {
+  RecordScope scope("softmax", [&] { return op_cost({&x, &out}); });
+  check_rowwise(x, out);
 
   DISPATCH_FLOAT(x.dtype(), scalar_t, {
-    it.for_each_with_inputs([&](uint8_t *optr, const uint8_t **iptrs, size_t) {
-      const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
-      scalar_t *py = reinterpret_cast<scalar_t *>(optr);
-      softmax_kernel(px, py, nfeat);
+    rowwise<scalar_t>(x, out, [](const scalar_t *px, scalar_t *py, size_t n) {
+      softmax_kernel(px, py, n);
     });
   })
   return out;
 };
 
+// Dropout : value k of x in row-major order takes value k of the mask, so
+// strided operands go through dense copies.
+
+namespace {
+
+void dropout_into(const Tensor &x, Tensor &out, const DropoutStep &step) {
+  const bool dense = torchlet::detail::is_dense(out.shape(), out.strides());
+  const Tensor xc = x.contiguous();
+  Tensor y = dense ? out : Tensor(out.shape(), out.dtype());
+
+  DISPATCH_FLOAT(x.dtype(), scalar_t, {
+    const scalar_t *px = xc.data_ptr<scalar_t>() + xc.elem_offset();
+    scalar_t *py = y.data_ptr<scalar_t>() + y.elem_offset();
+    torchlet::parallel_for(0, x.numel(), torchlet::GRAIN_SIZE,
+                           [&](std::size_t k0, std::size_t k1) {
+                             dropout_kernel(px + k0, py + k0, k1 - k0, k0,
+                                            step, false);
+                           });
+  })
+  if (!dense)
+    out.copy_(y);
+};
+
+} // namespace
+
+Tensor torchlet::ops::dropout(const Tensor &x, double p, Generator &gen) {
+  RecordScope scope("dropout");
+  Tensor out(x.shape(), x.dtype());
+  check_rowwise(x, out);
+  const DropoutStep step = draw_dropout(p, x.numel(), gen);
+  dropout_into(x, out, step);
+  if (torchlet::core::needs_grad({&x}))
+    torchlet::detail::record_dropout(x, out, step);
+  return out;
+};
+
+Tensor &torchlet::ops::dropout_(Tensor &x, double p, Generator &gen) {
+  return dropout_out(x, p, x, gen);
+};
+
+Tensor &torchlet::ops::dropout_out(const Tensor &x, double p, Tensor &out,
+                                   Generator &gen) {
+  RecordScope scope("dropout", [&] { return op_cost({&x, &out}); });
+  check_rowwise(x, out);
+  dropout_into(x, out, draw_dropout(p, x.numel(), gen));
+  return out;
+};
+
 Tensor torchlet::ops::log_softmax(const Tensor &x) {
-  torchlet::detail::check_contiguous(x, "x");
+  RecordScope scope("log_softmax");
+  Tensor out(x.shape(), x.dtype());
+  log_softmax_out(x, out);
+  if (torchlet::core::needs_grad({&x}))
+    torchlet::detail::record_unary(Unary::LogSoftmax, x, out);
+  return out;
+};
+
+Tensor &torchlet::ops::log_softmax_(Tensor &x) {
+  return log_softmax_out(x, x);
+};
+
+Tensor &torchlet::ops::log_softmax_out(const Tensor &x, Tensor &out) {
+  RecordScope scope("log_softmax", [&] { return op_cost({&x, &out}); });
+  check_rowwise(x, out);
+
+  DISPATCH_FLOAT(x.dtype(), scalar_t, {
+    rowwise<scalar_t>(x, out, [](const scalar_t *px, scalar_t *py, size_t n) {
+      log_softmax_kernel(px, py, n);
+    });
+  })
+  return out;
+};
+
+// Cross-entropy : one logsumexp_kernel call per row, the per-row lse kept
+// for the backward. Only the {rows} lse is stored, never a [rows, C] tensor.
+
+namespace {
+
+Tensor &cross_entropy_into(const Tensor &logits_in, const Tensor &targets_in,
+                           Tensor &loss, Tensor &lse) {
+  RecordScope scope("cross_entropy", [&] {
+    return op_cost({&logits_in, &targets_in, &loss},
+                   3.0 * double(logits_in.numel()));
+  });
+
+  const Tensor logits = logits_in.contiguous();
+  const Tensor targets = targets_in.contiguous();
+  torchlet::detail::check_rank_ge(logits, 1, "logits");
+  TL_CHECK(targets.dtype() == torchlet::core::Dtype::Int64,
+           "targets must be Int64.");
+  std::vector<size_t> rows_shape = logits.shape();
+  rows_shape.pop_back();
+  torchlet::detail::check_shape_eq(targets, rows_shape, "targets");
+  torchlet::detail::check_same_dtype(loss, logits, "loss", "logits");
+  torchlet::detail::check_shape_eq(loss, {1}, "loss");
+
+  const size_t C = logits.shape().back(), rows = targets.numel();
+  const int64_t *pt = targets.data_ptr<int64_t>() + targets.elem_offset();
+  for (size_t r = 0; r < rows; ++r)
+    if (pt[r] < 0 || static_cast<size_t>(pt[r]) >= C)
+      throw std::invalid_argument("Target out of range.");
+
+  lse = Tensor({rows}, logits.dtype());
+  DISPATCH_FLOAT(logits.dtype(), scalar_t, {
+    const scalar_t *px = logits.data_ptr<scalar_t>() + logits.elem_offset();
+    scalar_t *plse = lse.data_ptr<scalar_t>();
+    torchlet::parallel_for(
+        0, rows, std::max<size_t>(torchlet::GRAIN_SIZE / (C + 1), 1),
+        [&](size_t r0, size_t r1) {
+          for (size_t r = r0; r < r1; ++r)
+            plse[r] = logsumexp_kernel(px + r * C, C);
+        });
+
+    // rows is small next to rows * C : summed serially, in double, so that
+    // the loss does not depend on the thread count
+    double sum = 0.0;
+    for (size_t r = 0; r < rows; ++r)
+      sum += double(plse[r]) - double(px[r * C + size_t(pt[r])]);
+    loss.data_ptr<scalar_t>()[loss.elem_offset()] =
+        static_cast<scalar_t>(rows ? sum / double(rows) : 0.0);
+  })
+  return loss;
+};
+
+} // namespace
+
+Tensor torchlet::ops::cross_entropy(const Tensor &logits,
+                                    const Tensor &targets) {
+  RecordScope scope("cross_entropy");
+  Tensor loss({1}, logits.dtype()), lse;
+  cross_entropy_into(logits, targets, loss, lse);
+  if (torchlet::core::needs_grad({&logits}))
+    torchlet::detail::record_cross_entropy(logits, targets, lse, loss);
+  return loss;
+};
+
+Tensor &torchlet::ops::cross_entropy_out(const Tensor &logits,
+                                         const Tensor &targets, Tensor &loss) {
+  Tensor lse;
+  return cross_entropy_into(logits, targets, loss, lse);
+};
+
+// LayerNorm and RMSNorm over the last dim, one kernel call per row. With a
+// residual, the first pass over a row also stores x + residual into sum and
+// the second reads it back from there.
+
+namespace {
+
+enum class Norm { Layer, RMS };
+
+Tensor &norm_out(const char *name, Norm norm, const Tensor &x_in,
+                 const Tensor &residual_in, const Tensor &weight_in,
+                 const Tensor &bias_in, Tensor &out, Tensor &sum, double eps) {
+  RecordScope scope(name, [&] {
+    return op_cost({&x_in, &residual_in, &weight_in, &bias_in, &out, &sum},
+                   8.0 * double(out.numel()));
+  });
+
+  const Tensor x = x_in.contiguous();
+  const Tensor residual = residual_in.contiguous();
+  const Tensor weight = weight_in.contiguous();
+  const Tensor bias = bias_in.contiguous();
+
   torchlet::detail::check_rank_ge(x, 1, "x");
+  const size_t m = x.shape().back();
+  const bool has_residual = torchlet::detail::has_data(residual);
+  const bool has_weight = torchlet::detail::has_data(weight);
+  const bool has_bias = torchlet::detail::has_data(bias);
+  const bool has_sum = torchlet::detail::has_data(sum);
 
-  Tensor out(x.shape(), x.dtype());
-  ContiguousIterator it(&out, {&x});
-  std::size_t nfeat = it.input_dim;
+  if (has_residual) {
+    torchlet::detail::check_same_dtype(residual, x, "residual", "x");
+    torchlet::detail::check_shape_eq(residual, x.shape(), "residual");
+  }
+  if (has_weight) {
+    torchlet::detail::check_same_dtype(weight, x, "weight", "x");
+    torchlet::detail::check_rank(weight, 1, "weight");
+    torchlet::detail::check_dim_eq(weight, 0, m, "weight", "length");
+    torchlet::detail::check_no_alias(out, weight, "out", "weight");
+  }
+  if (has_bias) {
+    torchlet::detail::check_same_dtype(bias, x, "bias", "x");
+    torchlet::detail::check_rank(bias, 1, "bias");
+    torchlet::detail::check_dim_eq(bias, 0, m, "bias", "length");
+    torchlet::detail::check_no_alias(out, bias, "out", "bias");
+  }
+  torchlet::detail::check_contiguous(out, "out");
+  torchlet::detail::check_same_dtype(out, x, "out", "x");
+  torchlet::detail::check_shape_eq(out, x.shape(), "out");
+  if (has_sum) {
+    TL_CHECK(has_residual, "sum needs a residual.");
+    torchlet::detail::check_contiguous(sum, "sum");
+    torchlet::detail::check_same_dtype(sum, x, "sum", "x");
+    torchlet::detail::check_shape_eq(sum, x.shape(), "sum");
+  }
+
+  ContiguousIterator it = has_residual
+                              ? ContiguousIterator(&out, {&x, &residual})
+                              : ContiguousIterator(&out, {&x});
 
   DISPATCH_FLOAT(x.dtype(), scalar_t, {
-    it.for_each_with_inputs([&](uint8_t *optr, const uint8_t **iptrs, size_t) {
-      const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
-      scalar_t *py = reinterpret_cast<scalar_t *>(optr);
-      log_softmax_kernel(px, py, nfeat);
+    const scalar_t *pg =
+        has_weight ? weight.data_ptr<scalar_t>() + weight.elem_offset()
+                   : nullptr;
+    const scalar_t *pb =
+        has_bias ? bias.data_ptr<scalar_t>() + bias.elem_offset() : nullptr;
+    const scalar_t *py0 = reinterpret_cast<const scalar_t *>(it.output_ptr);
+    scalar_t *ph0 =
+        has_sum ? sum.data_ptr<scalar_t>() + sum.elem_offset() : nullptr;
+    const scalar_t e = static_cast<scalar_t>(eps);
+
+    it.parallel_for_each_block_with_inputs(
+        [&](uint8_t *optr, const uint8_t **iptrs, size_t n_in, size_t rows) {
+          scalar_t *py = reinterpret_cast<scalar_t *>(optr);
+          const scalar_t *px = reinterpret_cast<const scalar_t *>(iptrs[0]);
+          const scalar_t *pr =
+              n_in > 1 ? reinterpret_cast<const scalar_t *>(iptrs[1])
+                       : nullptr;
+          // sum has out's layout : same offset from its first row
+          scalar_t *ph = ph0 ? ph0 + (py - py0) : nullptr;
+
+          for (size_t i = 0; i < rows; ++i) {
+            if (norm == Norm::Layer)
+              layer_norm_kernel(px, pr, pg, pb, py, ph, m, e);
+            else
+              rms_norm_kernel(px, pr, pg, py, ph, m, e);
+            px += m;
+            py += m;
+            if (pr)
+              pr += m;
+            if (ph)
+              ph += m;
+          }
+        });
+  })
+  return out;
+};
+
+} // namespace
+
+Tensor torchlet::ops::layer_norm(const Tensor &x, const Tensor &weight,
+                                 const Tensor &bias, double eps) {
+  RecordScope scope("layer_norm");
+  Tensor out(x.shape(), x.dtype());
+  return layer_norm_out(x, weight, bias, out, eps);
+};
+
+Tensor &torchlet::ops::layer_norm_out(const Tensor &x, const Tensor &weight,
+                                      const Tensor &bias, Tensor &out,
+                                      double eps) {
+  Tensor none;
+  return norm_out("layer_norm", Norm::Layer, x, none, weight, bias, out, none,
+                  eps);
+};
+
+Tensor torchlet::ops::rms_norm(const Tensor &x, const Tensor &weight,
+                               double eps) {
+  RecordScope scope("rms_norm");
+  Tensor out(x.shape(), x.dtype());
+  return rms_norm_out(x, weight, out, eps);
+};
+
+Tensor &torchlet::ops::rms_norm_out(const Tensor &x, const Tensor &weight,
+                                    Tensor &out, double eps) {
+  Tensor none;
+  return norm_out("rms_norm", Norm::RMS, x, none, weight, none, out, none,
+                  eps);
+};
+
+Tensor torchlet::ops::residual_layer_norm(const Tensor &x, Tensor &residual,
+                                          const Tensor &weight,
+                                          const Tensor &bias, double eps) {
+  RecordScope scope("residual_layer_norm");
+  Tensor out(x.shape(), x.dtype());
+  return residual_layer_norm_out(x, residual, weight, bias, out, residual,
+                                 eps);
+};
+
+Tensor &torchlet::ops::residual_layer_norm_out(const Tensor &x,
+                                               const Tensor &residual,
+                                               const Tensor &weight,
+                                               const Tensor &bias, Tensor &out,
+                                               Tensor &sum, double eps) {
+  torchlet::detail::check_rank_ge(residual, 1, "residual");
+  return norm_out("residual_layer_norm", Norm::Layer, x, residual, weight,
+                  bias, out, sum, eps);
+};
+
+Tensor torchlet::ops::residual_rms_norm(const Tensor &x, Tensor &residual,
+                                        const Tensor &weight, double eps) {
+  RecordScope scope("residual_rms_norm");
+  Tensor out(x.shape(), x.dtype());
+  return residual_rms_norm_out(x, residual, weight, out, residual, eps);
+};
+
+Tensor &torchlet::ops::residual_rms_norm_out(const Tensor &x,
+                                             const Tensor &residual,
+                                             const Tensor &weight, Tensor &out,
+                                             Tensor &sum, double eps) {
+  torchlet::detail::check_rank_ge(residual, 1, "residual");
+  Tensor none;
+  return norm_out("residual_rms_norm", Norm::RMS, x, residual, weight, none,
+                  out, sum, eps);
+};
+
+// Binary ops : the iterator turns broadcast dims into 0 strides and
+// coalesces the rest, so same-shape operands reach the kernel as one run,
+// a scalar as a 0 stride and a bias row as one run per row.
+
+namespace {
+
+// Elements per chunk when a run has to be gathered into a dense buffer.
+constexpr std::size_t kBinaryChunk = 256;
+
+Tensor binary_alloc(const Tensor &a, const Tensor &b) {
+  torchlet::detail::check_same_dtype(a, b, "a", "b");
+  return Tensor(torchlet::detail::broadcast_shape(a.shape(), b.shape()),
+                a.dtype());
+};
+
+// A run with at least one non-unit stride : the strided operands are
+// gathered chunk by chunk into dense buffers and go through the same kernel.
+template <typename T>
+void binary_strided(const uint8_t *pa, std::ptrdiff_t sa, const uint8_t *pb,
+                    std::ptrdiff_t sb, uint8_t *py, std::ptrdiff_t sy,
+                    std::size_t n, BinaryOp op) {
+  const std::ptrdiff_t item = static_cast<std::ptrdiff_t>(sizeof(T));
+  auto gather = [](const uint8_t *src, std::ptrdiff_t s, std::size_t m,
+                   T *buf) {
+    for (std::size_t k = 0; k < m; ++k, src += s)
+      buf[k] = *reinterpret_cast<const T *>(src);
+  };
+
+  T ba[kBinaryChunk], bb[kBinaryChunk], by[kBinaryChunk];
+  for (std::size_t k0 = 0; k0 < n; k0 += kBinaryChunk) {
+    const std::size_t m = std::min(kBinaryChunk, n - k0);
+
+    const T *xa = reinterpret_cast<const T *>(pa);
+    if (sa != 0 && sa != item) {
+      gather(pa, sa, m, ba);
+      xa = ba;
+    }
+    const T *xb = reinterpret_cast<const T *>(pb);
+    if (sb != 0 && sb != item) {
+      gather(pb, sb, m, bb);
+      xb = bb;
+    }
+
+    if (sy == item) {
+      binary_kernel(xa, sa != 0, xb, sb != 0, reinterpret_cast<T *>(py), m,
+                    op);
+    } else {
+      binary_kernel(xa, sa != 0, xb, sb != 0, by, m, op);
+      uint8_t *dst = py;
+      for (std::size_t k = 0; k < m; ++k, dst += sy)
+        *reinterpret_cast<T *>(dst) = by[k];
+    }
+
+    const std::ptrdiff_t step = static_cast<std::ptrdiff_t>(m);
+    pa += step * sa;
+    pb += step * sb;
+    py += step * sy;
+  }
+};
+
+// Integer division traps on a zero divisor and on min / -1 : every pair is
+// checked before the kernel writes anything.
+template <typename T> void check_int_div(TensorIterator &it) {
+  it.parallel_for_each([](uint8_t **data, const std::ptrdiff_t *strides,
+                          size_t n) {
+    const uint8_t *pa = data[1], *pb = data[2];
+    for (size_t k = 0; k < n; ++k, pa += strides[1], pb += strides[2]) {
+      const T b = *reinterpret_cast<const T *>(pb);
+      if (b == T{0})
+        throw std::invalid_argument("Integer division by zero.");
+      if constexpr (std::is_signed_v<T>)
+        if (b == T{-1} && *reinterpret_cast<const T *>(pa) ==
+                              std::numeric_limits<T>::min())
+          throw std::invalid_argument("Integer division overflows.");
+    }
+  });
+};
+
+Tensor &binary_out(const char *name, const Tensor &a, const Tensor &b,
+                   Tensor &out, BinaryOp op) {
+  RecordScope scope(name, [&] {
+    return op_cost({&a, &b, &out}, double(out.numel()));
+  });
+  torchlet::detail::check_same_dtype(a, b, "a", "b");
+  torchlet::detail::check_same_dtype(out, a, "out", "a");
+  torchlet::detail::check_shape_eq(
+      out, torchlet::detail::broadcast_shape(a.shape(), b.shape()), "out");
+
+  TensorIterator it(&out, {&a, &b});
+
+  DISPATCH_ALL(out.dtype(), scalar_t, {
+    if constexpr (std::is_integral_v<scalar_t>)
+      if (op == BinaryOp::Div)
+        check_int_div<scalar_t>(it);
+    const std::ptrdiff_t item = static_cast<std::ptrdiff_t>(sizeof(scalar_t));
+    it.parallel_for_each([&](uint8_t **data, const std::ptrdiff_t *strides,
+                             size_t n) {
+      const std::ptrdiff_t sy = strides[0], sa = strides[1], sb = strides[2];
+      if (sy == item && (sa == 0 || sa == item) && (sb == 0 || sb == item)) {
+        binary_kernel(reinterpret_cast<const scalar_t *>(data[1]),
+                      static_cast<size_t>(sa / item),
+                      reinterpret_cast<const scalar_t *>(data[2]),
+                      static_cast<size_t>(sb / item),
+                      reinterpret_cast<scalar_t *>(data[0]), n, op);
+        return;
+      }
+      binary_strided<scalar_t>(data[1], sa, data[2], sb, data[0], sy, n, op);
     });
   })
   return out;
 };
+
+} // namespace
+
+#define TL_DEFINE_BINARY(NAME, OP)                                             \
+  Tensor torchlet::ops::NAME(const Tensor &a, const Tensor &b) {               \
+    RecordScope scope(#NAME);                                                  \
+    Tensor out = binary_alloc(a, b);                                           \
+    return binary_out(#NAME, a, b, out, OP);                                   \
+  };                                                                           \
+  Tensor &torchlet::ops::NAME##_out(const Tensor &a, const Tensor &b,          \
+                                    Tensor &out) {                             \
+    return binary_out(#NAME, a, b, out, OP);                                   \
+  };                                                                           \
+  Tensor &torchlet::ops::NAME##_(Tensor &a, const Tensor &b) {                 \
+    return binary_out(#NAME, a, b, a, OP);                                     \
+  };
+
+TL_DEFINE_BINARY(add, BinaryOp::Add)
+TL_DEFINE_BINARY(sub, BinaryOp::Sub)
+TL_DEFINE_BINARY(mul, BinaryOp::Mul)
+TL_DEFINE_BINARY(div, BinaryOp::Div)
+TL_DEFINE_BINARY(maximum, BinaryOp::Maximum)
+
+#undef TL_DEFINE_BINARY
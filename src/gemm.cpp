@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "simd/kernels.h"
+#include <torchlet/core/parallel.h>
+#include <torchlet/ops/kernel.h>
+
+// Cache-blocked GEMM in the style of Goto/BLIS : C is computed in NC x KC
+// panels of B and MC x KC blocks of A, both packed into contiguous slivers
+// so that the MR x NR register tile only ever streams unit-stride memory.
+
+namespace {
+
+// Register tile and micro-kernel of one GEMM, picked at runtime : the SIMD
+// table provides the float one, the portable template below the others.
+template <typename T> struct Tile {
+  std::size_t mr, nr;
+  void (*kernel)(std::size_t kc, const T *Ap, const T *Bp, T *C,
+                 std::size_t ldc, std::size_t mr, std::size_t nr,
+                 bool accumulate, const T *bias) noexcept;
+};
+
+// KC x NR slivers of B stay in L1, MC x KC blocks of A in L2 and the
+// KC x NC panel of B in L3. MC is rounded down to a multiple of the tile.
+constexpr std::size_t kKC = 256;
+constexpr std::size_t kMC = 128;
+constexpr std::size_t kNC = 2048;
+
+/// @brief Pack an mc x kc block of A into MR-tall slivers (zero padded).
+/// A(i, p) = A[i * rsa + p * csa]
+template <typename T>
+void pack_a(const T *A, std::size_t rsa, std::size_t csa, std::size_t mc,
+            std::size_t kc, std::size_t MR, T *Ap) noexcept {
+  for (std::size_t i0 = 0; i0 < mc; i0 += MR) {
+    const std::size_t mr = std::min(MR, mc - i0);
+    const T *a = A + i0 * rsa;
+
+    if (csa == 1) {
+      for (std::size_t i = 0; i < mr; ++i) {
+        const T *arow = a + i * rsa;
+        for (std::size_t p = 0; p < kc; ++p)
+          Ap[p * MR + i] = arow[p];
+      }
+    } else {
+      for (std::size_t p = 0; p < kc; ++p)
+        for (std::size_t i = 0; i < mr; ++i)
+          Ap[p * MR + i] = a[i * rsa + p * csa];
+    }
+    for (std::size_t i = mr; i < MR; ++i)
+      for (std::size_t p = 0; p < kc; ++p)
+        Ap[p * MR + i] = T{0};
+
+    Ap += MR * kc;
+  }
+};
+
+/// @brief Pack the NR-wide sliver j0 of a kc x nc panel of B (zero padded).
+/// B(p, j) = B[p * rsb + j * csb]
+template <typename T>
+void pack_b(const T *B, std::size_t rsb, std::size_t csb, std::size_t kc,
+            std::size_t nc, std::size_t j0, std::size_t NR, T *Bp) noexcept {
+  const std::size_t nr = std::min(NR, nc - j0);
+  const T *b = B + j0 * csb;
+
+  if (csb == 1) {
+    for (std::size_t p = 0; p < kc; ++p) {
+      const T *brow = b + p * rsb;
+      for (std::size_t j = 0; j < nr; ++j)
+        Bp[p * NR + j] = brow[j];
+      for (std::size_t j = nr; j < NR; ++j)
+        Bp[p * NR + j] = T{0};
+    }
+  } else {
+    for (std::size_t j = 0; j < nr; ++j) {
+      const T *bcol = b + j * csb;
+      for (std::size_t p = 0; p < kc; ++p)
+        Bp[p * NR + j] = bcol[p * rsb];
+    }
+    for (std::size_t j = nr; j < NR; ++j)
+      for (std::size_t p = 0; p < kc; ++p)
+        Bp[p * NR + j] = T{0};
+  }
+};
+
+/// @brief Portable MR x NR register tile : C (+)= Ap * Bp over kc.
+/// On the first K panel C is overwritten and the bias is added.
+template <typename T, std::size_t MR, std::size_t NR>
+void micro_kernel(std::size_t kc, const T *__restrict Ap,
+                  const T *__restrict Bp, T *__restrict C, std::size_t ldc,
+                  std::size_t mr, std::size_t nr, bool accumulate,
+                  const T *bias) noexcept {
+  T acc[MR][NR] = {};
+
+  for (std::size_t p = 0; p < kc; ++p) {
+    for (std::size_t i = 0; i < MR; ++i) {
+      const T a = Ap[i];
+      for (std::size_t j = 0; j < NR; ++j)
+        acc[i][j] += a * Bp[j];
+    }
+    Ap += MR;
+    Bp += NR;
+  }
+
+  for (std::size_t i = 0; i < mr; ++i) {
+    T *c = C + i * ldc;
+    if (accumulate) {
+      for (std::size_t j = 0; j < nr; ++j)
+        c[j] += acc[i][j];
+    } else if (bias) {
+      for (std::size_t j = 0; j < nr; ++j)
+        c[j] = bias[j] + acc[i][j];
+    } else {
+      for (std::size_t j = 0; j < nr; ++j)
+        c[j] = acc[i][j];
+    }
+  }
+};
+
+template <typename T> Tile<T> tile() noexcept {
+  if constexpr (std::is_same_v<T, float>) {
+    if (const auto *simd = torchlet::simd::kernel_table())
+      return {simd->gemm_mr, simd->gemm_nr, simd->gemm};
+    return {4, 8, micro_kernel<float, 4, 8>};
+  } else {
+    return {4, 4, micro_kernel<double, 4, 4>};
+  }
+};
+
+/// @brief C = act(A * B (+ bias broadcast over rows)), C row-major with ldc.
+/// With accumulate, C += A * B (no bias nor activation).
+///
+/// Each K panel of B is packed once, by all threads, then the MC row blocks
+/// times column chunks of the panel are spread over the threads, each of
+/// which packs its own A block.
+template <typename T>
+void gemm(std::size_t m, std::size_t n, std::size_t k, const T *A,
+          std::size_t rsa, std::size_t csa, const T *B, std::size_t rsb,
+          std::size_t csb, const T *bias, T *C, std::size_t ldc,
+          Activation act, bool accumulate = false) {
+  if (m == 0 || n == 0 || (k == 0 && accumulate))
+    return;
+
+  if (k == 0) {
+    for (std::size_t i = 0; i < m; ++i) {
+      T *c = C + i * ldc;
+      for (std::size_t j = 0; j < n; ++j)
+        c[j] = bias ? bias[j] : T{0};
+      activation_kernel(c, n, act);
+    }
+    return;
+  }
+
+  const Tile<T> tl = tile<T>();
+  const std::size_t MR = tl.mr, NR = tl.nr;
+  const std::size_t MC = std::max(kMC / MR, std::size_t{1}) * MR;
+  const std::size_t NC = (kNC + NR - 1) / NR * NR;
+
+  // Softmax needs whole rows : it runs once C is complete, elementwise
+  // activations run on each tile after its last K panel.
+  const Activation tile_act =
+      act == Activation::Softmax ? Activation::None : act;
+
+  thread_local std::vector<T> b_buf;
+  b_buf.resize(std::min(k, kKC) * ((std::min(n, NC) + NR - 1) / NR) * NR);
+  T *Bpanel = b_buf.data();
+
+  const std::size_t n_ic = (m + MC - 1) / MC;
+  const std::size_t threads = torchlet::get_num_threads();
+
+  for (std::size_t jc = 0; jc < n; jc += NC) {
+    const std::size_t nc = std::min(NC, n - jc);
+    const std::size_t n_slivers = (nc + NR - 1) / NR;
+
+    // Split the panel in column chunks when there are too few row blocks
+    // to keep every thread busy.
+    const std::size_t n_jt = std::min(
+        n_slivers, std::max<std::size_t>(1, (2 * threads + n_ic - 1) / n_ic));
+    const std::size_t chunk = (n_slivers + n_jt - 1) / n_jt * NR;
+
+    for (std::size_t pc = 0; pc < k; pc += kKC) {
+      const std::size_t kc = std::min(kKC, k - pc);
+      const bool acc = accumulate || pc != 0;
+      const bool last = pc + kc == k;
+      const T *Bk = B + pc * rsb + jc * csb;
+
+      torchlet::parallel_for(
+          0, n_slivers,
+          std::max<std::size_t>(torchlet::GRAIN_SIZE / (kc * NR), 1),
+          [&](std::size_t s0, std::size_t s1) {
+            for (std::size_t s = s0; s < s1; ++s)
+              pack_b(Bk, rsb, csb, kc, nc, s * NR, NR, Bpanel + s * NR * kc);
+          });
+
+      const std::size_t task_macs = std::min(MC, m) * kc * chunk;
+      torchlet::parallel_for(
+          0, n_ic * n_jt,
+          std::max<std::size_t>(torchlet::GRAIN_SIZE / task_macs, 1),
+          [&](std::size_t t0, std::size_t t1) {
+            thread_local std::vector<T> a_buf;
+            a_buf.resize(MC * kKC);
+            std::size_t packed = n_ic; // row block held in a_buf
+
+            for (std::size_t t = t0; t < t1; ++t) {
+              const std::size_t ic = t / n_jt * MC;
+              const std::size_t mc = std::min(MC, m - ic);
+              const std::size_t j0 = t % n_jt * chunk;
+              const std::size_t j1 = std::min(nc, j0 + chunk);
+
+              if (packed != ic / MC) {
+                pack_a(A + ic * rsa + pc * csa, rsa, csa, mc, kc, MR,
+                       a_buf.data());
+                packed = ic / MC;
+              }
+
+              for (std::size_t jr = j0; jr < j1; jr += NR) {
+                const std::size_t nr = std::min(NR, nc - jr);
+                const T *Bp = Bpanel + jr * kc;
+                const T *bj = bias ? bias + jc + jr : nullptr;
+
+                for (std::size_t ir = 0; ir < mc; ir += MR) {
+                  const std::size_t mr = std::min(MR, mc - ir);
+                  T *Cij = C + (ic + ir) * ldc + jc + jr;
+
+                  tl.kernel(kc, a_buf.data() + ir * kc, Bp, Cij, ldc, mr, nr,
+                            acc, bj);
+                  if (last && tile_act != Activation::None)
+                    for (std::size_t i = 0; i < mr; ++i)
+                      activation_kernel(Cij + i * ldc, nr, tile_act);
+                }
+              }
+            }
+          });
+    }
+  }
+
+  if (act == Activation::Softmax)
+    torchlet::parallel_for(
+        0, m, std::max<std::size_t>(torchlet::GRAIN_SIZE / n, 1),
+        [&](std::size_t i0, std::size_t i1) {
+          for (std::size_t i = i0; i < i1; ++i)
+            softmax_kernel(C + i * ldc, C + i * ldc, n);
+        });
+};
+
+} // namespace
+
+template <typename T>
+void mm_kernel(const T *A, const T *B, T *C, std::size_t m, std::size_t n,
+               std::size_t k) {
+  gemm<T>(m, n, k, A, k, 1, B, n, 1, nullptr, C, n, Activation::None);
+};
+
+template <typename T>
+void mm_strided_kernel(const T *A, std::size_t rsa, std::size_t csa,
+                       const T *B, std::size_t rsb, std::size_t csb, T *C,
+                       std::size_t ldc, std::size_t m, std::size_t n,
+                       std::size_t k, bool accumulate) {
+  gemm<T>(m, n, k, A, rsa, csa, B, rsb, csb, nullptr, C, ldc,
+          Activation::None, accumulate);
+};
+
+template <typename T>
+void mmb_kernel(const T *A, const T *W, const T *b, T *C, std::size_t m,
+                std::size_t n, std::size_t k, Activation act) {
+  // B = W^T : B(p, j) = W[j * k + p]
+  gemm<T>(m, n, k, A, k, 1, W, 1, k, b, C, n, act);
+};
+
+template void mm_kernel(const float *A, const float *B, float *C, std::size_t m,
+                        std::size_t n, std::size_t k);
+template void mm_kernel(const double *A, const double *B, double *C,
+                        std::size_t m, std::size_t n, std::size_t k);
+
+template void mm_strided_kernel(const float *A, std::size_t rsa,
+                                std::size_t csa, const float *B,
+                                std::size_t rsb, std::size_t csb, float *C,
+                                std::size_t ldc, std::size_t m, std::size_t n,
+                                std::size_t k, bool accumulate);
+template void mm_strided_kernel(const double *A, std::size_t rsa,
+                                std::size_t csa, const double *B,
+                                std::size_t rsb, std::size_t csb, double *C,
+                                std::size_t ldc, std::size_t m, std::size_t n,
+                                std::size_t k, bool accumulate);
+
+template void mmb_kernel(const float *A, const float *W, const float *b,
+                         float *C, std::size_t m, std::size_t n, std::size_t k,
+                         Activation act);
+template void mmb_kernel(const double *A, const double *W, const double *b,
+                         double *C, std::size_t m, std::size_t n, std::size_t k,
+                         Activation act);
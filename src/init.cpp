@@ -1,77 +1,77 @@
+#include <algorithm>
+#include <torchlet/core/parallel.h>
 #include <torchlet/ops/init.h>
+#include <torchlet/ops/kernel.h>
 
-// TODO : Remove hard coded loops -> implement iterator.
+#include "detail/helpers.h"
 
 using torchlet::core::Tensor, torchlet::core::Generator;
 
+namespace {
+
+// Element k, in logical row-major order, comes from counter offset + k / G of
+// gen whatever the layout : a view receives the same values as a contiguous
+// tensor of its shape, and chunks of counters drawn on separate threads give
+// the serial result. Views and Float16 / BFloat16 tensors draw into a dense
+// tensor of T first.
+template <typename T, typename Kernel>
+void fill_random(Tensor &tensor, Generator &gen, Kernel kernel) {
+  constexpr std::size_t G = kPhiloxValues<T>;
+  const auto draw = CPPTypeToDType<T>::dtype;
+  const std::size_t n = tensor.numel();
+  const std::size_t counters = (n + G - 1) / G;
+  const std::uint64_t seed = gen.seed();
+  const std::uint64_t counter = gen.advance(counters);
+
+  const bool direct =
+      tensor.dtype() == draw &&
+      torchlet::detail::is_dense(tensor.shape(), tensor.strides());
+  Tensor out = direct ? tensor : Tensor(tensor.shape(), draw);
+  T *y = out.data_ptr<T>() + out.elem_offset();
+  torchlet::parallel_for(
+      0, counters, torchlet::GRAIN_SIZE / G, [&](std::size_t b, std::size_t e) {
+        kernel(y + b * G, std::min(n, e * G) - b * G, seed, counter + b);
+      });
+  if (!direct)
+    tensor.copy_(out);
+};
+
+bool accepts(torchlet::core::Dtype dtype, torchlet::core::Dtype draw) {
+  return dtype == draw || (draw == torchlet::core::Dtype::Float32 &&
+                           (dtype == torchlet::core::Dtype::Float16 ||
+                            dtype == torchlet::core::Dtype::BFloat16));
+};
+
+} // namespace
+
 template <typename T>
 void torchlet::ops::init::normal_(Tensor &tensor, T mean, T stdev,
                                   Generator &gen) {
 
-  if (CPPTypeToDType<T>::dtype != tensor.dtype()) {
+  if (!accepts(tensor.dtype(), CPPTypeToDType<T>::dtype)) {
     throw std::runtime_error("Type T does not match the type of dtype.");
   }
 
-  std::normal_distribution<T> dist{mean, stdev};
-
-  std::size_t elem_offset = tensor.elem_offset();
-  T *data_ptr = tensor.data_ptr<T>();
-
-  if (tensor.is_contiguous()) {
-    for (std::size_t idx = 0; idx < tensor.numel(); idx++)
-      data_ptr[idx + elem_offset] = dist(gen.engine());
-  } else {
-
-    std::vector<std::size_t> shape = tensor.shape();
-    std::vector<std::size_t> strides = tensor.strides();
-
-    for (std::size_t idx = 0; idx < tensor.numel(); idx++) {
-      std::size_t offset = elem_offset;
-      std::size_t tmp = idx;
-      for (std::size_t dim = shape.size(); dim-- > 0;) {
-        std::size_t coord = tmp % shape[dim];
-        tmp /= shape[dim];
-        offset += coord * strides[dim];
-      }
-      data_ptr[offset] = dist(gen.engine());
-    }
-  }
-
-  return;
+  fill_random<T>(tensor, gen,
+                 [&](T *y, std::size_t n, std::uint64_t seed,
+                     std::uint64_t counter) {
+                   normal_kernel(y, n, seed, counter, mean, stdev);
+                 });
 };
 
 template <typename T>
 void torchlet::ops::init::uniform_(Tensor &tensor, T start, T end,
                                    Generator &gen) {
 
-  if (CPPTypeToDType<T>::dtype != tensor.dtype()) {
+  if (!accepts(tensor.dtype(), CPPTypeToDType<T>::dtype)) {
     throw std::runtime_error("Type T does not match the type of dtype.");
   }
 
-  std::uniform_real_distribution<T> dist{start, end};
-
-  std::size_t elem_offset = tensor.elem_offset();
-  T *data_ptr = tensor.data_ptr<T>();
-
-  if (tensor.is_contiguous()) {
-    for (std::size_t idx = 0; idx < tensor.numel(); idx++)
-      data_ptr[idx + elem_offset] = dist(gen.engine());
-  } else {
-
-    std::vector<std::size_t> shape = tensor.shape();
-    std::vector<std::size_t> strides = tensor.strides();
-
-    for (std::size_t idx = 0; idx < tensor.numel(); idx++) {
-      std::size_t offset = elem_offset;
-      std::size_t tmp = idx;
-      for (std::size_t dim = shape.size(); dim-- > 0;) {
-        std::size_t coord = tmp % shape[dim];
-        tmp /= shape[dim];
-        offset += coord * strides[dim];
-      }
-      data_ptr[offset] = dist(gen.engine());
-    }
-  }
+  fill_random<T>(tensor, gen,
+                 [&](T *y, std::size_t n, std::uint64_t seed,
+                     std::uint64_t counter) {
+                   uniform_kernel(y, n, seed, counter, start, end);
+                 });
 };
 
 template void torchlet::ops::init::normal_(Tensor &, float, float, Generator &);
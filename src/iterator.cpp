@@ -17,7 +17,7 @@ ContiguousIterator::ContiguousIterator(
   for (std::size_t k = 0; k < out_shape.size() - 1; k++)
     batch_size *= out_shape[k];
 
-  output_ptr = out->data_ptr<std::uint8_t>();
+  output_ptr = out->data_ptr<std::uint8_t>() + out->elem_offset() * itemsize;
 
   if (inputs.size() != 0) {
     bool set = false;
@@ -27,7 +27,8 @@ ContiguousIterator::ContiguousIterator(
         input_dim = in->shape().back();
         set = true;
       }
-      input_ptrs.push_back(in->data_ptr<std::uint8_t>());
+      input_ptrs.push_back(in->data_ptr<std::uint8_t>() +
+                           in->elem_offset() * itemsize);
     }
   }
 };
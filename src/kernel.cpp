@@ -1,68 +1,321 @@
-#include <Accelerate/Accelerate.h>
+#include "detail/blas.h"
+#include "detail/philox.h"
+#include "simd/kernels.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <torchlet/core/cpu.h>
+#include <torchlet/core/half.h>
 #include <torchlet/ops/kernel.h>
+#include <type_traits>
 
-template <typename T>
-void mm_kernel(const T *A, const T *B, T *C, std::size_t m, std::size_t n,
-               std::size_t k) {
-
-  T acc;
-  for (std::size_t i = 0; i < m; ++i) {
-    const T *Ai = A + i * k;
-    for (std::size_t j = 0; j < n; ++j) {
-      acc = T{0};
-      for (std::size_t l = 0; l < k; ++l) {
-        acc = std::fma(Ai[l], B[n * l + j], acc);
-      }
-      C[i * n + j] = acc;
-    }
+const torchlet::simd::KernelTable *torchlet::simd::kernel_table() noexcept {
+#if TORCHLET_HAVE_X86_SIMD
+  switch (torchlet::core::cpu_capability()) {
+  case torchlet::core::CpuCapability::AVX512:
+    return &avx512::table;
+  case torchlet::core::CpuCapability::AVX2:
+    return &avx2::table;
+  case torchlet::core::CpuCapability::SSE4:
+    return &sse4::table;
+  case torchlet::core::CpuCapability::Default:
+    break;
   }
+#endif
+  return nullptr;
 };
 
+// float kernels go through the SIMD table of the active CPU capability, the
+// templates below are the portable reference.
+#define TL_SIMD_DISPATCH(T, NAME, ...)                                         \
+  if constexpr (std::is_same_v<T, float>) {                                    \
+    if (const auto *simd = torchlet::simd::kernel_table()) {                   \
+      simd->NAME(__VA_ARGS__);                                                 \
+      return;                                                                  \
+    }                                                                          \
+  }
+
+const char *blas_backend() noexcept { return TORCHLET_BLAS_NAME; };
+
 template <typename T>
 void mvb_kernel(const T *W, const T *x, const T *b, T *y, std::size_t m,
                 std::size_t n) noexcept {
+  TL_SIMD_DISPATCH(T, mvb, W, x, b, y, m, n)
 
-  for (auto k = 0; k < m; k++) {
+  // Four rows per pass share every load of x and give four independent
+  // accumulator chains. -ffast-math lets the compiler vectorise each one.
+  std::size_t k = 0;
+  for (; k + 4 <= m; k += 4) {
+    const T *w0 = W + k * n;
+    const T *w1 = w0 + n;
+    const T *w2 = w1 + n;
+    const T *w3 = w2 + n;
+    T acc0 = T{0}, acc1 = T{0}, acc2 = T{0}, acc3 = T{0};
+
+    for (std::size_t i = 0; i < n; i++) {
+      const T xv = x[i];
+      acc0 += w0[i] * xv;
+      acc1 += w1[i] * xv;
+      acc2 += w2[i] * xv;
+      acc3 += w3[i] * xv;
+    }
+
+    y[k] = b ? b[k] + acc0 : acc0;
+    y[k + 1] = b ? b[k + 1] + acc1 : acc1;
+    y[k + 2] = b ? b[k + 2] + acc2 : acc2;
+    y[k + 3] = b ? b[k + 3] + acc3 : acc3;
+  }
+
+  for (; k < m; k++) {
     T acc = b ? b[k] : T{0};
     const T *wrow = W + k * n;
-    for (auto i = 0; i < n; i++) {
+    for (std::size_t i = 0; i < n; i++)
       acc += wrow[i] * x[i];
-    }
     y[k] = acc;
   }
 }
 
-void mvb_blas_kernel(const float *__restrict W, const float *__restrict x,
-                     const float *__restrict b, float *__restrict y,
-                     std::size_t m, std::size_t n) noexcept {
+// Entries of the SIMD table that take the raw bits of W_T, nullptr where
+// the instruction set has no fast path.
+template <typename W_T> struct ReducedEntries;
+template <> struct ReducedEntries<torchlet::core::Half> {
+  static constexpr auto mvb = &torchlet::simd::KernelTable::mvb_f16;
+  static constexpr auto widen = &torchlet::simd::KernelTable::widen_f16;
+  static constexpr auto narrow = &torchlet::simd::KernelTable::narrow_f16;
+};
+template <> struct ReducedEntries<torchlet::core::BFloat16> {
+  static constexpr auto mvb = &torchlet::simd::KernelTable::mvb_bf16;
+  static constexpr auto widen = &torchlet::simd::KernelTable::widen_bf16;
+  static constexpr auto narrow = &torchlet::simd::KernelTable::narrow_bf16;
+};
+
+template <typename W_T> const std::uint16_t *bits_of(const W_T *p) noexcept {
+  return reinterpret_cast<const std::uint16_t *>(p);
+};
+
+template <typename W_T>
+void mvb_mixed_kernel(const W_T *W, const float *x, const float *b, float *y,
+                      std::size_t m, std::size_t n) noexcept {
+  if (const auto *simd = torchlet::simd::kernel_table())
+    if (auto fn = simd->*ReducedEntries<W_T>::mvb) {
+      fn(bits_of(W), x, b, y, m, n);
+      return;
+    }
+
+  for (std::size_t k = 0; k < m; k++) {
+    float acc = b ? b[k] : 0.0f;
+    const W_T *wrow = W + k * n;
+    for (std::size_t i = 0; i < n; i++)
+      acc += static_cast<float>(wrow[i]) * x[i];
+    y[k] = acc;
+  }
+};
+
+template <typename R>
+void widen_kernel(const R *x, float *y, std::size_t m) noexcept {
+  if (const auto *simd = torchlet::simd::kernel_table())
+    if (auto fn = simd->*ReducedEntries<R>::widen) {
+      fn(bits_of(x), y, m);
+      return;
+    }
+
+  for (std::size_t k = 0; k < m; k++)
+    y[k] = static_cast<float>(x[k]);
+};
+
+template <typename R>
+void narrow_kernel(const float *x, R *y, std::size_t m) noexcept {
+  if (const auto *simd = torchlet::simd::kernel_table())
+    if (auto fn = simd->*ReducedEntries<R>::narrow) {
+      fn(x, reinterpret_cast<std::uint16_t *>(y), m);
+      return;
+    }
+
+  for (std::size_t k = 0; k < m; k++)
+    y[k] = R(x[k]);
+};
+
+void quantize_row_kernel(const float *x, std::int8_t *q, std::size_t n,
+                         float &scale, std::int32_t &sum) noexcept {
+  float amax = 0.0f;
+  for (std::size_t k = 0; k < n; k++)
+    amax = std::max(amax, std::fabs(x[k]));
+  scale = amax > 0.0f ? amax / 127.0f : 1.0f;
+
+  const float inv = 1.0f / scale;
+  sum = 0;
+  for (std::size_t k = 0; k < n; k++) {
+    const float r = std::nearbyint(x[k] * inv);
+    q[k] = static_cast<std::int8_t>(std::clamp(r, -127.0f, 127.0f));
+    sum += q[k];
+  }
+};
+
+void qmmb_kernel(const std::uint8_t *W, const float *w_scale,
+                 const std::int32_t *w_zp, const std::int8_t *X,
+                 const float *x_scale, const std::int32_t *x_sum,
+                 const float *b, float *Y, std::size_t M, std::size_t m,
+                 std::size_t n, std::size_t ldy) noexcept {
+  if (const auto *simd = torchlet::simd::kernel_table()) {
+    simd->qmmb(W, w_scale, w_zp, X, x_scale, x_sum, b, Y, M, m, n, ldy);
+    return;
+  }
 
-  float alpha = 1.0f, beta = 0.0f;
-  const int incx = 1, incy = 1;
+  for (std::size_t i = 0; i < M; i++) {
+    const std::int8_t *xrow = X + i * n;
+    for (std::size_t o = 0; o < m; o++) {
+      const std::uint8_t *wrow = W + o * n;
+      std::int32_t dot = 0;
+      for (std::size_t k = 0; k < n; k++)
+        dot += static_cast<std::int32_t>(wrow[k]) * xrow[k];
+      const float v = static_cast<float>(dot - w_zp[o] * x_sum[i]);
+      Y[i * ldy + o] = w_scale[o] * x_scale[i] * v + (b ? b[o] : 0.0f);
+    }
+  }
+};
 
+template <typename T>
+void mvb_blas_kernel(const T *__restrict W, const T *__restrict x,
+                     const T *__restrict b, T *__restrict y, std::size_t m,
+                     std::size_t n) noexcept {
+#if TORCHLET_HAS_BLAS
+  T beta = T{0};
   if (b) {
-    beta = 1.0f;
-    std::memcpy(y, b, m * sizeof(float));
+    beta = T{1};
+    std::memcpy(y, b, m * sizeof(T));
   }
+  torchlet::detail::blas::gemv(m, n, W, x, beta, y);
+#else
+  mvb_kernel(W, x, b, y, m, n);
+#endif
+};
+
+template <typename T>
+void mm_blas_kernel(const T *A, bool trans_a, const T *B, bool trans_b, T *C,
+                    std::size_t m, std::size_t n, std::size_t k,
+                    bool accumulate) {
+#if TORCHLET_HAS_BLAS
+  if (m && n)
+    torchlet::detail::blas::gemm(trans_a, trans_b, m, n, k, A, B,
+                                 accumulate ? T{1} : T{0}, C);
+#else
+  mm_strided_kernel(A, trans_a ? 1 : k, trans_a ? m : 1, B, trans_b ? 1 : n,
+                    trans_b ? k : 1, C, n, m, n, k, accumulate);
+#endif
+};
+
+template <typename T>
+void mmb_blas_kernel(const T *__restrict A, const T *__restrict W,
+                     const T *__restrict b, T *__restrict C, std::size_t m,
+                     std::size_t n, std::size_t k, Activation act) {
+#if TORCHLET_HAS_BLAS
+  if (m == 0 || n == 0)
+    return;
+  // The BLAS call has no epilogue : with an activation, rows go through in
+  // ~256 KiB blocks so that the second pass reads C back from L2.
+  const std::size_t block =
+      act == Activation::None
+          ? m
+          : std::max<std::size_t>((std::size_t{1} << 18) / (n * sizeof(T)), 4);
+
+  for (std::size_t i0 = 0; i0 < m; i0 += block) {
+    const std::size_t mb = std::min(block, m - i0);
+    T *Cb = C + i0 * n;
+
+    T beta = T{0};
+    if (b) {
+      beta = T{1};
+      for (std::size_t i = 0; i < mb; ++i)
+        std::memcpy(Cb + i * n, b, n * sizeof(T));
+    }
+    torchlet::detail::blas::gemm_nt(mb, n, k, A + i0 * k, W, beta, Cb);
 
-  cblas_sgemv(CblasRowMajor, CblasNoTrans, m, n, alpha, W, n, x, incx, beta, y,
-              incy);
+    if (act != Activation::None)
+      for (std::size_t i = 0; i < mb; ++i)
+        activation_kernel(Cb + i * n, n, act);
+  }
+#else
+  mmb_kernel(A, W, b, C, m, n, k, act);
+#endif
 };
 
 template <typename T>
 void vadd_kernel(const T *x, T *y, std::size_t m) noexcept {
+  TL_SIMD_DISPATCH(T, vadd, x, y, m)
+
   for (auto k = 0; k < m; k++) {
     y[k] += x[k];
   }
 };
 
+namespace {
+
+template <BinaryOp OP, typename T> inline T binary(T a, T b) noexcept {
+  if constexpr (OP == BinaryOp::Add)
+    return static_cast<T>(a + b);
+  else if constexpr (OP == BinaryOp::Sub)
+    return static_cast<T>(a - b);
+  else if constexpr (OP == BinaryOp::Mul)
+    return static_cast<T>(a * b);
+  else if constexpr (OP == BinaryOp::Div)
+    return static_cast<T>(a / b);
+  else
+    return a > b ? a : b;
+};
+
+// One loop per broadcast pattern so that each one vectorises on its own.
+template <BinaryOp OP, typename T>
+void binary_loop(const T *a, std::size_t sa, const T *b, std::size_t sb, T *y,
+                 std::size_t m) noexcept {
+  if (m == 0)
+    return;
+  if (sa && sb) {
+    for (std::size_t k = 0; k < m; ++k)
+      y[k] = binary<OP>(a[k], b[k]);
+  } else if (sa) {
+    const T vb = *b;
+    for (std::size_t k = 0; k < m; ++k)
+      y[k] = binary<OP>(a[k], vb);
+  } else if (sb) {
+    const T va = *a;
+    for (std::size_t k = 0; k < m; ++k)
+      y[k] = binary<OP>(va, b[k]);
+  } else {
+    std::fill(y, y + m, binary<OP>(*a, *b));
+  }
+};
+
+} // namespace
+
+template <typename T>
+void binary_kernel(const T *a, std::size_t sa, const T *b, std::size_t sb,
+                   T *y, std::size_t m, BinaryOp op) noexcept {
+  TL_SIMD_DISPATCH(T, binary, a, sa, b, sb, y, m, op)
+
+  switch (op) {
+  case BinaryOp::Add:
+    return binary_loop<BinaryOp::Add>(a, sa, b, sb, y, m);
+  case BinaryOp::Sub:
+    return binary_loop<BinaryOp::Sub>(a, sa, b, sb, y, m);
+  case BinaryOp::Mul:
+    return binary_loop<BinaryOp::Mul>(a, sa, b, sb, y, m);
+  case BinaryOp::Div:
+    return binary_loop<BinaryOp::Div>(a, sa, b, sb, y, m);
+  case BinaryOp::Maximum:
+    return binary_loop<BinaryOp::Maximum>(a, sa, b, sb, y, m);
+  }
+};
+
 template <typename T>
 void gelu_kernel(const T *x, T *y, std::size_t m) noexcept {
+  TL_SIMD_DISPATCH(T, gelu, x, y, m)
 
   constexpr T half = T{0.5};
-  constexpr T coeff = T{0.044715};
-  constexpr T sqrt_2_over_pi = T{0.7978845608028654};
+  constexpr T coeff = static_cast<T>(0.044715);
+  constexpr T sqrt_2_over_pi = static_cast<T>(0.7978845608028654);
 
   for (auto k = 0; k < m; k++) {
     const T vx = x[k];
@@ -73,8 +326,33 @@ void gelu_kernel(const T *x, T *y, std::size_t m) noexcept {
   };
 };
 
+template <typename T>
+void relu_kernel(const T *x, T *y, std::size_t m) noexcept {
+  for (std::size_t k = 0; k < m; k++)
+    y[k] = x[k] > T{0} ? x[k] : T{0};
+};
+
+template <typename T>
+void activation_kernel(T *y, std::size_t m, Activation act) noexcept {
+  switch (act) {
+  case Activation::None:
+    break;
+  case Activation::ReLU:
+    relu_kernel(y, y, m);
+    break;
+  case Activation::GELU:
+    gelu_kernel(y, y, m);
+    break;
+  case Activation::Softmax:
+    softmax_kernel(y, y, m);
+    break;
+  }
+};
+
 template <typename T>
 void softmax_kernel(const T *x, T *y, std::size_t m) noexcept {
+  TL_SIMD_DISPATCH(T, softmax, x, y, m)
+
   T max = static_cast<T>(std::numeric_limits<T>::lowest());
 
   for (std::size_t k = 0; k < m; ++k) {
@@ -105,6 +383,8 @@ void softmax_kernel(const T *x, T *y, std::size_t m) noexcept {
 
 template <typename T>
 void log_softmax_kernel(const T *x, T *y, std::size_t m) noexcept {
+  TL_SIMD_DISPATCH(T, log_softmax, x, y, m)
+
   T max = static_cast<T>(std::numeric_limits<T>::lowest());
 
   for (std::size_t k = 0; k < m; ++k) {
@@ -136,24 +416,440 @@ void log_softmax_kernel(const T *x, T *y, std::size_t m) noexcept {
   }
 };
 
-template void mm_kernel(const float *A, const float *B, float *C, std::size_t m,
-                        std::size_t n, std::size_t k);
-template void mm_kernel(const double *A, const double *B, double *C,
-                        std::size_t m, std::size_t n, std::size_t k);
+template <typename T>
+void gelu_backward_kernel(const T *x, const T *dy, T *dx, std::size_t m,
+                          bool accumulate) noexcept {
+  TL_SIMD_DISPATCH(T, gelu_backward, x, dy, dx, m, accumulate)
+
+  constexpr T half = T{0.5};
+  constexpr T coeff = static_cast<T>(0.044715);
+  constexpr T sqrt_2_over_pi = static_cast<T>(0.7978845608028654);
+
+  // gelu' = (1 + t) / 2 + x (1 - t^2) / 2 * dz / dx, t = tanh(z)
+  for (std::size_t k = 0; k < m; ++k) {
+    const T vx = x[k];
+    const T t = std::tanh(sqrt_2_over_pi * std::fma(coeff, vx * vx * vx, vx));
+    const T dz = sqrt_2_over_pi * std::fma(T{3} * coeff, vx * vx, T{1});
+    const T g = dy[k] * (half * (T{1} + t) + half * vx * (T{1} - t * t) * dz);
+    dx[k] = accumulate ? dx[k] + g : g;
+  }
+};
+
+template <typename T>
+void relu_backward_kernel(const T *y, const T *dy, T *dx, std::size_t m,
+                          bool accumulate) noexcept {
+  for (std::size_t k = 0; k < m; ++k) {
+    const T g = y[k] > T{0} ? dy[k] : T{0};
+    dx[k] = accumulate ? dx[k] + g : g;
+  }
+};
+
+template <typename T>
+void softmax_backward_kernel(const T *y, const T *dy, T *dx, std::size_t m,
+                             bool accumulate) noexcept {
+  TL_SIMD_DISPATCH(T, softmax_backward, y, dy, dx, m, accumulate)
+
+  T dot = T{0};
+  for (std::size_t k = 0; k < m; ++k)
+    dot += dy[k] * y[k];
+  for (std::size_t k = 0; k < m; ++k) {
+    const T g = y[k] * (dy[k] - dot);
+    dx[k] = accumulate ? dx[k] + g : g;
+  }
+};
+
+template <typename T>
+void log_softmax_backward_kernel(const T *y, const T *dy, T *dx,
+                                 std::size_t m, bool accumulate) noexcept {
+  TL_SIMD_DISPATCH(T, log_softmax_backward, y, dy, dx, m, accumulate)
+
+  T sum = T{0};
+  for (std::size_t k = 0; k < m; ++k)
+    sum += dy[k];
+  for (std::size_t k = 0; k < m; ++k) {
+    const T g = dy[k] - std::exp(y[k]) * sum;
+    dx[k] = accumulate ? dx[k] + g : g;
+  }
+};
+
+template <typename T>
+T logsumexp_kernel(const T *x, std::size_t m) noexcept {
+  if constexpr (std::is_same_v<T, float>)
+    if (const auto *simd = torchlet::simd::kernel_table())
+      return simd->logsumexp(x, m);
+
+  // Chunks that stay in L1 : the max of a chunk, then its exps, both
+  // loops vectorisable; the running sum is rescaled once per chunk.
+  constexpr std::size_t kChunk = 256;
+  T max = std::numeric_limits<T>::lowest(), sum = T{0};
+  for (std::size_t k0 = 0; k0 < m; k0 += kChunk) {
+    const std::size_t k1 = std::min(m, k0 + kChunk);
+    T cmax = max;
+    for (std::size_t k = k0; k < k1; ++k)
+      cmax = (x[k] > cmax) ? x[k] : cmax;
+    T csum = T{0};
+    for (std::size_t k = k0; k < k1; ++k)
+      csum += std::exp(x[k] - cmax);
+    sum = sum * std::exp(max - cmax) + csum;
+    max = cmax;
+  }
+  return max + std::log(sum);
+};
+
+template <typename T>
+void cross_entropy_backward_kernel(const T *x, T lse, std::size_t target,
+                                   T scale, T *dx, std::size_t m,
+                                   bool accumulate) noexcept {
+  TL_SIMD_DISPATCH(T, cross_entropy_backward, x, lse, target, scale, dx, m,
+                   accumulate)
+
+  for (std::size_t k = 0; k < m; ++k) {
+    const T g = scale * std::exp(x[k] - lse);
+    dx[k] = accumulate ? dx[k] + g : g;
+  }
+  dx[target] -= scale;
+};
+
+template <typename T>
+void sgd_kernel(T *p, const T *g, T *buf, std::size_t n,
+                const SGDStep &step) noexcept {
+  TL_SIMD_DISPATCH(T, sgd, p, g, buf, n, step)
+
+  const T lr = static_cast<T>(step.lr);
+  const T mu = static_cast<T>(step.momentum);
+  const T wd = static_cast<T>(step.weight_decay);
+  for (std::size_t k = 0; k < n; ++k) {
+    T d = g[k] + wd * p[k];
+    if (step.momentum != 0.0) {
+      buf[k] = mu * buf[k] + d;
+      d = step.nesterov ? d + mu * buf[k] : buf[k];
+    }
+    p[k] -= lr * d;
+  }
+};
+
+template <typename T>
+void adam_kernel(T *p, const T *g, T *m, T *v, std::size_t n,
+                 const AdamStep &step) noexcept {
+  TL_SIMD_DISPATCH(T, adam, p, g, m, v, n, step)
+
+  const T wd = static_cast<T>(step.decoupled ? 0.0 : step.weight_decay);
+  const T keep =
+      static_cast<T>(step.decoupled ? 1.0 - step.lr * step.weight_decay : 1.0);
+  const T b1 = static_cast<T>(step.beta1), b2 = static_cast<T>(step.beta2);
+  const T step_size = static_cast<T>(step.lr / step.bias1);
+  const T inv_b2 = static_cast<T>(1.0 / std::sqrt(step.bias2));
+  const T eps = static_cast<T>(step.eps);
+  for (std::size_t k = 0; k < n; ++k) {
+    const T d = g[k] + wd * p[k];
+    m[k] = b1 * m[k] + (T{1} - b1) * d;
+    v[k] = b2 * v[k] + (T{1} - b2) * d * d;
+    p[k] = p[k] * keep - step_size * m[k] / (std::sqrt(v[k]) * inv_b2 + eps);
+  }
+};
+
+namespace {
+
+using torchlet::detail::kPhiloxBatch;
+using PhiloxWords = std::uint32_t[4][kPhiloxBatch];
+
+// Uniform in [0, 1) of value j of counter i of a batch.
+template <typename T>
+inline T philox_unit(const PhiloxWords &x, std::size_t i,
+                     std::size_t j) noexcept {
+  if constexpr (std::is_same_v<T, float>)
+    return torchlet::detail::philox_unit_float(x[j][i]);
+  else
+    return torchlet::detail::philox_unit_double(x[2 * j][i], x[2 * j + 1][i]);
+};
+
+// f(x, k, c) on the elements [k, k + c) of y, c <= G kPhiloxBatch, with x
+// the words of their counters.
+template <typename T, typename F>
+void philox_for_each(std::size_t n, std::uint64_t seed, std::uint64_t counter,
+                     F f) noexcept {
+  constexpr std::size_t G = kPhiloxValues<T>;
+  PhiloxWords x;
+  for (std::size_t k = 0; k < n; k += G * kPhiloxBatch) {
+    const std::size_t c = std::min(n - k, G * kPhiloxBatch);
+    torchlet::detail::philox_batch(seed, counter + k / G, (c + G - 1) / G, x);
+    f(x, k, c);
+  }
+};
+
+} // namespace
+
+template <typename T>
+void uniform_kernel(T *y, std::size_t n, std::uint64_t seed,
+                    std::uint64_t counter, T low, T high) noexcept {
+  TL_SIMD_DISPATCH(T, uniform, y, n, seed, counter, low, high)
+
+  constexpr std::size_t G = kPhiloxValues<T>;
+  const T span = high - low;
+  philox_for_each<T>(
+      n, seed, counter,
+      [&](const PhiloxWords &x, std::size_t k, std::size_t c) {
+        for (std::size_t e = 0; e < c; ++e)
+          y[k + e] = low + span * philox_unit<T>(x, e / G, e % G);
+      });
+};
+
+template <typename T>
+void normal_kernel(T *y, std::size_t n, std::uint64_t seed,
+                   std::uint64_t counter, T mean, T stdev) noexcept {
+  TL_SIMD_DISPATCH(T, normal, y, n, seed, counter, mean, stdev)
+
+  constexpr std::size_t G = kPhiloxValues<T>;
+  const T two_pi = static_cast<T>(6.283185307179586);
+  philox_for_each<T>(
+      n, seed, counter,
+      [&](const PhiloxWords &x, std::size_t k, std::size_t c) {
+        for (std::size_t e = 0; e < c; e += 2) {
+          const std::size_t i = e / G, j = e % G;
+          // 1 - u in (0, 1] keeps the log finite
+          const T u1 = T{1} - philox_unit<T>(x, i, j);
+          const T theta = two_pi * philox_unit<T>(x, i, j + 1);
+          const T r = stdev * std::sqrt(T{-2} * std::log(u1));
+          y[k + e] = mean + r * std::cos(theta);
+          if (e + 1 < c)
+            y[k + e + 1] = mean + r * std::sin(theta);
+        }
+      });
+};
+
+template <typename T>
+void dropout_kernel(const T *x, T *y, std::size_t n, std::size_t first,
+                    const DropoutStep &step, bool accumulate) noexcept {
+  TL_SIMD_DISPATCH(T, dropout, x, y, n, first, step, accumulate)
+
+  const std::uint32_t threshold = torchlet::detail::philox_threshold(step.p);
+  const T scale = step.p < 1.0 ? static_cast<T>(1.0 / (1.0 - step.p)) : T{0};
+  std::uint32_t w[4 * kPhiloxBatch];
+  for (std::size_t k = 0; k < n;) {
+    const std::size_t c = torchlet::detail::philox_words(
+        step.seed, step.counter, first + k, n - k, w);
+    for (std::size_t e = 0; e < c; ++e) {
+      const T v = (w[e] >> 8) >= threshold ? x[k + e] * scale : T{0};
+      y[k + e] = accumulate ? y[k + e] + v : v;
+    }
+    k += c;
+  }
+};
+
+template <typename T>
+void layer_norm_kernel(const T *x, const T *r, const T *gamma, const T *beta,
+                       T *y, T *h, std::size_t m, T eps) noexcept {
+  TL_SIMD_DISPATCH(T, layer_norm, x, r, gamma, beta, y, h, m, eps)
+
+  if (m == 0)
+    return;
+  if (!r)
+    h = nullptr;
+
+  // Sums about the first value : a single pass that does not cancel when
+  // |mean| >> std.
+  const T shift = r ? x[0] + r[0] : x[0];
+  T s1 = T{0}, s2 = T{0};
+  for (std::size_t k = 0; k < m; ++k) {
+    const T v = r ? x[k] + r[k] : x[k];
+    if (h)
+      h[k] = v;
+    const T d = v - shift;
+    s1 += d;
+    s2 += d * d;
+  }
+
+  const T mean_d = s1 / static_cast<T>(m);
+  const T var = std::max(s2 / static_cast<T>(m) - mean_d * mean_d, T{0});
+  const T mean = shift + mean_d;
+  const T rstd = T{1} / std::sqrt(var + eps);
+
+  // h already holds x + r
+  const T *src = h ? h : x;
+  const T *add = h ? nullptr : r;
+  for (std::size_t k = 0; k < m; ++k) {
+    T v = ((add ? src[k] + add[k] : src[k]) - mean) * rstd;
+    if (gamma)
+      v *= gamma[k];
+    if (beta)
+      v += beta[k];
+    y[k] = v;
+  }
+};
+
+template <typename T>
+void rms_norm_kernel(const T *x, const T *r, const T *gamma, T *y, T *h,
+                     std::size_t m, T eps) noexcept {
+  TL_SIMD_DISPATCH(T, rms_norm, x, r, gamma, y, h, m, eps)
+
+  if (m == 0)
+    return;
+  if (!r)
+    h = nullptr;
+
+  T ss = T{0};
+  for (std::size_t k = 0; k < m; ++k) {
+    const T v = r ? x[k] + r[k] : x[k];
+    if (h)
+      h[k] = v;
+    ss += v * v;
+  }
+  const T rstd = T{1} / std::sqrt(ss / static_cast<T>(m) + eps);
+
+  const T *src = h ? h : x;
+  const T *add = h ? nullptr : r;
+  for (std::size_t k = 0; k < m; ++k) {
+    const T v = (add ? src[k] + add[k] : src[k]) * rstd;
+    y[k] = gamma ? v * gamma[k] : v;
+  }
+};
 
 template void mvb_kernel(const float *W, const float *x, const float *b,
                          float *y, std::size_t m, std::size_t n);
 template void mvb_kernel(const double *W, const double *x, const double *b,
                          double *y, std::size_t m, std::size_t n);
 
+template void mvb_mixed_kernel(const torchlet::core::Half *W, const float *x,
+                               const float *b, float *y, std::size_t m,
+                               std::size_t n);
+template void mvb_mixed_kernel(const torchlet::core::BFloat16 *W,
+                               const float *x, const float *b, float *y,
+                               std::size_t m, std::size_t n);
+
+template void widen_kernel(const torchlet::core::Half *x, float *y,
+                           std::size_t m);
+template void widen_kernel(const torchlet::core::BFloat16 *x, float *y,
+                           std::size_t m);
+template void narrow_kernel(const float *x, torchlet::core::Half *y,
+                            std::size_t m);
+template void narrow_kernel(const float *x, torchlet::core::BFloat16 *y,
+                            std::size_t m);
+
+template void mvb_blas_kernel(const float *W, const float *x, const float *b,
+                              float *y, std::size_t m, std::size_t n);
+template void mvb_blas_kernel(const double *W, const double *x,
+                              const double *b, double *y, std::size_t m,
+                              std::size_t n);
+
+template void mm_blas_kernel(const float *A, bool trans_a, const float *B,
+                             bool trans_b, float *C, std::size_t m,
+                             std::size_t n, std::size_t k, bool accumulate);
+template void mm_blas_kernel(const double *A, bool trans_a, const double *B,
+                             bool trans_b, double *C, std::size_t m,
+                             std::size_t n, std::size_t k, bool accumulate);
+
+template void mmb_blas_kernel(const float *A, const float *W, const float *b,
+                              float *C, std::size_t m, std::size_t n,
+                              std::size_t k, Activation act);
+template void mmb_blas_kernel(const double *A, const double *W,
+                              const double *b, double *C, std::size_t m,
+                              std::size_t n, std::size_t k, Activation act);
+
 template void vadd_kernel(const float *x, float *y, std::size_t m);
 template void vadd_kernel(const double *x, double *y, std::size_t m);
 
+#define TL_INSTANTIATE_BINARY(T)                                               \
+  template void binary_kernel(const T *a, std::size_t sa, const T *b,          \
+                              std::size_t sb, T *y, std::size_t m,             \
+                              BinaryOp op);
+TL_INSTANTIATE_BINARY(float)
+TL_INSTANTIATE_BINARY(double)
+TL_INSTANTIATE_BINARY(std::int32_t)
+TL_INSTANTIATE_BINARY(std::int64_t)
+TL_INSTANTIATE_BINARY(std::uint8_t)
+TL_INSTANTIATE_BINARY(std::uint32_t)
+TL_INSTANTIATE_BINARY(std::uint64_t)
+TL_INSTANTIATE_BINARY(torchlet::core::Half)
+TL_INSTANTIATE_BINARY(torchlet::core::BFloat16)
+#undef TL_INSTANTIATE_BINARY
+
 template void gelu_kernel(const float *x, float *y, std::size_t m);
 template void gelu_kernel(const double *x, double *y, std::size_t m);
 
+template void relu_kernel(const float *x, float *y, std::size_t m);
+template void relu_kernel(const double *x, double *y, std::size_t m);
+
+template void activation_kernel(float *y, std::size_t m, Activation act);
+template void activation_kernel(double *y, std::size_t m, Activation act);
+
 template void softmax_kernel(const float *x, float *y, std::size_t m);
 template void softmax_kernel(const double *x, double *y, std::size_t m);
 
 template void log_softmax_kernel(const float *x, float *y, std::size_t m);
-template void log_softmax_kernel(const double *x, double *y, std::size_t m);
\ No newline at end of file
+template void log_softmax_kernel(const double *x, double *y, std::size_t m);
+
+template void layer_norm_kernel(const float *x, const float *r,
+                                const float *gamma, const float *beta,
+                                float *y, float *h, std::size_t m, float eps);
+template void layer_norm_kernel(const double *x, const double *r,
+                                const double *gamma, const double *beta,
+                                double *y, double *h, std::size_t m,
+                                double eps);
+
+template void rms_norm_kernel(const float *x, const float *r,
+                              const float *gamma, float *y, float *h,
+                              std::size_t m, float eps);
+template void rms_norm_kernel(const double *x, const double *r,
+                              const double *gamma, double *y, double *h,
+                              std::size_t m, double eps);
+
+template void gelu_backward_kernel(const float *x, const float *dy, float *dx,
+                                   std::size_t m, bool accumulate);
+template void gelu_backward_kernel(const double *x, const double *dy,
+                                   double *dx, std::size_t m, bool accumulate);
+
+template void relu_backward_kernel(const float *y, const float *dy, float *dx,
+                                   std::size_t m, bool accumulate);
+template void relu_backward_kernel(const double *y, const double *dy,
+                                   double *dx, std::size_t m, bool accumulate);
+
+template void softmax_backward_kernel(const float *y, const float *dy,
+                                      float *dx, std::size_t m,
+                                      bool accumulate);
+template void softmax_backward_kernel(const double *y, const double *dy,
+                                      double *dx, std::size_t m,
+                                      bool accumulate);
+
+template void log_softmax_backward_kernel(const float *y, const float *dy,
+                                          float *dx, std::size_t m,
+                                          bool accumulate);
+template void log_softmax_backward_kernel(const double *y, const double *dy,
+                                          double *dx, std::size_t m,
+                                          bool accumulate);
+template float logsumexp_kernel(const float *x, std::size_t m);
+template double logsumexp_kernel(const double *x, std::size_t m);
+
+template void cross_entropy_backward_kernel(const float *x, float lse,
+                                            std::size_t target, float scale,
+                                            float *dx, std::size_t m,
+                                            bool accumulate);
+template void cross_entropy_backward_kernel(const double *x, double lse,
+                                            std::size_t target, double scale,
+                                            double *dx, std::size_t m,
+                                            bool accumulate);
+
+template void sgd_kernel(float *p, const float *g, float *buf, std::size_t n,
+                         const SGDStep &step);
+template void sgd_kernel(double *p, const double *g, double *buf,
+                         std::size_t n, const SGDStep &step);
+
+template void adam_kernel(float *p, const float *g, float *m, float *v,
+                          std::size_t n, const AdamStep &step);
+template void adam_kernel(double *p, const double *g, double *m, double *v,
+                          std::size_t n, const AdamStep &step);
+template void uniform_kernel(float *y, std::size_t n, std::uint64_t seed,
+                             std::uint64_t counter, float low, float high);
+template void uniform_kernel(double *y, std::size_t n, std::uint64_t seed,
+                             std::uint64_t counter, double low, double high);
+
+template void normal_kernel(float *y, std::size_t n, std::uint64_t seed,
+                            std::uint64_t counter, float mean, float stdev);
+template void normal_kernel(double *y, std::size_t n, std::uint64_t seed,
+                            std::uint64_t counter, double mean, double stdev);
+
+template void dropout_kernel(const float *x, float *y, std::size_t n,
+                             std::size_t first, const DropoutStep &step,
+                             bool accumulate);
+template void dropout_kernel(const double *x, double *y, std::size_t n,
+                             std::size_t first, const DropoutStep &step,
+                             bool accumulate);
\ No newline at end of file
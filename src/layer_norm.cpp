@@ -0,0 +1,107 @@
+#include <stdexcept>
+#include <torchlet/core/profiler.h>
+#include <torchlet/module/layer_norm.h>
+#include <torchlet/ops/functional.h>
+
+using torchlet::module::LayerNorm, torchlet::module::RMSNorm,
+    torchlet::core::Dtype, torchlet::core::Tensor;
+
+namespace {
+
+void check_args(std::size_t dim, const Dtype &dtype) {
+  if (dtype != Dtype::Float32 && dtype != Dtype::Float64) {
+    throw std::invalid_argument(
+        "Invalid input type. Only support float32 or float64.");
+  }
+  if (dim == 0) {
+    throw std::invalid_argument("dim must be positive.");
+  }
+};
+
+// state[prefix + name], of like's shape, in like's dtype
+Tensor take(const torchlet::io::TensorDict &state, const std::string &prefix,
+            const char *name, const Tensor &like) {
+  auto it = state.find(prefix + name);
+  if (it == state.end()) {
+    throw std::invalid_argument("Missing parameter " + prefix + name + ".");
+  }
+  if (it->second.shape() != like.shape()) {
+    throw std::invalid_argument("Parameter " + prefix + name +
+                                " does not match the layer.");
+  }
+  return it->second.to(like.dtype());
+};
+
+} // namespace
+
+LayerNorm::LayerNorm(std::size_t dim, double eps, bool affine,
+                     const Dtype &dtype)
+    : m_dim(dim), m_eps(eps), m_affine(affine) {
+  check_args(dim, dtype);
+  if (affine) {
+    m_weight = Tensor::ones({dim}, dtype);
+    m_bias = Tensor::zeros({dim}, dtype);
+  }
+};
+
+Tensor LayerNorm::forward(const Tensor &x) const {
+  torchlet::core::RecordScope scope("LayerNorm::forward");
+  return torchlet::ops::layer_norm(x, m_weight, m_bias, m_eps);
+};
+
+Tensor &LayerNorm::forward_out(const Tensor &x, Tensor &out) const {
+  torchlet::core::RecordScope scope("LayerNorm::forward");
+  return torchlet::ops::layer_norm_out(x, m_weight, m_bias, out, m_eps);
+};
+
+Tensor LayerNorm::forward(const Tensor &x, Tensor &residual) const {
+  torchlet::core::RecordScope scope("LayerNorm::forward");
+  return torchlet::ops::residual_layer_norm(x, residual, m_weight, m_bias,
+                                            m_eps);
+};
+
+torchlet::io::TensorDict LayerNorm::state_dict() const {
+  if (!m_affine)
+    return {};
+  return {{"weight", m_weight}, {"bias", m_bias}};
+};
+
+void LayerNorm::load_state_dict(const torchlet::io::TensorDict &state,
+                                const std::string &prefix) {
+  if (!m_affine)
+    return;
+  Tensor weight = take(state, prefix, "weight", m_weight);
+  Tensor bias = take(state, prefix, "bias", m_bias);
+  m_weight = weight;
+  m_bias = bias;
+};
+
+RMSNorm::RMSNorm(std::size_t dim, double eps, const Dtype &dtype)
+    : m_dim(dim), m_eps(eps) {
+  check_args(dim, dtype);
+  m_weight = Tensor::ones({dim}, dtype);
+};
+
+Tensor RMSNorm::forward(const Tensor &x) const {
+  torchlet::core::RecordScope scope("RMSNorm::forward");
+  return torchlet::ops::rms_norm(x, m_weight, m_eps);
+};
+
+Tensor &RMSNorm::forward_out(const Tensor &x, Tensor &out) const {
+  torchlet::core::RecordScope scope("RMSNorm::forward");
+  return torchlet::ops::rms_norm_out(x, m_weight, out, m_eps);
+};
+
+Tensor RMSNorm::forward(const Tensor &x, Tensor &residual) const {
+  torchlet::core::RecordScope scope("RMSNorm::forward");
+  return torchlet::ops::residual_rms_norm(x, residual, m_weight, m_eps);
+};
+
+torchlet::io::TensorDict RMSNorm::state_dict() const {
+  return {{"weight", m_weight}};
+};
+
+void RMSNorm::load_state_dict(const torchlet::io::TensorDict &state,
+                              const std::string &prefix) {
+  m_weight = take(state, prefix, "weight", m_weight);
+};
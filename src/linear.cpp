@@ -1,19 +1,23 @@
 #include "detail/helpers.h"
 
+#include <algorithm>
+#include <cmath>
+#include <torchlet/core/profiler.h>
 #include <torchlet/module/linear.h>
 #include <torchlet/ops/functional.h>
 #include <torchlet/ops/init.h>
 
-using torchlet::module::Linear, torchlet::core::Dtype, torchlet::core::Tensor,
-    torchlet::core::Generator;
+using torchlet::module::Linear, torchlet::module::QuantizedLinear,
+    torchlet::core::Dtype, torchlet::core::Tensor, torchlet::core::Generator;
 
 Linear::Linear(std::size_t in_features, std::size_t out_features, bool bias,
                const Dtype &dtype)
     : in_features(in_features), out_features(out_features), m_has_bias(bias) {
 
-  if (dtype != Dtype::Float32 && dtype != Dtype::Float64) {
-    throw std::invalid_argument(
-        "Invalid input type. Only support float32 or float64.");
+  if (dtype != Dtype::Float32 && dtype != Dtype::Float64 &&
+      dtype != Dtype::Float16 && dtype != Dtype::BFloat16) {
+    throw std::invalid_argument("Invalid input type. Only support float32, "
+                                "float64, float16 or bfloat16.");
   }
   if (in_features <= 0 || out_features <= 0) {
     throw std::invalid_argument(
@@ -23,7 +27,10 @@ Linear::Linear(std::size_t in_features, std::size_t out_features, bool bias,
   std::vector<std::size_t> shape_w{out_features, in_features};
   m_weights = Tensor(shape_w, dtype);
 
-  DISPATCH_FLOAT(dtype, scalar_t, {
+  // Float16 / BFloat16 parameters are drawn in float
+  const Dtype draw = dtype == Dtype::Float64 ? dtype : Dtype::Float32;
+
+  DISPATCH_FLOAT(draw, scalar_t, {
     torchlet::ops::init::uniform_(m_weights,
                                   -std::sqrt(scalar_t{1} / in_features),
                                   std::sqrt(scalar_t{1} / in_features));
@@ -32,7 +39,7 @@ Linear::Linear(std::size_t in_features, std::size_t out_features, bool bias,
   if (bias) {
     std::vector<std::size_t> shape_b{out_features};
     m_bias = Tensor(shape_b, dtype);
-    DISPATCH_FLOAT(dtype, scalar_t, {
+    DISPATCH_FLOAT(draw, scalar_t, {
       torchlet::ops::init::uniform_(m_bias,
                                     -std::sqrt(scalar_t{1} / in_features),
                                     std::sqrt(scalar_t{1} / in_features));
@@ -44,5 +51,105 @@ Linear::Linear(std::size_t in_features, std::size_t out_features, bool bias,
 
 // naive implementation
 Tensor Linear::forward(const Tensor &x) const {
+  torchlet::core::RecordScope scope("Linear::forward");
   return torchlet::ops::linear(x, m_weights, m_bias);
-}
\ No newline at end of file
+}
+
+Tensor &Linear::forward_out(const Tensor &x, Tensor &out) const {
+  torchlet::core::RecordScope scope("Linear::forward");
+  return torchlet::ops::linear_out(x, m_weights, m_bias, out);
+}
+
+Tensor &Linear::forward_out(const Tensor &x, Tensor &out,
+                            Activation act) const {
+  torchlet::core::RecordScope scope("Linear::forward");
+  switch (act) {
+  case Activation::ReLU:
+    return torchlet::ops::linear_relu_out(x, m_weights, m_bias, out);
+  case Activation::GELU:
+    return torchlet::ops::linear_gelu_out(x, m_weights, m_bias, out);
+  case Activation::Softmax:
+    return torchlet::ops::linear_bias_softmax_out(x, m_weights, m_bias, out);
+  default:
+    return torchlet::ops::linear_out(x, m_weights, m_bias, out);
+  }
+}
+
+torchlet::io::TensorDict Linear::state_dict() const {
+  torchlet::io::TensorDict state{{"weight", m_weights}};
+  if (m_has_bias)
+    state.emplace("bias", m_bias);
+  return state;
+}
+
+void Linear::load_state_dict(const torchlet::io::TensorDict &state,
+                             const std::string &prefix) {
+  auto take = [&](const char *name, const Tensor &like) {
+    auto it = state.find(prefix + name);
+    if (it == state.end()) {
+      throw std::invalid_argument("Missing parameter " + prefix + name + ".");
+    }
+    if (it->second.shape() != like.shape()) {
+      throw std::invalid_argument("Parameter " + prefix + name +
+                                  " does not match the layer.");
+    }
+    return it->second.to(like.dtype());
+  };
+
+  Tensor weights = take("weight", m_weights);
+  Tensor bias = m_has_bias ? take("bias", m_bias) : Tensor();
+  // the new parameters keep tracking gradients if the old ones did
+  if (m_weights.requires_grad())
+    weights.requires_grad_();
+  if (m_has_bias && m_bias.requires_grad())
+    bias.requires_grad_();
+  m_weights = weights;
+  m_bias = bias;
+}
+
+std::vector<Tensor> Linear::parameters() const {
+  if (m_has_bias)
+    return {m_weights, m_bias};
+  return {m_weights};
+}
+
+Linear &Linear::requires_grad_(bool requires_grad) {
+  m_weights.requires_grad_(requires_grad);
+  if (m_has_bias)
+    m_bias.requires_grad_(requires_grad);
+  return *this;
+}
+
+// Codes stop at 127 so that a pair of u8 x s8 products never saturates the
+// int16 lanes of the SIMD kernel.
+QuantizedLinear Linear::quantize() const {
+  const Tensor w = m_weights.to(Dtype::Float32).contiguous();
+  const float *pw = w.data_ptr<float>() + w.elem_offset();
+
+  Tensor q({out_features, in_features}, Dtype::UInt8);
+  Tensor scales({out_features}, Dtype::Float32);
+  Tensor zero_points({out_features}, Dtype::Int32);
+  std::uint8_t *pq = q.data_ptr<std::uint8_t>();
+  float *ps = scales.data_ptr<float>();
+  std::int32_t *pz = zero_points.data_ptr<std::int32_t>();
+
+  for (std::size_t o = 0; o < out_features; ++o) {
+    const float *row = pw + o * in_features;
+    // the range keeps 0 so that it is represented exactly
+    float lo = 0.0f, hi = 0.0f;
+    for (std::size_t k = 0; k < in_features; ++k) {
+      lo = std::min(lo, row[k]);
+      hi = std::max(hi, row[k]);
+    }
+    const float scale = hi > lo ? (hi - lo) / 127.0f : 1.0f;
+    const float zp = std::clamp(std::nearbyint(-lo / scale), 0.0f, 127.0f);
+    for (std::size_t k = 0; k < in_features; ++k)
+      pq[o * in_features + k] = static_cast<std::uint8_t>(
+          std::clamp(std::nearbyint(row[k] / scale) + zp, 0.0f, 127.0f));
+    ps[o] = scale;
+    pz[o] = static_cast<std::int32_t>(zp);
+  }
+
+  const Tensor bias = m_has_bias ? m_bias.to(Dtype::Float32) : Tensor();
+  return QuantizedLinear(q, scales, zero_points, bias);
+}
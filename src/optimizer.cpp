@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <stdexcept>
+#include <torchlet/core/parallel.h>
+#include <torchlet/core/profiler.h>
+#include <torchlet/optim/optimizer.h>
+
+#include "detail/helpers.h"
+#include "detail/validators.h"
+
+using torchlet::optim::Optimizer, torchlet::core::Tensor,
+    torchlet::core::Dtype;
+
+Optimizer::Optimizer(const std::vector<Tensor> &params, std::size_t n_state)
+    : m_params(params), m_param_steps(params.size(), 0) {
+  if (!params.empty())
+    m_dtype = params.front().dtype();
+  if (m_dtype != Dtype::Float32 && m_dtype != Dtype::Float64) {
+    throw std::invalid_argument(
+        "Invalid parameter type. Only support float32 or float64.");
+  }
+
+  m_offsets.reserve(params.size());
+  for (const Tensor &p : params) {
+    if (p.dtype() != m_dtype)
+      throw std::invalid_argument("Parameters must share one dtype.");
+    if (!torchlet::detail::has_data(p) ||
+        !torchlet::detail::is_dense(p.shape(), p.strides()))
+      throw std::invalid_argument("Parameters must be dense.");
+    m_offsets.push_back(m_numel);
+    m_numel += p.numel();
+  }
+
+  if (n_state)
+    m_state = Tensor::zeros({n_state, m_numel}, m_dtype);
+};
+
+void Optimizer::step() {
+  std::vector<Tensor> grads;
+  grads.reserve(m_params.size());
+  for (const Tensor &p : m_params)
+    grads.push_back(p.grad());
+  step(grads);
+};
+
+void Optimizer::step(const std::vector<Tensor> &grads_in) {
+  torchlet::core::RecordScope scope("Optimizer::step");
+  if (grads_in.size() != m_params.size())
+    throw std::invalid_argument("Expected one gradient per parameter.");
+
+  // The parameters with a gradient, laid end to end : piece s covers
+  // [starts[s], starts[s + 1]) of the range split across the threads.
+  std::vector<Tensor> grads(grads_in.size());
+  std::vector<std::size_t> active, starts{0};
+  for (std::size_t i = 0; i < m_params.size(); ++i) {
+    if (!torchlet::detail::has_data(grads_in[i]) || m_params[i].numel() == 0)
+      continue;
+    if (grads_in[i].shape() != m_params[i].shape() ||
+        grads_in[i].dtype() != m_dtype)
+      throw std::invalid_argument("Gradient " + std::to_string(i) +
+                                  " does not match its parameter.");
+    grads[i] = grads_in[i].contiguous();
+    active.push_back(i);
+    starts.push_back(starts.back() + m_params[i].numel());
+  }
+
+  ++m_steps;
+  for (std::size_t i : active)
+    ++m_param_steps[i];
+
+  DISPATCH_FLOAT(m_dtype, scalar_t, {
+    torchlet::parallel_for(
+        0, starts.back(), torchlet::GRAIN_SIZE,
+        [&](std::size_t k0, std::size_t k1) {
+          std::size_t s =
+              std::upper_bound(starts.begin(), starts.end(), k0) -
+              starts.begin() - 1;
+          for (; k0 < k1; ++s) {
+            const std::size_t i = active[s];
+            const std::size_t a = k0 - starts[s];
+            const std::size_t b = std::min(k1, starts[s + 1]) - starts[s];
+            scalar_t *p =
+                m_params[i].data_ptr<scalar_t>() + m_params[i].elem_offset();
+            const scalar_t *g =
+                grads[i].data_ptr<scalar_t>() + grads[i].elem_offset();
+            update(p + a, g + a, m_offsets[i] + a, b - a, m_param_steps[i]);
+            k0 = starts[s] + b;
+          }
+        });
+  })
+};
+
+void Optimizer::zero_grad() {
+  for (Tensor &p : m_params)
+    p.zero_grad();
+};
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <torchlet/core/parallel.h>
+
+namespace {
+
+thread_local bool t_in_parallel = false;
+
+/// @brief Persistent pool : n - 1 workers plus the thread calling run().
+/// Chunks are handed out through an atomic counter, one region at a time.
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t n_threads) {
+    m_workers.reserve(n_threads - 1);
+    for (std::size_t k = 1; k < n_threads; ++k)
+      m_workers.emplace_back([this] { worker_loop(); });
+  };
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_stop = true;
+    }
+    m_cv_start.notify_all();
+    for (auto &w : m_workers)
+      w.join();
+  };
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  std::size_t size() const noexcept { return m_workers.size() + 1; };
+
+  void run(std::size_t n_chunks, const std::function<void(std::size_t)> &fn) {
+    std::lock_guard<std::mutex> region(m_region_mutex);
+
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_fn = &fn;
+      m_n_chunks = n_chunks;
+      m_next.store(0, std::memory_order_relaxed);
+      m_active = m_workers.size();
+      m_error = nullptr;
+      ++m_generation;
+    }
+    m_cv_start.notify_all();
+
+    drain();
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cv_done.wait(lk, [this] { return m_active == 0; });
+    m_fn = nullptr;
+
+    if (m_error)
+      std::rethrow_exception(m_error);
+  };
+
+private:
+  void drain() {
+    t_in_parallel = true;
+    for (std::size_t c; (c = m_next.fetch_add(1)) < m_n_chunks;) {
+      try {
+        (*m_fn)(c);
+      } catch (...) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        if (!m_error)
+          m_error = std::current_exception();
+      }
+    }
+    t_in_parallel = false;
+  };
+
+  void worker_loop() {
+    std::uint64_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cv_start.wait(lk, [&] { return m_stop || m_generation != seen; });
+        if (m_stop)
+          return;
+        seen = m_generation;
+      }
+
+      drain();
+
+      std::lock_guard<std::mutex> lk(m_mutex);
+      if (--m_active == 0)
+        m_cv_done.notify_one();
+    }
+  };
+
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_region_mutex; // one parallel region at a time
+  std::mutex m_mutex;
+  std::condition_variable m_cv_start;
+  std::condition_variable m_cv_done;
+
+  const std::function<void(std::size_t)> *m_fn = nullptr;
+  std::size_t m_n_chunks = 0;
+  std::atomic<std::size_t> m_next{0};
+  std::size_t m_active = 0;
+  std::uint64_t m_generation = 0;
+  std::exception_ptr m_error;
+  bool m_stop = false;
+};
+
+std::size_t default_num_threads() {
+  if (const char *env = std::getenv("TORCHLET_NUM_THREADS")) {
+    try {
+      const long n = std::stol(env);
+      if (n > 0)
+        return static_cast<std::size_t>(n);
+    } catch (const std::exception &) {
+    }
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+};
+
+std::mutex g_pool_mutex;
+std::atomic<std::size_t> g_num_threads{default_num_threads()};
+std::unique_ptr<ThreadPool> g_pool;
+
+ThreadPool &pool() {
+  std::lock_guard<std::mutex> lk(g_pool_mutex);
+  const std::size_t n = g_num_threads.load();
+  if (!g_pool || g_pool->size() != n)
+    g_pool = std::make_unique<ThreadPool>(n);
+  return *g_pool;
+};
+
+} // namespace
+
+void torchlet::set_num_threads(std::size_t n) {
+  if (n == 0)
+    throw std::invalid_argument("Number of threads must be positive.");
+  g_num_threads.store(n);
+};
+
+std::size_t torchlet::get_num_threads() noexcept {
+  return g_num_threads.load(std::memory_order_relaxed);
+};
+
+bool torchlet::in_parallel_region() noexcept { return t_in_parallel; };
+
+void torchlet::detail::parallel_for_impl(
+    std::size_t begin, std::size_t end, std::size_t grain_size,
+    const std::function<void(std::size_t, std::size_t)> &f) {
+
+  const std::size_t range = end - begin;
+  const std::size_t grain = std::max<std::size_t>(grain_size, 1);
+
+  ThreadPool &p = pool();
+  const std::size_t n_chunks =
+      std::min(p.size(), (range + grain - 1) / grain);
+  const std::size_t chunk = (range + n_chunks - 1) / n_chunks;
+
+  p.run(n_chunks, [&](std::size_t c) {
+    const std::size_t b = begin + c * chunk;
+    const std::size_t e = std::min(end, b + chunk);
+    if (b < e)
+      f(b, e);
+  });
+};
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <torchlet/core/profiler.h>
+
+#include "detail/helpers.h"
+
+using torchlet::core::OpCost, torchlet::core::ProfileEvent,
+    torchlet::core::RecordScope, torchlet::core::Tensor;
+
+std::atomic<bool> torchlet::core::detail::g_profiling{false};
+
+namespace {
+
+// Events of every thread : one push per op call, a mutex is cheap enough.
+std::mutex g_mutex;
+std::vector<ProfileEvent> g_events;
+std::chrono::steady_clock::time_point g_epoch;
+std::atomic<std::size_t> g_n_threads{0};
+
+thread_local RecordScope *t_current = nullptr;
+thread_local std::size_t t_depth = 0;
+thread_local std::size_t t_allocs = 0, t_alloc_bytes = 0;
+
+std::size_t thread_index() noexcept {
+  thread_local const std::size_t index = g_n_threads.fetch_add(1);
+  return index;
+};
+
+std::uint64_t now_ns() noexcept {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - g_epoch)
+          .count());
+};
+
+std::string json_escape(const std::string &s) {
+  std::string out;
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\')
+      out += '\\';
+    out += ch;
+  }
+  return out;
+};
+
+} // namespace
+
+void torchlet::core::detail::record_allocation(std::size_t nbytes) noexcept {
+  ++t_allocs;
+  t_alloc_bytes += nbytes;
+};
+
+OpCost torchlet::core::op_cost(std::initializer_list<const Tensor *> tensors,
+                               double flops) {
+  OpCost cost;
+  cost.flops = flops;
+  for (const Tensor *t : tensors) {
+    if (!t || !t->storage_ptr())
+      continue;
+    if (!cost.shapes.empty())
+      cost.shapes += ' ';
+    cost.shapes += '[';
+    for (std::size_t d = 0; d < t->shape().size(); ++d)
+      cost.shapes += (d ? ", " : "") + std::to_string(t->shape()[d]);
+    cost.shapes += ']';
+    cost.bytes += double(torchlet::detail::nbytes(t->shape(), t->dtype()));
+  }
+  return cost;
+};
+
+RecordScope *RecordScope::enter(const char *name) {
+  if (t_current && std::strcmp(t_current->m_name, name) == 0)
+    return t_current;
+
+  m_active = true;
+  m_name = name;
+  m_parent = t_current;
+  m_allocs = t_allocs;
+  m_alloc_bytes = t_alloc_bytes;
+  t_current = this;
+  ++t_depth;
+  m_start_ns = now_ns();
+  return this;
+};
+
+void RecordScope::leave() noexcept {
+  const std::uint64_t end_ns = now_ns();
+  t_current = m_parent;
+  --t_depth;
+
+  try {
+    ProfileEvent event;
+    event.name = m_name;
+    event.shapes = std::move(m_cost.shapes);
+    event.start_ns = m_start_ns;
+    event.duration_ns = end_ns - m_start_ns;
+    event.flops = m_cost.flops;
+    event.bytes = m_cost.bytes;
+    event.n_allocs = t_allocs - m_allocs;
+    event.alloc_bytes = t_alloc_bytes - m_alloc_bytes;
+    event.thread = thread_index();
+    event.depth = t_depth;
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_events.push_back(std::move(event));
+  } catch (...) {
+    // out of memory while profiling : the event is dropped
+  }
+};
+
+void torchlet::core::start_profiling() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  g_events.clear();
+  g_epoch = std::chrono::steady_clock::now();
+  detail::g_profiling.store(true);
+};
+
+void torchlet::core::stop_profiling() noexcept {
+  detail::g_profiling.store(false);
+};
+
+std::vector<ProfileEvent> torchlet::core::profile_events() {
+  std::lock_guard<std::mutex> lock(g_mutex);
+  return g_events;
+};
+
+void torchlet::core::export_chrome_trace(const std::string &path) {
+  const std::vector<ProfileEvent> events = profile_events();
+
+  std::ofstream out(path);
+  if (!out)
+    throw std::runtime_error("Cannot write trace " + path + ".");
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  char buf[128];
+  for (std::size_t k = 0; k < events.size(); ++k) {
+    const ProfileEvent &e = events[k];
+    // trace timestamps are in us
+    std::snprintf(buf, sizeof(buf),
+                  "\"ph\": \"X\", \"pid\": 0, \"tid\": %zu, \"ts\": %.3f, "
+                  "\"dur\": %.3f",
+                  e.thread, double(e.start_ns) * 1e-3,
+                  double(e.duration_ns) * 1e-3);
+    out << (k ? ",\n" : "\n") << "{\"name\": \"" << json_escape(e.name)
+        << "\", \"cat\": \"op\", " << buf << ", \"args\": {\"shapes\": \""
+        << json_escape(e.shapes) << "\", \"flops\": " << e.flops
+        << ", \"bytes\": " << e.bytes << ", \"allocs\": " << e.n_allocs
+        << ", \"alloc_bytes\": " << e.alloc_bytes << "}}";
+  }
+  out << "\n]}\n";
+  if (!out)
+    throw std::runtime_error("Cannot write trace " + path + ".");
+};
+
+std::string torchlet::core::profile_table() {
+  struct Row {
+    std::size_t calls = 0, allocs = 0, alloc_bytes = 0;
+    std::uint64_t total_ns = 0, min_ns = UINT64_MAX, max_ns = 0;
+    double flops = 0, bytes = 0;
+  };
+  std::map<std::string, Row> rows;
+  for (const ProfileEvent &e : profile_events()) {
+    Row &r = rows[e.name];
+    ++r.calls;
+    r.total_ns += e.duration_ns;
+    r.min_ns = std::min(r.min_ns, e.duration_ns);
+    r.max_ns = std::max(r.max_ns, e.duration_ns);
+    r.flops += e.flops;
+    r.bytes += e.bytes;
+    r.allocs += e.n_allocs;
+    r.alloc_bytes += e.alloc_bytes;
+  }
+
+  std::vector<std::pair<std::string, Row>> sorted(rows.begin(), rows.end());
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+    return a.second.total_ns > b.second.total_ns;
+  });
+
+  std::string table;
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "%-24s %7s %11s %10s %10s %10s %9s %9s %8s %11s\n", "Name",
+                "Calls", "Total ms", "Mean us", "Min us", "Max us", "GFLOP/s",
+                "GB/s", "Allocs", "Alloc MB");
+  table += line;
+  for (const auto &[name, r] : sorted) {
+    const double total = double(r.total_ns);
+    std::snprintf(line, sizeof(line),
+                  "%-24s %7zu %11.3f %10.2f %10.2f %10.2f %9.2f %9.2f %8zu "
+                  "%11.3f\n",
+                  name.c_str(), r.calls, total * 1e-6,
+                  total * 1e-3 / double(r.calls), double(r.min_ns) * 1e-3,
+                  double(r.max_ns) * 1e-3, total > 0 ? r.flops / total : 0.0,
+                  total > 0 ? r.bytes / total : 0.0, r.allocs,
+                  double(r.alloc_bytes) * 1e-6);
+    table += line;
+  }
+  return table;
+};
@@ -0,0 +1,69 @@
+#include "detail/validators.h"
+
+#include <algorithm>
+#include <torchlet/core/profiler.h>
+#include <torchlet/module/quantized_linear.h>
+#include <torchlet/ops/functional.h>
+
+using torchlet::module::QuantizedLinear, torchlet::core::Dtype,
+    torchlet::core::Tensor;
+
+QuantizedLinear::QuantizedLinear(const Tensor &weights, const Tensor &scales,
+                                 const Tensor &zero_points, const Tensor &bias)
+    : m_weights(weights.contiguous()), m_scales(scales.contiguous()),
+      m_zero_points(zero_points.contiguous()), m_bias(bias.contiguous()),
+      m_has_bias(torchlet::detail::has_data(bias)) {
+
+  if (weights.dtype() != Dtype::UInt8 || weights.shape().size() != 2) {
+    throw std::invalid_argument("weights must be a UInt8 matrix.");
+  }
+  const std::size_t out_features = weights.shape().front();
+  if (scales.dtype() != Dtype::Float32 ||
+      scales.shape() != std::vector<std::size_t>{out_features} ||
+      zero_points.dtype() != Dtype::Int32 ||
+      zero_points.shape() != std::vector<std::size_t>{out_features}) {
+    throw std::invalid_argument(
+        "scales and zero_points must be Float32 and Int32 of out_features.");
+  }
+  if (m_has_bias && (bias.dtype() != Dtype::Float32 ||
+                     bias.shape() != std::vector<std::size_t>{out_features})) {
+    throw std::invalid_argument("bias must be Float32 of out_features.");
+  }
+  // Above 127, the int16 pair sums of the SIMD kernels saturate.
+  const std::uint8_t *q =
+      m_weights.data_ptr<std::uint8_t>() + m_weights.elem_offset();
+  if (std::any_of(q, q + m_weights.numel(),
+                  [](std::uint8_t c) { return c > 127; })) {
+    throw std::invalid_argument("weights codes must be in [0, 127].");
+  }
+};
+
+Tensor QuantizedLinear::forward(const Tensor &x) const {
+  torchlet::core::RecordScope scope("QuantizedLinear::forward");
+  return torchlet::ops::quantized_linear(x, m_weights, m_scales,
+                                         m_zero_points, m_bias);
+};
+
+Tensor &QuantizedLinear::forward_out(const Tensor &x, Tensor &out) const {
+  torchlet::core::RecordScope scope("QuantizedLinear::forward");
+  return torchlet::ops::quantized_linear_out(x, m_weights, m_scales,
+                                             m_zero_points, m_bias, out);
+};
+
+Tensor QuantizedLinear::dequantize() const {
+  const auto &shape = m_weights.shape();
+  const std::size_t out_features = shape[0], in_features = shape[1];
+
+  Tensor w(shape, Dtype::Float32);
+  const std::uint8_t *q =
+      m_weights.data_ptr<std::uint8_t>() + m_weights.elem_offset();
+  const float *s = m_scales.data_ptr<float>() + m_scales.elem_offset();
+  const std::int32_t *z =
+      m_zero_points.data_ptr<std::int32_t>() + m_zero_points.elem_offset();
+  float *pw = w.data_ptr<float>();
+  for (std::size_t o = 0; o < out_features; ++o)
+    for (std::size_t k = 0; k < in_features; ++k)
+      pw[o * in_features + k] =
+          s[o] * static_cast<float>(q[o * in_features + k] - z[o]);
+  return w;
+};
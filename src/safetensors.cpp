@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <torchlet/io/safetensors.h>
+
+#include "detail/helpers.h"
+#include "detail/mmap.h"
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::io::TensorDict;
+
+namespace {
+
+struct DtypeName {
+  Dtype dtype;
+  const char *name;
+};
+
+constexpr DtypeName kDtypeNames[] = {
+    {Dtype::Float32, "F32"}, {Dtype::Float64, "F64"},
+    {Dtype::Float16, "F16"}, {Dtype::BFloat16, "BF16"},
+    {Dtype::Int32, "I32"},   {Dtype::Int64, "I64"},
+    {Dtype::UInt8, "U8"},    {Dtype::UInt32, "U32"},
+    {Dtype::UInt64, "U64"}};
+
+Dtype dtype_from_name(const std::string &name) {
+  for (const auto &d : kDtypeNames)
+    if (name == d.name)
+      return d.dtype;
+  throw std::runtime_error("Unsupported safetensors dtype " + name + ".");
+};
+
+const char *dtype_name(Dtype dtype) {
+  for (const auto &d : kDtypeNames)
+    if (dtype == d.dtype)
+      return d.name;
+  throw std::runtime_error("Dtype has no safetensors name.");
+};
+
+// The subset of JSON a safetensors header is made of.
+class JsonReader {
+public:
+  JsonReader(const char *data, std::size_t size)
+      : m_data(data), m_end(data + size) {};
+
+  void expect(char c) {
+    if (peek() != c)
+      fail();
+    ++m_data;
+  };
+  // consumes c if it is next
+  bool accept(char c) {
+    if (peek() != c)
+      return false;
+    ++m_data;
+    return true;
+  };
+
+  std::string string() {
+    expect('"');
+    std::string out;
+    while (m_data < m_end && *m_data != '"') {
+      char c = *m_data++;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (m_data == m_end)
+        fail();
+      switch (c = *m_data++) {
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u':
+        utf8(out, hex4());
+        break;
+      default: // '"', '\\', '/'
+        out += c;
+      }
+    }
+    expect('"');
+    return out;
+  };
+
+  std::uint64_t integer() {
+    peek();
+    if (m_data == m_end || *m_data < '0' || *m_data > '9')
+      fail();
+    std::uint64_t v = 0;
+    while (m_data < m_end && *m_data >= '0' && *m_data <= '9') {
+      const auto digit = static_cast<std::uint64_t>(*m_data++ - '0');
+      if (v > (UINT64_MAX - digit) / 10)
+        fail();
+      v = v * 10 + digit;
+    }
+    return v;
+  };
+
+  std::vector<std::uint64_t> integers() {
+    std::vector<std::uint64_t> out;
+    expect('[');
+    if (accept(']'))
+      return out;
+    do
+      out.push_back(integer());
+    while (accept(','));
+    expect(']');
+    return out;
+  };
+
+  // Calls fn(key) for every member, fn reads the value.
+  template <typename Fn> void object(Fn fn) {
+    expect('{');
+    if (accept('}'))
+      return;
+    do {
+      std::string key = string();
+      expect(':');
+      fn(key);
+    } while (accept(','));
+    expect('}');
+  };
+
+  void skip_value() {
+    const char c = peek();
+    if (c == '{')
+      object([&](const std::string &) { skip_value(); });
+    else if (c == '[') {
+      expect('[');
+      if (accept(']'))
+        return;
+      do
+        skip_value();
+      while (accept(','));
+      expect(']');
+    } else if (c == '"')
+      string();
+    else {
+      // number, true, false, null
+      while (m_data < m_end && *m_data != ',' && *m_data != '}' &&
+             *m_data != ']' &&
+             !std::isspace(static_cast<unsigned char>(*m_data)))
+        ++m_data;
+    }
+  };
+
+  void end() {
+    if (peek() != '\0')
+      fail();
+  };
+
+  [[noreturn]] static void fail() {
+    throw std::runtime_error("Malformed safetensors header.");
+  };
+
+private:
+  char peek() {
+    while (m_data < m_end && std::isspace(static_cast<unsigned char>(*m_data)))
+      ++m_data;
+    return m_data < m_end ? *m_data : '\0';
+  };
+
+  unsigned hex4() {
+    if (m_end - m_data < 4)
+      fail();
+    unsigned v = 0;
+    for (int k = 0; k < 4; ++k) {
+      const char c = *m_data++;
+      v <<= 4;
+      if (c >= '0' && c <= '9')
+        v |= static_cast<unsigned>(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        v |= static_cast<unsigned>(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        v |= static_cast<unsigned>(c - 'A' + 10);
+      else
+        fail();
+    }
+    return v;
+  };
+
+  void utf8(std::string &out, unsigned cp) {
+    if (cp >= 0xd800 && cp < 0xdc00) { // surrogate pair
+      if (!(m_end - m_data >= 2 && m_data[0] == '\\' && m_data[1] == 'u'))
+        fail();
+      m_data += 2;
+      const unsigned lo = hex4();
+      if (lo < 0xdc00 || lo >= 0xe000)
+        fail();
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+    }
+    auto byte = [&](unsigned b) { out += static_cast<char>(b); };
+    if (cp < 0x80) {
+      byte(cp);
+    } else if (cp < 0x800) {
+      byte(0xc0 | (cp >> 6));
+      byte(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      byte(0xe0 | (cp >> 12));
+      byte(0x80 | ((cp >> 6) & 0x3f));
+      byte(0x80 | (cp & 0x3f));
+    } else {
+      byte(0xf0 | (cp >> 18));
+      byte(0x80 | ((cp >> 12) & 0x3f));
+      byte(0x80 | ((cp >> 6) & 0x3f));
+      byte(0x80 | (cp & 0x3f));
+    }
+  };
+
+  const char *m_data;
+  const char *m_end;
+};
+
+void json_string(std::string &out, const std::string &s) {
+  static const char hex[] = "0123456789abcdef";
+  out += '"';
+  for (const char c : s) {
+    const auto u = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (u < 0x20) {
+      out += "\\u00";
+      out += hex[u >> 4];
+      out += hex[u & 0xf];
+    } else {
+      out += c;
+    }
+  }
+  out += '"';
+};
+
+} // namespace
+
+TensorDict
+torchlet::io::load_safetensors(const std::string &path,
+                               std::map<std::string, std::string> *metadata) {
+  const auto map = torchlet::detail::map_file(path);
+  const auto *base = static_cast<const char *>(map->data);
+
+  std::uint64_t header_size;
+  if (map->size < sizeof(header_size))
+    throw std::runtime_error(path + " is not a safetensors file.");
+  std::memcpy(&header_size, base, sizeof(header_size));
+  if (header_size > map->size - sizeof(header_size))
+    throw std::runtime_error("Truncated safetensors header.");
+  const std::size_t data_start = sizeof(header_size) + header_size;
+  const std::size_t data_size = map->size - data_start;
+
+  TensorDict tensors;
+  JsonReader json(base + sizeof(header_size), header_size);
+  json.object([&](const std::string &name) {
+    if (name == "__metadata__") {
+      json.object([&](const std::string &key) {
+        std::string value = json.string();
+        if (metadata)
+          (*metadata)[key] = std::move(value);
+      });
+      return;
+    }
+
+    std::string dtype_str;
+    std::vector<std::uint64_t> shape64, offsets;
+    json.object([&](const std::string &key) {
+      if (key == "dtype")
+        dtype_str = json.string();
+      else if (key == "shape")
+        shape64 = json.integers();
+      else if (key == "data_offsets")
+        offsets = json.integers();
+      else
+        json.skip_value();
+    });
+
+    const Dtype dtype = dtype_from_name(dtype_str);
+    const std::vector<std::size_t> shape(shape64.begin(), shape64.end());
+    std::size_t nbytes = 0;
+    if (!torchlet::detail::checked_nbytes(shape, dtype, nbytes) ||
+        offsets.size() != 2 || offsets[0] > offsets[1] ||
+        offsets[1] > data_size || offsets[1] - offsets[0] != nbytes)
+      throw std::runtime_error("Corrupt safetensors entry " + name + ".");
+
+    const std::size_t offset = data_start + offsets[0];
+    if (offset % torchlet::detail::dtype_size(dtype) == 0) {
+      auto storage = torchlet::detail::view_storage(map, offset, nbytes);
+      tensors.emplace(name, Tensor::from_storage(storage, shape, dtype));
+    } else {
+      Tensor t(shape, dtype);
+      std::memcpy(t.data_ptr<char>(), base + offset, nbytes);
+      tensors.emplace(name, t);
+    }
+  });
+  json.end();
+
+  return tensors;
+};
+
+void torchlet::io::save_safetensors(
+    const std::string &path, const TensorDict &tensors,
+    const std::map<std::string, std::string> &metadata) {
+
+  // Largest items first : every offset stays a multiple of its item size.
+  std::vector<std::pair<std::string, Tensor>> order;
+  for (const auto &[name, t] : tensors)
+    order.emplace_back(name, t.contiguous());
+  std::stable_sort(order.begin(), order.end(),
+                   [](const auto &a, const auto &b) {
+                     return torchlet::detail::dtype_size(a.second.dtype()) >
+                            torchlet::detail::dtype_size(b.second.dtype());
+                   });
+
+  std::string header = "{";
+  if (!metadata.empty()) {
+    header += "\"__metadata__\":{";
+    for (const auto &[key, value] : metadata) {
+      if (header.back() != '{')
+        header += ',';
+      json_string(header, key);
+      header += ':';
+      json_string(header, value);
+    }
+    header += '}';
+  }
+  std::size_t offset = 0;
+  for (const auto &[name, t] : order) {
+    const std::size_t nbytes = torchlet::detail::nbytes(t.shape(), t.dtype());
+    if (header.back() != '{')
+      header += ',';
+    json_string(header, name);
+    header += ":{\"dtype\":\"";
+    header += dtype_name(t.dtype());
+    header += "\",\"shape\":[";
+    for (std::size_t d = 0; d < t.shape().size(); ++d)
+      header += (d ? "," : "") + std::to_string(t.shape()[d]);
+    header += "],\"data_offsets\":[" + std::to_string(offset) + "," +
+              std::to_string(offset + nbytes) + "]}";
+    offset += nbytes;
+  }
+  header += '}';
+  // pad with spaces so that the data region starts aligned
+  const std::size_t a = torchlet::core::ALIGNMENT;
+  const std::size_t used = sizeof(std::uint64_t) + header.size();
+  header.append((a - used % a) % a, ' ');
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    throw std::runtime_error("Cannot open " + path + " for writing.");
+
+  const std::uint64_t header_size = header.size();
+  out.write(reinterpret_cast<const char *>(&header_size), sizeof(header_size));
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+  for (const auto &[name, t] : order) {
+    const std::size_t nbytes = torchlet::detail::nbytes(t.shape(), t.dtype());
+    if (nbytes)
+      out.write(t.data_ptr<char>() +
+                    t.elem_offset() * torchlet::detail::dtype_size(t.dtype()),
+                static_cast<std::streamsize>(nbytes));
+  }
+
+  if (!out)
+    throw std::runtime_error("Failed writing " + path + ".");
+};
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <stdexcept>
+#include <torchlet/core/autograd.h>
+#include <torchlet/core/profiler.h>
+#include <torchlet/module/sequential.h>
+#include <torchlet/ops/functional.h>
+
+#include "detail/helpers.h"
+
+using torchlet::module::Sequential, torchlet::module::Linear,
+    torchlet::core::Tensor, torchlet::core::Dtype, torchlet::core::Storage;
+
+namespace {
+
+// Non owning Storage on bytes [offset, offset + nbytes) of the workspace,
+// ctx keeps the workspace alive.
+std::shared_ptr<Storage> workspace_view(const std::shared_ptr<Storage> &ws,
+                                        std::size_t offset,
+                                        std::size_t nbytes) {
+  auto storage = std::make_shared<Storage>();
+  storage->data = static_cast<std::uint8_t *>(ws->data) + offset;
+  storage->nbytes = nbytes;
+  storage->ctx = new std::shared_ptr<Storage>(ws);
+  storage->deleter = [](void *, std::size_t, void *ctx) {
+    delete static_cast<std::shared_ptr<Storage> *>(ctx);
+  };
+  return storage;
+};
+
+std::size_t align_up(std::size_t n) {
+  const std::size_t a = torchlet::core::ALIGNMENT;
+  return (n + a - 1) / a * a;
+};
+
+// A planned intermediate : live from the step that writes it to the last
+// step that reads it.
+struct Interval {
+  std::size_t first, last, bytes, offset;
+};
+
+// Greedy first fit, largest buffers first : each buffer takes the lowest
+// offset that does not overlap a placed buffer alive at the same time.
+// Returns the workspace size.
+std::size_t assign_offsets(std::vector<Interval> &buffers) {
+  std::vector<std::size_t> order(buffers.size());
+  for (std::size_t k = 0; k < order.size(); ++k)
+    order[k] = k;
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return buffers[a].bytes > buffers[b].bytes;
+  });
+
+  std::size_t total = 0;
+  std::vector<const Interval *> placed;
+  for (std::size_t k : order) {
+    Interval &buf = buffers[k];
+    std::vector<const Interval *> clash;
+    for (const Interval *p : placed)
+      if (p->first <= buf.last && buf.first <= p->last)
+        clash.push_back(p);
+    std::sort(clash.begin(), clash.end(),
+              [](auto a, auto b) { return a->offset < b->offset; });
+
+    std::size_t offset = 0;
+    for (const Interval *p : clash) {
+      if (offset + buf.bytes <= p->offset)
+        break;
+      offset = std::max(offset, p->offset + p->bytes);
+    }
+    buf.offset = offset;
+    total = std::max(total, offset + buf.bytes);
+    placed.push_back(&buf);
+  }
+  return total;
+};
+
+} // namespace
+
+Sequential::Sequential(const Sequential &other)
+    : m_layers(other.m_layers), m_linears(other.m_linears) {};
+
+Sequential &Sequential::operator=(const Sequential &other) {
+  if (this != &other) {
+    m_layers = other.m_layers;
+    m_linears = other.m_linears;
+    m_planned = false;
+    m_steps.clear();
+    m_buffers.clear();
+    m_workspace_bytes = 0;
+  }
+  return *this;
+};
+
+Sequential &Sequential::add(const Linear &layer) {
+  m_linears.push_back(layer);
+  m_layers.push_back({m_linears.size() - 1, Activation::None});
+  m_planned = false;
+  return *this;
+};
+
+Sequential &Sequential::add(Activation act) {
+  if (act != Activation::None) {
+    m_layers.push_back({kInput, act});
+    m_planned = false;
+  }
+  return *this;
+};
+
+void Sequential::plan(const Tensor &x) {
+  m_steps.clear();
+  m_buffers.clear();
+
+  // Steps, with every buffer id a new intermediate for now.
+  std::vector<std::vector<std::size_t>> shapes; // of each intermediate
+  std::vector<std::size_t> shape = x.shape();
+  std::size_t current = kInput;
+  for (std::size_t k = 0; k < m_layers.size(); ++k) {
+    const Layer &layer = m_layers[k];
+    if (layer.linear != kInput) {
+      const Linear &lin = m_linears[layer.linear];
+      Activation act = Activation::None;
+      if (k + 1 < m_layers.size() && m_layers[k + 1].linear == kInput)
+        act = m_layers[++k].act;
+      shape.back() = lin.weights().shape().front();
+      shapes.push_back(shape);
+      m_steps.push_back({layer.linear, act, current, shapes.size() - 1});
+    } else if (current == kInput) {
+      // the input is not ours to overwrite
+      shapes.push_back(shape);
+      m_steps.push_back({kInput, layer.act, current, shapes.size() - 1});
+    } else {
+      m_steps.push_back({kInput, layer.act, current, current});
+    }
+    current = m_steps.back().out;
+  }
+
+  // The last step writes out. Unless it ran in place, the intermediate it
+  // produced, the last one, is not needed.
+  if (!m_steps.empty()) {
+    Step &last = m_steps.back();
+    if (last.in != last.out)
+      shapes.pop_back();
+    last.out = kOutput;
+  }
+
+  std::vector<Interval> buffers(shapes.size(), {kInput, 0, 0, 0});
+  for (std::size_t s = 0; s < m_steps.size(); ++s) {
+    for (std::size_t id : {m_steps[s].in, m_steps[s].out}) {
+      if (id == kInput || id == kOutput)
+        continue;
+      buffers[id].first = std::min(buffers[id].first, s);
+      buffers[id].last = std::max(buffers[id].last, s);
+    }
+  }
+  for (std::size_t id = 0; id < buffers.size(); ++id)
+    buffers[id].bytes =
+        align_up(torchlet::detail::nbytes(shapes[id], x.dtype()));
+  m_workspace_bytes = assign_offsets(buffers);
+
+  if (m_workspace_bytes) {
+    Tensor workspace({m_workspace_bytes}, Dtype::UInt8);
+    for (std::size_t id = 0; id < buffers.size(); ++id)
+      m_buffers.push_back(Tensor::from_storage(
+          workspace_view(workspace.storage_ptr(), buffers[id].offset,
+                         buffers[id].bytes),
+          shapes[id], x.dtype()));
+  }
+
+  m_in_shape = x.shape();
+  m_out_shape = shape;
+  m_dtype = x.dtype();
+  m_planned = true;
+};
+
+const Tensor &Sequential::value(std::size_t id, const Tensor &x) const {
+  return id == kInput ? x : m_buffers[id];
+};
+
+// Training : intermediates are not planned, each op allocates its output
+// and records itself.
+Tensor Sequential::forward_recorded(const Tensor &x) {
+  Tensor h = x;
+  for (std::size_t k = 0; k < m_layers.size(); ++k) {
+    Activation act = m_layers[k].act;
+    if (m_layers[k].linear != kInput) {
+      const Linear &lin = m_linears[m_layers[k].linear];
+      const std::vector<Tensor> params = lin.parameters();
+      const Tensor &w = params.front();
+      const Tensor bias = lin.has_bias() ? params.back() : Tensor();
+      act = Activation::None;
+      if (k + 1 < m_layers.size() && m_layers[k + 1].linear == kInput)
+        act = m_layers[++k].act;
+      switch (act) {
+      case Activation::ReLU:
+        h = torchlet::ops::linear_relu(h, w, bias);
+        break;
+      case Activation::GELU:
+        h = torchlet::ops::linear_gelu(h, w, bias);
+        break;
+      case Activation::Softmax:
+        h = torchlet::ops::linear_bias_softmax(h, w, bias);
+        break;
+      default:
+        h = torchlet::ops::linear(h, w, bias);
+      }
+      continue;
+    }
+    switch (act) {
+    case Activation::ReLU:
+      h = torchlet::ops::relu(h);
+      break;
+    case Activation::GELU:
+      h = torchlet::ops::gelu(h);
+      break;
+    default:
+      h = torchlet::ops::softmax(h);
+    }
+  }
+  return h;
+};
+
+Tensor Sequential::forward(const Tensor &x) {
+  torchlet::core::RecordScope scope("Sequential::forward");
+  if (torchlet::core::grad_enabled()) {
+    bool grad = x.requires_grad();
+    for (const Linear &lin : m_linears)
+      for (const Tensor &p : lin.parameters())
+        grad = grad || p.requires_grad();
+    if (grad)
+      return forward_recorded(x);
+  }
+  if (!m_planned || x.shape() != m_in_shape || x.dtype() != m_dtype)
+    plan(x);
+  Tensor out(m_out_shape, x.dtype());
+  return forward_out(x, out);
+};
+
+Tensor &Sequential::forward_out(const Tensor &x, Tensor &out) {
+  torchlet::core::RecordScope scope("Sequential::forward");
+  if (!m_planned || x.shape() != m_in_shape || x.dtype() != m_dtype)
+    plan(x);
+  if (m_steps.empty())
+    return out.copy_(x);
+
+  for (const Step &step : m_steps) {
+    const Tensor &in = value(step.in, x);
+    Tensor &dst = step.out == kOutput ? out : m_buffers[step.out];
+
+    if (step.linear != kInput) {
+      m_linears[step.linear].forward_out(in, dst, step.act);
+      continue;
+    }
+    switch (step.act) {
+    case Activation::ReLU:
+      torchlet::ops::relu_out(in, dst);
+      break;
+    case Activation::GELU:
+      torchlet::ops::gelu_out(in, dst);
+      break;
+    default:
+      torchlet::ops::softmax_out(in, dst);
+    }
+  }
+  return out;
+};
+
+std::vector<Tensor> Sequential::parameters() const {
+  std::vector<Tensor> params;
+  for (const Layer &layer : m_layers)
+    if (layer.linear != kInput)
+      for (const Tensor &p : m_linears[layer.linear].parameters())
+        params.push_back(p);
+  return params;
+};
+
+Sequential &Sequential::requires_grad_(bool requires_grad) {
+  for (Linear &lin : m_linears)
+    lin.requires_grad_(requires_grad);
+  return *this;
+};
+
+torchlet::io::TensorDict Sequential::state_dict() const {
+  torchlet::io::TensorDict state;
+  for (std::size_t k = 0; k < m_layers.size(); ++k) {
+    if (m_layers[k].linear == kInput)
+      continue;
+    for (auto &[name, t] : m_linears[m_layers[k].linear].state_dict())
+      state.emplace(std::to_string(k) + "." + name, t);
+  }
+  return state;
+};
+
+void Sequential::load_state_dict(const torchlet::io::TensorDict &state,
+                                 const std::string &prefix) {
+  for (std::size_t k = 0; k < m_layers.size(); ++k)
+    if (m_layers[k].linear != kInput)
+      m_linears[m_layers[k].linear].load_state_dict(
+          state, prefix + std::to_string(k) + ".");
+};
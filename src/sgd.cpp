@@ -0,0 +1,37 @@
+#include <stdexcept>
+#include <torchlet/optim/sgd.h>
+
+using torchlet::optim::SGD, torchlet::core::Tensor;
+
+SGD::SGD(const std::vector<Tensor> &params, double lr, double momentum,
+         double weight_decay, bool nesterov)
+    : Optimizer(params, momentum != 0.0 ? 1 : 0),
+      m_hyper{lr, momentum, weight_decay, nesterov} {
+  if (lr < 0.0 || momentum < 0.0 || weight_decay < 0.0)
+    throw std::invalid_argument(
+        "lr, momentum and weight_decay must be non negative.");
+  if (nesterov && momentum == 0.0)
+    throw std::invalid_argument("Nesterov needs a momentum.");
+};
+
+void SGD::set_lr(double lr) {
+  if (lr < 0.0)
+    throw std::invalid_argument("lr must be non negative.");
+  m_hyper.lr = lr;
+};
+
+template <typename T>
+void SGD::run(T *p, const T *g, std::size_t offset, std::size_t n) {
+  T *buf = m_hyper.momentum != 0.0 ? state<T>(0, offset) : nullptr;
+  sgd_kernel(p, g, buf, n, m_hyper);
+};
+
+void SGD::update(float *p, const float *g, std::size_t offset,
+                 std::size_t n, std::size_t) {
+  run(p, g, offset, n);
+};
+
+void SGD::update(double *p, const double *g, std::size_t offset,
+                 std::size_t n, std::size_t) {
+  run(p, g, offset, n);
+};
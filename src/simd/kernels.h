@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <torchlet/ops/kernel.h>
+
+namespace torchlet::simd {
+
+/// @brief float kernels specialised for one instruction set. Each one
+/// matches the semantics of the scalar template of the same name in
+/// torchlet/ops/kernel.h.
+///
+/// Float16 / BFloat16 data is passed as its raw bits. The f16 entries need
+/// F16C and are nullptr on the SSE4 table.
+struct KernelTable {
+  void (*mvb)(const float *W, const float *x, const float *b, float *y,
+              std::size_t m, std::size_t n) noexcept;
+  void (*mvb_f16)(const std::uint16_t *W, const float *x, const float *b,
+                  float *y, std::size_t m, std::size_t n) noexcept;
+  void (*mvb_bf16)(const std::uint16_t *W, const float *x, const float *b,
+                   float *y, std::size_t m, std::size_t n) noexcept;
+  void (*widen_f16)(const std::uint16_t *x, float *y, std::size_t m) noexcept;
+  void (*widen_bf16)(const std::uint16_t *x, float *y,
+                     std::size_t m) noexcept;
+  void (*narrow_f16)(const float *x, std::uint16_t *y,
+                     std::size_t m) noexcept;
+  void (*narrow_bf16)(const float *x, std::uint16_t *y,
+                      std::size_t m) noexcept;
+  void (*qmmb)(const std::uint8_t *W, const float *w_scale,
+               const std::int32_t *w_zp, const std::int8_t *X,
+               const float *x_scale, const std::int32_t *x_sum,
+               const float *b, float *Y, std::size_t M, std::size_t m,
+               std::size_t n, std::size_t ldy) noexcept;
+  /// GEMM micro-kernel on a gemm_mr x gemm_nr register tile, see gemm.cpp.
+  std::size_t gemm_mr, gemm_nr;
+  void (*gemm)(std::size_t kc, const float *Ap, const float *Bp, float *C,
+               std::size_t ldc, std::size_t mr, std::size_t nr,
+               bool accumulate, const float *bias) noexcept;
+  void (*vadd)(const float *x, float *y, std::size_t m) noexcept;
+  void (*binary)(const float *a, std::size_t sa, const float *b,
+                 std::size_t sb, float *y, std::size_t m,
+                 BinaryOp op) noexcept;
+  void (*gelu)(const float *x, float *y, std::size_t m) noexcept;
+  void (*softmax)(const float *x, float *y, std::size_t m) noexcept;
+  void (*log_softmax)(const float *x, float *y, std::size_t m) noexcept;
+  void (*layer_norm)(const float *x, const float *r, const float *gamma,
+                     const float *beta, float *y, float *h, std::size_t m,
+                     float eps) noexcept;
+  void (*rms_norm)(const float *x, const float *r, const float *gamma,
+                   float *y, float *h, std::size_t m, float eps) noexcept;
+  void (*gelu_backward)(const float *x, const float *dy, float *dx,
+                        std::size_t m, bool accumulate) noexcept;
+  void (*softmax_backward)(const float *y, const float *dy, float *dx,
+                           std::size_t m, bool accumulate) noexcept;
+  void (*log_softmax_backward)(const float *y, const float *dy, float *dx,
+                               std::size_t m, bool accumulate) noexcept;
+  float (*logsumexp)(const float *x, std::size_t m) noexcept;
+  void (*cross_entropy_backward)(const float *x, float lse, std::size_t target,
+                                 float scale, float *dx, std::size_t m,
+                                 bool accumulate) noexcept;
+  void (*sgd)(float *p, const float *g, float *buf, std::size_t n,
+              const SGDStep &step) noexcept;
+  void (*adam)(float *p, const float *g, float *m, float *v, std::size_t n,
+               const AdamStep &step) noexcept;
+  void (*uniform)(float *y, std::size_t n, std::uint64_t seed,
+                  std::uint64_t counter, float low, float high) noexcept;
+  void (*normal)(float *y, std::size_t n, std::uint64_t seed,
+                 std::uint64_t counter, float mean, float stdev) noexcept;
+  void (*dropout)(const float *x, float *y, std::size_t n, std::size_t first,
+                  const DropoutStep &step, bool accumulate) noexcept;
+};
+
+namespace sse4 {
+extern const KernelTable table;
+}
+namespace avx2 {
+extern const KernelTable table;
+}
+namespace avx512 {
+extern const KernelTable table;
+}
+
+/// @brief Table of the active CPU capability, nullptr for the scalar kernels.
+const KernelTable *kernel_table() noexcept;
+
+} // namespace torchlet::simd
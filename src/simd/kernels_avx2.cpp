@@ -0,0 +1,4 @@
+// Compiled with -mavx2 -mfma -mf16c (see CMakeLists.txt).
+#define TORCHLET_SIMD_LEVEL 2
+#define TORCHLET_SIMD_NS avx2
+#include "simd/kernels_impl.h"
@@ -0,0 +1,4 @@
+// Compiled with -mavx512{f,dq,bw,vl} -mfma -mf16c (see CMakeLists.txt).
+#define TORCHLET_SIMD_LEVEL 3
+#define TORCHLET_SIMD_NS avx512
+#include "simd/kernels_impl.h"
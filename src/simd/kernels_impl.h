@@ -0,0 +1,910 @@
+#pragma once
+// Kernel bodies shared by the per-ISA translation units, see simd/vec.h.
+
+#include "detail/philox.h"
+#include "simd/kernels.h"
+#include "simd/vec.h"
+
+namespace torchlet::simd::TORCHLET_SIMD_NS {
+
+namespace {
+
+constexpr float kLowest = -3.40282347e+38f;
+
+/// 0.5 x (1 + tanh(u)) rewritten as x / (1 + exp(-2u)),
+/// u = sqrt(2 / pi) (x + 0.044715 x^3)
+inline Vec gelu(Vec x) noexcept {
+  const Vec one = Vec::set1(1.0f);
+  Vec u = x * Vec::fmadd(Vec::set1(0.044715f), x * x, one);
+  Vec e = exp(u * Vec::set1(-2.0f * 0.7978845608028654f));
+  return x / (one + e);
+};
+
+// d gelu / dx. With s = sigmoid(2 z), z = sqrt(2 / pi) (x + 0.044715 x^3),
+// gelu = x s and gelu' = s + 2 x s (1 - s) dz / dx.
+inline Vec gelu_grad(Vec x) noexcept {
+  const Vec one = Vec::set1(1.0f);
+  const Vec c = Vec::set1(0.7978845608028654f);
+  const Vec x2 = x * x;
+  const Vec z = c * x * Vec::fmadd(Vec::set1(0.044715f), x2, one);
+  const Vec s = one / (one + exp(z * Vec::set1(-2.0f)));
+  const Vec dz = c * Vec::fmadd(Vec::set1(3.0f * 0.044715f), x2, one);
+  return Vec::fmadd(Vec::set1(2.0f) * x * s * (one - s), dz, s);
+};
+
+// Distance, in weights, at which the GEMV prefetches ahead in each W row.
+constexpr std::size_t kPrefetch = 256;
+
+inline void prefetch(const void *p) noexcept {
+  _mm_prefetch(reinterpret_cast<const char *>(p), _MM_HINT_T0);
+};
+
+/// Storage format of the GEMV weights, widened to float on load.
+enum class WFormat { F32, F16, BF16 };
+
+template <WFormat F, typename WT> inline Vec load_w(const WT *p) noexcept {
+  if constexpr (F == WFormat::F32)
+    return Vec::loadu(p);
+  else if constexpr (F == WFormat::BF16)
+    return Vec::load_bf16(p);
+#if TORCHLET_SIMD_LEVEL >= 2
+  else
+    return Vec::load_f16(p);
+#endif
+};
+
+/// @brief First n < Vec::size weights of p, the rest zero.
+template <WFormat F, typename WT>
+inline Vec load_w_partial(const WT *p, std::size_t n) noexcept {
+  WT buf[Vec::size] = {};
+  for (std::size_t k = 0; k < n; ++k)
+    buf[k] = p[k];
+  return load_w<F>(buf);
+};
+
+/// Dot products of R consecutive rows of W with x. The R rows share every
+/// load of x and each row keeps two independent accumulators.
+template <std::size_t R, WFormat F, typename WT>
+inline void mvb_rows(const WT *W, const float *x, const float *b, float *y,
+                     std::size_t n) noexcept {
+  Vec acc0[R], acc1[R];
+  for (std::size_t r = 0; r < R; ++r)
+    acc0[r] = acc1[r] = Vec::set1(0.0f);
+
+  std::size_t k = 0;
+  for (; k + 2 * Vec::size <= n; k += 2 * Vec::size) {
+    const Vec x0 = Vec::loadu(x + k);
+    const Vec x1 = Vec::loadu(x + k + Vec::size);
+    for (std::size_t r = 0; r < R; ++r) {
+      const WT *w = W + r * n + k;
+      prefetch(w + kPrefetch);
+      acc0[r] = Vec::fmadd(load_w<F>(w), x0, acc0[r]);
+      acc1[r] = Vec::fmadd(load_w<F>(w + Vec::size), x1, acc1[r]);
+    }
+  }
+  for (; k + Vec::size <= n; k += Vec::size) {
+    const Vec x0 = Vec::loadu(x + k);
+    for (std::size_t r = 0; r < R; ++r)
+      acc0[r] = Vec::fmadd(load_w<F>(W + r * n + k), x0, acc0[r]);
+  }
+  if (k < n) {
+    const Vec x0 = load_partial(x + k, n - k, 0.0f);
+    for (std::size_t r = 0; r < R; ++r)
+      acc0[r] = Vec::fmadd(load_w_partial<F>(W + r * n + k, n - k), x0,
+                           acc0[r]);
+  }
+
+  for (std::size_t r = 0; r < R; ++r) {
+    const float dot = (acc0[r] + acc1[r]).hsum();
+    y[r] = b ? b[r] + dot : dot;
+  }
+};
+
+template <WFormat F, typename WT>
+void mvb_impl(const WT *W, const float *x, const float *b, float *y,
+              std::size_t m, std::size_t n) noexcept {
+  std::size_t i = 0;
+  for (; i + 4 <= m; i += 4)
+    mvb_rows<4, F>(W + i * n, x, b ? b + i : nullptr, y + i, n);
+  for (; i < m; ++i)
+    mvb_rows<1, F>(W + i * n, x, b ? b + i : nullptr, y + i, n);
+};
+
+void mvb_kernel(const float *W, const float *x, const float *b, float *y,
+                std::size_t m, std::size_t n) noexcept {
+  mvb_impl<WFormat::F32>(W, x, b, y, m, n);
+};
+
+void mvb_bf16_kernel(const std::uint16_t *W, const float *x, const float *b,
+                     float *y, std::size_t m, std::size_t n) noexcept {
+  mvb_impl<WFormat::BF16>(W, x, b, y, m, n);
+};
+
+template <WFormat F>
+void widen_impl(const std::uint16_t *x, float *y, std::size_t m) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    load_w<F>(x + k).storeu(y + k);
+  if (k < m)
+    store_partial(y + k, m - k, load_w_partial<F>(x + k, m - k));
+};
+
+void widen_bf16_kernel(const std::uint16_t *x, float *y,
+                       std::size_t m) noexcept {
+  widen_impl<WFormat::BF16>(x, y, m);
+};
+
+template <WFormat F>
+inline void store_w(Vec v, std::uint16_t *p) noexcept {
+  if constexpr (F == WFormat::BF16)
+    v.store_bf16(p);
+#if TORCHLET_SIMD_LEVEL >= 2
+  else
+    v.store_f16(p);
+#endif
+};
+
+template <WFormat F>
+void narrow_impl(const float *x, std::uint16_t *y, std::size_t m) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    store_w<F>(Vec::loadu(x + k), y + k);
+  if (k < m) {
+    std::uint16_t buf[Vec::size];
+    store_w<F>(load_partial(x + k, m - k, 0.0f), buf);
+    for (std::size_t i = 0; i < m - k; ++i)
+      y[k + i] = buf[i];
+  }
+};
+
+void narrow_bf16_kernel(const float *x, std::uint16_t *y,
+                        std::size_t m) noexcept {
+  narrow_impl<WFormat::BF16>(x, y, m);
+};
+
+#if TORCHLET_SIMD_LEVEL >= 2
+void mvb_f16_kernel(const std::uint16_t *W, const float *x, const float *b,
+                    float *y, std::size_t m, std::size_t n) noexcept {
+  mvb_impl<WFormat::F16>(W, x, b, y, m, n);
+};
+
+void widen_f16_kernel(const std::uint16_t *x, float *y,
+                      std::size_t m) noexcept {
+  widen_impl<WFormat::F16>(x, y, m);
+};
+
+void narrow_f16_kernel(const float *x, std::uint16_t *y,
+                       std::size_t m) noexcept {
+  narrow_impl<WFormat::F16>(x, y, m);
+};
+#else
+constexpr auto mvb_f16_kernel = nullptr;
+constexpr auto widen_f16_kernel = nullptr;
+constexpr auto narrow_f16_kernel = nullptr;
+#endif
+
+/// Int32 dots of RW rows of W with RX rows of X over n bytes. Every load
+/// of W is shared by the RX rows of X and the other way round.
+template <std::size_t RW, std::size_t RX>
+inline void qdot_tile(const std::uint8_t *W, const std::int8_t *X,
+                      std::size_t n, std::int32_t (&dot)[RW][RX]) noexcept {
+  QVec acc[RW][RX];
+  for (std::size_t r = 0; r < RW; ++r)
+    for (std::size_t c = 0; c < RX; ++c)
+      acc[r][c] = QVec::zero();
+
+  auto step = [&](const std::uint8_t *const *w, const std::int8_t *const *x) {
+    QVec xv[RX];
+    for (std::size_t c = 0; c < RX; ++c)
+      xv[c] = QVec::loadu(x[c]);
+    for (std::size_t r = 0; r < RW; ++r) {
+      const QVec wv = QVec::loadu(w[r]);
+      for (std::size_t c = 0; c < RX; ++c)
+        acc[r][c] = QVec::dot(acc[r][c], wv, xv[c]);
+    }
+  };
+
+  const std::uint8_t *w[RW];
+  const std::int8_t *x[RX];
+  std::size_t k = 0;
+  for (; k + QVec::size <= n; k += QVec::size) {
+    for (std::size_t r = 0; r < RW; ++r) {
+      w[r] = W + r * n + k;
+      prefetch(w[r] + 4 * QVec::size);
+    }
+    for (std::size_t c = 0; c < RX; ++c)
+      x[c] = X + c * n + k;
+    step(w, x);
+  }
+  if (k < n) {
+    // zero padding adds nothing to the dots
+    std::uint8_t wbuf[RW][QVec::size] = {};
+    std::int8_t xbuf[RX][QVec::size] = {};
+    for (std::size_t r = 0; r < RW; ++r) {
+      for (std::size_t i = 0; i < n - k; ++i)
+        wbuf[r][i] = W[r * n + k + i];
+      w[r] = wbuf[r];
+    }
+    for (std::size_t c = 0; c < RX; ++c) {
+      for (std::size_t i = 0; i < n - k; ++i)
+        xbuf[c][i] = X[c * n + k + i];
+      x[c] = xbuf[c];
+    }
+    step(w, x);
+  }
+
+  for (std::size_t r = 0; r < RW; ++r)
+    for (std::size_t c = 0; c < RX; ++c)
+      dot[r][c] = acc[r][c].hsum();
+};
+
+template <std::size_t RW, std::size_t RX>
+inline void qmmb_tile(const std::uint8_t *W, const float *w_scale,
+                      const std::int32_t *w_zp, const std::int8_t *X,
+                      const float *x_scale, const std::int32_t *x_sum,
+                      const float *b, float *Y, std::size_t n,
+                      std::size_t ldy) noexcept {
+  std::int32_t dot[RW][RX];
+  qdot_tile<RW, RX>(W, X, n, dot);
+  for (std::size_t r = 0; r < RW; ++r)
+    for (std::size_t c = 0; c < RX; ++c) {
+      const float v = static_cast<float>(dot[r][c] - w_zp[r] * x_sum[c]);
+      Y[c * ldy + r] = w_scale[r] * x_scale[c] * v + (b ? b[r] : 0.0f);
+    }
+};
+
+void qmmb_kernel(const std::uint8_t *W, const float *w_scale,
+                 const std::int32_t *w_zp, const std::int8_t *X,
+                 const float *x_scale, const std::int32_t *x_sum,
+                 const float *b, float *Y, std::size_t M, std::size_t m,
+                 std::size_t n, std::size_t ldy) noexcept {
+  auto tile_args = [&](std::size_t i, std::size_t o) {
+    return [=](auto tile) {
+      tile(W + o * n, w_scale + o, w_zp + o, X + i * n, x_scale + i,
+           x_sum + i, b ? b + o : nullptr, Y + i * ldy + o, n, ldy);
+    };
+  };
+
+  std::size_t i = 0;
+  for (; i + 4 <= M; i += 4) {
+    std::size_t o = 0;
+    for (; o + 2 <= m; o += 2)
+      tile_args(i, o)(qmmb_tile<2, 4>);
+    for (; o < m; ++o)
+      tile_args(i, o)(qmmb_tile<1, 4>);
+  }
+  for (; i < M; ++i) {
+    std::size_t o = 0;
+    for (; o + 4 <= m; o += 4)
+      tile_args(i, o)(qmmb_tile<4, 1>);
+    for (; o < m; ++o)
+      tile_args(i, o)(qmmb_tile<1, 1>);
+  }
+};
+
+// GEMM register tile : kGemmMR rows of two vectors each, 2 * kGemmMR
+// accumulators plus the two B vectors held in registers.
+#if TORCHLET_SIMD_LEVEL == 3
+constexpr std::size_t kGemmMR = 12;
+#elif TORCHLET_SIMD_LEVEL == 2
+constexpr std::size_t kGemmMR = 6;
+#else
+constexpr std::size_t kGemmMR = 4;
+#endif
+constexpr std::size_t kGemmNR = 2 * Vec::size;
+
+/// kGemmMR x kGemmNR tile of C (+)= Ap Bp over kc, Ap and Bp packed by
+/// pack_a / pack_b of gemm.cpp. Partial tiles go through a buffer.
+void gemm_kernel(std::size_t kc, const float *Ap, const float *Bp, float *C,
+                 std::size_t ldc, std::size_t mr, std::size_t nr,
+                 bool accumulate, const float *bias) noexcept {
+  Vec acc[kGemmMR][2];
+  for (std::size_t i = 0; i < kGemmMR; ++i)
+    acc[i][0] = acc[i][1] = Vec::set1(0.0f);
+
+  for (std::size_t p = 0; p < kc; ++p) {
+    const Vec b0 = Vec::loadu(Bp);
+    const Vec b1 = Vec::loadu(Bp + Vec::size);
+    for (std::size_t i = 0; i < kGemmMR; ++i) {
+      const Vec a = Vec::set1(Ap[i]);
+      acc[i][0] = Vec::fmadd(a, b0, acc[i][0]);
+      acc[i][1] = Vec::fmadd(a, b1, acc[i][1]);
+    }
+    Ap += kGemmMR;
+    Bp += kGemmNR;
+  }
+
+  if (mr == kGemmMR && nr == kGemmNR) {
+    for (std::size_t i = 0; i < kGemmMR; ++i) {
+      float *c = C + i * ldc;
+      for (std::size_t v = 0; v < 2; ++v) {
+        Vec r = acc[i][v];
+        if (accumulate)
+          r = Vec::loadu(c + v * Vec::size) + r;
+        else if (bias)
+          r = Vec::loadu(bias + v * Vec::size) + r;
+        r.storeu(c + v * Vec::size);
+      }
+    }
+    return;
+  }
+
+  float row[kGemmNR];
+  for (std::size_t i = 0; i < mr; ++i) {
+    acc[i][0].storeu(row);
+    acc[i][1].storeu(row + Vec::size);
+    float *c = C + i * ldc;
+    for (std::size_t j = 0; j < nr; ++j)
+      c[j] = accumulate ? c[j] + row[j] : (bias ? bias[j] + row[j] : row[j]);
+  }
+};
+
+void vadd_kernel(const float *x, float *y, std::size_t m) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    (Vec::loadu(y + k) + Vec::loadu(x + k)).storeu(y + k);
+  for (; k < m; ++k)
+    y[k] += x[k];
+};
+
+template <BinaryOp OP> inline Vec binary(Vec a, Vec b) noexcept {
+  if constexpr (OP == BinaryOp::Add)
+    return a + b;
+  else if constexpr (OP == BinaryOp::Sub)
+    return a - b;
+  else if constexpr (OP == BinaryOp::Mul)
+    return a * b;
+  else if constexpr (OP == BinaryOp::Div)
+    return a / b;
+  else
+    return Vec::max(a, b);
+};
+
+// A broadcast operand is splat once, outside the loop. Padding lanes load
+// 1 so that Div stays exception free.
+template <BinaryOp OP>
+void binary_loop(const float *a, std::size_t sa, const float *b,
+                 std::size_t sb, float *y, std::size_t m) noexcept {
+  if (m == 0)
+    return;
+  const Vec va = Vec::set1(*a), vb = Vec::set1(*b);
+  std::size_t k = 0;
+  if (sa && sb) {
+    for (; k + Vec::size <= m; k += Vec::size)
+      binary<OP>(Vec::loadu(a + k), Vec::loadu(b + k)).storeu(y + k);
+  } else if (sa) {
+    for (; k + Vec::size <= m; k += Vec::size)
+      binary<OP>(Vec::loadu(a + k), vb).storeu(y + k);
+  } else if (sb) {
+    for (; k + Vec::size <= m; k += Vec::size)
+      binary<OP>(va, Vec::loadu(b + k)).storeu(y + k);
+  } else {
+    const Vec vy = binary<OP>(va, vb);
+    for (; k + Vec::size <= m; k += Vec::size)
+      vy.storeu(y + k);
+  }
+  if (k < m) {
+    const Vec ta = sa ? load_partial(a + k, m - k, 1.0f) : va;
+    const Vec tb = sb ? load_partial(b + k, m - k, 1.0f) : vb;
+    store_partial(y + k, m - k, binary<OP>(ta, tb));
+  }
+};
+
+void binary_kernel(const float *a, std::size_t sa, const float *b,
+                   std::size_t sb, float *y, std::size_t m,
+                   BinaryOp op) noexcept {
+  switch (op) {
+  case BinaryOp::Add:
+    return binary_loop<BinaryOp::Add>(a, sa, b, sb, y, m);
+  case BinaryOp::Sub:
+    return binary_loop<BinaryOp::Sub>(a, sa, b, sb, y, m);
+  case BinaryOp::Mul:
+    return binary_loop<BinaryOp::Mul>(a, sa, b, sb, y, m);
+  case BinaryOp::Div:
+    return binary_loop<BinaryOp::Div>(a, sa, b, sb, y, m);
+  case BinaryOp::Maximum:
+    return binary_loop<BinaryOp::Maximum>(a, sa, b, sb, y, m);
+  }
+};
+
+void gelu_kernel(const float *x, float *y, std::size_t m) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    gelu(Vec::loadu(x + k)).storeu(y + k);
+  if (k < m)
+    store_partial(y + k, m - k, gelu(load_partial(x + k, m - k, 0.0f)));
+};
+
+float row_max(const float *x, std::size_t m) noexcept {
+  Vec vmax = Vec::set1(kLowest);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    vmax = Vec::max(vmax, Vec::loadu(x + k));
+  if (k < m)
+    vmax = Vec::max(vmax, load_partial(x + k, m - k, kLowest));
+  return vmax.hmax();
+};
+
+void softmax_kernel(const float *x, float *y, std::size_t m) noexcept {
+  const Vec vmax = Vec::set1(row_max(x, m));
+
+  // Padding lanes load kLowest so that exp flushes them to 0.
+  Vec vsum = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size) {
+    Vec e = exp(Vec::loadu(x + k) - vmax);
+    e.storeu(y + k);
+    vsum = vsum + e;
+  }
+  if (k < m) {
+    Vec e = exp(load_partial(x + k, m - k, kLowest) - vmax);
+    store_partial(y + k, m - k, e);
+    vsum = vsum + e;
+  }
+
+  const float sum = vsum.hsum();
+  if (sum == 0.0f) {
+    const float val = 1.0f / static_cast<float>(m);
+    for (k = 0; k < m; ++k)
+      y[k] = val;
+    return;
+  }
+
+  const Vec inv_sum = Vec::set1(1.0f / sum);
+  for (k = 0; k + Vec::size <= m; k += Vec::size)
+    (Vec::loadu(y + k) * inv_sum).storeu(y + k);
+  for (; k < m; ++k)
+    y[k] *= 1.0f / sum;
+};
+
+void log_softmax_kernel(const float *x, float *y, std::size_t m) noexcept {
+  const float max = row_max(x, m);
+  const Vec vmax = Vec::set1(max);
+
+  Vec vsum = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    vsum = vsum + exp(Vec::loadu(x + k) - vmax);
+  if (k < m)
+    vsum = vsum + exp(load_partial(x + k, m - k, kLowest) - vmax);
+
+  const float sum = vsum.hsum();
+  if (sum == 0.0f) {
+    for (k = 0; k < m; ++k)
+      y[k] = -__builtin_inff();
+    return;
+  }
+
+  const float shift = max + __builtin_logf(sum);
+  const Vec vshift = Vec::set1(shift);
+  for (k = 0; k + Vec::size <= m; k += Vec::size)
+    (Vec::loadu(x + k) - vshift).storeu(y + k);
+  for (; k < m; ++k)
+    y[k] = x[k] - shift;
+};
+
+// Both norms read the row twice : one pass for the statistics, which also
+// writes h = x + r, and one that normalises and applies the affine.
+
+// x + r on k.. (n < Vec::size lanes), padding lanes set to fill
+inline Vec load_sum_partial(const float *x, const float *r, std::size_t k,
+                            std::size_t n, float fill) noexcept {
+  Vec v = load_partial(x + k, n, fill);
+  return r ? v + load_partial(r + k, n, 0.0f) : v;
+};
+
+// y = v * rstd (* gamma), the centred value v of lanes k..
+inline Vec scale_shift(Vec v, const float *gamma, const float *beta,
+                       std::size_t k, Vec vrstd) noexcept {
+  v = v * vrstd;
+  if (gamma)
+    v = v * Vec::loadu(gamma + k);
+  if (beta)
+    v = v + Vec::loadu(beta + k);
+  return v;
+};
+
+void layer_norm_kernel(const float *x, const float *r, const float *gamma,
+                       const float *beta, float *y, float *h, std::size_t m,
+                       float eps) noexcept {
+  if (m == 0)
+    return;
+  if (!r)
+    h = nullptr;
+
+  // Sums of (v - shift) with shift the first value : one pass, and no
+  // cancellation when |mean| >> std. Padding lanes hold shift.
+  const float shift = r ? x[0] + r[0] : x[0];
+  const Vec vshift = Vec::set1(shift);
+  Vec s1 = Vec::set1(0.0f), s2 = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size) {
+    Vec v = Vec::loadu(x + k);
+    if (r) {
+      v = v + Vec::loadu(r + k);
+      if (h)
+        v.storeu(h + k);
+    }
+    const Vec d = v - vshift;
+    s1 = s1 + d;
+    s2 = Vec::fmadd(d, d, s2);
+  }
+  if (k < m) {
+    const Vec v = load_sum_partial(x, r, k, m - k, shift);
+    if (h)
+      store_partial(h + k, m - k, v);
+    const Vec d = v - vshift;
+    s1 = s1 + d;
+    s2 = Vec::fmadd(d, d, s2);
+  }
+
+  const float inv_m = 1.0f / static_cast<float>(m);
+  const float mean_d = s1.hsum() * inv_m;
+  float var = s2.hsum() * inv_m - mean_d * mean_d;
+  var = var > 0.0f ? var : 0.0f;
+  const Vec vmean = Vec::set1(shift + mean_d);
+  const Vec vrstd = Vec::set1(1.0f / __builtin_sqrtf(var + eps));
+
+  // h already holds x + r
+  const float *src = h ? h : x;
+  const float *add = h ? nullptr : r;
+  for (k = 0; k + Vec::size <= m; k += Vec::size) {
+    Vec v = Vec::loadu(src + k);
+    if (add)
+      v = v + Vec::loadu(add + k);
+    scale_shift(v - vmean, gamma, beta, k, vrstd).storeu(y + k);
+  }
+  for (; k < m; ++k) {
+    float v = (src[k] + (add ? add[k] : 0.0f) - (shift + mean_d)) *
+              (1.0f / __builtin_sqrtf(var + eps));
+    if (gamma)
+      v *= gamma[k];
+    if (beta)
+      v += beta[k];
+    y[k] = v;
+  }
+};
+
+void rms_norm_kernel(const float *x, const float *r, const float *gamma,
+                     float *y, float *h, std::size_t m, float eps) noexcept {
+  if (m == 0)
+    return;
+  if (!r)
+    h = nullptr;
+
+  Vec ss = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size) {
+    Vec v = Vec::loadu(x + k);
+    if (r) {
+      v = v + Vec::loadu(r + k);
+      if (h)
+        v.storeu(h + k);
+    }
+    ss = Vec::fmadd(v, v, ss);
+  }
+  if (k < m) {
+    const Vec v = load_sum_partial(x, r, k, m - k, 0.0f);
+    if (h)
+      store_partial(h + k, m - k, v);
+    ss = Vec::fmadd(v, v, ss);
+  }
+
+  const float rstd =
+      1.0f / __builtin_sqrtf(ss.hsum() / static_cast<float>(m) + eps);
+  const Vec vrstd = Vec::set1(rstd);
+
+  const float *src = h ? h : x;
+  const float *add = h ? nullptr : r;
+  for (k = 0; k + Vec::size <= m; k += Vec::size) {
+    Vec v = Vec::loadu(src + k);
+    if (add)
+      v = v + Vec::loadu(add + k);
+    scale_shift(v, gamma, nullptr, k, vrstd).storeu(y + k);
+  }
+  for (; k < m; ++k) {
+    const float v = (src[k] + (add ? add[k] : 0.0f)) * rstd;
+    y[k] = gamma ? v * gamma[k] : v;
+  }
+};
+
+// Backward kernels : dx = g, or dx += g when accumulating.
+
+inline void store_grad(float *dx, std::size_t k, Vec g,
+                       bool accumulate) noexcept {
+  if (accumulate)
+    g = g + Vec::loadu(dx + k);
+  g.storeu(dx + k);
+};
+
+inline void store_grad_partial(float *dx, std::size_t k, std::size_t n, Vec g,
+                               bool accumulate) noexcept {
+  if (accumulate)
+    g = g + load_partial(dx + k, n, 0.0f);
+  store_partial(dx + k, n, g);
+};
+
+void gelu_backward_kernel(const float *x, const float *dy, float *dx,
+                          std::size_t m, bool accumulate) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    store_grad(dx, k, Vec::loadu(dy + k) * gelu_grad(Vec::loadu(x + k)),
+               accumulate);
+  if (k < m)
+    store_grad_partial(dx, k, m - k,
+                       load_partial(dy + k, m - k, 0.0f) *
+                           gelu_grad(load_partial(x + k, m - k, 0.0f)),
+                       accumulate);
+};
+
+void softmax_backward_kernel(const float *y, const float *dy, float *dx,
+                             std::size_t m, bool accumulate) noexcept {
+  Vec vdot = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    vdot = Vec::fmadd(Vec::loadu(dy + k), Vec::loadu(y + k), vdot);
+  if (k < m)
+    vdot = Vec::fmadd(load_partial(dy + k, m - k, 0.0f),
+                      load_partial(y + k, m - k, 0.0f), vdot);
+  const Vec vs = Vec::set1(vdot.hsum());
+
+  for (k = 0; k + Vec::size <= m; k += Vec::size)
+    store_grad(dx, k, Vec::loadu(y + k) * (Vec::loadu(dy + k) - vs),
+               accumulate);
+  if (k < m)
+    store_grad_partial(dx, k, m - k,
+                       load_partial(y + k, m - k, 0.0f) *
+                           (load_partial(dy + k, m - k, 0.0f) - vs),
+                       accumulate);
+};
+
+void log_softmax_backward_kernel(const float *y, const float *dy, float *dx,
+                                 std::size_t m, bool accumulate) noexcept {
+  Vec vsum = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    vsum = vsum + Vec::loadu(dy + k);
+  if (k < m)
+    vsum = vsum + load_partial(dy + k, m - k, 0.0f);
+  const Vec vs = Vec::set1(vsum.hsum());
+
+  for (k = 0; k + Vec::size <= m; k += Vec::size)
+    store_grad(dx, k,
+               Vec::fnmadd(exp(Vec::loadu(y + k)), vs, Vec::loadu(dy + k)),
+               accumulate);
+  if (k < m)
+    store_grad_partial(dx, k, m - k,
+                       Vec::fnmadd(exp(load_partial(y + k, m - k, 0.0f)), vs,
+                                   load_partial(dy + k, m - k, 0.0f)),
+                       accumulate);
+};
+
+// Online logsumexp : lane-wise running max and sum of exp(x - max). The sum
+// is rescaled once per block of four vectors, 1.25 exp per element, so the
+// row is read once. Padding lanes load kLowest, which exp flushes to 0.
+inline void lse_step(Vec v, Vec &vmax, Vec &vsum) noexcept {
+  const Vec nmax = Vec::max(vmax, v);
+  vsum = vsum * exp(vmax - nmax) + exp(v - nmax);
+  vmax = nmax;
+};
+
+float logsumexp_kernel(const float *x, std::size_t m) noexcept {
+  constexpr std::size_t V = Vec::size;
+  Vec vmax = Vec::set1(kLowest), vsum = Vec::set1(0.0f);
+  std::size_t k = 0;
+  for (; k + 4 * V <= m; k += 4 * V) {
+    const Vec a = Vec::loadu(x + k), b = Vec::loadu(x + k + V);
+    const Vec c = Vec::loadu(x + k + 2 * V), d = Vec::loadu(x + k + 3 * V);
+    const Vec nmax =
+        Vec::max(vmax, Vec::max(Vec::max(a, b), Vec::max(c, d)));
+    vsum = vsum * exp(vmax - nmax) + (exp(a - nmax) + exp(b - nmax)) +
+           (exp(c - nmax) + exp(d - nmax));
+    vmax = nmax;
+  }
+  for (; k + V <= m; k += V)
+    lse_step(Vec::loadu(x + k), vmax, vsum);
+  if (k < m)
+    lse_step(load_partial(x + k, m - k, kLowest), vmax, vsum);
+
+  const float max = vmax.hmax();
+  const float sum = (vsum * exp(vmax - Vec::set1(max))).hsum();
+  return max + __builtin_logf(sum);
+};
+
+void cross_entropy_backward_kernel(const float *x, float lse,
+                                   std::size_t target, float scale, float *dx,
+                                   std::size_t m, bool accumulate) noexcept {
+  const Vec vlse = Vec::set1(lse), vscale = Vec::set1(scale);
+  std::size_t k = 0;
+  for (; k + Vec::size <= m; k += Vec::size)
+    store_grad(dx, k, vscale * exp(Vec::loadu(x + k) - vlse), accumulate);
+  if (k < m)
+    store_grad_partial(dx, k, m - k,
+                       vscale * exp(load_partial(x + k, m - k, 0.0f) - vlse),
+                       accumulate);
+  dx[target] -= scale;
+};
+
+// Optimizer updates, lanes k .. k + c with c <= Vec::size : the full
+// vectors take plain loads once inlined, the tail masked ones.
+template <typename F>
+inline void update_lanes(std::size_t n, F update) noexcept {
+  std::size_t k = 0;
+  for (; k + Vec::size <= n; k += Vec::size)
+    update(k, Vec::size);
+  if (k < n)
+    update(k, n - k);
+};
+
+inline Vec load_lanes(const float *x, std::size_t k, std::size_t c) noexcept {
+  return c == Vec::size ? Vec::loadu(x + k) : load_partial(x + k, c, 0.0f);
+};
+
+inline void store_lanes(float *x, std::size_t k, std::size_t c,
+                        Vec v) noexcept {
+  if (c == Vec::size)
+    v.storeu(x + k);
+  else
+    store_partial(x + k, c, v);
+};
+
+void sgd_kernel(float *p, const float *g, float *buf, std::size_t n,
+                const SGDStep &step) noexcept {
+  const Vec lr = Vec::set1(static_cast<float>(step.lr));
+  const Vec mu = Vec::set1(static_cast<float>(step.momentum));
+  const Vec wd = Vec::set1(static_cast<float>(step.weight_decay));
+  const bool momentum = step.momentum != 0.0, nesterov = step.nesterov;
+
+  update_lanes(n, [&](std::size_t k, std::size_t c) {
+    const Vec vp = load_lanes(p, k, c);
+    Vec d = Vec::fmadd(wd, vp, load_lanes(g, k, c));
+    if (momentum) {
+      const Vec b = Vec::fmadd(mu, load_lanes(buf, k, c), d);
+      store_lanes(buf, k, c, b);
+      d = nesterov ? Vec::fmadd(mu, b, d) : b;
+    }
+    store_lanes(p, k, c, Vec::fnmadd(lr, d, vp));
+  });
+};
+
+void adam_kernel(float *p, const float *g, float *m, float *v, std::size_t n,
+                 const AdamStep &step) noexcept {
+  const float decay = step.decoupled ? 0.0f : float(step.weight_decay);
+  const float shrink =
+      step.decoupled ? float(1.0 - step.lr * step.weight_decay) : 1.0f;
+  const Vec wd = Vec::set1(decay), keep = Vec::set1(shrink);
+  const Vec b1 = Vec::set1(float(step.beta1));
+  const Vec c1 = Vec::set1(float(1.0 - step.beta1));
+  const Vec b2 = Vec::set1(float(step.beta2));
+  const Vec c2 = Vec::set1(float(1.0 - step.beta2));
+  const Vec step_size = Vec::set1(float(step.lr / step.bias1));
+  const Vec inv_b2 = Vec::set1(float(1.0 / __builtin_sqrt(step.bias2)));
+  const Vec eps = Vec::set1(float(step.eps));
+
+  update_lanes(n, [&](std::size_t k, std::size_t c) {
+    Vec vp = load_lanes(p, k, c);
+    const Vec d = Vec::fmadd(wd, vp, load_lanes(g, k, c));
+    vp = vp * keep;
+    const Vec vm = Vec::fmadd(b1, load_lanes(m, k, c), c1 * d);
+    const Vec vv = Vec::fmadd(b2, load_lanes(v, k, c), c2 * d * d);
+    store_lanes(m, k, c, vm);
+    store_lanes(v, k, c, vv);
+    const Vec denom = Vec::fmadd(Vec::sqrt(vv), inv_b2, eps);
+    store_lanes(p, k, c, Vec::fnmadd(step_size, vm / denom, vp));
+  });
+};
+
+// Random fills : the Philox rounds vectorise over the counters of a batch,
+// word j of every counter in its own array, and the words are interleaved
+// back into y, 4 floats per counter, once converted.
+using torchlet::detail::kPhiloxBatch;
+static_assert(kPhiloxBatch % Vec::size == 0);
+
+void uniform_kernel(float *y, std::size_t n, std::uint64_t seed,
+                    std::uint64_t counter, float low, float high) noexcept {
+  const float span = high - low;
+  std::uint32_t x[4][kPhiloxBatch];
+  std::size_t k = 0;
+  for (; k + 4 * kPhiloxBatch <= n; k += 4 * kPhiloxBatch) {
+    torchlet::detail::philox_batch(seed, counter + k / 4, kPhiloxBatch, x);
+    for (std::size_t i = 0; i < kPhiloxBatch; ++i)
+      for (std::size_t j = 0; j < 4; ++j)
+        y[k + 4 * i + j] =
+            low + span * torchlet::detail::philox_unit_float(x[j][i]);
+  }
+  if (k < n) {
+    torchlet::detail::philox_batch(seed, counter + k / 4, (n - k + 3) / 4, x);
+    for (std::size_t e = 0; e < n - k; ++e)
+      y[k + e] =
+          low + span * torchlet::detail::philox_unit_float(x[e % 4][e / 4]);
+  }
+};
+
+void normal_kernel(float *y, std::size_t n, std::uint64_t seed,
+                   std::uint64_t counter, float mean, float stdev) noexcept {
+  const Vec one = Vec::set1(1.0f), vmean = Vec::set1(mean);
+  const Vec vstd = Vec::set1(stdev), m2 = Vec::set1(-2.0f);
+  // zeroed once so that the lanes past a partial batch stay finite
+  std::uint32_t x[4][kPhiloxBatch] = {};
+  float u[4][kPhiloxBatch];
+  for (std::size_t k = 0; k < n; k += 4 * kPhiloxBatch) {
+    const std::size_t c = n - k < 4 * kPhiloxBatch ? n - k : 4 * kPhiloxBatch;
+    torchlet::detail::philox_batch(seed, counter + k / 4, (c + 3) / 4, x);
+    for (std::size_t j = 0; j < 4; ++j)
+      for (std::size_t i = 0; i < kPhiloxBatch; ++i)
+        u[j][i] = torchlet::detail::philox_unit_float(x[j][i]);
+
+    // Box-Muller on words (0, 1) and (2, 3), in place
+    for (std::size_t j = 0; j < 4; j += 2)
+      for (std::size_t i = 0; i < kPhiloxBatch; i += Vec::size) {
+        const Vec u1 = one - Vec::loadu(u[j] + i);
+        const Vec r = vstd * Vec::sqrt(m2 * log(u1));
+        Vec cos, sin;
+        sincos_2pi(Vec::loadu(u[j + 1] + i), cos, sin);
+        Vec::fmadd(r, cos, vmean).storeu(u[j] + i);
+        Vec::fmadd(r, sin, vmean).storeu(u[j + 1] + i);
+      }
+
+    if (c == 4 * kPhiloxBatch) {
+      for (std::size_t i = 0; i < kPhiloxBatch; ++i)
+        for (std::size_t j = 0; j < 4; ++j)
+          y[k + 4 * i + j] = u[j][i];
+    } else {
+      for (std::size_t e = 0; e < c; ++e)
+        y[k + e] = u[e % 4][e / 4];
+    }
+  }
+};
+
+// Plain loops over the words : the mask is integer compares, so the result
+// matches the portable kernel bit for bit.
+void dropout_kernel(const float *x, float *y, std::size_t n, std::size_t first,
+                    const DropoutStep &step, bool accumulate) noexcept {
+  const std::uint32_t threshold = torchlet::detail::philox_threshold(step.p);
+  const float scale = step.p < 1.0 ? float(1.0 / (1.0 - step.p)) : 0.0f;
+  std::uint32_t w[4 * kPhiloxBatch];
+  for (std::size_t k = 0; k < n;) {
+    const std::size_t c = torchlet::detail::philox_words(
+        step.seed, step.counter, first + k, n - k, w);
+    for (std::size_t e = 0; e < c; ++e) {
+      const float v = (w[e] >> 8) >= threshold ? x[k + e] * scale : 0.0f;
+      y[k + e] = accumulate ? y[k + e] + v : v;
+    }
+    k += c;
+  }
+};
+
+} // namespace
+
+const KernelTable table = {
+    mvb_kernel,
+    mvb_f16_kernel,
+    mvb_bf16_kernel,
+    widen_f16_kernel,
+    widen_bf16_kernel,
+    narrow_f16_kernel,
+    narrow_bf16_kernel,
+    qmmb_kernel,
+    kGemmMR,
+    kGemmNR,
+    gemm_kernel,
+    vadd_kernel,
+    binary_kernel,
+    gelu_kernel,
+    softmax_kernel,
+    log_softmax_kernel,
+    layer_norm_kernel,
+    rms_norm_kernel,
+    gelu_backward_kernel,
+    softmax_backward_kernel,
+    log_softmax_backward_kernel,
+    logsumexp_kernel,
+    cross_entropy_backward_kernel,
+    sgd_kernel,
+    adam_kernel,
+    uniform_kernel,
+    normal_kernel,
+    dropout_kernel,
+};
+
+} // namespace torchlet::simd::TORCHLET_SIMD_NS
@@ -0,0 +1,4 @@
+// Compiled with -msse4.1 (see CMakeLists.txt).
+#define TORCHLET_SIMD_LEVEL 1
+#define TORCHLET_SIMD_NS sse4
+#include "simd/kernels_impl.h"
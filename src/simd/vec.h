@@ -0,0 +1,462 @@
+#pragma once
+// Thin float vector wrapper over one x86 instruction set, selected by
+// TORCHLET_SIMD_LEVEL (1 = SSE4.1, 2 = AVX2 + FMA, 3 = AVX-512).
+// Only ever included from the per-ISA translation units in src/simd/,
+// which are compiled with the matching -m flags.
+//
+// Keep this header free of std:: templates : their instantiations would be
+// compiled for the wider ISA and the linker may pick them for scalar code.
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#ifndef TORCHLET_SIMD_LEVEL
+#error "TORCHLET_SIMD_LEVEL must be defined before including simd/vec.h"
+#endif
+
+namespace torchlet::simd::TORCHLET_SIMD_NS {
+
+#if TORCHLET_SIMD_LEVEL == 3
+
+struct Vec {
+  static constexpr std::size_t size = 16;
+  __m512 v;
+
+  static Vec loadu(const float *p) noexcept { return {_mm512_loadu_ps(p)}; };
+  void storeu(float *p) const noexcept { _mm512_storeu_ps(p, v); };
+  static Vec set1(float x) noexcept { return {_mm512_set1_ps(x)}; };
+
+  friend Vec operator+(Vec a, Vec b) noexcept {
+    return {_mm512_add_ps(a.v, b.v)};
+  };
+  friend Vec operator-(Vec a, Vec b) noexcept {
+    return {_mm512_sub_ps(a.v, b.v)};
+  };
+  friend Vec operator*(Vec a, Vec b) noexcept {
+    return {_mm512_mul_ps(a.v, b.v)};
+  };
+  friend Vec operator/(Vec a, Vec b) noexcept {
+    return {_mm512_div_ps(a.v, b.v)};
+  };
+
+  /// a * b + c
+  static Vec fmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm512_fmadd_ps(a.v, b.v, c.v)};
+  };
+  /// c - a * b
+  static Vec fnmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm512_fnmadd_ps(a.v, b.v, c.v)};
+  };
+  static Vec max(Vec a, Vec b) noexcept { return {_mm512_max_ps(a.v, b.v)}; };
+  static Vec min(Vec a, Vec b) noexcept { return {_mm512_min_ps(a.v, b.v)}; };
+  static Vec sqrt(Vec a) noexcept { return {_mm512_sqrt_ps(a.v)}; };
+  static Vec round(Vec a) noexcept {
+    return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT |
+                                           _MM_FROUND_NO_EXC)};
+  };
+  /// 2^n for integral valued n in [-126, 127]
+  static Vec pow2(Vec n) noexcept {
+    __m512i e =
+        _mm512_add_epi32(_mm512_cvtps_epi32(n.v), _mm512_set1_epi32(127));
+    return {_mm512_castsi512_ps(_mm512_slli_epi32(e, 23))};
+  };
+  /// x < t ? a : b
+  static Vec select_lt(Vec x, Vec t, Vec a, Vec b) noexcept {
+    __mmask16 m = _mm512_cmp_ps_mask(x.v, t.v, _CMP_LT_OQ);
+    return {_mm512_mask_blend_ps(m, b.v, a.v)};
+  };
+  /// x = m 2^e with m in [1, 2), for positive normal x. Returns m.
+  static Vec frexp(Vec x, Vec &e) noexcept {
+    e = {_mm512_getexp_ps(x.v)};
+    return {_mm512_getmant_ps(x.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src)};
+  };
+
+  float hsum() const noexcept { return _mm512_reduce_add_ps(v); };
+  float hmax() const noexcept { return _mm512_reduce_max_ps(v); };
+
+  static Vec load_f16(const std::uint16_t *p) noexcept {
+    return {_mm512_cvtph_ps(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)))};
+  };
+  void store_f16(std::uint16_t *p) const noexcept {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i *>(p),
+        _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+  };
+  static Vec load_bf16(const std::uint16_t *p) noexcept {
+    __m512i w = _mm512_cvtepu16_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+    return {_mm512_castsi512_ps(_mm512_slli_epi32(w, 16))};
+  };
+  /// Round to nearest even, nan kept quiet.
+  void store_bf16(std::uint16_t *p) const noexcept {
+    __m512i u = _mm512_castps_si512(v);
+    __m512i odd = _mm512_and_si512(_mm512_srli_epi32(u, 16),
+                                   _mm512_set1_epi32(1));
+    __m512i r = _mm512_add_epi32(
+        u, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7fff)));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    r = _mm512_mask_or_epi32(r, nan, u, _mm512_set1_epi32(0x400000));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm512_cvtepi32_epi16(_mm512_srli_epi32(r, 16)));
+  };
+};
+
+#elif TORCHLET_SIMD_LEVEL == 2
+
+struct Vec {
+  static constexpr std::size_t size = 8;
+  __m256 v;
+
+  static Vec loadu(const float *p) noexcept { return {_mm256_loadu_ps(p)}; };
+  void storeu(float *p) const noexcept { _mm256_storeu_ps(p, v); };
+  static Vec set1(float x) noexcept { return {_mm256_set1_ps(x)}; };
+
+  friend Vec operator+(Vec a, Vec b) noexcept {
+    return {_mm256_add_ps(a.v, b.v)};
+  };
+  friend Vec operator-(Vec a, Vec b) noexcept {
+    return {_mm256_sub_ps(a.v, b.v)};
+  };
+  friend Vec operator*(Vec a, Vec b) noexcept {
+    return {_mm256_mul_ps(a.v, b.v)};
+  };
+  friend Vec operator/(Vec a, Vec b) noexcept {
+    return {_mm256_div_ps(a.v, b.v)};
+  };
+
+  static Vec fmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+  };
+  static Vec fnmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm256_fnmadd_ps(a.v, b.v, c.v)};
+  };
+  static Vec max(Vec a, Vec b) noexcept { return {_mm256_max_ps(a.v, b.v)}; };
+  static Vec min(Vec a, Vec b) noexcept { return {_mm256_min_ps(a.v, b.v)}; };
+  static Vec sqrt(Vec a) noexcept { return {_mm256_sqrt_ps(a.v)}; };
+  static Vec round(Vec a) noexcept {
+    return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT |
+                                     _MM_FROUND_NO_EXC)};
+  };
+  static Vec pow2(Vec n) noexcept {
+    __m256i e =
+        _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+    return {_mm256_castsi256_ps(_mm256_slli_epi32(e, 23))};
+  };
+  static Vec select_lt(Vec x, Vec t, Vec a, Vec b) noexcept {
+    __m256 m = _mm256_cmp_ps(x.v, t.v, _CMP_LT_OQ);
+    return {_mm256_blendv_ps(b.v, a.v, m)};
+  };
+  static Vec frexp(Vec x, Vec &e) noexcept {
+    __m256i u = _mm256_castps_si256(x.v);
+    e = {_mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(u, 23),
+                                             _mm256_set1_epi32(127)))};
+    u = _mm256_or_si256(_mm256_and_si256(u, _mm256_set1_epi32(0x7fffff)),
+                        _mm256_set1_epi32(0x3f800000));
+    return {_mm256_castsi256_ps(u)};
+  };
+
+  float hsum() const noexcept {
+    __m128 s =
+        _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  };
+  float hmax() const noexcept {
+    __m128 s =
+        _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  };
+
+  // F16C
+  static Vec load_f16(const std::uint16_t *p) noexcept {
+    return {_mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)))};
+  };
+  void store_f16(std::uint16_t *p) const noexcept {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(p),
+        _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+  };
+  static Vec load_bf16(const std::uint16_t *p) noexcept {
+    __m256i w = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    return {_mm256_castsi256_ps(_mm256_slli_epi32(w, 16))};
+  };
+  void store_bf16(std::uint16_t *p) const noexcept {
+    __m256i u = _mm256_castps_si256(v);
+    __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16),
+                                   _mm256_set1_epi32(1));
+    __m256i r = _mm256_add_epi32(
+        u, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7fff)));
+    __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    __m256i quiet = _mm256_or_si256(u, _mm256_set1_epi32(0x400000));
+    r = _mm256_srli_epi32(_mm256_blendv_epi8(r, quiet, nan), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+                     _mm_packus_epi32(_mm256_castsi256_si128(r),
+                                      _mm256_extracti128_si256(r, 1)));
+  };
+};
+
+#elif TORCHLET_SIMD_LEVEL == 1
+
+struct Vec {
+  static constexpr std::size_t size = 4;
+  __m128 v;
+
+  static Vec loadu(const float *p) noexcept { return {_mm_loadu_ps(p)}; };
+  void storeu(float *p) const noexcept { _mm_storeu_ps(p, v); };
+  static Vec set1(float x) noexcept { return {_mm_set1_ps(x)}; };
+
+  friend Vec operator+(Vec a, Vec b) noexcept {
+    return {_mm_add_ps(a.v, b.v)};
+  };
+  friend Vec operator-(Vec a, Vec b) noexcept {
+    return {_mm_sub_ps(a.v, b.v)};
+  };
+  friend Vec operator*(Vec a, Vec b) noexcept {
+    return {_mm_mul_ps(a.v, b.v)};
+  };
+  friend Vec operator/(Vec a, Vec b) noexcept {
+    return {_mm_div_ps(a.v, b.v)};
+  };
+
+  // No FMA before AVX2 : two roundings instead of one.
+  static Vec fmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)};
+  };
+  static Vec fnmadd(Vec a, Vec b, Vec c) noexcept {
+    return {_mm_sub_ps(c.v, _mm_mul_ps(a.v, b.v))};
+  };
+  static Vec max(Vec a, Vec b) noexcept { return {_mm_max_ps(a.v, b.v)}; };
+  static Vec min(Vec a, Vec b) noexcept { return {_mm_min_ps(a.v, b.v)}; };
+  static Vec sqrt(Vec a) noexcept { return {_mm_sqrt_ps(a.v)}; };
+  static Vec round(Vec a) noexcept {
+    return {_mm_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)};
+  };
+  static Vec pow2(Vec n) noexcept {
+    __m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+    return {_mm_castsi128_ps(_mm_slli_epi32(e, 23))};
+  };
+  static Vec select_lt(Vec x, Vec t, Vec a, Vec b) noexcept {
+    return {_mm_blendv_ps(b.v, a.v, _mm_cmplt_ps(x.v, t.v))};
+  };
+  static Vec frexp(Vec x, Vec &e) noexcept {
+    __m128i u = _mm_castps_si128(x.v);
+    e = {_mm_cvtepi32_ps(
+        _mm_sub_epi32(_mm_srli_epi32(u, 23), _mm_set1_epi32(127)))};
+    u = _mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(0x7fffff)),
+                     _mm_set1_epi32(0x3f800000));
+    return {_mm_castsi128_ps(u)};
+  };
+
+  float hsum() const noexcept {
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  };
+  float hmax() const noexcept {
+    __m128 s = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_max_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+  };
+
+  // No F16C at this level : Float16 stays on the portable kernels.
+  static Vec load_bf16(const std::uint16_t *p) noexcept {
+    __m128i w = _mm_cvtepu16_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    return {_mm_castsi128_ps(_mm_slli_epi32(w, 16))};
+  };
+  void store_bf16(std::uint16_t *p) const noexcept {
+    __m128i u = _mm_castps_si128(v);
+    __m128i odd = _mm_and_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(1));
+    __m128i r =
+        _mm_add_epi32(u, _mm_add_epi32(odd, _mm_set1_epi32(0x7fff)));
+    __m128i nan = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+    __m128i quiet = _mm_or_si128(u, _mm_set1_epi32(0x400000));
+    r = _mm_srli_epi32(_mm_blendv_epi8(r, quiet, nan), 16);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi32(r, r));
+  };
+};
+
+#else
+#error "Unknown TORCHLET_SIMD_LEVEL"
+#endif
+
+// Int8 dot products : maddubs multiplies unsigned by signed bytes and sums
+// adjacent pairs into int16 (saturating), madd against ones widens to int32.
+
+#if TORCHLET_SIMD_LEVEL == 3
+
+struct QVec {
+  static constexpr std::size_t size = 64; // bytes
+  __m512i v;
+
+  static QVec loadu(const void *p) noexcept { return {_mm512_loadu_si512(p)}; };
+  static QVec zero() noexcept { return {_mm512_setzero_si512()}; };
+  /// acc + sum of u[k] * s[k] over each group of 4 bytes
+  static QVec dot(QVec acc, QVec u, QVec s) noexcept {
+    __m512i p = _mm512_maddubs_epi16(u.v, s.v);
+    return {_mm512_add_epi32(acc.v,
+                             _mm512_madd_epi16(p, _mm512_set1_epi16(1)))};
+  };
+  std::int32_t hsum() const noexcept { return _mm512_reduce_add_epi32(v); };
+};
+
+#elif TORCHLET_SIMD_LEVEL == 2
+
+struct QVec {
+  static constexpr std::size_t size = 32;
+  __m256i v;
+
+  static QVec loadu(const void *p) noexcept {
+    return {_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))};
+  };
+  static QVec zero() noexcept { return {_mm256_setzero_si256()}; };
+  static QVec dot(QVec acc, QVec u, QVec s) noexcept {
+    __m256i p = _mm256_maddubs_epi16(u.v, s.v);
+    return {_mm256_add_epi32(acc.v,
+                             _mm256_madd_epi16(p, _mm256_set1_epi16(1)))};
+  };
+  std::int32_t hsum() const noexcept {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),
+                              _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+  };
+};
+
+#else
+
+struct QVec {
+  static constexpr std::size_t size = 16;
+  __m128i v;
+
+  static QVec loadu(const void *p) noexcept {
+    return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))};
+  };
+  static QVec zero() noexcept { return {_mm_setzero_si128()}; };
+  static QVec dot(QVec acc, QVec u, QVec s) noexcept {
+    __m128i p = _mm_maddubs_epi16(u.v, s.v);
+    return {_mm_add_epi32(acc.v, _mm_madd_epi16(p, _mm_set1_epi16(1)))};
+  };
+  std::int32_t hsum() const noexcept {
+    __m128i s = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+  };
+};
+
+#endif
+
+/// @brief Load the first n < Vec::size floats of p, the rest set to fill.
+inline Vec load_partial(const float *p, std::size_t n, float fill) noexcept {
+  float buf[Vec::size];
+  for (std::size_t k = 0; k < Vec::size; ++k)
+    buf[k] = k < n ? p[k] : fill;
+  return Vec::loadu(buf);
+};
+
+/// @brief Store the first n < Vec::size lanes of v to p.
+inline void store_partial(float *p, std::size_t n, Vec v) noexcept {
+  float buf[Vec::size];
+  v.storeu(buf);
+  for (std::size_t k = 0; k < n; ++k)
+    p[k] = buf[k];
+};
+
+/// @brief exp(x), Cephes style : range reduction by ln2 and a degree 6
+/// polynomial on [-ln2/2, ln2/2]. Max relative error ~2 ulp over the normal
+/// range; inputs below ~-87.3 flush to 0, inputs above ~88.03 saturate.
+inline Vec exp(Vec x) noexcept {
+  const Vec lo = Vec::set1(-87.3365447505f);
+  const Vec hi = Vec::set1(88.0296919311f);
+
+  Vec xc = Vec::min(Vec::max(x, lo), hi);
+  Vec n = Vec::round(xc * Vec::set1(1.44269504088896341f));
+
+  // r = x - n ln2, ln2 split in a high and a low part
+  Vec r = Vec::fnmadd(n, Vec::set1(0.693359375f), xc);
+  r = Vec::fnmadd(n, Vec::set1(-2.12194440e-4f), r);
+
+  Vec p = Vec::set1(1.9875691500e-4f);
+  p = Vec::fmadd(p, r, Vec::set1(1.3981999507e-3f));
+  p = Vec::fmadd(p, r, Vec::set1(8.3334519073e-3f));
+  p = Vec::fmadd(p, r, Vec::set1(4.1665795894e-2f));
+  p = Vec::fmadd(p, r, Vec::set1(1.6666665459e-1f));
+  p = Vec::fmadd(p, r, Vec::set1(5.0000001201e-1f));
+  p = Vec::fmadd(p, r * r, r + Vec::set1(1.0f));
+
+  // n in [-126, 127] after clamping, so 2^n is a normal float
+  Vec y = p * Vec::pow2(n);
+  return Vec::select_lt(x, lo, Vec::set1(0.0f), y);
+};
+
+/// @brief log(x) for positive normal x, Cephes style : x = m 2^e with m in
+/// [sqrt(1/2), sqrt(2)) and a degree 9 polynomial in m - 1. Max relative
+/// error ~2 ulp.
+inline Vec log(Vec x) noexcept {
+  const Vec one = Vec::set1(1.0f);
+  Vec e;
+  Vec m = Vec::frexp(x, e);
+  const Vec sqrt2 = Vec::set1(1.41421356237f);
+  e = Vec::select_lt(m, sqrt2, e, e + one);
+  m = Vec::select_lt(m, sqrt2, m, m * Vec::set1(0.5f));
+
+  const Vec f = m - one;
+  Vec p = Vec::set1(7.0376836292e-2f);
+  p = Vec::fmadd(p, f, Vec::set1(-1.1514610310e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(1.1676998740e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(-1.2420140846e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(1.4249322787e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(-1.6668057665e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(2.0000714765e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(-2.4999993993e-1f));
+  p = Vec::fmadd(p, f, Vec::set1(3.3333331174e-1f));
+
+  // ln2 split in a high and a low part, as in exp
+  const Vec f2 = f * f;
+  Vec y = Vec::fmadd(p * f, f2, e * Vec::set1(-2.12194440e-4f));
+  y = Vec::fnmadd(Vec::set1(0.5f), f2, y);
+  return Vec::fmadd(e, Vec::set1(0.693359375f), f + y);
+};
+
+/// @brief cos(2 pi u) and sin(2 pi u) for u in [0, 1] : quadrant q =
+/// round(4 u), minimax polynomials on the reduced angle in [-pi/4, pi/4].
+/// Absolute error ~1e-7.
+inline void sincos_2pi(Vec u, Vec &c, Vec &s) noexcept {
+  const Vec zero = Vec::set1(0.0f);
+  Vec q = Vec::round(u * Vec::set1(4.0f));
+  const Vec a = Vec::fnmadd(q, Vec::set1(0.25f), u) *
+                Vec::set1(6.283185307179586f);
+  q = Vec::select_lt(q, Vec::set1(3.5f), q, zero); // quadrant 4 is 0
+
+  const Vec a2 = a * a;
+  Vec ps = Vec::set1(-1.9515295891e-4f);
+  ps = Vec::fmadd(ps, a2, Vec::set1(8.3321608736e-3f));
+  ps = Vec::fmadd(ps, a2, Vec::set1(-1.6666654611e-1f));
+  const Vec sa = Vec::fmadd(ps * a2, a, a);
+  Vec pc = Vec::set1(2.443315711809948e-5f);
+  pc = Vec::fmadd(pc, a2, Vec::set1(-1.388731625493765e-3f));
+  pc = Vec::fmadd(pc, a2, Vec::set1(4.166664568298827e-2f));
+  const Vec ca = Vec::fmadd(pc * a2, a2,
+                            Vec::fnmadd(Vec::set1(0.5f), a2, Vec::set1(1.0f)));
+
+  // rotate (ca, sa) by q quarter turns
+  const Vec h1 = Vec::set1(0.5f), h2 = Vec::set1(1.5f),
+            h3 = Vec::set1(2.5f);
+  c = Vec::select_lt(
+      q, h1, ca,
+      Vec::select_lt(q, h2, zero - sa, Vec::select_lt(q, h3, zero - ca, sa)));
+  s = Vec::select_lt(
+      q, h1, sa,
+      Vec::select_lt(q, h2, ca, Vec::select_lt(q, h3, zero - sa, zero - ca)));
+};
+
+} // namespace torchlet::simd::TORCHLET_SIMD_NS
@@ -1,9 +1,16 @@
+#include <cstring>
+#include <torchlet/core/profiler.h>
 #include <torchlet/core/tensor.h>
+#include <torchlet/iterator/tensor_iterator.h>
+#include <torchlet/ops/kernel.h>
+#include <type_traits>
 
 #include "detail/helpers.h"
 #include "detail/validators.h"
 
-using torchlet::core::Tensor, torchlet::core::Dtype;
+using torchlet::core::Tensor, torchlet::core::Dtype,
+    torchlet::core::Allocator, torchlet::core::get_allocator,
+    torchlet::iterator::TensorIterator;
 
 Tensor::Tensor(const std::vector<std::size_t> &shape, const Dtype &dtype)
     : m_dtype(dtype), m_shape(shape), m_elem_offset(0) {
@@ -12,8 +19,16 @@ Tensor::Tensor(const std::vector<std::size_t> &shape, const Dtype &dtype)
   m_numel = torchlet::detail::numel(shape);
   std::size_t n_bytes = torchlet::detail::nbytes(shape, dtype);
 
+  if (torchlet::core::profiling())
+    torchlet::core::detail::record_allocation(n_bytes);
+  Allocator *alloc = get_allocator();
   m_storage = std::make_shared<Storage>();
-  m_storage->data = std::malloc(n_bytes);
+  m_storage->data = alloc->allocate(n_bytes);
+  m_storage->nbytes = n_bytes;
+  m_storage->ctx = alloc;
+  m_storage->deleter = [](void *data, std::size_t nbytes, void *ctx) {
+    static_cast<Allocator *>(ctx)->deallocate(data, nbytes);
+  };
 };
 
 Tensor::Tensor(const std::vector<std::size_t> &shape,
@@ -31,7 +46,7 @@ Tensor Tensor::zeros(const std::initializer_list<std::size_t> &shape,
 
   Tensor t = Tensor(shape, dtype);
   void *data_ptr = t.data_ptr<void>();
-  memset(data_ptr, 0, t.numel());
+  std::memset(data_ptr, 0, torchlet::detail::nbytes(t.shape(), dtype));
 
   return t;
 }
@@ -40,7 +55,7 @@ Tensor Tensor::zeros(const std::vector<std::size_t> &shape,
 
   Tensor t = Tensor(shape, dtype);
   void *data_ptr = t.data_ptr<void>();
-  memset(data_ptr, 0, t.numel());
+  std::memset(data_ptr, 0, torchlet::detail::nbytes(t.shape(), dtype));
 
   return t;
 }
@@ -69,6 +84,16 @@ Tensor Tensor::ones(const std::vector<std::size_t> &shape, const Dtype &dtype) {
   return t;
 }
 
+Tensor Tensor::from_storage(const std::shared_ptr<Storage> &storage,
+                            const std::vector<std::size_t> &shape,
+                            const Dtype &dtype) {
+  if (storage->nbytes < torchlet::detail::nbytes(shape, dtype)) {
+    throw std::invalid_argument("Storage is too small for the shape.");
+  }
+  return Tensor(shape, torchlet::detail::get_strides(shape), 0, dtype,
+                storage);
+};
+
 Tensor Tensor::index(const std::initializer_list<std::size_t> &index) const {
 
   if (index.size() != m_strides.size()) {
@@ -118,23 +143,18 @@ template <typename T> void Tensor::fill_(T val) {
     throw std::runtime_error("Type T does not match the type of dtype.");
   }
 
-  T *data_ptr = this->data_ptr<T>();
-
-  if (m_contiguous) {
-    std::fill(data_ptr + m_elem_offset, data_ptr + m_elem_offset + m_numel,
-              val);
-  } else {
-    for (std::size_t idx = 0; idx < m_numel; idx++) {
-      std::size_t offset = m_elem_offset;
-      std::size_t tmp = idx;
-      for (std::size_t dim = m_shape.size(); dim-- > 0;) {
-        std::size_t coord = tmp % m_shape[dim];
-        tmp /= m_shape[dim];
-        offset += coord * m_strides[dim];
-      }
-      data_ptr[offset] = val;
+  TensorIterator it(this, {});
+  it.for_each([&](std::uint8_t **data, const std::ptrdiff_t *strides,
+                  std::size_t n) {
+    if (strides[0] == sizeof(T)) {
+      T *ptr = reinterpret_cast<T *>(data[0]);
+      std::fill(ptr, ptr + n, val);
+      return;
     }
-  }
+    std::uint8_t *ptr = data[0];
+    for (std::size_t k = 0; k < n; ++k, ptr += strides[0])
+      *reinterpret_cast<T *>(ptr) = val;
+  });
 };
 
 template void Tensor::fill_(float val);
@@ -144,6 +164,8 @@ template void Tensor::fill_(int64_t val);
 template void Tensor::fill_(uint8_t val);
 template void Tensor::fill_(uint32_t val);
 template void Tensor::fill_(uint64_t val);
+template void Tensor::fill_(torchlet::core::Half val);
+template void Tensor::fill_(torchlet::core::BFloat16 val);
 
 template <typename T>
 void Tensor::assign_(const std::initializer_list<std::size_t> &index, T val) {
@@ -172,6 +194,10 @@ template void Tensor::assign_(const std::initializer_list<std::size_t> &index,
                               uint32_t);
 template void Tensor::assign_(const std::initializer_list<std::size_t> &index,
                               uint64_t);
+template void Tensor::assign_(const std::initializer_list<std::size_t> &index,
+                              torchlet::core::Half);
+template void Tensor::assign_(const std::initializer_list<std::size_t> &index,
+                              torchlet::core::BFloat16);
 
 Tensor Tensor::permute(const std::size_t &idx1, const std::size_t &idx2) const {
 
@@ -199,4 +225,70 @@ Tensor Tensor::view(const std::vector<std::size_t> &new_shape) const {
       torchlet::detail::get_strides(new_shape);
 
   return Tensor(new_shape, new_strides, m_elem_offset, m_dtype, m_storage);
-};
\ No newline at end of file
+};
+
+Tensor Tensor::contiguous() const {
+  if (!m_storage || torchlet::detail::is_dense(m_shape, m_strides))
+    return *this;
+
+  Tensor out(m_shape, m_dtype);
+  return out.copy_(*this);
+};
+
+Tensor Tensor::to(const Dtype &dtype) const {
+  if (dtype == m_dtype)
+    return *this;
+
+  Tensor out(m_shape, dtype);
+  return out.copy_(*this);
+};
+
+Tensor &Tensor::copy_(const Tensor &src) {
+  TensorIterator it(this, {&src});
+
+  DISPATCH_ALL(m_dtype, dst_t, {
+    DISPATCH_ALL(src.dtype(), src_t, {
+      it.parallel_for_each([](std::uint8_t **data,
+                              const std::ptrdiff_t *strides, std::size_t n) {
+        std::uint8_t *dst = data[0];
+        const std::uint8_t *in = data[1];
+        const bool dense =
+            strides[0] == sizeof(dst_t) && strides[1] == sizeof(src_t);
+        if constexpr (std::is_same_v<dst_t, src_t>) {
+          if (dense) {
+            std::memcpy(dst, in, n * sizeof(dst_t));
+            return;
+          }
+        }
+        // float <-> reduced precision goes through the vectorised kernels
+        if constexpr (std::is_same_v<dst_t, float> &&
+                      torchlet::core::is_reduced_float_v<src_t>) {
+          if (dense) {
+            widen_kernel(reinterpret_cast<const src_t *>(in),
+                         reinterpret_cast<float *>(dst), n);
+            return;
+          }
+        }
+        if constexpr (torchlet::core::is_reduced_float_v<dst_t> &&
+                      std::is_same_v<src_t, float>) {
+          if (dense) {
+            narrow_kernel(reinterpret_cast<const float *>(in),
+                          reinterpret_cast<dst_t *>(dst), n);
+            return;
+          }
+        }
+        // reduced types only convert from float
+        using via_t = std::conditional_t<
+            torchlet::core::is_reduced_float_v<dst_t>, float, dst_t>;
+        for (std::size_t k = 0; k < n; ++k) {
+          *reinterpret_cast<dst_t *>(dst) = static_cast<dst_t>(
+              static_cast<via_t>(*reinterpret_cast<const src_t *>(in)));
+          dst += strides[0];
+          in += strides[1];
+        }
+      });
+    });
+  });
+
+  return *this;
+};
@@ -0,0 +1,187 @@
+#include <stdexcept>
+
+#include "detail/helpers.h"
+#include <torchlet/iterator/tensor_iterator.h>
+
+using torchlet::core::Tensor, torchlet::iterator::TensorIterator;
+
+TensorIterator::TensorIterator(
+    Tensor *out, std::initializer_list<const Tensor *const> inputs,
+    bool reorder) {
+  build(out, inputs, reorder, false);
+};
+
+TensorIterator
+TensorIterator::rows(Tensor *out,
+                     std::initializer_list<const Tensor *const> inputs) {
+  TensorIterator it;
+  it.build(out, inputs, true, true);
+  return it;
+};
+
+void TensorIterator::build(Tensor *out,
+                           std::initializer_list<const Tensor *const> inputs,
+                           bool reorder, bool row_mode) {
+
+  m_ntensors = 1 + inputs.size();
+  if (m_ntensors > MAX_OPERANDS)
+    throw std::invalid_argument("TensorIterator supports at most " +
+                                std::to_string(MAX_OPERANDS) + " operands.");
+
+  std::array<const Tensor *, MAX_OPERANDS> ops{};
+  ops[0] = out;
+  std::size_t t = 1;
+  const std::size_t out_nd = out->shape().size();
+  for (const Tensor *in : inputs) {
+    const auto &shape = in->shape();
+    bool ok = shape.size() <= out_nd;
+    for (std::size_t d = 0; ok && d < shape.size(); ++d) {
+      const std::size_t size = shape[d];
+      ok = size == 1 || size == out->shape()[out_nd - shape.size() + d];
+    }
+    if (!ok)
+      throw std::invalid_argument(
+          "TensorIterator input does not broadcast to the output shape.");
+    ops[t++] = in;
+  }
+
+  // operands may differ in dtype (copies, conversions) : byte strides and
+  // offsets use each one's own item size
+  for (t = 0; t < m_ntensors; ++t) {
+    m_itemsizes[t] = torchlet::detail::dtype_size(ops[t]->dtype());
+    if (!ops[t]->storage_ptr())
+      continue;
+    // inputs are only ever read through the loop callback
+    auto *base =
+        const_cast<std::uint8_t *>(ops[t]->data_ptr<std::uint8_t>());
+    m_data[t] = base + ops[t]->elem_offset() * m_itemsizes[t];
+  }
+
+  // byte stride of operand t along output dim d, 0 where it broadcasts
+  auto stride_of = [&](std::size_t op, std::size_t d) -> std::ptrdiff_t {
+    const auto &shape = ops[op]->shape();
+    const std::size_t lead = out_nd - shape.size();
+    if (d < lead || shape[d - lead] == 1)
+      return 0;
+    return static_cast<std::ptrdiff_t>(ops[op]->strides()[d - lead] *
+                                       m_itemsizes[op]);
+  };
+
+  m_row_mode = row_mode;
+  std::size_t nd = out_nd;
+  if (row_mode && nd > 0) {
+    nd--;
+    m_row_size = out->shape()[nd];
+    for (t = 0; t < m_ntensors; ++t)
+      m_row_strides[t] = stride_of(t, nd);
+  }
+
+  // innermost first, size 1 dims dropped
+  m_numel = 1;
+  m_shape.clear();
+  m_strides.clear();
+  for (std::size_t d = nd; d-- > 0;) {
+    const std::size_t size = out->shape()[d];
+    m_numel *= size;
+    if (size == 1)
+      continue;
+    m_shape.push_back(size);
+    for (t = 0; t < m_ntensors; ++t)
+      m_strides.push_back(stride_of(t, d));
+  }
+  if (m_row_size == 0)
+    m_numel = 0;
+
+  if (reorder)
+    reorder_dims();
+  coalesce_dims();
+
+  if (m_shape.empty()) {
+    m_shape.push_back(1);
+    m_strides.assign(m_ntensors, 0);
+  }
+  if (m_shape.size() > MAX_DIMS)
+    throw std::invalid_argument("TensorIterator supports at most " +
+                                std::to_string(MAX_DIMS) +
+                                " non-coalescable dims.");
+};
+
+void TensorIterator::reorder_dims() {
+  const std::size_t nd = m_shape.size();
+  const std::size_t nt = m_ntensors;
+
+  // True when dim b should run inside dim a : the first operand whose
+  // strides differ decides, broadcast (0) strides do not vote.
+  auto inner_first = [&](std::size_t a, std::size_t b) {
+    for (std::size_t t = 0; t < nt; ++t) {
+      const std::ptrdiff_t sa = m_strides[a * nt + t];
+      const std::ptrdiff_t sb = m_strides[b * nt + t];
+      if (sa == 0 || sb == 0 || sa == sb)
+        continue;
+      return sb < sa;
+    }
+    return false;
+  };
+
+  std::vector<std::size_t> perm(nd);
+  for (std::size_t d = 0; d < nd; ++d)
+    perm[d] = d;
+
+  // insertion sort : stable, and nd is tiny
+  for (std::size_t i = 1; i < nd; ++i)
+    for (std::size_t j = i; j > 0 && inner_first(perm[j - 1], perm[j]); --j)
+      std::swap(perm[j - 1], perm[j]);
+
+  std::vector<std::size_t> shape(nd);
+  std::vector<std::ptrdiff_t> strides(nd * nt);
+  for (std::size_t d = 0; d < nd; ++d) {
+    shape[d] = m_shape[perm[d]];
+    for (std::size_t t = 0; t < nt; ++t)
+      strides[d * nt + t] = m_strides[perm[d] * nt + t];
+  }
+  m_shape = std::move(shape);
+  m_strides = std::move(strides);
+};
+
+void TensorIterator::coalesce_dims() {
+  const std::size_t nd = m_shape.size();
+  const std::size_t nt = m_ntensors;
+  if (nd < 2)
+    return;
+
+  std::size_t cur = 0;
+  for (std::size_t d = 1; d < nd; ++d) {
+    bool mergeable = true;
+    for (std::size_t t = 0; t < nt && mergeable; ++t)
+      mergeable = m_strides[d * nt + t] ==
+                  m_strides[cur * nt + t] *
+                      static_cast<std::ptrdiff_t>(m_shape[cur]);
+
+    if (mergeable) {
+      m_shape[cur] *= m_shape[d];
+      continue;
+    }
+    cur++;
+    m_shape[cur] = m_shape[d];
+    for (std::size_t t = 0; t < nt; ++t)
+      m_strides[cur * nt + t] = m_strides[d * nt + t];
+  }
+  m_shape.resize(cur + 1);
+  m_strides.resize((cur + 1) * nt);
+};
+
+bool TensorIterator::is_contiguous() const noexcept {
+  if (m_shape.size() != 1)
+    return false;
+
+  for (std::size_t t = 0; t < m_ntensors; ++t) {
+    const std::ptrdiff_t item = static_cast<std::ptrdiff_t>(m_itemsizes[t]);
+    const std::ptrdiff_t step =
+        item * static_cast<std::ptrdiff_t>(m_row_mode ? m_row_size : 1);
+    if (m_row_mode && m_row_size > 1 && m_row_strides[t] != item)
+      return false;
+    if (m_shape[0] > 1 && m_strides[t] != step)
+      return false;
+  }
+  return true;
+};
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+#include "utils/utils.h"
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::core::Arena,
+    torchlet::core::ArenaGuard, torchlet::core::CachingAllocator;
+
+static bool is_aligned(const void *ptr) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % torchlet::core::ALIGNMENT ==
+         0;
+};
+
+TEST(AllocatorTest, TensorDataIsAligned) {
+  for (std::size_t n : {1u, 3u, 17u, 1000u, 4097u}) {
+    Tensor t({n}, Dtype::Float32);
+    EXPECT_TRUE(is_aligned(t.storage_ptr()->data)) << "n=" << n;
+  }
+};
+
+TEST(AllocatorTest, RoundSizeClasses) {
+  EXPECT_EQ(CachingAllocator::round_size(0), 64u);
+  EXPECT_EQ(CachingAllocator::round_size(65), 128u);
+  EXPECT_EQ(CachingAllocator::round_size(256), 256u);
+  EXPECT_EQ(CachingAllocator::round_size(257), 320u);
+  EXPECT_EQ(CachingAllocator::round_size(1000), 1024u);
+  EXPECT_EQ(CachingAllocator::round_size(1025), 1280u);
+};
+
+TEST(AllocatorTest, CachingReusesFreedBlocks) {
+  CachingAllocator alloc;
+
+  void *a = alloc.allocate(1000);
+  alloc.deallocate(a, 1000);
+  void *b = alloc.allocate(900); // same size class
+  EXPECT_EQ(a, b);
+
+  auto stats = alloc.stats();
+  EXPECT_EQ(stats.n_fresh, 1u);
+  EXPECT_EQ(stats.n_reused, 1u);
+  EXPECT_EQ(stats.allocated_bytes, 1024u);
+
+  alloc.deallocate(b, 900);
+  EXPECT_EQ(alloc.stats().cached_bytes, 1024u);
+  alloc.empty_cache();
+  EXPECT_EQ(alloc.stats().cached_bytes, 0u);
+};
+
+TEST(AllocatorTest, ArenaGuardRoutesAllocations) {
+  Arena arena(1 << 12);
+  {
+    ArenaGuard guard(arena);
+    EXPECT_EQ(torchlet::core::get_allocator(), &arena);
+
+    Tensor a({10}, Dtype::Float32);
+    Tensor b({300}, Dtype::Float64);
+    EXPECT_TRUE(is_aligned(a.storage_ptr()->data));
+    EXPECT_TRUE(is_aligned(b.storage_ptr()->data));
+    EXPECT_EQ(arena.live(), 2u);
+    EXPECT_THROW(arena.reset(), std::runtime_error);
+  }
+  EXPECT_NE(torchlet::core::get_allocator(), &arena);
+  EXPECT_EQ(arena.live(), 0u);
+
+  const std::size_t capacity = arena.capacity();
+  arena.reset();
+  void *first = nullptr;
+  {
+    ArenaGuard guard(arena);
+    Tensor c({10}, Dtype::Float32);
+    first = c.storage_ptr()->data;
+  }
+  arena.reset();
+  {
+    ArenaGuard guard(arena);
+    Tensor d({10}, Dtype::Float32);
+    EXPECT_EQ(d.storage_ptr()->data, first); // same slot after rewind
+  }
+  EXPECT_EQ(arena.capacity(), capacity);
+};
+
+TEST(AllocatorTest, ArenaOpsMatchHeap) {
+  Tensor x = Tensor::ones({8, 33}, Dtype::Float32);
+  Tensor expected = torchlet::ops::gelu(x);
+
+  Arena arena;
+  for (int it = 0; it < 3; ++it) {
+    ArenaGuard guard(arena);
+    Tensor y = torchlet::ops::gelu(x);
+    for (std::size_t i = 0; i < y.numel(); ++i)
+      EXPECT_FLOAT_EQ(y.data_ptr<float>()[i], expected.data_ptr<float>()[i]);
+  }
+  arena.reset();
+};
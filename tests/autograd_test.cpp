@@ -0,0 +1,256 @@
+#include "utils/utils.h"
+#include <cmath>
+#include <functional>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::module::Linear,
+    torchlet::module::Sequential;
+
+namespace {
+
+Tensor randn(const std::vector<size_t> &shape) {
+  Tensor t(shape, Dtype::Float64);
+  torchlet::ops::init::normal_(t, 0.0, 1.0);
+  return t;
+};
+
+double dot(const Tensor &a, const Tensor &b) {
+  double s = 0;
+  for (size_t i = 0; i < a.numel(); ++i)
+    s += a.data_ptr<double>()[i] * b.data_ptr<double>()[i];
+  return s;
+};
+
+// Central differences of L = <f(), r> with respect to every element of t,
+// against the gradient backward left in t.grad().
+void expect_grad(const std::function<Tensor()> &f, const Tensor &r, Tensor &t,
+                 const char *what) {
+  const Tensor g = t.grad();
+  ASSERT_EQ(g.shape(), t.shape()) << what;
+  torchlet::core::NoGradGuard guard;
+  double *p = t.data_ptr<double>();
+  for (size_t i = 0; i < t.numel(); ++i) {
+    const double v = p[i], h = 1e-6;
+    p[i] = v + h;
+    const double lp = dot(f(), r);
+    p[i] = v - h;
+    const double lm = dot(f(), r);
+    p[i] = v;
+    EXPECT_NEAR(g.data_ptr<double>()[i], (lp - lm) / (2 * h), 1e-6)
+        << what << " i=" << i;
+  }
+};
+
+} // namespace
+
+TEST(AutogradTest, LinearAndActivationsMatchFiniteDifferences) {
+  using torchlet::ops::linear;
+  using Forward = std::function<Tensor(Tensor &, Tensor &, Tensor &)>;
+  torchlet::core::Generator gen; // reseeded so every forward keeps one mask
+  const std::vector<std::pair<const char *, Forward>> cases = {
+    {"linear", [](Tensor &x, Tensor &w, Tensor &b) {
+       return linear(x, w, b);
+     }},
+    {"linear_relu", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::linear_relu(x, w, b);
+     }},
+    {"linear_gelu", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::linear_gelu(x, w, b);
+     }},
+    {"linear_gelu_dropout", [&gen](Tensor &x, Tensor &w, Tensor &b) {
+       gen.manual_seed(3u);
+       return torchlet::ops::linear_gelu_dropout(x, w, b, 0.3, gen);
+     }},
+    {"linear_bias_softmax", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::linear_bias_softmax(x, w, b);
+     }},
+    {"gelu", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::gelu(linear(x, w, b));
+     }},
+    {"relu", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::relu(linear(x, w, b));
+     }},
+    {"softmax", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::softmax(linear(x, w, b));
+     }},
+    {"log_softmax", [](Tensor &x, Tensor &w, Tensor &b) {
+       return torchlet::ops::log_softmax(linear(x, w, b));
+     }},
+    {"dropout", [&gen](Tensor &x, Tensor &w, Tensor &b) {
+       gen.manual_seed(3u);
+       return torchlet::ops::dropout(linear(x, w, b), 0.3, gen);
+     }},
+  };
+
+  for (const auto &[name, f] : cases) {
+    Tensor x = randn({2, 3, 5}).requires_grad_();
+    Tensor w = randn({4, 5}).requires_grad_();
+    Tensor b = randn({4}).requires_grad_();
+    const Tensor r = randn({2, 3, 4});
+
+    Tensor y = f(x, w, b);
+    EXPECT_TRUE(y.requires_grad());
+    torchlet::core::backward(y, r);
+    EXPECT_EQ(torchlet::core::tape_size(), 0u);
+
+    auto again = [&, &f = f] { return f(x, w, b); };
+    expect_grad(again, r, x, name);
+    expect_grad(again, r, w, name);
+    expect_grad(again, r, b, name);
+  }
+};
+
+TEST(AutogradTest, CrossEntropyMatchesFiniteDifferences) {
+  Tensor x = randn({4, 5}).requires_grad_();
+  Tensor w = randn({7, 5}).requires_grad_();
+  Tensor b = randn({7}).requires_grad_();
+  Tensor targets({4}, Dtype::Int64);
+  const int64_t t[] = {0, 6, 3, 3};
+  for (size_t i = 0; i < 4; ++i)
+    targets.data_ptr<int64_t>()[i] = t[i];
+
+  auto f = [&] {
+    return torchlet::ops::cross_entropy(torchlet::ops::linear(x, w, b),
+                                        targets);
+  };
+  // against the mean of -log_softmax gathered at the targets
+  double ref = 0;
+  {
+    torchlet::core::NoGradGuard guard;
+    const Tensor lp =
+        torchlet::ops::log_softmax(torchlet::ops::linear(x, w, b));
+    for (size_t i = 0; i < 4; ++i)
+      ref -= lp.data_ptr<double>()[i * 7 + size_t(t[i])] / 4;
+  }
+  Tensor loss = f();
+  ASSERT_EQ(loss.shape(), std::vector<size_t>{1});
+  EXPECT_NEAR(loss.data_ptr<double>()[0], ref, 1e-12);
+
+  const Tensor r = randn({1});
+  torchlet::core::backward(loss, r);
+  expect_grad(f, r, x, "cross_entropy");
+  expect_grad(f, r, w, "cross_entropy");
+  expect_grad(f, r, b, "cross_entropy");
+
+  targets.data_ptr<int64_t>()[2] = 7;
+  EXPECT_THROW(torchlet::ops::cross_entropy(x, targets),
+               std::invalid_argument);
+};
+
+TEST(AutogradTest, GradientsAccumulateUntilZeroGrad) {
+  Tensor x = randn({3, 4});
+  Linear lin(4, 2, true, Dtype::Float64);
+  lin.requires_grad_();
+  const Tensor r = randn({3, 2});
+
+  torchlet::core::backward(lin.forward(x), r);
+  const Tensor once = lin.weights().grad();
+  std::vector<double> first(once.data_ptr<double>(),
+                            once.data_ptr<double>() + once.numel());
+
+  // two more passes add to the same buffer
+  Tensor y = lin.forward(x);
+  torchlet::core::backward(torchlet::ops::relu(y), r);
+  torchlet::core::backward(lin.forward(x), r);
+  const Tensor acc = lin.weights().grad();
+  EXPECT_EQ(acc.data_ptr<double>(), once.data_ptr<double>()); // in place
+
+  lin.weights().zero_grad();
+  EXPECT_EQ(lin.weights().grad().storage_ptr(), nullptr);
+  torchlet::core::backward(lin.forward(x), r);
+  for (size_t i = 0; i < first.size(); ++i)
+    EXPECT_NEAR(lin.weights().grad().data_ptr<double>()[i], first[i], 1e-12);
+
+  // intermediates give their gradient back once their node ran
+  Tensor h = lin.forward(x);
+  Tensor out = torchlet::ops::gelu(h);
+  torchlet::core::backward(out, randn({3, 2}));
+  EXPECT_EQ(h.grad().storage_ptr(), nullptr);
+  EXPECT_EQ(x.grad().storage_ptr(), nullptr); // x does not require grad
+};
+
+TEST(AutogradTest, SeparateGraphsKeepTheirHistory) {
+  Linear l1(4, 2, true, Dtype::Float64), l2(4, 3, false, Dtype::Float64);
+  l1.requires_grad_();
+  l2.requires_grad_();
+  const Tensor x = randn({3, 4});
+  const Tensor r1 = randn({3, 2}), r2 = randn({3, 3});
+
+  // both recorded before either backward
+  Tensor y1 = l1.forward(x);
+  Tensor y2 = torchlet::ops::gelu(l2.forward(x));
+  torchlet::core::backward(y1, r1);
+  EXPECT_EQ(l2.weights().grad().storage_ptr(), nullptr);
+  EXPECT_EQ(torchlet::core::tape_size(), 2u);
+  torchlet::core::backward(y2, r2);
+  EXPECT_EQ(torchlet::core::tape_size(), 0u);
+  ASSERT_NE(l2.weights().grad().storage_ptr(), nullptr);
+
+  // the same gradient as a graph recorded on its own
+  const Tensor g = l2.weights().grad().contiguous();
+  l2.weights().zero_grad();
+  torchlet::core::backward(torchlet::ops::gelu(l2.forward(x)), r2);
+  for (size_t i = 0; i < g.numel(); ++i)
+    EXPECT_EQ(l2.weights().grad().data_ptr<double>()[i],
+              g.data_ptr<double>()[i]);
+
+  // y2's graph ran : a second backward has nothing to replay
+  EXPECT_THROW(torchlet::core::backward(y2, r2), std::runtime_error);
+
+  // a graph nobody can reach any more leaves the tape on the next backward
+  { Tensor dead = l2.forward(x); }
+  torchlet::core::backward(l1.forward(x), r1);
+  EXPECT_EQ(torchlet::core::tape_size(), 0u);
+};
+
+TEST(AutogradTest, NoGradAndErrors) {
+  Linear lin(4, 2, true, Dtype::Float64);
+  lin.requires_grad_();
+  {
+    torchlet::core::NoGradGuard guard;
+    Tensor y = lin.forward(randn({3, 4}));
+    EXPECT_FALSE(y.requires_grad());
+    EXPECT_EQ(torchlet::core::tape_size(), 0u);
+  }
+
+  Tensor y = lin.forward(randn({3, 4}));
+  EXPECT_EQ(torchlet::core::tape_size(), 1u);
+  // several elements : the seed must be given
+  EXPECT_THROW(torchlet::core::backward(y), std::runtime_error);
+  torchlet::core::clear_tape();
+  EXPECT_THROW(torchlet::core::backward(randn({1})), std::runtime_error);
+};
+
+TEST(AutogradTest, SequentialRecordsWhenTraining) {
+  Linear l1(6, 8, true, Dtype::Float64), l2(8, 3, false, Dtype::Float64);
+  Sequential seq;
+  seq.add(l1).add(Activation::GELU).add(l2).add(Activation::Softmax);
+  seq.requires_grad_();
+  ASSERT_EQ(seq.parameters().size(), 3u);
+
+  const Tensor x = randn({5, 6}), r = randn({5, 3});
+  torchlet::core::backward(seq.forward(x), r);
+
+  // the same network through the ops, on copies of the parameters
+  std::vector<Tensor> ref;
+  for (const Tensor &p : seq.parameters()) {
+    Tensor c(p.shape(), p.dtype());
+    ref.push_back(c.copy_(p).requires_grad_());
+  }
+  Tensor y = torchlet::ops::softmax(torchlet::ops::linear(
+      torchlet::ops::linear_gelu(x, ref[0], ref[1]), ref[2], Tensor()));
+  torchlet::core::backward(y, r);
+
+  const std::vector<Tensor> params = seq.parameters();
+  for (size_t k = 0; k < params.size(); ++k)
+    for (size_t i = 0; i < params[k].numel(); ++i)
+      EXPECT_NEAR(params[k].grad().data_ptr<double>()[i],
+                  ref[k].grad().data_ptr<double>()[i], 1e-10)
+          << "param " << k << " i=" << i;
+
+  // inference still takes the planned path
+  torchlet::core::NoGradGuard guard;
+  EXPECT_FALSE(seq.forward(x).requires_grad());
+};
@@ -0,0 +1,247 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "utils/utils.h"
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::io::TensorDict;
+
+static std::string temp_path(const char *name) {
+  return ::testing::TempDir() + "torchlet_" + name + ".ckpt";
+};
+
+// Every dtype converts exactly to double.
+static void expect_same(const Tensor &a, const Tensor &b) {
+  ASSERT_EQ(a.shape(), b.shape());
+  ASSERT_EQ(a.dtype(), b.dtype());
+  const Tensor da = a.to(Dtype::Float64).contiguous();
+  const Tensor db = b.to(Dtype::Float64).contiguous();
+  for (std::size_t k = 0; k < da.numel(); ++k)
+    EXPECT_EQ(da.data_ptr<double>()[da.elem_offset() + k],
+              db.data_ptr<double>()[db.elem_offset() + k]);
+};
+
+TEST(CheckpointTest, RoundTripIsAlignedAndZeroCopy) {
+  Tensor f({3, 5}, Dtype::Float32);
+  torchlet::ops::init::uniform_(f, -1.0f, 1.0f);
+  Tensor d({7}, Dtype::Float64);
+  torchlet::ops::init::normal_(d, 0.0, 1.0);
+  Tensor h({2, 3}, Dtype::Float16);
+  torchlet::ops::init::uniform_(h, -1.0f, 1.0f);
+  Tensor u({5}, Dtype::UInt8);
+  u.fill_(std::uint8_t{7});
+  Tensor i = Tensor::zeros({0}, Dtype::Int64);
+  // strided view, stored dense
+  Tensor view = f.permute(0, 1);
+
+  const std::string path = temp_path("roundtrip");
+  torchlet::io::save(path, {{"f", f}, {"d", d}, {"h", h}, {"u", u},
+                            {"i", i}, {"view", view}});
+
+  TensorDict loaded = torchlet::io::load(path);
+  ASSERT_EQ(loaded.size(), 6u);
+  expect_same(loaded.at("f"), f);
+  expect_same(loaded.at("d"), d);
+  expect_same(loaded.at("h"), h);
+  expect_same(loaded.at("u"), u);
+  expect_same(loaded.at("i"), i);
+  expect_same(loaded.at("view"), view);
+
+  for (const auto &[name, t] : loaded) {
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(t.storage_ptr()->data) %
+                  torchlet::core::ALIGNMENT,
+              0u)
+        << name;
+    EXPECT_NE(t.storage_ptr(), f.storage_ptr());
+  }
+  std::remove(path.c_str());
+};
+
+TEST(CheckpointTest, TensorsOutliveDictAndWriteInPlace) {
+  Tensor w({4, 4}, Dtype::Float32);
+  w.fill_(2.0f);
+  const std::string path = temp_path("outlive");
+  torchlet::io::save(path, {{"w", w}});
+
+  Tensor kept;
+  {
+    TensorDict loaded = torchlet::io::load(path);
+    kept = loaded.at("w");
+  }
+  // the mapping lives as long as its tensors; writes stay private
+  kept.fill_(3.0f);
+  EXPECT_EQ(kept.data_ptr<float>()[15], 3.0f);
+  expect_same(torchlet::io::load(path).at("w"), w);
+  std::remove(path.c_str());
+};
+
+TEST(CheckpointTest, LinearStateDict) {
+  torchlet::module::Linear lin(6, 3, true, Dtype::Float32);
+  const std::string path = temp_path("linear");
+  torchlet::io::save(path, lin.state_dict());
+
+  torchlet::module::Linear other(6, 3, true, Dtype::Float32);
+  other.load_state_dict(torchlet::io::load(path));
+  expect_same(other.weights(), lin.weights());
+  expect_same(other.bias(), lin.bias());
+
+  Tensor x({2, 6}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+  expect_same(other.forward(x), lin.forward(x));
+
+  torchlet::module::Linear wrong(5, 3, true, Dtype::Float32);
+  EXPECT_THROW(wrong.load_state_dict(torchlet::io::load(path)),
+               std::invalid_argument);
+  std::remove(path.c_str());
+};
+
+TEST(CheckpointTest, RejectsBadFiles) {
+  EXPECT_THROW(torchlet::io::load(temp_path("missing")), std::runtime_error);
+
+  const std::string path = temp_path("bad");
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "not a checkpoint at all";
+  }
+  EXPECT_THROW(torchlet::io::load(path), std::runtime_error);
+
+  // truncated data block
+  Tensor t({64}, Dtype::Float64);
+  t.fill_(1.0);
+  torchlet::io::save(path, {{"t", t}});
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), {});
+  in.close();
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 64));
+  }
+  EXPECT_THROW(torchlet::io::load(path), std::runtime_error);
+
+  // header fields of the single entry "t" : ndim at 33, the dims from 37
+  Tensor m({1, 4}, Dtype::Float32);
+  m.fill_(1.0f);
+  torchlet::io::save(path, {{"t", m}});
+  std::ifstream in2(path, std::ios::binary);
+  const std::string good((std::istreambuf_iterator<char>(in2)), {});
+  in2.close();
+  auto patch = [&](std::size_t at, auto v) {
+    std::string b = good;
+    std::memcpy(&b[at], &v, sizeof(v));
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(b.data(), static_cast<std::streamsize>(b.size()));
+  };
+  EXPECT_EQ(torchlet::io::load(path).at("t").shape(), m.shape());
+  patch(33, std::uint32_t{0xffffffffu}); // more dims than the header holds
+  EXPECT_THROW(torchlet::io::load(path), std::runtime_error);
+  patch(37, (std::uint64_t{1} << 62) + 1); // 16 bytes once wrapped
+  EXPECT_THROW(torchlet::io::load(path), std::runtime_error);
+  std::remove(path.c_str());
+};
+
+TEST(SafetensorsTest, RoundTripWithMetadata) {
+  Tensor u({3}, Dtype::UInt8);
+  u.fill_(std::uint8_t{9});
+  Tensor d({2, 2}, Dtype::Float64);
+  torchlet::ops::init::normal_(d, 0.0, 1.0);
+  Tensor b({5}, Dtype::BFloat16);
+  torchlet::ops::init::uniform_(b, -1.0f, 1.0f);
+
+  const std::string path = temp_path("st_roundtrip");
+  torchlet::io::save_safetensors(path, {{"u", u}, {"d", d}, {"b\"q", b}},
+                                 {{"format", "pt"}});
+
+  std::map<std::string, std::string> metadata;
+  TensorDict loaded = torchlet::io::load_safetensors(path, &metadata);
+  EXPECT_EQ(metadata.at("format"), "pt");
+  ASSERT_EQ(loaded.size(), 3u);
+  expect_same(loaded.at("u"), u);
+  expect_same(loaded.at("d"), d);
+  expect_same(loaded.at("b\"q"), b);
+  // largest items first from an aligned data region
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(
+                loaded.at("d").storage_ptr()->data) %
+                torchlet::core::ALIGNMENT,
+            0u);
+  std::remove(path.c_str());
+};
+
+TEST(SafetensorsTest, ReadsForeignLayout) {
+  // Header as another writer may lay it out : whitespace, metadata last,
+  // unknown keys, and a Float32 tensor at an odd offset.
+  std::string json =
+      "{ \"u\": {\"dtype\": \"U8\", \"shape\": [1], \"data_offsets\": [0, 1]},"
+      " \"w\": {\"shape\": [2], \"dtype\": \"F32\", \"data_offsets\": [1, 9],"
+      " \"extra\": [true, null, {\"x\": -1.5}]},"
+      " \"__metadata__\": {\"name\": \"caf\\u00e9\"} }";
+  while ((sizeof(std::uint64_t) + json.size() + 1) % 4 != 1)
+    json += ' ';
+  const std::uint64_t size = json.size();
+  const float w[2] = {1.5f, -2.0f};
+
+  const std::string path = temp_path("st_foreign");
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out << json;
+    out.put(7);
+    out.write(reinterpret_cast<const char *>(w), sizeof(w));
+  }
+
+  std::map<std::string, std::string> metadata;
+  TensorDict loaded = torchlet::io::load_safetensors(path, &metadata);
+  EXPECT_EQ(metadata.at("name"), "caf\xc3\xa9");
+  EXPECT_EQ(loaded.at("u").data_ptr<std::uint8_t>()[0], 7);
+  const Tensor &tw = loaded.at("w");
+  EXPECT_EQ(tw.shape(), std::vector<std::size_t>{2});
+  EXPECT_EQ(tw.data_ptr<float>()[0], 1.5f);
+  EXPECT_EQ(tw.data_ptr<float>()[1], -2.0f);
+  std::remove(path.c_str());
+};
+
+TEST(SafetensorsTest, LinearByPrefix) {
+  torchlet::module::Linear lin(4, 3, true, Dtype::Float32);
+  TensorDict state;
+  for (const auto &[name, t] : lin.state_dict())
+    state.emplace("fc1." + name, t.to(Dtype::BFloat16));
+
+  const std::string path = temp_path("st_linear");
+  torchlet::io::save_safetensors(path, state);
+
+  torchlet::module::Linear other(4, 3, true, Dtype::Float32);
+  other.load_state_dict(torchlet::io::load_safetensors(path), "fc1.");
+  EXPECT_EQ(other.weights().dtype(), Dtype::Float32);
+  expect_same(other.weights(),
+              lin.weights().to(Dtype::BFloat16).to(Dtype::Float32));
+  EXPECT_THROW(other.load_state_dict(torchlet::io::load_safetensors(path)),
+               std::invalid_argument);
+  std::remove(path.c_str());
+};
+
+TEST(SafetensorsTest, RejectsBadHeaders) {
+  const std::string path = temp_path("st_bad");
+  auto write = [&](const std::string &json, std::size_t data) {
+    const std::uint64_t size = json.size();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out << json << std::string(data, '\0');
+  };
+
+  write("{\"a\":{\"dtype\":\"I8\",\"shape\":[1],\"data_offsets\":[0,1]}}", 1);
+  EXPECT_THROW(torchlet::io::load_safetensors(path), std::runtime_error);
+  write("{\"a\":{\"dtype\":\"F32\",\"shape\":[2],\"data_offsets\":[0,8]}}", 4);
+  EXPECT_THROW(torchlet::io::load_safetensors(path), std::runtime_error);
+  write("{\"a\":{\"dtype\":\"F32\",\"shape\":[1],\"data_offsets\":[0,4]}", 4);
+  EXPECT_THROW(torchlet::io::load_safetensors(path), std::runtime_error);
+  // 16 bytes once the byte count wraps around
+  write("{\"a\":{\"dtype\":\"F32\",\"shape\":[4611686018427387905,4],"
+        "\"data_offsets\":[0,16]}}",
+        16);
+  EXPECT_THROW(torchlet::io::load_safetensors(path), std::runtime_error);
+  std::remove(path.c_str());
+};
@@ -0,0 +1,491 @@
+#include "utils/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::module::Linear, torchlet::core::Dtype;
+
+template <typename T> class FunctionalTypedTest : public ::testing::Test {};
+using MyTypes = ::testing::Types<float, double>;
+TYPED_TEST_SUITE(FunctionalTypedTest, MyTypes);
+
+TYPED_TEST(FunctionalTypedTest, OutMatchesAllocating) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const size_t B = 6, in = 19, out = 23;
+
+  Linear lin(in, out, true, dt);
+  Tensor x({B, in}, dt);
+  torchlet::ops::init::normal_(x, T{0}, T{1});
+
+  Tensor y({B, out}, dt), g({B, out}, dt), s({B, out}, dt), l({B, out}, dt);
+  Tensor &ry = lin.forward_out(x, y);
+  EXPECT_EQ(ry.data_ptr<T>(), y.data_ptr<T>());
+  torchlet::ops::gelu_out(y, g);
+  torchlet::ops::softmax_out(y, s);
+  torchlet::ops::log_softmax_out(y, l);
+
+  Tensor ey = lin.forward(x);
+  expect_array_equal(y.data_ptr<T>(), ey.data_ptr<T>(), y.numel());
+  expect_array_equal(g.data_ptr<T>(), torchlet::ops::gelu(ey).data_ptr<T>(),
+                     g.numel());
+  expect_array_equal(s.data_ptr<T>(), torchlet::ops::softmax(ey).data_ptr<T>(),
+                     s.numel());
+  expect_array_equal(l.data_ptr<T>(),
+                     torchlet::ops::log_softmax(ey).data_ptr<T>(), l.numel());
+};
+
+TYPED_TEST(FunctionalTypedTest, InPlaceMatchesAllocating) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  Tensor x({5, 37}, dt);
+  torchlet::ops::init::normal_(x, T{0}, T{2});
+
+  Tensor eg = torchlet::ops::gelu(x);
+  Tensor es = torchlet::ops::softmax(x);
+  Tensor el = torchlet::ops::log_softmax(x);
+
+  Tensor a = torchlet::ops::log_softmax(el); // log_softmax is idempotent
+  torchlet::ops::log_softmax_(el);
+  expect_array_equal(el.data_ptr<T>(), a.data_ptr<T>(), el.numel());
+
+  Tensor g = Tensor::zeros({5, 37}, dt);
+  std::copy(x.data_ptr<T>(), x.data_ptr<T>() + x.numel(), g.data_ptr<T>());
+  Tensor s = Tensor::zeros({5, 37}, dt);
+  std::copy(x.data_ptr<T>(), x.data_ptr<T>() + x.numel(), s.data_ptr<T>());
+
+  Tensor &rg = torchlet::ops::gelu_(g);
+  EXPECT_EQ(rg.data_ptr<T>(), g.data_ptr<T>());
+  torchlet::ops::softmax_(s);
+
+  expect_array_equal(g.data_ptr<T>(), eg.data_ptr<T>(), g.numel());
+  expect_array_equal(s.data_ptr<T>(), es.data_ptr<T>(), s.numel());
+};
+
+TYPED_TEST(FunctionalTypedTest, FusedLinearMatchesUnfused) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const size_t in = 40, out = 70;
+
+  Linear lin(in, out, true, dt);
+  const Tensor &W = lin.weights(), &b = lin.bias();
+
+  for (size_t B : {size_t{1}, size_t{9}}) { // GEMV and GEMM paths
+    Tensor x({B, in}, dt);
+    torchlet::ops::init::normal_(x, T{0}, T{1});
+    Tensor y = torchlet::ops::linear(x, W, b);
+
+    Tensor g = torchlet::ops::linear_gelu(x, W, b);
+    Tensor eg = torchlet::ops::gelu(y);
+    Tensor s = torchlet::ops::linear_bias_softmax(x, W, b);
+    Tensor es = torchlet::ops::softmax(y);
+    Tensor r = torchlet::ops::linear_relu(x, W, b);
+
+    for (size_t i = 0; i < y.numel(); ++i) {
+      const T yi = y.data_ptr<T>()[i];
+      EXPECT_NEAR(g.data_ptr<T>()[i], eg.data_ptr<T>()[i], T(1e-5));
+      EXPECT_NEAR(s.data_ptr<T>()[i], es.data_ptr<T>()[i], T(1e-5));
+      EXPECT_NEAR(r.data_ptr<T>()[i], yi > T{0} ? yi : T{0}, T(1e-5));
+    }
+  }
+};
+
+TYPED_TEST(FunctionalTypedTest, MatmulBroadcastsAndReadsViews) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const size_t m = 9, k = 21, n = 14;
+
+  // a [2, 1, m, k] against b [3, k, n], b given as the transpose of a
+  // dense [3, n, k] tensor.
+  Tensor a({2, 1, m, k}, dt), bt({3, n, k}, dt);
+  torchlet::ops::init::normal_(a, T{0}, T{1});
+  torchlet::ops::init::normal_(bt, T{0}, T{1});
+  Tensor b = bt.permute(1, 2);
+
+  Tensor c = torchlet::ops::matmul(a, b);
+  ASSERT_EQ(c.shape(), (std::vector<size_t>{2, 3, m, n}));
+
+  const T *pa = a.data_ptr<T>(), *pb = bt.data_ptr<T>(), *pc = c.data_ptr<T>();
+  for (size_t i0 = 0; i0 < 2; ++i0)
+    for (size_t i1 = 0; i1 < 3; ++i1)
+      for (size_t i = 0; i < m; ++i)
+        for (size_t j = 0; j < n; ++j) {
+          T acc{0};
+          for (size_t l = 0; l < k; ++l)
+            acc += pa[(i0 * m + i) * k + l] * pb[(i1 * n + j) * k + l];
+          EXPECT_NEAR(pc[((i0 * 3 + i1) * m + i) * n + j], acc, T(1e-4));
+        }
+
+  Tensor out({2, 3, m, n}, dt);
+  torchlet::ops::matmul_out(a, b, out);
+  expect_array_equal(out.data_ptr<T>(), pc, out.numel());
+
+  Tensor wrong({3, k + 1, n}, dt);
+  EXPECT_THROW(torchlet::ops::matmul(a, wrong), std::invalid_argument);
+};
+
+TYPED_TEST(FunctionalTypedTest, AttentionMatchesNaive) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  // Several query and key tiles with tails, k / v shared by both heads.
+  const size_t H = 2, Lq = 70, Lk = 150, d = 24, dv = 16;
+
+  Tensor q({3, H, Lq, d}, dt), k({3, 1, Lk, d}, dt), v({3, 1, Lk, dv}, dt);
+  torchlet::ops::init::normal_(q, T{0}, T{1});
+  torchlet::ops::init::normal_(k, T{0}, T{1});
+  torchlet::ops::init::normal_(v, T{0}, T{1});
+  const T *pq = q.data_ptr<T>(), *pk = k.data_ptr<T>(), *pv = v.data_ptr<T>();
+
+  for (bool causal : {false, true}) {
+    Tensor o = torchlet::ops::scaled_dot_product_attention(q, k, v, causal);
+    ASSERT_EQ(o.shape(), (std::vector<size_t>{3, H, Lq, dv}));
+    const T *po = o.data_ptr<T>();
+
+    std::vector<T> s(Lk);
+    for (size_t b = 0; b < 3; ++b)
+      for (size_t h = 0; h < H; ++h)
+        for (size_t i = 0; i < Lq; ++i) {
+          const T *qi = pq + ((b * H + h) * Lq + i) * d;
+          const size_t n = causal ? std::min(Lk, i + 1) : Lk;
+          T mx = std::numeric_limits<T>::lowest(), sum{0};
+          for (size_t j = 0; j < n; ++j) {
+            T dot{0};
+            for (size_t c = 0; c < d; ++c)
+              dot += qi[c] * pk[(b * Lk + j) * d + c];
+            s[j] = dot / std::sqrt(T(d));
+            mx = std::max(mx, s[j]);
+          }
+          for (size_t j = 0; j < n; ++j)
+            sum += s[j] = std::exp(s[j] - mx);
+          for (size_t c = 0; c < dv; ++c) {
+            T acc{0};
+            for (size_t j = 0; j < n; ++j)
+              acc += s[j] * pv[(b * Lk + j) * dv + c];
+            EXPECT_NEAR(po[((b * H + h) * Lq + i) * dv + c], acc / sum,
+                        T(1e-5))
+                << "causal=" << causal << " i=" << i;
+          }
+        }
+  }
+
+  Tensor wrong({3, 1, Lk + 1, dv}, dt);
+  EXPECT_THROW(torchlet::ops::scaled_dot_product_attention(q, k, wrong),
+               std::invalid_argument);
+};
+
+TYPED_TEST(FunctionalTypedTest, NormsMatchNaive) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const size_t rows = 6, m = 45;
+
+  // Rows centred far from 0 : a naive sum of squares would cancel.
+  Tensor x({2, 3, m}, dt), res({2, 3, m}, dt), w({m}, dt), b({m}, dt);
+  torchlet::ops::init::normal_(x, T{500}, T{2});
+  torchlet::ops::init::normal_(res, T{0}, T{1});
+  torchlet::ops::init::normal_(w, T{1}, T{0.5});
+  torchlet::ops::init::normal_(b, T{0}, T{0.5});
+  Tensor res0({2, 3, m}, dt);
+  res0.copy_(res);
+
+  // row r of the reference, on h = x + residual
+  auto expect_rows = [&](const Tensor &y, const std::vector<T> &h, bool rms,
+                         const char *what) {
+    const T *py = y.data_ptr<T>();
+    for (size_t r = 0; r < rows; ++r) {
+      const T *hr = h.data() + r * m;
+      T mean{0}, var{0}, ms{0};
+      for (size_t k = 0; k < m; ++k) {
+        mean += hr[k] / T(m);
+        ms += hr[k] * hr[k] / T(m);
+      }
+      for (size_t k = 0; k < m; ++k)
+        var += (hr[k] - mean) * (hr[k] - mean) / T(m);
+      for (size_t k = 0; k < m; ++k) {
+        const T want =
+            rms ? hr[k] / std::sqrt(ms + T(1e-6)) * w.data_ptr<T>()[k]
+                : (hr[k] - mean) / std::sqrt(var + T(1e-5)) *
+                          w.data_ptr<T>()[k] +
+                      b.data_ptr<T>()[k];
+        EXPECT_NEAR(py[r * m + k], want, rms ? T(1e-4) : T(2e-3))
+            << what << " r=" << r << " k=" << k;
+      }
+    }
+  };
+
+  std::vector<T> hx(x.data_ptr<T>(), x.data_ptr<T>() + rows * m), hs(hx);
+  for (size_t i = 0; i < rows * m; ++i)
+    hs[i] += res0.data_ptr<T>()[i];
+
+  expect_rows(torchlet::ops::layer_norm(x, w, b), hx, false, "layer_norm");
+  expect_rows(torchlet::ops::rms_norm(x, w), hx, true, "rms_norm");
+
+  Tensor out({2, 3, m}, dt), sum({2, 3, m}, dt);
+  torchlet::ops::residual_layer_norm_out(x, res, w, b, out, sum);
+  expect_rows(out, hs, false, "residual_layer_norm_out");
+  for (size_t i = 0; i < rows * m; ++i)
+    EXPECT_EQ(sum.data_ptr<T>()[i], hs[i]);
+
+  // residual updated in place, then normalised
+  Tensor y = torchlet::ops::residual_rms_norm(x, res, w);
+  expect_rows(y, hs, true, "residual_rms_norm");
+  for (size_t i = 0; i < rows * m; ++i)
+    EXPECT_EQ(res.data_ptr<T>()[i], hs[i]);
+
+  // no weight and bias, out aliasing x
+  Tensor xc({2, 3, m}, dt);
+  xc.copy_(x);
+  torchlet::ops::layer_norm_out(xc, Tensor(), Tensor(), xc);
+  Tensor ref = torchlet::ops::layer_norm(x, Tensor::ones({m}, dt),
+                                         Tensor::zeros({m}, dt));
+  for (size_t i = 0; i < rows * m; ++i)
+    EXPECT_NEAR(xc.data_ptr<T>()[i], ref.data_ptr<T>()[i], T(1e-5));
+};
+
+TYPED_TEST(FunctionalTypedTest, StridedViewsMatchContiguous) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  namespace idx = torchlet::core::index;
+
+  Tensor x({13, 6}, dt);
+  torchlet::ops::init::normal_(x, T{0}, T{2});
+  Tensor xt = x.permute(0, 1); // rows of xt are strided columns of x
+  Tensor xc = xt.contiguous();
+
+  Tensor s = torchlet::ops::softmax(xt), es = torchlet::ops::softmax(xc);
+  Tensor l = torchlet::ops::log_softmax(xt),
+         el = torchlet::ops::log_softmax(xc);
+  expect_array_equal(s.data_ptr<T>(), es.data_ptr<T>(), s.numel());
+  expect_array_equal(l.data_ptr<T>(), el.data_ptr<T>(), l.numel());
+
+  // in place on a view writes back through the original storage
+  Tensor eg = torchlet::ops::gelu(xc);
+  torchlet::ops::gelu_(xt);
+  expect_array_equal(xt.contiguous().data_ptr<T>(), eg.data_ptr<T>(),
+                     eg.numel());
+
+  Linear lin(6, 4, true, dt);
+  Tensor rows = x.index({idx::Slice(2, 9), idx::Slice(0, 6)});
+  Tensor y = lin.forward(rows), ey = lin.forward(rows.contiguous());
+  expect_array_equal(y.data_ptr<T>(), ey.data_ptr<T>(), y.numel());
+};
+
+TYPED_TEST(FunctionalTypedTest, BinaryBroadcasting) {
+
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const size_t B = 5, N = 19;
+
+  Tensor x({B, N}, dt), bias({N}, dt), col({B, 1}, dt), s({1}, dt);
+  torchlet::ops::init::uniform_(x, T{1}, T{2});
+  torchlet::ops::init::uniform_(bias, T{1}, T{2});
+  torchlet::ops::init::uniform_(col, T{1}, T{2});
+  s.fill_(T{3});
+
+  const T *px = x.data_ptr<T>(), *pb = bias.data_ptr<T>(),
+          *pc = col.data_ptr<T>();
+
+  Tensor y = torchlet::ops::add(x, bias);
+  Tensor z = torchlet::ops::div(col, x);
+  Tensor w = torchlet::ops::mul(x, s);
+  Tensor m = torchlet::ops::maximum(x, col);
+  Tensor d = torchlet::ops::sub(x, x.permute(0, 1).permute(0, 1));
+  EXPECT_EQ(y.shape(), x.shape());
+  EXPECT_EQ(z.shape(), x.shape());
+
+  for (size_t i = 0; i < B; ++i)
+    for (size_t j = 0; j < N; ++j) {
+      const size_t k = i * N + j;
+      expect_equal(y.data_ptr<T>()[k], px[k] + pb[j]);
+      expect_equal(z.data_ptr<T>()[k], pc[i] / px[k]);
+      expect_equal(w.data_ptr<T>()[k], px[k] * T{3});
+      expect_equal(m.data_ptr<T>()[k], std::max(px[k], pc[i]));
+      expect_equal(d.data_ptr<T>()[k], T{0});
+    }
+
+  // outer product of a column and a row
+  Tensor outer = torchlet::ops::mul(col, bias);
+  EXPECT_EQ(outer.shape(), (std::vector<size_t>{B, N}));
+  expect_equal(outer.data_ptr<T>()[2 * N + 7], pc[2] * pb[7]);
+
+  // residual connection in place, on a transposed view
+  Tensor r({N, B}, dt);
+  torchlet::ops::init::uniform_(r, T{1}, T{2});
+  Tensor rt = r.permute(0, 1);
+  Tensor expected = torchlet::ops::add(rt.contiguous(), x);
+  torchlet::ops::add_(rt, x);
+  expect_array_equal(rt.contiguous().data_ptr<T>(), expected.data_ptr<T>(),
+                     expected.numel());
+
+  Tensor bad({4}, dt);
+  EXPECT_THROW(torchlet::ops::add(x, bad), std::invalid_argument);
+};
+
+TEST(FunctionalTest, BinaryIntegerDtypes) {
+  Tensor a({3, 4}, Dtype::Int32), b({4}, Dtype::Int32);
+  for (int k = 0; k < 12; ++k)
+    a.data_ptr<int32_t>()[k] = 3 * k - 10;
+  for (int k = 0; k < 4; ++k)
+    b.data_ptr<int32_t>()[k] = k + 1;
+
+  Tensor q = torchlet::ops::div(a, b);
+  Tensor m = torchlet::ops::maximum(a, b);
+  for (int k = 0; k < 12; ++k) {
+    const int32_t va = a.data_ptr<int32_t>()[k], vb = (k % 4) + 1;
+    EXPECT_EQ(q.data_ptr<int32_t>()[k], va / vb);
+    EXPECT_EQ(m.data_ptr<int32_t>()[k], std::max(va, vb));
+  }
+
+  Tensor u = Tensor::ones({300}, Dtype::UInt8);
+  torchlet::ops::add_(u, u);
+  EXPECT_EQ(u.data_ptr<uint8_t>()[299], 2);
+};
+
+TEST(FunctionalTest, BinaryIntegerDivisionChecks) {
+  Tensor a = Tensor::ones({4}, Dtype::Int32), zero({4}, Dtype::Int32);
+  for (int k = 0; k < 4; ++k)
+    zero.data_ptr<int32_t>()[k] = 0;
+  EXPECT_THROW(torchlet::ops::div(a, zero), std::invalid_argument);
+  EXPECT_THROW(torchlet::ops::div_(a, zero), std::invalid_argument);
+  EXPECT_EQ(a.data_ptr<int32_t>()[0], 1); // untouched
+
+  Tensor u = Tensor::ones({3, 5}, Dtype::UInt8);
+  Tensor uz = Tensor::ones({5}, Dtype::UInt8);
+  uz.data_ptr<uint8_t>()[4] = 0;
+  EXPECT_THROW(torchlet::ops::div(u, uz), std::invalid_argument);
+
+  Tensor lo({2}, Dtype::Int64), m1({1}, Dtype::Int64);
+  lo.data_ptr<int64_t>()[0] = 7;
+  lo.data_ptr<int64_t>()[1] = std::numeric_limits<int64_t>::min();
+  m1.data_ptr<int64_t>()[0] = -1;
+  EXPECT_THROW(torchlet::ops::div(lo, m1), std::invalid_argument);
+  lo.data_ptr<int64_t>()[1] = 8;
+  const Tensor q = torchlet::ops::div(lo, m1);
+  EXPECT_EQ(q.data_ptr<int64_t>()[1], -8);
+};
+
+TEST(FunctionalTest, FloatOnlyOpsRejectReducedDtypes) {
+  for (auto dt : {Dtype::Float16, Dtype::BFloat16, Dtype::Int32}) {
+    Tensor x = Tensor::ones({2, 4}, dt);
+    EXPECT_THROW(torchlet::ops::gelu(x), std::runtime_error);
+    EXPECT_THROW(torchlet::ops::layer_norm(x, Tensor(), Tensor()),
+                 std::runtime_error);
+  }
+};
+
+TEST(FunctionalTest, OutValidation) {
+  Linear lin(4, 3, false, Dtype::Float32);
+  Tensor x = Tensor::ones({2, 4}, Dtype::Float32);
+
+  Tensor bad_shape({2, 4}, Dtype::Float32);
+  EXPECT_THROW(lin.forward_out(x, bad_shape), std::runtime_error);
+  Tensor transposed({4, 2}, Dtype::Float32);
+  EXPECT_THROW(torchlet::ops::gelu_out(x, transposed), std::runtime_error);
+
+  Tensor bad_dtype({2, 3}, Dtype::Float64);
+  EXPECT_THROW(lin.forward_out(x, bad_dtype), std::runtime_error);
+
+  Tensor sq = Tensor::ones({4, 4}, Dtype::Float32);
+  Linear sq_lin(4, 4, false, Dtype::Float32);
+  EXPECT_THROW(sq_lin.forward_out(sq, sq), std::runtime_error);
+};
+
+TEST(FunctionalTest, PreallocatedForwardDoesNotAllocate) {
+  Linear l1(16, 32, true, Dtype::Float32), l2(32, 8, true, Dtype::Float32);
+  Tensor x = Tensor::ones({4, 16}, Dtype::Float32);
+  Tensor h({4, 32}, Dtype::Float32), y({4, 8}, Dtype::Float32);
+
+  auto &alloc = torchlet::core::caching_allocator();
+  torchlet::core::set_allocator(&alloc);
+  const auto before = alloc.stats();
+  for (int it = 0; it < 3; ++it) {
+    torchlet::ops::gelu_(l1.forward_out(x, h));
+    torchlet::ops::softmax_(l2.forward_out(h, y));
+  }
+  const auto after = alloc.stats();
+  torchlet::core::set_allocator(nullptr);
+
+  EXPECT_EQ(after.n_fresh, before.n_fresh);
+  EXPECT_EQ(after.n_reused, before.n_reused);
+};
+
+TYPED_TEST(FunctionalTypedTest, DropoutDrawsOneMask) {
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const std::size_t saved = torchlet::get_num_threads();
+  const double p = 0.3;
+  const T scale = T(1.0 / (1.0 - p));
+
+  Tensor x({3, torchlet::GRAIN_SIZE + 5}, dt);
+  torchlet::ops::init::normal_(x, T{0}, T{1});
+  torchlet::core::Generator g1(4u), g2(4u), g3(4u);
+  torchlet::set_num_threads(1);
+  Tensor serial = torchlet::ops::dropout(x, p, g1);
+  torchlet::set_num_threads(4);
+  Tensor parallel = torchlet::ops::dropout(x, p, g2);
+  torchlet::set_num_threads(saved);
+  expect_array_equal(serial.data_ptr<T>(), parallel.data_ptr<T>(), x.numel());
+
+  std::size_t kept = 0;
+  for (std::size_t k = 0; k < x.numel(); ++k) {
+    const T y = serial.data_ptr<T>()[k], v = x.data_ptr<T>()[k];
+    if (y != T{0}) {
+      ++kept;
+      EXPECT_EQ(y, v * scale) << "k=" << k;
+    }
+  }
+  EXPECT_NEAR(double(kept) / double(x.numel()), 1.0 - p, 0.01);
+
+  // in place, and into a strided out, with the same mask
+  Tensor inplace = Tensor(x.shape(), dt).copy_(x);
+  torchlet::ops::dropout_(inplace, p, g3);
+  expect_array_equal(inplace.data_ptr<T>(), serial.data_ptr<T>(), x.numel());
+
+  Tensor small({4, 6}, dt), base({6, 4}, dt);
+  torchlet::ops::init::normal_(small, T{0}, T{1});
+  Tensor view = base.permute(0, 1);
+  torchlet::core::Generator g4(5u), g5(5u);
+  const Tensor dense = torchlet::ops::dropout(small, 0.5, g4);
+  torchlet::ops::dropout_out(small, 0.5, view, g5);
+  for (std::size_t i = 0; i < 4; ++i)
+    for (std::size_t j = 0; j < 6; ++j)
+      EXPECT_EQ(base.data_ptr<T>()[j * 4 + i], dense.data_ptr<T>()[i * 6 + j]);
+
+  const Tensor none = torchlet::ops::dropout(small, 0.0);
+  expect_array_equal(none.data_ptr<T>(), small.data_ptr<T>(), small.numel());
+  const Tensor all = torchlet::ops::dropout(small, 1.0);
+  for (std::size_t k = 0; k < all.numel(); ++k)
+    EXPECT_EQ(all.data_ptr<T>()[k], T{0});
+  EXPECT_THROW(torchlet::ops::dropout(small, 1.5), std::invalid_argument);
+};
+
+TYPED_TEST(FunctionalTypedTest, DropoutFusesWithLinearGelu) {
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  // GEMV rows, then GEMM blocks
+  for (std::size_t B : {2, 37}) {
+    Linear lin(19, 23, true, dt);
+    const std::vector<Tensor> params = lin.parameters();
+    Tensor x({B, 19}, dt);
+    torchlet::ops::init::normal_(x, T{0}, T{1});
+
+    torchlet::core::Generator g1(6u), g2(6u);
+    const Tensor fused = torchlet::ops::linear_gelu_dropout(
+        x, params.front(), params.back(), 0.4, g1);
+    const Tensor ref = torchlet::ops::dropout(
+        torchlet::ops::linear_gelu(x, params.front(), params.back()), 0.4, g2);
+    expect_array_equal(fused.data_ptr<T>(), ref.data_ptr<T>(), ref.numel());
+    EXPECT_EQ(g1.offset(), g2.offset());
+  }
+};
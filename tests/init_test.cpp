@@ -1,3 +1,4 @@
+#include <cmath>
 #include <gtest/gtest.h>
 #include <torchlet/torchlet.h>
 
@@ -28,4 +29,74 @@ TYPED_TEST(InitTypedTest, Reproducable) {
   torchlet::ops::init::uniform_(t, T{0}, T{1}, g1);
   torchlet::ops::init::uniform_(v, T{0}, T{1}, g2);
   expect_array_equal(t.data_ptr<T>(), v.data_ptr<T>(), len);
-};
\ No newline at end of file
+};
+TYPED_TEST(InitTypedTest, ParallelMatchesSerial) {
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const std::size_t saved = torchlet::get_num_threads();
+  const std::size_t len = 3 * torchlet::GRAIN_SIZE + 7;
+
+  Tensor serial({len}, dt), parallel({len}, dt);
+  Generator g1(3u), g2(3u);
+  torchlet::set_num_threads(1);
+  torchlet::ops::init::normal_(serial, T{0}, T{1}, g1);
+  torchlet::set_num_threads(4);
+  torchlet::ops::init::normal_(parallel, T{0}, T{1}, g2);
+  torchlet::set_num_threads(saved);
+  expect_array_equal(serial.data_ptr<T>(), parallel.data_ptr<T>(), len);
+};
+
+TYPED_TEST(InitTypedTest, DrawsFollowTheStream) {
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  // two draws of 8 continue one another : the same as one draw of 16
+  Generator g1(5u), g2(5u);
+  Tensor whole({16}, dt), first({8}, dt), second({8}, dt);
+  torchlet::ops::init::uniform_(whole, T{0}, T{1}, g1);
+  torchlet::ops::init::uniform_(first, T{0}, T{1}, g2);
+  torchlet::ops::init::uniform_(second, T{0}, T{1}, g2);
+  EXPECT_EQ(g1.offset(), g2.offset());
+  expect_array_equal(whole.data_ptr<T>(), first.data_ptr<T>(), 8);
+  expect_array_equal(whole.data_ptr<T>() + 8, second.data_ptr<T>(), 8);
+
+  // a view receives the values of a contiguous tensor of its shape
+  Tensor dense({3, 5}, dt), base({5, 3}, dt);
+  Tensor view = base.permute(0, 1);
+  Generator g(6u);
+  torchlet::ops::init::normal_(dense, T{0}, T{1}, g);
+  EXPECT_NE(g.offset(), 0u);
+  g.manual_seed(6u); // back to the start of the stream
+  torchlet::ops::init::normal_(view, T{0}, T{1}, g);
+  for (std::size_t i = 0; i < 3; ++i)
+    for (std::size_t j = 0; j < 5; ++j)
+      EXPECT_EQ(base.data_ptr<T>()[j * 3 + i], dense.data_ptr<T>()[i * 5 + j]);
+};
+
+TYPED_TEST(InitTypedTest, Moments) {
+  using T = TypeParam;
+  const auto dt = CPPTypeToDType<T>::dtype;
+  const std::size_t len = 100001;
+  Generator gen(8u);
+
+  Tensor t({len}, dt);
+  torchlet::ops::init::normal_(t, T{2}, T{3}, gen);
+  double sum = 0.0, sq = 0.0;
+  for (std::size_t k = 0; k < len; ++k) {
+    const double v = double(t.data_ptr<T>()[k]);
+    sum += v;
+    sq += v * v;
+  }
+  const double mean = sum / len;
+  EXPECT_NEAR(mean, 2.0, 0.05);
+  EXPECT_NEAR(std::sqrt(sq / len - mean * mean), 3.0, 0.05);
+
+  torchlet::ops::init::uniform_(t, T{-1}, T{3}, gen);
+  sum = 0.0;
+  for (std::size_t k = 0; k < len; ++k) {
+    const T v = t.data_ptr<T>()[k];
+    EXPECT_TRUE(v >= T{-1} && v <= T{3}) << "k=" << k;
+    sum += double(v);
+  }
+  EXPECT_NEAR(sum / len, 1.0, 0.02);
+};
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <cmath>
 #include <random>
 
 #include "utils/utils.h"
@@ -26,13 +27,13 @@ TYPED_TEST(KernelTypedTest, MvBasic) {
   std::size_t m = 1 << 9;
   std::size_t n = 1 << 8;
 
-  std::vector<T> W(m * n, T{1.0}), x(m, T{1.0}), y(n, T{0.0}),
-      expected(n, static_cast<T>(m));
+  std::vector<T> W(m * n, T{1.0}), x(n, T{1.0}), y(m, T{0.0}),
+      expected(m, static_cast<T>(n));
 
   const T *bias = static_cast<const T *>(nullptr);
 
   mvb_kernel(W.data(), x.data(), bias, y.data(), m, n);
-  expect_array_equal(y.data(), expected.data(), n);
+  expect_array_equal(y.data(), expected.data(), m);
 };
 
 TYPED_TEST(KernelTypedTest, MvIdentityRandom) {
@@ -78,3 +79,757 @@ TYPED_TEST(KernelTypedTest, VaddWithNegatives) {
   vadd_kernel(a.data(), b.data(), a.size());
   expect_array_equal(b.data(), expected.data(), a.size());
 };
+
+template <typename T>
+static void naive_mmb(const T *A, const T *W, const T *b, T *C, std::size_t m,
+                      std::size_t n, std::size_t k) {
+  for (std::size_t i = 0; i < m; ++i)
+    for (std::size_t j = 0; j < n; ++j) {
+      T acc = b ? b[j] : T{0};
+      for (std::size_t l = 0; l < k; ++l)
+        acc += A[i * k + l] * W[j * k + l];
+      C[i * n + j] = acc;
+    }
+};
+
+TYPED_TEST(KernelTypedTest, MmRandomOddSizes) {
+  using T = TypeParam;
+  std::mt19937 engine{7};
+  std::uniform_real_distribution<T> dist{T{-1}, T{1}};
+
+  // Not multiples of any register / cache tile, K spans several panels.
+  const std::size_t m = 131, n = 37, k = 517;
+  std::vector<T> A(m * k), B(k * n), Bt(n * k), C(m * n), expected(m * n);
+  for (auto &v : A)
+    v = dist(engine);
+  for (auto &v : B)
+    v = dist(engine);
+  for (std::size_t l = 0; l < k; ++l)
+    for (std::size_t j = 0; j < n; ++j)
+      Bt[j * k + l] = B[l * n + j];
+
+  naive_mmb(A.data(), Bt.data(), static_cast<const T *>(nullptr),
+            expected.data(), m, n, k);
+  mm_kernel(A.data(), B.data(), C.data(), m, n, k);
+
+  for (std::size_t i = 0; i < m * n; ++i)
+    EXPECT_NEAR(C[i], expected[i], T(1e-3)) << "i=" << i;
+};
+
+TYPED_TEST(KernelTypedTest, MmbRandomBias) {
+  using T = TypeParam;
+  std::mt19937 engine{11};
+  std::uniform_real_distribution<T> dist{T{-1}, T{1}};
+
+  const std::size_t m = 67, n = 2100, k = 29;
+  std::vector<T> A(m * k), W(n * k), b(n), C(m * n), expected(m * n);
+  for (auto &v : A)
+    v = dist(engine);
+  for (auto &v : W)
+    v = dist(engine);
+  for (auto &v : b)
+    v = dist(engine);
+
+  naive_mmb(A.data(), W.data(), b.data(), expected.data(), m, n, k);
+  mmb_kernel(A.data(), W.data(), b.data(), C.data(), m, n, k);
+
+  for (std::size_t i = 0; i < m * n; ++i)
+    EXPECT_NEAR(C[i], expected[i], T(1e-4)) << "i=" << i;
+};
+
+TYPED_TEST(KernelTypedTest, BlasMatchesNative) {
+  using T = TypeParam;
+  std::mt19937 engine{3};
+  std::uniform_real_distribution<T> dist{T{-1}, T{1}};
+
+  const std::size_t m = 33, n = 45, k = 70;
+  std::vector<T> A(m * k), W(n * k), b(n), C(m * n), C_ref(m * n), y(n),
+      y_ref(n);
+  for (auto &v : A)
+    v = dist(engine);
+  for (auto &v : W)
+    v = dist(engine);
+  for (auto &v : b)
+    v = dist(engine);
+
+  mmb_kernel(A.data(), W.data(), b.data(), C_ref.data(), m, n, k);
+  mmb_blas_kernel(A.data(), W.data(), b.data(), C.data(), m, n, k);
+  for (std::size_t i = 0; i < m * n; ++i)
+    EXPECT_NEAR(C[i], C_ref[i], T(1e-4)) << "i=" << i;
+
+  mvb_kernel(W.data(), A.data(), b.data(), y_ref.data(), n, k);
+  mvb_blas_kernel(W.data(), A.data(), b.data(), y.data(), n, k);
+  for (std::size_t i = 0; i < n; ++i)
+    EXPECT_NEAR(y[i], y_ref[i], T(1e-4)) << "i=" << i;
+};
+
+TYPED_TEST(KernelTypedTest, MmbFusedActivation) {
+  using T = TypeParam;
+  std::mt19937 engine{5};
+  std::uniform_real_distribution<T> dist{T{-1}, T{1}};
+
+  // k > KC so the epilogue only fires on the last K panel, n > NC for the
+  // row-wise softmax across column panels.
+  const std::size_t m = 21, n = 2063, k = 300;
+  std::vector<T> A(m * k), W(n * k), b(n), C(m * n), C_blas(m * n),
+      expected(m * n);
+  for (auto &v : A)
+    v = dist(engine);
+  for (auto &v : W)
+    v = dist(engine);
+  for (auto &v : b)
+    v = dist(engine);
+
+  for (auto act : {Activation::ReLU, Activation::GELU, Activation::Softmax}) {
+    mmb_kernel(A.data(), W.data(), b.data(), expected.data(), m, n, k);
+    for (std::size_t i = 0; i < m; ++i)
+      activation_kernel(expected.data() + i * n, n, act);
+
+    mmb_kernel(A.data(), W.data(), b.data(), C.data(), m, n, k, act);
+    mmb_blas_kernel(A.data(), W.data(), b.data(), C_blas.data(), m, n, k, act);
+    for (std::size_t i = 0; i < m * n; ++i) {
+      EXPECT_NEAR(C[i], expected[i], T(1e-5)) << "act=" << int(act);
+      EXPECT_NEAR(C_blas[i], expected[i], T(1e-4)) << "act=" << int(act);
+    }
+    // no output column : nothing to write
+    mmb_blas_kernel(A.data(), W.data(), b.data(), C_blas.data(), m, 0, k, act);
+  }
+};
+
+// Every SIMD level the host supports against the portable float kernels.
+TEST(KernelSimdTest, MatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t m = 1027; // not a multiple of any vector width
+
+  std::mt19937 engine{5};
+  std::uniform_real_distribution<float> dist{-12.0f, 12.0f};
+  std::vector<float> x(m), a(m);
+  for (auto &v : x)
+    v = dist(engine);
+  for (auto &v : a)
+    v = dist(engine);
+  x[0] = 0.0f;
+  x[1] = -90.0f;
+  x[2] = 60.0f;
+
+  auto run_all = [&](std::vector<std::vector<float>> &res) {
+    res.assign(4, std::vector<float>(m));
+    res[0] = a;
+    vadd_kernel(x.data(), res[0].data(), m);
+    gelu_kernel(x.data(), res[1].data(), m);
+    softmax_kernel(x.data(), res[2].data(), m);
+    log_softmax_kernel(x.data(), res[3].data(), m);
+  };
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
+  std::vector<std::vector<float>> ref, got;
+  run_all(ref);
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > torchlet::core::max_cpu_capability())
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    run_all(got);
+
+    const char *name = torchlet::core::to_string(cap);
+    for (std::size_t k = 0; k < m; ++k) {
+      EXPECT_FLOAT_EQ(got[0][k], ref[0][k]) << name << " vadd k=" << k;
+      EXPECT_NEAR(got[1][k], ref[1][k], 2e-6f * (1.0f + std::fabs(x[k])))
+          << name << " gelu k=" << k;
+      EXPECT_NEAR(got[2][k], ref[2][k], 1e-5f * ref[2][k] + 1e-9f)
+          << name << " softmax k=" << k;
+      EXPECT_NEAR(got[3][k], ref[3][k], 1e-5f * (1.0f + std::fabs(ref[3][k])))
+          << name << " log_softmax k=" << k;
+    }
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, BinaryMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t m = 37; // vector body and a padded tail at every width
+
+  std::mt19937 engine{7};
+  std::uniform_real_distribution<float> dist{0.5f, 4.0f};
+  std::vector<float> a(m), b(m), ref(m), got(m);
+  for (auto &v : a)
+    v = dist(engine);
+  for (auto &v : b)
+    v = dist(engine);
+
+  for (auto op : {BinaryOp::Add, BinaryOp::Sub, BinaryOp::Mul, BinaryOp::Div,
+                  BinaryOp::Maximum})
+    for (std::size_t sa : {0u, 1u})
+      for (std::size_t sb : {0u, 1u}) {
+        torchlet::core::set_cpu_capability(CpuCapability::Default);
+        binary_kernel(a.data(), sa, b.data(), sb, ref.data(), m, op);
+
+        for (auto cap : {CpuCapability::SSE4, CpuCapability::AVX2,
+                         CpuCapability::AVX512}) {
+          if (cap > torchlet::core::max_cpu_capability())
+            continue;
+          torchlet::core::set_cpu_capability(cap);
+          binary_kernel(a.data(), sa, b.data(), sb, got.data(), m, op);
+          for (std::size_t k = 0; k < m; ++k)
+            EXPECT_FLOAT_EQ(got[k], ref[k])
+                << torchlet::core::to_string(cap) << " op="
+                << static_cast<int>(op) << " sa=" << sa << " sb=" << sb;
+        }
+      }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, ReducedPrecisionMatchesScalarReference) {
+  using torchlet::core::CpuCapability, torchlet::core::Half,
+      torchlet::core::BFloat16;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t m = 7, n = 1029;
+
+  std::mt19937 engine{11};
+  std::uniform_real_distribution<float> dist{-2.0f, 2.0f};
+  std::vector<float> f(m * n), x(n), b(m);
+  for (auto &v : f)
+    v = dist(engine);
+  for (auto &v : x)
+    v = dist(engine);
+  for (auto &v : b)
+    v = dist(engine);
+  f[0] = 1.0f + 1.0f / 256; // ties
+  f[1] = 1.0f + 1.0f / 2048;
+  f[2] = 1e6f; // overflows Float16
+
+  auto run = [&](auto tag, std::vector<std::uint16_t> &bits,
+                 std::vector<float> &wide, std::vector<float> &y) {
+    using R = decltype(tag);
+    std::vector<R> r(m * n);
+    narrow_kernel(f.data(), r.data(), r.size());
+    bits.resize(r.size());
+    for (std::size_t k = 0; k < r.size(); ++k)
+      bits[k] = r[k].bits;
+    wide.resize(r.size());
+    widen_kernel(r.data(), wide.data(), r.size());
+    y.resize(m);
+    mvb_mixed_kernel(r.data(), x.data(), b.data(), y.data(), m, n);
+  };
+
+  auto check = [&](auto tag, const char *type) {
+    std::vector<std::uint16_t> ref_bits, got_bits;
+    std::vector<float> ref_wide, got_wide, ref_y, got_y;
+    torchlet::core::set_cpu_capability(CpuCapability::Default);
+    run(tag, ref_bits, ref_wide, ref_y);
+
+    for (auto cap :
+         {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+      if (cap > torchlet::core::max_cpu_capability())
+        continue;
+      torchlet::core::set_cpu_capability(cap);
+      run(tag, got_bits, got_wide, got_y);
+
+      const char *name = torchlet::core::to_string(cap);
+      EXPECT_EQ(got_bits, ref_bits) << name << " " << type;
+      EXPECT_EQ(got_wide, ref_wide) << name << " " << type;
+      for (std::size_t k = 0; k < m; ++k) {
+        if (std::isinf(ref_y[k]))
+          EXPECT_EQ(got_y[k], ref_y[k]) << name << " " << type;
+        else
+          EXPECT_NEAR(got_y[k], ref_y[k], 1e-5f * (1.0f + std::fabs(ref_y[k])))
+              << name << " " << type;
+      }
+    }
+  };
+  check(Half{}, "f16");
+  check(BFloat16{}, "bf16");
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, SoftmaxShortRows) {
+  using torchlet::core::CpuCapability;
+
+  // Rows shorter than a vector only go through the padded tail.
+  for (std::size_t m : {1u, 3u, 5u, 17u}) {
+    std::vector<float> x(m), y(m);
+    for (std::size_t k = 0; k < m; ++k)
+      x[k] = static_cast<float>(k);
+    softmax_kernel(x.data(), y.data(), m);
+
+    float sum = 0.0f;
+    for (auto v : y)
+      sum += v;
+    EXPECT_NEAR(sum, 1.0f, 1e-6f) << "m=" << m;
+  }
+};
+
+TEST(KernelSimdTest, MvbMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+
+  std::mt19937 engine{9};
+  std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+  // Row counts around the 4-row block, column counts around the unroll.
+  for (std::size_t m : {1u, 6u, 37u})
+    for (std::size_t n : {3u, 32u, 1029u}) {
+      std::vector<float> W(m * n), x(n), b(m), ref(m), got(m);
+      for (auto &v : W)
+        v = dist(engine);
+      for (auto &v : x)
+        v = dist(engine);
+      for (auto &v : b)
+        v = dist(engine);
+
+      torchlet::core::set_cpu_capability(CpuCapability::Default);
+      mvb_kernel(W.data(), x.data(), b.data(), ref.data(), m, n);
+
+      for (auto cap :
+           {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+        if (cap > torchlet::core::max_cpu_capability())
+          continue;
+        torchlet::core::set_cpu_capability(cap);
+        mvb_kernel(W.data(), x.data(), b.data(), got.data(), m, n);
+        for (std::size_t k = 0; k < m; ++k)
+          EXPECT_NEAR(got[k], ref[k], 1e-4f)
+              << torchlet::core::to_string(cap) << " m=" << m << " n=" << n;
+
+        mvb_kernel(W.data(), x.data(), static_cast<const float *>(nullptr),
+                   got.data(), m, n);
+        for (std::size_t k = 0; k < m; ++k)
+          EXPECT_NEAR(got[k] + b[k], ref[k], 1e-4f);
+      }
+    }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, QmmbMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+
+  std::mt19937 engine{13};
+  std::uniform_int_distribution<int> code{0, 127}, zp{0, 127};
+  std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+  // Row blocks of 4 with their tails, columns around the 16 / 32 / 64 bytes
+  // of each instruction set. Extreme codes check the int16 pairs.
+  for (std::size_t M : {1u, 5u, 9u})
+    for (std::size_t m : {1u, 3u, 6u})
+      for (std::size_t n : {7u, 64u, 131u}) {
+        std::vector<std::uint8_t> W(m * n);
+        std::vector<float> ws(m), x(M * n), b(m), ref(M * m), got(M * m);
+        std::vector<std::int32_t> wz(m);
+        for (auto &v : W)
+          v = static_cast<std::uint8_t>(code(engine));
+        W[0] = 127;
+        for (std::size_t o = 0; o < m; ++o) {
+          ws[o] = 0.01f * (1.0f + dist(engine));
+          wz[o] = zp(engine);
+          b[o] = dist(engine);
+        }
+        for (auto &v : x)
+          v = dist(engine);
+        x[0] = -1.0f;
+
+        std::vector<std::int8_t> X(M * n);
+        std::vector<float> xs(M);
+        std::vector<std::int32_t> xsum(M);
+        for (std::size_t i = 0; i < M; ++i)
+          quantize_row_kernel(x.data() + i * n, X.data() + i * n, n, xs[i],
+                              xsum[i]);
+        EXPECT_EQ(X[0], -127);
+
+        torchlet::core::set_cpu_capability(CpuCapability::Default);
+        qmmb_kernel(W.data(), ws.data(), wz.data(), X.data(), xs.data(),
+                    xsum.data(), b.data(), ref.data(), M, m, n, m);
+
+        for (auto cap : {CpuCapability::SSE4, CpuCapability::AVX2,
+                         CpuCapability::AVX512}) {
+          if (cap > torchlet::core::max_cpu_capability())
+            continue;
+          torchlet::core::set_cpu_capability(cap);
+          qmmb_kernel(W.data(), ws.data(), wz.data(), X.data(), xs.data(),
+                      xsum.data(), b.data(), got.data(), M, m, n, m);
+          for (std::size_t k = 0; k < M * m; ++k)
+            EXPECT_NEAR(got[k], ref[k], 1e-5f * (1.0f + std::fabs(ref[k])))
+                << torchlet::core::to_string(cap) << " M=" << M
+                << " m=" << m << " n=" << n;
+        }
+      }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, GemmMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t threads = torchlet::get_num_threads();
+
+  std::mt19937 engine{17};
+  std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+  // Sizes around the register tiles of every instruction set and across
+  // several row blocks and K panels, with the blocks of C split between
+  // threads.
+  for (std::size_t m : {1u, 13u, 263u})
+    for (std::size_t n : {5u, 48u, 97u})
+      for (std::size_t k : {3u, 300u}) {
+        std::vector<float> A(m * k), W(n * k), b(n), ref(m * n), got(m * n);
+        for (auto &v : A)
+          v = dist(engine);
+        for (auto &v : W)
+          v = dist(engine);
+        for (auto &v : b)
+          v = dist(engine);
+
+        torchlet::core::set_cpu_capability(CpuCapability::Default);
+        torchlet::set_num_threads(1);
+        mmb_kernel(A.data(), W.data(), b.data(), ref.data(), m, n, k,
+                   Activation::ReLU);
+
+        torchlet::set_num_threads(4);
+        for (auto cap : {CpuCapability::Default, CpuCapability::SSE4,
+                         CpuCapability::AVX2, CpuCapability::AVX512}) {
+          if (cap > torchlet::core::max_cpu_capability())
+            continue;
+          torchlet::core::set_cpu_capability(cap);
+          mmb_kernel(A.data(), W.data(), b.data(), got.data(), m, n, k,
+                     Activation::ReLU);
+          for (std::size_t i = 0; i < m * n; ++i)
+            EXPECT_NEAR(got[i], ref[i], 1e-4f)
+                << torchlet::core::to_string(cap) << " m=" << m
+                << " n=" << n << " k=" << k;
+        }
+      }
+
+  torchlet::set_num_threads(threads);
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, NormsMatchScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  std::mt19937 engine{23};
+  std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+
+  // A vector body and a padded tail at every width, and a row far from 0
+  // on which the shifted sums must not cancel.
+  for (std::size_t m : {1u, 37u, 300u})
+    for (float offset : {0.0f, 1000.0f}) {
+      std::vector<float> x(m), r(m), g(m), b(m);
+      for (auto &v : x)
+        v = offset + dist(engine);
+      for (auto &v : r)
+        v = dist(engine);
+      for (auto &v : g)
+        v = dist(engine);
+      for (auto &v : b)
+        v = dist(engine);
+
+      auto run_all = [&](std::vector<std::vector<float>> &res) {
+        res.assign(4, std::vector<float>(m));
+        layer_norm_kernel(x.data(), r.data(), g.data(), b.data(),
+                          res[0].data(), res[1].data(), m, 1e-5f);
+        rms_norm_kernel(x.data(), r.data(), g.data(), res[2].data(),
+                        res[3].data(), m, 1e-6f);
+      };
+
+      torchlet::core::set_cpu_capability(CpuCapability::Default);
+      std::vector<std::vector<float>> ref, got;
+      run_all(ref);
+
+      for (auto cap :
+           {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+        if (cap > torchlet::core::max_cpu_capability())
+          continue;
+        torchlet::core::set_cpu_capability(cap);
+        run_all(got);
+
+        const char *name = torchlet::core::to_string(cap);
+        for (std::size_t k = 0; k < m; ++k) {
+          EXPECT_NEAR(got[0][k], ref[0][k], 2e-3f)
+              << name << " layer_norm m=" << m << " k=" << k;
+          EXPECT_FLOAT_EQ(got[1][k], ref[1][k]) << name << " sum k=" << k;
+          EXPECT_NEAR(got[2][k], ref[2][k], 1e-4f)
+              << name << " rms_norm m=" << m << " k=" << k;
+          EXPECT_FLOAT_EQ(got[3][k], ref[3][k]) << name << " sum k=" << k;
+        }
+      }
+    }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, BackwardMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t m = 37;
+
+  std::mt19937 engine{29};
+  std::uniform_real_distribution<float> dist{-3.0f, 3.0f};
+  std::vector<float> x(m), dy(m), y(m), ly(m), acc(m);
+  for (auto &v : x)
+    v = dist(engine);
+  for (auto &v : dy)
+    v = dist(engine);
+  for (auto &v : acc)
+    v = dist(engine);
+  softmax_kernel(x.data(), y.data(), m);
+  log_softmax_kernel(x.data(), ly.data(), m);
+
+  auto run_all = [&](std::vector<std::vector<float>> &res) {
+    res.assign(6, acc);
+    for (int a = 0; a < 2; ++a) {
+      gelu_backward_kernel(x.data(), dy.data(), res[3 * a].data(), m, a);
+      softmax_backward_kernel(y.data(), dy.data(), res[3 * a + 1].data(), m,
+                              a);
+      log_softmax_backward_kernel(ly.data(), dy.data(), res[3 * a + 2].data(),
+                                  m, a);
+    }
+  };
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
+  std::vector<std::vector<float>> ref, got;
+  run_all(ref);
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > torchlet::core::max_cpu_capability())
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    run_all(got);
+    for (std::size_t r = 0; r < ref.size(); ++r)
+      for (std::size_t k = 0; k < m; ++k)
+        EXPECT_NEAR(got[r][k], ref[r][k], 1e-5f * (1.0f + std::fabs(ref[r][k])))
+            << torchlet::core::to_string(cap) << " kernel " << r << " k=" << k;
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, CrossEntropyMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+
+  std::mt19937 engine{31};
+  std::uniform_real_distribution<float> dist{-8.0f, 8.0f};
+  // the short row only takes the tail, the long one the blocks of 4 vectors
+  for (std::size_t m : {std::size_t{5}, std::size_t{1000}}) {
+    std::vector<float> x(m), acc(m);
+    for (auto &v : x)
+      v = dist(engine);
+    for (auto &v : acc)
+      v = dist(engine);
+    const std::size_t target = m / 2;
+
+    auto run = [&](float &lse, std::vector<std::vector<float>> &res) {
+      lse = logsumexp_kernel(x.data(), m);
+      res.assign(2, acc);
+      for (int a = 0; a < 2; ++a)
+        cross_entropy_backward_kernel(x.data(), lse, target, 0.25f,
+                                      res[a].data(), m, a);
+    };
+
+    torchlet::core::set_cpu_capability(CpuCapability::Default);
+    float ref_lse, got_lse;
+    std::vector<std::vector<float>> ref, got;
+    run(ref_lse, ref);
+
+    double sum = 0;
+    for (float v : x)
+      sum += std::exp(double(v));
+    EXPECT_NEAR(ref_lse, std::log(sum), 1e-4);
+
+    for (auto cap :
+         {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+      if (cap > torchlet::core::max_cpu_capability())
+        continue;
+      torchlet::core::set_cpu_capability(cap);
+      run(got_lse, got);
+      EXPECT_NEAR(got_lse, ref_lse, 1e-5f * (1.0f + std::fabs(ref_lse)))
+          << torchlet::core::to_string(cap) << " m=" << m;
+      for (std::size_t r = 0; r < ref.size(); ++r)
+        for (std::size_t k = 0; k < m; ++k)
+          EXPECT_NEAR(got[r][k], ref[r][k],
+                      1e-5f * (1.0f + std::fabs(ref[r][k])))
+              << torchlet::core::to_string(cap) << " m=" << m << " k=" << k;
+    }
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, OptimizersMatchScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t n = 45;
+
+  std::mt19937 engine{37};
+  std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+  std::vector<float> p0(n), g(n), s0(n), s1(n);
+  for (auto *v : {&p0, &g, &s0, &s1})
+    for (auto &x : *v)
+      x = dist(engine);
+  for (auto &x : s1)
+    x = std::fabs(x);
+
+  const SGDStep sgd{0.1, 0.9, 0.01, true};
+  const AdamStep adam{1e-2, 0.9, 0.99, 1e-8, 0.1, 0.19, 0.0199, false};
+  const AdamStep adamw{1e-2, 0.9, 0.99, 1e-8, 0.1, 0.19, 0.0199, true};
+
+  // p, then the state, of each update
+  auto run_all = [&](std::vector<std::vector<float>> &res) {
+    res.assign(9, {});
+    res[0] = p0, res[1] = s0;
+    sgd_kernel(res[0].data(), g.data(), res[1].data(), n, sgd);
+    for (int a = 0; a < 2; ++a) {
+      res[2 + 3 * a] = p0, res[3 + 3 * a] = s0, res[4 + 3 * a] = s1;
+      adam_kernel(res[2 + 3 * a].data(), g.data(), res[3 + 3 * a].data(),
+                  res[4 + 3 * a].data(), n, a ? adamw : adam);
+    }
+  };
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
+  std::vector<std::vector<float>> ref, got;
+  run_all(ref);
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > torchlet::core::max_cpu_capability())
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    run_all(got);
+    for (std::size_t r = 0; r < 8; ++r)
+      for (std::size_t k = 0; k < n; ++k)
+        EXPECT_NEAR(got[r][k], ref[r][k], 1e-5f * (1.0f + std::fabs(ref[r][k])))
+            << torchlet::core::to_string(cap) << " output " << r << " k=" << k;
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, RandomMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t n = 1027, split = 260; // partial batches, odd tail
+  const std::uint64_t seed = 0x123456789abcdefull, counter = 77;
+
+  // the whole draw, then the same draw in two chunks
+  auto run_all = [&](std::vector<std::vector<float>> &res) {
+    res.assign(4, std::vector<float>(n));
+    uniform_kernel(res[0].data(), n, seed, counter, -2.0f, 3.0f);
+    normal_kernel(res[1].data(), n, seed, counter, 1.0f, 2.0f);
+    for (std::size_t r = 0; r < 2; ++r) {
+      float *y = res[2 + r].data();
+      auto draw = [&](float *out, std::size_t c, std::uint64_t ctr) {
+        if (r == 0)
+          uniform_kernel(out, c, seed, ctr, -2.0f, 3.0f);
+        else
+          normal_kernel(out, c, seed, ctr, 1.0f, 2.0f);
+      };
+      draw(y, split, counter);
+      draw(y + split, n - split, counter + split / 4);
+    }
+  };
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
+  std::vector<std::vector<float>> ref, got;
+  run_all(ref);
+  EXPECT_EQ(ref[2], ref[0]);
+  EXPECT_EQ(ref[3], ref[1]);
+
+  // Philox4x32-10 known answer (Random123) : counter 0, key 0
+  std::vector<float> words(4);
+  uniform_kernel(words.data(), 4, 0, 0, 0.0f, 16777216.0f);
+  EXPECT_EQ(words, (std::vector<float>{float(0x6627e8d5u >> 8),
+                                       float(0xe169c58du >> 8),
+                                       float(0xbc57ac4cu >> 8),
+                                       float(0x9b00dbd8u >> 8)}));
+  std::vector<double> dwords(2);
+  uniform_kernel(dwords.data(), 2, 0, 0, 0.0, 9007199254740992.0);
+  EXPECT_EQ(dwords[0], double(0xe169c58d6627e8d5ull >> 11));
+  EXPECT_EQ(dwords[1], double(0x9b00dbd8bc57ac4cull >> 11));
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > torchlet::core::max_cpu_capability())
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    run_all(got);
+
+    const char *name = torchlet::core::to_string(cap);
+    EXPECT_EQ(got[2], got[0]) << name << " uniform chunks";
+    EXPECT_EQ(got[3], got[1]) << name << " normal chunks";
+    for (std::size_t k = 0; k < n; ++k) {
+      EXPECT_NEAR(got[0][k], ref[0][k], 1e-6f) << name << " uniform k=" << k;
+      EXPECT_NEAR(got[1][k], ref[1][k], 1e-5f * (1.0f + std::fabs(ref[1][k])))
+          << name << " normal k=" << k;
+    }
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
+
+TEST(KernelSimdTest, DropoutMatchesScalarReference) {
+  using torchlet::core::CpuCapability;
+
+  const CpuCapability saved = torchlet::core::cpu_capability();
+  const std::size_t n = 1031, split = 261; // split off a word boundary
+  const DropoutStep step{0.35, 0xfeedbeefull, 11};
+  std::vector<float> x(n);
+  for (std::size_t k = 0; k < n; ++k)
+    x[k] = 0.25f * float(k % 17) - 2.0f;
+
+  // the whole sweep, the same sweep in two chunks, then accumulated on x
+  auto run_all = [&](std::vector<std::vector<float>> &res) {
+    res.assign(3, std::vector<float>(n));
+    dropout_kernel(x.data(), res[0].data(), n, 0, step, false);
+    dropout_kernel(x.data(), res[1].data(), split, 0, step, false);
+    dropout_kernel(x.data() + split, res[1].data() + split, n - split, split,
+                   step, false);
+    res[2] = x;
+    dropout_kernel(x.data(), res[2].data(), n, 0, step, true);
+  };
+
+  torchlet::core::set_cpu_capability(CpuCapability::Default);
+  std::vector<std::vector<float>> ref, got;
+  run_all(ref);
+  EXPECT_EQ(ref[1], ref[0]);
+  std::size_t kept = 0;
+  for (std::size_t k = 0; k < n; ++k) {
+    kept += ref[0][k] != 0.0f || x[k] == 0.0f;
+    EXPECT_EQ(ref[2][k], x[k] + ref[0][k]) << "k=" << k;
+  }
+  EXPECT_NEAR(double(kept) / double(n), 0.65, 0.05);
+
+  std::vector<float> y(n);
+  dropout_kernel(x.data(), y.data(), n, 0, DropoutStep{0.0, 1, 0}, false);
+  EXPECT_EQ(y, x);
+  dropout_kernel(x.data(), y.data(), n, 0, DropoutStep{1.0, 1, 0}, false);
+  EXPECT_EQ(y, std::vector<float>(n));
+
+  for (auto cap :
+       {CpuCapability::SSE4, CpuCapability::AVX2, CpuCapability::AVX512}) {
+    if (cap > torchlet::core::max_cpu_capability())
+      continue;
+    torchlet::core::set_cpu_capability(cap);
+    run_all(got);
+    EXPECT_EQ(got, ref) << torchlet::core::to_string(cap);
+  }
+
+  torchlet::core::set_cpu_capability(saved);
+};
@@ -0,0 +1,61 @@
+#include "utils/utils.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::module::LayerNorm,
+    torchlet::module::RMSNorm, torchlet::core::Dtype;
+
+template <typename T> class LayerNormTypedTest : public ::testing::Test {};
+using MyTypes = ::testing::Types<float, double>;
+TYPED_TEST_SUITE(LayerNormTypedTest, MyTypes);
+
+TYPED_TEST(LayerNormTypedTest, ForwardMatchesOps) {
+
+  using T = TypeParam;
+  const size_t dim = 19;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  LayerNorm ln(dim, 1e-5, true, dt);
+  RMSNorm rms(dim, 1e-6, dt);
+  torchlet::ops::init::normal_(ln.weight(), T{1}, T{0.1});
+  torchlet::ops::init::normal_(ln.bias(), T{0}, T{0.1});
+  torchlet::ops::init::normal_(rms.weight(), T{1}, T{0.1});
+
+  Tensor x({4, dim}, dt);
+  torchlet::ops::init::normal_(x, T{0}, T{1});
+
+  const Tensor a = ln.forward(x);
+  const Tensor b = torchlet::ops::layer_norm(x, ln.weight(), ln.bias());
+  const Tensor c = rms.forward(x);
+  const Tensor d = torchlet::ops::rms_norm(x, rms.weight());
+  Tensor out({4, dim}, dt);
+  rms.forward_out(x, out);
+  for (size_t i = 0; i < 4 * dim; ++i) {
+    EXPECT_EQ(a.data_ptr<T>()[i], b.data_ptr<T>()[i]);
+    EXPECT_EQ(c.data_ptr<T>()[i], d.data_ptr<T>()[i]);
+    EXPECT_EQ(out.data_ptr<T>()[i], d.data_ptr<T>()[i]);
+  }
+};
+
+TYPED_TEST(LayerNormTypedTest, StateDictRoundTrip) {
+
+  using T = TypeParam;
+  const size_t dim = 8;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  LayerNorm src(dim, 1e-5, true, dt), dst(dim, 1e-5, true, dt);
+  torchlet::ops::init::normal_(src.weight(), T{0}, T{1});
+  torchlet::ops::init::normal_(src.bias(), T{0}, T{1});
+  dst.load_state_dict(src.state_dict());
+  for (size_t k = 0; k < dim; ++k) {
+    EXPECT_EQ(dst.weight().data_ptr<T>()[k], src.weight().data_ptr<T>()[k]);
+    EXPECT_EQ(dst.bias().data_ptr<T>()[k], src.bias().data_ptr<T>()[k]);
+  }
+
+  EXPECT_TRUE(LayerNorm(dim, 1e-5, false, dt).state_dict().empty());
+
+  RMSNorm wrong(dim + 1, 1e-6, dt);
+  EXPECT_THROW(wrong.load_state_dict(src.state_dict()), std::invalid_argument);
+  EXPECT_THROW(RMSNorm(dim, 1e-6, Dtype::Int32), std::invalid_argument);
+};
@@ -241,4 +241,98 @@ TEST(LinearTest, ForwardNonContiguous) {
   torchlet::ops::init::uniform_(lin.weights(), 0.0f, 0.0f);
 
   EXPECT_THROW(lin.forward(x), std::runtime_error);
-};
\ No newline at end of file
+};
+TYPED_TEST(LinearTypedTest, ForwardBatchedMatchesRowwise) {
+  using T = TypeParam;
+  const std::size_t B = 16, in = 300, out = 70;
+  const auto dt = CPPTypeToDType<T>::dtype;
+
+  Linear lin(in, out, true, dt);
+
+  Tensor x({B, in}, dt);
+  torchlet::ops::init::uniform_(x, T{-1}, T{1});
+
+  Tensor y = lin.forward(x);
+  ASSERT_EQ(y.shape(), (std::vector<std::size_t>{B, out}));
+
+  std::vector<T> expected(out);
+  for (std::size_t b = 0; b < B; ++b) {
+    mvb_kernel(lin.weights().template data_ptr<T>(),
+               x.data_ptr<T>() + b * in, lin.bias().template data_ptr<T>(),
+               expected.data(), out, in);
+    for (std::size_t j = 0; j < out; ++j)
+      EXPECT_NEAR(y.data_ptr<T>()[b * out + j], expected[j], T(1e-4))
+          << "b=" << b << " j=" << j;
+  }
+};
+
+TEST(LinearTest, MixedPrecisionMatchesFloat) {
+  // One row takes the GEMV path on Float16 / BFloat16 weights, 8 rows the
+  // widened GEMM path.
+  for (auto wdt : {Dtype::Float16, Dtype::BFloat16})
+    for (std::size_t B : {1u, 8u}) {
+      const std::size_t in = 130, out = 21;
+      Linear lin(in, out, true, wdt);
+      const Tensor w32 = lin.weights().to(Dtype::Float32);
+      const Tensor b32 = lin.bias().to(Dtype::Float32);
+
+      Tensor x({B, in}, Dtype::Float32);
+      torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+
+      Tensor y = lin.forward(x);
+      EXPECT_EQ(y.dtype(), Dtype::Float32);
+      Tensor ey = torchlet::ops::linear(x, w32, b32);
+      for (std::size_t k = 0; k < y.numel(); ++k)
+        EXPECT_NEAR(y.data_ptr<float>()[k], ey.data_ptr<float>()[k], 1e-4f)
+            << "B=" << B << " k=" << k;
+
+      // reduced input and output, activation fused in float
+      Tensor xh = x.to(wdt);
+      Tensor yh = torchlet::ops::linear_relu(xh, lin.weights(), lin.bias());
+      EXPECT_EQ(yh.dtype(), wdt);
+      Tensor eyh = torchlet::ops::linear_relu(xh.to(Dtype::Float32), w32, b32)
+                       .to(wdt)
+                       .to(Dtype::Float32);
+      Tensor got = yh.to(Dtype::Float32);
+      for (std::size_t k = 0; k < got.numel(); ++k)
+        EXPECT_NEAR(got.data_ptr<float>()[k], eyh.data_ptr<float>()[k], 2e-2f)
+            << "B=" << B << " k=" << k;
+    }
+};
+
+TEST(LinearTest, QuantizedMatchesFloat) {
+  // Rows below and above the 4-row block of the kernel, a 3D batch.
+  for (std::size_t B : {1u, 6u}) {
+    const std::size_t in = 130, out = 21;
+    Linear lin(in, out, true, Dtype::Float32);
+    const torchlet::module::QuantizedLinear qlin = lin.quantize();
+
+    // dequantized weights are within half a step of the float ones
+    const Tensor wq = qlin.dequantize();
+    const float *scales = qlin.scales().data_ptr<float>();
+    for (std::size_t k = 0; k < wq.numel(); ++k)
+      EXPECT_LE(std::fabs(wq.data_ptr<float>()[k] -
+                          lin.weights().data_ptr<float>()[k]),
+                0.5f * scales[k / in] + 1e-7f);
+
+    Tensor x({B, 2, in}, Dtype::Float32);
+    torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+
+    Tensor y = qlin.forward(x);
+    EXPECT_EQ(y.shape(), (std::vector<std::size_t>{B, 2, out}));
+    Tensor ey = lin.forward(x);
+    for (std::size_t k = 0; k < y.numel(); ++k)
+      EXPECT_NEAR(y.data_ptr<float>()[k], ey.data_ptr<float>()[k], 3e-2f)
+          << "B=" << B << " k=" << k;
+  }
+
+  // 8 bit codes would saturate the SIMD pair sums
+  const torchlet::module::QuantizedLinear ok =
+      Linear(4, 2, false, Dtype::Float32).quantize();
+  Tensor codes({2, 4}, Dtype::UInt8);
+  codes.copy_(ok.weights());
+  codes.data_ptr<std::uint8_t>()[5] = 128;
+  EXPECT_THROW(torchlet::module::QuantizedLinear(codes, ok.scales(),
+                                                 ok.zero_points(), Tensor()),
+               std::invalid_argument);
+};
@@ -0,0 +1,205 @@
+#include "utils/utils.h"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::module::Linear;
+
+namespace {
+
+// Parameters of many sizes, one past a thread chunk, so that chunks start
+// and end inside parameters.
+template <typename T> std::vector<Tensor> make_params() {
+  const auto dt = CPPTypeToDType<T>::dtype;
+  std::vector<Tensor> params;
+  for (size_t n : {1, 7, 16, 33, 100, 3, 5, 64, 1, 19})
+    params.emplace_back(std::vector<size_t>{n}, dt);
+  params.emplace_back(std::vector<size_t>{3, torchlet::GRAIN_SIZE / 2 + 5},
+                      dt);
+  for (Tensor &p : params)
+    torchlet::ops::init::normal_(p, T{0}, T{1});
+  return params;
+};
+
+template <typename T>
+std::vector<Tensor> make_grads(const std::vector<Tensor> &params) {
+  std::vector<Tensor> grads;
+  for (const Tensor &p : params) {
+    grads.emplace_back(p.shape(), p.dtype());
+    torchlet::ops::init::normal_(grads.back(), T{0}, T{1});
+  }
+  return grads;
+};
+
+std::vector<std::vector<double>> values(const std::vector<Tensor> &ts) {
+  std::vector<std::vector<double>> v;
+  for (const Tensor &t : ts) {
+    v.emplace_back();
+    DISPATCH_FLOAT(t.dtype(), scalar_t, {
+      for (size_t i = 0; i < t.numel(); ++i)
+        v.back().push_back(double(t.data_ptr<scalar_t>()[i]));
+    })
+  }
+  return v;
+};
+
+template <typename T>
+void expect_params(const std::vector<Tensor> &params,
+                   const std::vector<std::vector<double>> &ref,
+                   const char *what) {
+  const double tol = std::is_same_v<T, float> ? 1e-5 : 1e-12;
+  for (size_t k = 0; k < params.size(); ++k)
+    for (size_t i = 0; i < params[k].numel(); ++i)
+      ASSERT_NEAR(double(params[k].data_ptr<T>()[i]), ref[k][i],
+                  tol * (1.0 + std::fabs(ref[k][i])))
+          << what << " param " << k << " i=" << i;
+};
+
+struct ThreadsGuard {
+  std::size_t saved = torchlet::get_num_threads();
+  ~ThreadsGuard() { torchlet::set_num_threads(saved); };
+};
+
+} // namespace
+
+template <typename T> class OptimTypedTest : public ::testing::Test {};
+using MyTypes = ::testing::Types<float, double>;
+TYPED_TEST_SUITE(OptimTypedTest, MyTypes);
+
+TYPED_TEST(OptimTypedTest, SGDMatchesReference) {
+  using T = TypeParam;
+  ThreadsGuard guard;
+  torchlet::set_num_threads(4);
+
+  for (bool nesterov : {false, true}) {
+    std::vector<Tensor> params = make_params<T>();
+    auto ref = values(params);
+    std::vector<std::vector<double>> buf;
+    for (const auto &p : ref)
+      buf.emplace_back(p.size(), 0.0);
+
+    const double lr = 0.1, mu = 0.9, wd = 0.01;
+    torchlet::optim::SGD sgd(params, lr, mu, wd, nesterov);
+    for (int s = 0; s < 3; ++s) {
+      const std::vector<Tensor> grads = make_grads<T>(params);
+      const auto g = values(grads);
+      sgd.step(grads);
+      for (size_t k = 0; k < ref.size(); ++k)
+        for (size_t i = 0; i < ref[k].size(); ++i) {
+          const double d = g[k][i] + wd * ref[k][i];
+          buf[k][i] = mu * buf[k][i] + d;
+          ref[k][i] -= lr * (nesterov ? d + mu * buf[k][i] : buf[k][i]);
+        }
+    }
+    EXPECT_EQ(sgd.steps(), 3u);
+    expect_params<T>(params, ref, nesterov ? "nesterov" : "momentum");
+  }
+};
+
+TYPED_TEST(OptimTypedTest, AdamMatchesReference) {
+  using T = TypeParam;
+  ThreadsGuard guard;
+  torchlet::set_num_threads(4);
+
+  for (bool decoupled : {false, true}) {
+    std::vector<Tensor> params = make_params<T>();
+    auto ref = values(params);
+    std::vector<std::vector<double>> m, v;
+    for (const auto &p : ref) {
+      m.emplace_back(p.size(), 0.0);
+      v.emplace_back(p.size(), 0.0);
+    }
+
+    const double lr = 1e-2, b1 = 0.9, b2 = 0.99, eps = 1e-8, wd = 0.1;
+    std::unique_ptr<torchlet::optim::Adam> adam;
+    if (decoupled)
+      adam = std::make_unique<torchlet::optim::AdamW>(params, lr, b1, b2, eps,
+                                                      wd);
+    else
+      adam = std::make_unique<torchlet::optim::Adam>(params, lr, b1, b2, eps,
+                                                     wd);
+    // parameter 2 has no gradient on the first step : its bias correction
+    // starts with its own first update
+    std::vector<int> t(ref.size(), 0);
+    for (int s = 1; s <= 3; ++s) {
+      std::vector<Tensor> grads = make_grads<T>(params);
+      if (s == 1)
+        grads[2] = Tensor();
+      const auto g = values(grads);
+      adam->step(grads);
+      for (size_t k = 0; k < ref.size(); ++k) {
+        if (s == 1 && k == 2)
+          continue;
+        ++t[k];
+        for (size_t i = 0; i < ref[k].size(); ++i) {
+          double &p = ref[k][i];
+          const double d = decoupled ? g[k][i] : g[k][i] + wd * p;
+          if (decoupled)
+            p *= 1.0 - lr * wd;
+          m[k][i] = b1 * m[k][i] + (1.0 - b1) * d;
+          v[k][i] = b2 * v[k][i] + (1.0 - b2) * d * d;
+          const double mh = m[k][i] / (1.0 - std::pow(b1, t[k]));
+          const double vh = v[k][i] / (1.0 - std::pow(b2, t[k]));
+          p -= lr * mh / (std::sqrt(vh) + eps);
+        }
+      }
+    }
+    EXPECT_EQ(adam->steps(), 3u);
+    EXPECT_EQ(adam->steps(2), 2u);
+    expect_params<T>(params, ref, decoupled ? "adamw" : "adam");
+  }
+};
+
+TEST(OptimTest, StepsFromAutogradGradients) {
+  Linear l1(4, 3, true, Dtype::Float64), l2(3, 2, false, Dtype::Float64);
+  l1.requires_grad_();
+  l2.requires_grad_();
+  std::vector<Tensor> params = l1.parameters();
+  for (const Tensor &p : l2.parameters())
+    params.push_back(p);
+  torchlet::optim::SGD sgd(params, 0.5);
+
+  Tensor x({5, 4}, Dtype::Float64);
+  torchlet::ops::init::normal_(x, 0.0, 1.0);
+  Tensor r({5, 2}, Dtype::Float64);
+  torchlet::ops::init::normal_(r, 0.0, 1.0);
+  torchlet::core::backward(l2.forward(torchlet::ops::relu(l1.forward(x))), r);
+
+  const auto before = values(params);
+  std::vector<Tensor> grads;
+  for (const Tensor &p : params)
+    grads.push_back(p.grad());
+  const auto g = values(grads);
+  sgd.step();
+  const auto after = values(params);
+  for (size_t k = 0; k < params.size(); ++k)
+    for (size_t i = 0; i < after[k].size(); ++i)
+      EXPECT_NEAR(after[k][i], before[k][i] - 0.5 * g[k][i], 1e-12);
+  EXPECT_EQ(l1.weights().data_ptr<double>(), params[0].data_ptr<double>());
+
+  sgd.zero_grad();
+  EXPECT_EQ(l1.weights().grad().storage_ptr(), nullptr);
+  sgd.step(); // no gradient left : nothing moves
+  const auto again = values(params);
+  EXPECT_EQ(again, after);
+};
+
+TEST(OptimTest, InvalidArguments) {
+  Tensor a({3}, Dtype::Float32), b({3}, Dtype::Float64);
+  EXPECT_THROW(torchlet::optim::SGD({a, b}, 0.1), std::invalid_argument);
+  EXPECT_THROW(torchlet::optim::SGD({Tensor({3}, Dtype::Int32)}, 0.1),
+               std::invalid_argument);
+  EXPECT_THROW(torchlet::optim::SGD({a}, -1.0), std::invalid_argument);
+  EXPECT_THROW(torchlet::optim::Adam({a}, 1e-3, 1.0), std::invalid_argument);
+
+  torchlet::optim::Adam adam({a});
+  EXPECT_THROW(adam.step({}), std::invalid_argument);
+  EXPECT_THROW(adam.step({Tensor({4}, Dtype::Float32)}),
+               std::invalid_argument);
+  EXPECT_THROW(adam.step({Tensor({3}, Dtype::Float64)}),
+               std::invalid_argument);
+  adam.step({Tensor()});
+  EXPECT_EQ(adam.steps(), 1u);
+};
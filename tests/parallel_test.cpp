@@ -0,0 +1,95 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+#include "utils/utils.h"
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype;
+
+// Restores the thread count so tests do not leak their configuration.
+struct NumThreadsGuard {
+  explicit NumThreadsGuard(std::size_t n) : saved(torchlet::get_num_threads()) {
+    torchlet::set_num_threads(n);
+  };
+  ~NumThreadsGuard() { torchlet::set_num_threads(saved); };
+  std::size_t saved;
+};
+
+TEST(ParallelTest, CoversRangeExactlyOnce) {
+  NumThreadsGuard guard(4);
+
+  const std::size_t n = 10007;
+  std::vector<std::atomic<int>> hits(n);
+
+  torchlet::parallel_for(0, n, 16, [&](std::size_t b, std::size_t e) {
+    EXPECT_TRUE(torchlet::in_parallel_region());
+    for (std::size_t i = b; i < e; ++i)
+      hits[i]++;
+  });
+
+  for (std::size_t i = 0; i < n; ++i)
+    EXPECT_EQ(hits[i].load(), 1) << "i=" << i;
+  EXPECT_FALSE(torchlet::in_parallel_region());
+};
+
+TEST(ParallelTest, SmallRangeStaysSerial) {
+  NumThreadsGuard guard(4);
+
+  int calls = 0;
+  torchlet::parallel_for(0, 100, 1000, [&](std::size_t b, std::size_t e) {
+    EXPECT_EQ(b, 0u);
+    EXPECT_EQ(e, 100u);
+    calls++;
+  });
+  EXPECT_EQ(calls, 1);
+};
+
+TEST(ParallelTest, NestedRunsSerially) {
+  NumThreadsGuard guard(3);
+
+  std::atomic<std::size_t> total{0};
+  torchlet::parallel_for(0, 64, 1, [&](std::size_t b, std::size_t e) {
+    for (std::size_t i = b; i < e; ++i)
+      torchlet::parallel_for(0, 32, 1, [&](std::size_t ib, std::size_t ie) {
+        total += ie - ib;
+      });
+  });
+  EXPECT_EQ(total.load(), 64u * 32u);
+};
+
+TEST(ParallelTest, PropagatesExceptions) {
+  NumThreadsGuard guard(4);
+
+  EXPECT_THROW(torchlet::parallel_for(0, 1000, 1,
+                                      [](std::size_t b, std::size_t) {
+                                        if (b == 0)
+                                          throw std::runtime_error("boom");
+                                      }),
+               std::runtime_error);
+  EXPECT_THROW(torchlet::set_num_threads(0), std::invalid_argument);
+};
+
+TEST(ParallelTest, OpsMatchSerial) {
+  const std::size_t B = 257, in = 96, out = 130;
+  torchlet::module::Linear lin(in, out, true, Dtype::Float32);
+
+  Tensor x({B, in}, Dtype::Float32);
+  torchlet::ops::init::normal_(x, 0.0f, 1.0f);
+
+  std::vector<Tensor> serial, parallel;
+  for (std::size_t nt : {std::size_t{1}, std::size_t{4}}) {
+    NumThreadsGuard guard(nt);
+    Tensor y = lin.forward(x);
+    auto &res = (nt == 1) ? serial : parallel;
+    res.push_back(y);
+    res.push_back(torchlet::ops::gelu(y));
+    res.push_back(torchlet::ops::softmax(y));
+    res.push_back(torchlet::ops::log_softmax(y));
+  }
+
+  for (std::size_t k = 0; k < serial.size(); ++k)
+    expect_array_equal(parallel[k].data_ptr<float>(),
+                       serial[k].data_ptr<float>(), serial[k].numel());
+};
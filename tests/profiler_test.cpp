@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype,
+    torchlet::core::ProfileEvent, torchlet::module::Linear;
+
+static std::vector<ProfileEvent> named(const std::vector<ProfileEvent> &all,
+                                       const std::string &name) {
+  std::vector<ProfileEvent> out;
+  std::copy_if(all.begin(), all.end(), std::back_inserter(out),
+               [&](const ProfileEvent &e) { return e.name == name; });
+  return out;
+};
+
+TEST(ProfilerTest, DisabledRecordsNothing) {
+  torchlet::core::start_profiling();
+  torchlet::core::stop_profiling();
+
+  Tensor x = Tensor::ones({2, 8}, Dtype::Float32);
+  torchlet::ops::gelu(x);
+  EXPECT_TRUE(torchlet::core::profile_events().empty());
+};
+
+TEST(ProfilerTest, RecordsOpsNestedInModules) {
+  const std::size_t B = 4, in = 16, out = 8;
+  Linear lin(in, out, true, Dtype::Float32);
+  Tensor x = Tensor::ones({B, in}, Dtype::Float32);
+
+  torchlet::core::start_profiling();
+  Tensor y = lin.forward(x);
+  torchlet::ops::gelu(y);
+  Tensor h({B, out}, Dtype::Float32);
+  torchlet::ops::add_out(y, y, h);
+  torchlet::core::stop_profiling();
+
+  const auto events = torchlet::core::profile_events();
+  const auto fwd = named(events, "Linear::forward");
+  const auto lin_op = named(events, "linear");
+  ASSERT_EQ(fwd.size(), 1u);
+  // linear calling linear_out is one event, with the cost of linear_out
+  ASSERT_EQ(lin_op.size(), 1u);
+  EXPECT_EQ(fwd[0].depth, 0u);
+  EXPECT_EQ(lin_op[0].depth, 1u);
+  EXPECT_LE(fwd[0].start_ns, lin_op[0].start_ns);
+  EXPECT_GE(fwd[0].duration_ns, lin_op[0].duration_ns);
+  EXPECT_DOUBLE_EQ(lin_op[0].flops, 2.0 * B * in * out);
+  EXPECT_DOUBLE_EQ(lin_op[0].bytes, 4.0 * (B * in + out * in + out + B * out));
+  EXPECT_EQ(lin_op[0].shapes, "[4, 16] [8, 16] [8] [4, 8]");
+  // the result of forward is allocated inside the scope
+  EXPECT_GE(fwd[0].n_allocs, 1u);
+  EXPECT_GE(fwd[0].alloc_bytes, 4u * B * out);
+
+  const auto gelu = named(events, "gelu");
+  ASSERT_EQ(gelu.size(), 1u);
+  EXPECT_EQ(gelu[0].n_allocs, 1u);
+  const auto add = named(events, "add");
+  ASSERT_EQ(add.size(), 1u);
+  EXPECT_EQ(add[0].n_allocs, 0u);
+  EXPECT_DOUBLE_EQ(add[0].flops, double(B * out));
+};
+
+TEST(ProfilerTest, ExportsTraceAndTable) {
+  Tensor a = Tensor::ones({3, 5}, Dtype::Float32);
+  Tensor b = Tensor::ones({5, 2}, Dtype::Float32);
+  torchlet::core::start_profiling();
+  for (int k = 0; k < 3; ++k)
+    torchlet::ops::matmul(a, b);
+  torchlet::core::stop_profiling();
+
+  const std::string table = torchlet::core::profile_table();
+  EXPECT_NE(table.find("matmul"), std::string::npos);
+
+  const std::string path = ::testing::TempDir() + "torchlet_trace.json";
+  torchlet::core::export_chrome_trace(path);
+  std::ifstream in(path);
+  std::string json((std::istreambuf_iterator<char>(in)), {});
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\"", 0), 0u);
+  std::size_t n = 0;
+  for (std::size_t p = json.find("\"ph\": \"X\""); p != std::string::npos;
+       p = json.find("\"ph\": \"X\"", p + 1))
+    ++n;
+  EXPECT_EQ(n, 3u);
+  EXPECT_NE(json.find("\"shapes\": \"[3, 5] [5, 2] [3, 2]\""),
+            std::string::npos);
+  std::remove(path.c_str());
+
+  EXPECT_THROW(torchlet::core::export_chrome_trace("/nonexistent/dir/t.json"),
+               std::runtime_error);
+};
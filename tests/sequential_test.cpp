@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <memory>
+
+#include "utils/utils.h"
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype, torchlet::module::Linear,
+    torchlet::module::Sequential;
+
+static void expect_near(const Tensor &a, const Tensor &b, float tol = 1e-5f) {
+  ASSERT_EQ(a.shape(), b.shape());
+  for (std::size_t k = 0; k < a.numel(); ++k)
+    EXPECT_NEAR(a.data_ptr<float>()[k], b.data_ptr<float>()[k], tol)
+        << "k=" << k;
+};
+
+TEST(SequentialTest, MatchesLayerByLayer) {
+  Linear l1(6, 16, true, Dtype::Float32), l2(16, 16, false, Dtype::Float32),
+      l3(16, 5, true, Dtype::Float32);
+  Sequential seq;
+  seq.add(l1).add(Activation::GELU).add(l2).add(Activation::ReLU).add(l3).add(
+      Activation::Softmax);
+  EXPECT_EQ(seq.size(), 6u);
+
+  // one row takes the GEMV path, 2 x 4 rows the GEMM path
+  for (auto shape : {std::vector<std::size_t>{6},
+                     std::vector<std::size_t>{2, 4, 6}}) {
+    Tensor x(shape, Dtype::Float32);
+    torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+
+    Tensor ref = torchlet::ops::softmax(l3.forward(torchlet::ops::relu(
+        l2.forward(torchlet::ops::gelu(l1.forward(x))))));
+    expect_near(seq.forward(x), ref);
+    expect_near(seq.forward(x), ref); // planned
+  }
+};
+
+TEST(SequentialTest, StandaloneActivations) {
+  Linear l1(8, 8, true, Dtype::Float32);
+  Sequential seq;
+  // leading activation out of place, trailing ones in place then into out
+  seq.add(Activation::ReLU).add(l1).add(Activation::GELU).add(
+      Activation::ReLU);
+
+  Tensor x({3, 8}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+  Tensor x0(x.shape(), x.dtype());
+  x0.copy_(x);
+  Tensor ref = torchlet::ops::relu(
+      torchlet::ops::gelu(l1.forward(torchlet::ops::relu(x))));
+  expect_near(seq.forward(x), ref);
+  expect_near(x, x0, 0.0f); // input untouched
+
+  Sequential act_only;
+  act_only.add(Activation::Softmax);
+  expect_near(act_only.forward(x), torchlet::ops::softmax(x));
+  Sequential empty;
+  expect_near(empty.forward(x), x, 0.0f);
+};
+
+TEST(SequentialTest, PlanSharesMemoryAndStopsAllocating) {
+  Sequential seq;
+  seq.add(Linear(8, 32, true, Dtype::Float32))
+      .add(Activation::ReLU)
+      .add(Linear(32, 32, true, Dtype::Float32))
+      .add(Linear(32, 32, true, Dtype::Float32))
+      .add(Activation::GELU)
+      .add(Linear(32, 4, true, Dtype::Float32));
+
+  Tensor x({16, 8}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+  Tensor out({16, 4}, Dtype::Float32);
+  seq.forward_out(x, out);
+  Tensor first(out.shape(), out.dtype());
+  first.copy_(out);
+
+  // three 16 x 32 intermediates, at most two alive at a time
+  EXPECT_EQ(seq.workspace_bytes(), 2 * 16 * 32 * sizeof(float));
+
+  auto &alloc = torchlet::core::caching_allocator();
+  const auto before = alloc.stats();
+  seq.forward_out(x, out);
+  const auto after = alloc.stats();
+  EXPECT_EQ(after.n_fresh + after.n_reused, before.n_fresh + before.n_reused);
+  expect_near(out, first, 0.0f);
+
+  // another shape replans
+  Tensor x2({3, 8}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x2, -1.0f, 1.0f);
+  EXPECT_EQ(seq.forward(x2).shape(), (std::vector<std::size_t>{3, 4}));
+  EXPECT_EQ(seq.workspace_bytes(), 2 * 3 * 32 * sizeof(float));
+};
+
+TEST(SequentialTest, StateDictNamesFollowLayerIndex) {
+  Sequential seq;
+  seq.add(Linear(4, 3, true, Dtype::Float32))
+      .add(Activation::ReLU)
+      .add(Linear(3, 2, false, Dtype::Float32));
+  const auto state = seq.state_dict();
+  ASSERT_EQ(state.size(), 3u);
+  EXPECT_EQ(state.count("0.weight"), 1u);
+  EXPECT_EQ(state.count("0.bias"), 1u);
+  EXPECT_EQ(state.count("2.weight"), 1u);
+
+  Sequential other;
+  other.add(Linear(4, 3, true, Dtype::Float32))
+      .add(Activation::ReLU)
+      .add(Linear(3, 2, false, Dtype::Float32));
+  other.load_state_dict(state);
+  Tensor x({5, 4}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+  expect_near(other.forward(x), seq.forward(x), 0.0f);
+};
+
+TEST(SequentialTest, CopiesPlanTheirOwnWorkspace) {
+  Tensor x({3, 4}, Dtype::Float32);
+  torchlet::ops::init::uniform_(x, -1.0f, 1.0f);
+
+  auto a = std::make_unique<Sequential>();
+  a->add(Linear(4, 8, true, Dtype::Float32))
+      .add(Activation::GELU)
+      .add(Linear(8, 2, true, Dtype::Float32));
+  const Tensor ya = a->forward(x); // planned before the copies
+
+  auto zeros = a->state_dict();
+  for (auto &[name, t] : zeros) {
+    t = Tensor(t.shape(), t.dtype());
+    t.fill_(0.0f);
+  }
+  Tensor y0(ya.shape(), ya.dtype());
+  y0.fill_(0.0f);
+
+  Sequential b(*a), c;
+  c = *a;
+  EXPECT_EQ(b.workspace_bytes(), 0u);
+  b.load_state_dict(zeros);
+  c.load_state_dict(zeros);
+  a.reset(); // the copies must not reach into it
+  expect_near(b.forward(x), y0, 0.0f);
+  expect_near(c.forward(x), y0, 0.0f);
+};
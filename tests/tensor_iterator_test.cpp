@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "utils/utils.h"
+#include <torchlet/iterator/tensor_iterator.h>
+#include <torchlet/torchlet.h>
+
+using torchlet::core::Tensor, torchlet::core::Dtype,
+    torchlet::iterator::TensorIterator;
+namespace idx = torchlet::core::index;
+
+TEST(TensorIteratorTest, ContiguousCoalescesToOneRun) {
+  Tensor a({2, 3, 4}, Dtype::Float32), b({2, 3, 4}, Dtype::Float32);
+  TensorIterator it(&a, {&b});
+
+  EXPECT_EQ(it.ndim(), 1u);
+  EXPECT_EQ(it.numel(), 24u);
+  EXPECT_TRUE(it.is_contiguous());
+};
+
+TEST(TensorIteratorTest, PermutedReordersToOneRun) {
+  Tensor t({2, 3, 4}, Dtype::Float32);
+  Tensor p = t.permute(0, 2);
+  TensorIterator it(&p, {});
+
+  EXPECT_EQ(it.ndim(), 1u);
+  EXPECT_TRUE(it.is_contiguous());
+};
+
+TEST(TensorIteratorTest, SliceKeepsOuterDim) {
+  Tensor t({4, 6}, Dtype::Float32);
+  Tensor s = t.index({idx::Slice(0, 4), idx::Slice(1, 4)});
+  TensorIterator it(&s, {});
+
+  EXPECT_EQ(it.ndim(), 2u);
+  EXPECT_EQ(it.numel(), 12u);
+  EXPECT_FALSE(it.is_contiguous());
+};
+
+TEST(TensorIteratorTest, VisitsEveryElementOnce) {
+  Tensor t = Tensor::zeros({5, 7, 3}, Dtype::Float32);
+  Tensor p = t.permute(1, 2).index(
+      {idx::Slice(1, 5), idx::Slice(0, 3), idx::Slice(2, 7)});
+
+  TensorIterator it(&p, {});
+  it.parallel_for_each(
+      [](std::uint8_t **data, const std::ptrdiff_t *strides, std::size_t n) {
+        std::uint8_t *ptr = data[0];
+        for (std::size_t k = 0; k < n; ++k, ptr += strides[0])
+          *reinterpret_cast<float *>(ptr) += 1.0f;
+      },
+      1);
+
+  float total = 0;
+  const float *d = t.data_ptr<float>();
+  for (std::size_t i = 0; i < t.numel(); ++i) {
+    EXPECT_TRUE(d[i] == 0.0f || d[i] == 1.0f);
+    total += d[i];
+  }
+  EXPECT_EQ(total, static_cast<float>(p.numel()));
+};
+
+TEST(TensorIteratorTest, BroadcastInputsGetZeroStrides) {
+  Tensor out({6, 8}, Dtype::Float32), bias({8}, Dtype::Float32),
+      s({1}, Dtype::Float32);
+
+  TensorIterator row(&out, {&bias});
+  EXPECT_EQ(row.ndim(), 2u); // one unit stride run per bias row
+
+  TensorIterator scalar(&out, {&s});
+  EXPECT_EQ(scalar.ndim(), 1u);
+  scalar.for_each(
+      [](std::uint8_t **, const std::ptrdiff_t *strides, std::size_t n) {
+        EXPECT_EQ(n, 48u);
+        EXPECT_EQ(strides[1], 0);
+      });
+
+  Tensor bad({6}, Dtype::Float32);
+  EXPECT_THROW(TensorIterator(&out, {&bad}), std::invalid_argument);
+};
+
+TEST(TensorIteratorTest, RowsOfPermutedView) {
+  Tensor t({3, 5}, Dtype::Float32);
+  Tensor p = t.permute(0, 1);
+  TensorIterator it = TensorIterator::rows(&p, {});
+
+  EXPECT_EQ(it.numel(), 5u);
+  EXPECT_EQ(it.row_size(), 3u);
+  EXPECT_EQ(it.row_stride(0), static_cast<std::ptrdiff_t>(5 * sizeof(float)));
+};
+
+TEST(TensorIteratorTest, ContiguousCopiesStridedView) {
+  Tensor t({2, 3}, Dtype::Float64);
+  for (std::size_t i = 0; i < 6; ++i)
+    t.data_ptr<double>()[i] = static_cast<double>(i);
+
+  Tensor c = t.permute(0, 1).contiguous();
+  EXPECT_TRUE(c.is_contiguous());
+  EXPECT_NE(c.storage_ptr(), t.storage_ptr());
+  const std::vector<double> expected{0, 3, 1, 4, 2, 5};
+  expect_array_equal(c.data_ptr<double>(), expected.data(), expected.size());
+
+  Tensor same = t.contiguous();
+  EXPECT_EQ(same.storage_ptr(), t.storage_ptr());
+};
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <gtest/gtest.h>
 #include <limits>
 
@@ -185,4 +186,42 @@ TEST_P(SizeParam, ZerosNumelAndFill) {
 
   expect_array_equal(ptr, std::vector<float>(t.numel(), 5.0f).data(),
                      t.numel());
-};
\ No newline at end of file
+};
+TEST(TensorTest, HalfAndBFloat16Conversions) {
+  using torchlet::core::Half, torchlet::core::BFloat16;
+
+  EXPECT_EQ(Half(1.0f).bits, 0x3c00);
+  EXPECT_EQ(Half(-2.5f).bits, 0xc100);
+  EXPECT_EQ(Half(65504.0f).bits, 0x7bff);
+  EXPECT_EQ(Half(65520.0f).bits, 0x7c00); // rounds to inf
+  EXPECT_EQ(Half(5.9604645e-8f).bits, 0x0001); // smallest subnormal
+  EXPECT_EQ(Half(1.0f + 1.0f / 2048).bits, 0x3c00); // tie to even
+  EXPECT_EQ(static_cast<float>(Half::from_bits(0x0001)), 5.9604645e-8f);
+  EXPECT_TRUE(std::isnan(static_cast<float>(
+      Half(std::numeric_limits<float>::quiet_NaN()))));
+
+  EXPECT_EQ(BFloat16(1.0f).bits, 0x3f80);
+  EXPECT_EQ(BFloat16(1.0f + 1.0f / 256).bits, 0x3f80); // tie to even
+  EXPECT_EQ(BFloat16(1.0f + 3.0f / 256).bits, 0x3f82);
+  EXPECT_EQ(static_cast<float>(BFloat16::from_bits(0xc040)), -3.0f);
+};
+
+TEST(TensorTest, ToConvertsDtype) {
+  Tensor t({3, 5}, Dtype::Float32);
+  for (std::size_t k = 0; k < t.numel(); ++k)
+    t.data_ptr<float>()[k] = static_cast<float>(k) * 0.25f - 1.0f;
+
+  for (auto dt : {Dtype::Float16, Dtype::BFloat16}) {
+    Tensor h = t.to(dt);
+    EXPECT_EQ(h.dtype(), dt);
+    Tensor back = h.permute(0, 1).to(Dtype::Float32);
+    for (std::size_t i = 0; i < 3; ++i)
+      for (std::size_t j = 0; j < 5; ++j)
+        EXPECT_EQ(back.data_ptr<float>()[j * 3 + i],
+                  t.data_ptr<float>()[i * 5 + j]); // exact in both formats
+  }
+
+  Tensor i = t.to(Dtype::Int32);
+  EXPECT_EQ(i.data_ptr<int32_t>()[14], 2);
+  EXPECT_EQ(t.to(Dtype::Float32).storage_ptr(), t.storage_ptr());
+};